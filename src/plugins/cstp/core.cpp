@@ -49,9 +49,11 @@
 #include <interfaces/idownload.h>
 #include <util/util.h>
 #include <util/sll/prelude.h>
+#include <util/threads/futures.h>
 #include <util/xpc/notificationactionhandler.h>
 #include <util/xpc/util.h>
 #include "task.h"
+#include "filewriter.h"
 #include "xmlsettingsmanager.h"
 #include "addtask.h"
 
@@ -69,6 +71,15 @@ extern "C"
 	#endif
 }
 
+namespace
+{
+	/* Segmented tasks report their progress every few seconds, but
+	 * rewriting all the tasks that often is too much just to survive a
+	 * crash.
+	 */
+	const int ProgressSaveInterval = 30 * 1000;
+}
+
 namespace LeechCraft
 {
 namespace CSTP
@@ -77,11 +88,23 @@ namespace CSTP
 	: Headers_ { "URL", tr ("State"), tr ("Progress") }
 	, SaveScheduled_ (false)
 	, Toolbar_ (0)
+	, Writer_
+	{
+		new FileWriter,
+		[] (FileWriter *writer)
+		{
+			writer->quit ();
+			writer->wait ();
+			delete writer;
+		}
+	}
 	{
 		setObjectName ("CSTP Core");
 		qRegisterMetaType<std::shared_ptr<QFile>> ("std::shared_ptr<QFile>");
 		qRegisterMetaType<QNetworkReply*> ("QNetworkReply*");
 
+		Writer_->start ();
+
 		ReadSettings ();
 	}
 
@@ -93,7 +116,26 @@ namespace CSTP
 
 	void Core::Release ()
 	{
+		/* Stopping schedules closing the files, and the segments left
+		 * are saved below. The aborted replies aren't failures to report.
+		 */
+		for (const auto& td : ActiveTasks_)
+		{
+			disconnect (td.Task_.get (),
+					0,
+					this,
+					0);
+			if (td.Task_->IsRunning ())
+				td.Task_->Stop ();
+		}
+
 		writeSettings ();
+
+		/* Quitting the writer drops the operations still queued, so it
+		 * is only quit once everything scheduled so far is done.
+		 */
+		Writer_->ScheduleImpl ([] {}).waitForFinished ();
+		Writer_.reset ();
 	}
 
 	void Core::SetCoreProxy (ICoreProxy_ptr proxy)
@@ -416,6 +458,11 @@ namespace CSTP
 		return NetworkAccessManager_;
 	}
 
+	FileWriter* Core::GetFileWriter () const
+	{
+		return Writer_.get ();
+	}
+
 	bool Core::HasFinishedReply (QNetworkReply *rep) const
 	{
 		return FinishedReplies_.contains (rep);
@@ -582,6 +629,26 @@ namespace CSTP
 		TaskDescr selected = TaskAt (i);
 		if (selected.Task_->IsRunning ())
 			return;
+
+		// The file of a just stopped task is reopened once it's closed.
+		const auto& pendingClose = selected.Task_->GetPendingClose ();
+		if (!pendingClose.isFinished ())
+		{
+			const std::weak_ptr<Task> weakTask = selected.Task_;
+			Util::Sequence (this, pendingClose) >>
+					[this, weakTask] (const WriteResult&)
+					{
+						const auto task = weakTask.lock ();
+						if (!task)
+							return;
+
+						const auto pos = FindTask (task.get ());
+						if (pos != ActiveTasks_.end ())
+							startTriggered (std::distance (ActiveTasks_.begin (), pos));
+					};
+			return;
+		}
+
 		if (!selected.File_->open (QIODevice::ReadWrite))
 		{
 			QString msg = tr ("Could not open file %1: %2")
@@ -608,7 +675,9 @@ namespace CSTP
 		if (!selected.Task_->IsRunning ())
 			return;
 		selected.Task_->Stop ();
-		selected.File_->close ();
+
+		if (selected.Task_->IsSegmented ())
+			ScheduleSave ();
 	}
 
 	void Core::startAllTriggered ()
@@ -637,8 +706,6 @@ namespace CSTP
 		QString errorStr = taskdscr->Task_->GetErrorString ();
 		QStringList tags = taskdscr->Tags_;
 
-		taskdscr->File_->close ();
-
 		bool notifyUser = !(taskdscr->Parameters_ & LeechCraft::DoNotNotifyUser) &&
 				!(taskdscr->Parameters_ & LeechCraft::Internal);
 
@@ -728,6 +795,11 @@ namespace CSTP
 
 		int pos = std::distance<tasks_t::const_iterator> (ActiveTasks_.begin (), it);
 		emit dataChanged (index (pos, 0), index (pos, columnCount () - 1));
+
+		// Keep the per-segment progress saved in case of a crash.
+		if (it->Task_->IsSegmented () &&
+				(!SinceLastSave_.isValid () || SinceLastSave_.elapsed () >= ProgressSaveInterval))
+			ScheduleSave ();
 	}
 
 	void Core::writeSettings ()
@@ -751,6 +823,7 @@ namespace CSTP
 			settings.setValue ("Tags", i->Tags_);
 		}
 		SaveScheduled_ = false;
+		SinceLastSave_.start ();
 		settings.endArray ();
 	}
 
@@ -808,6 +881,7 @@ namespace CSTP
 		if (SaveScheduled_)
 			return;
 
+		SaveScheduled_ = true;
 		QTimer::singleShot (100, this, SLOT (writeSettings ()));
 	}
 
@@ -37,6 +37,7 @@
 #include <QNetworkAccessManager>
 #include <QSet>
 #include <QUrl>
+#include <QElapsedTimer>
 #include <interfaces/iinfo.h>
 #include <interfaces/structures.h>
 #include <interfaces/idownload.h>
@@ -59,6 +60,7 @@ namespace LeechCraft
 namespace CSTP
 {
 	class Task;
+	class FileWriter;
 
 	class Core : public QAbstractItemModel
 	{
@@ -79,11 +81,13 @@ namespace CSTP
 		typedef std::vector<TaskDescr> tasks_t;
 		tasks_t ActiveTasks_;
 		bool SaveScheduled_;
+		QElapsedTimer SinceLastSave_;
 		QNetworkAccessManager *NetworkAccessManager_;
 		QToolBar *Toolbar_;
 		QSet<QNetworkReply*> FinishedReplies_;
 		QModelIndex Selected_;
 		ICoreProxy_ptr CoreProxy_;
+		std::shared_ptr<FileWriter> Writer_;
 
 		explicit Core ();
 	public:
@@ -114,6 +118,7 @@ namespace CSTP
 		QAbstractItemModel* GetRepresentationModel ();
 		void SetNetworkAccessManager (QNetworkAccessManager*);
 		QNetworkAccessManager* GetNetworkAccessManager () const;
+		FileWriter* GetFileWriter () const;
 		bool HasFinishedReply (QNetworkReply*) const;
 		void RemoveFinishedReply (QNetworkReply*);
 
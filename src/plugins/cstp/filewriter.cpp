@@ -0,0 +1,151 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "filewriter.h"
+#include <algorithm>
+#include <QFile>
+#include <QCoreApplication>
+
+namespace LeechCraft
+{
+namespace CSTP
+{
+	namespace
+	{
+		QString MakeWriteError (const QFile& file)
+		{
+			return QCoreApplication::translate ("LeechCraft::CSTP::FileWriter",
+						"Error writing to file %1: %2")
+					.arg (file.fileName ())
+					.arg (file.errorString ());
+		}
+	}
+
+	QFuture<WriteResult> FileWriter::Write (const std::shared_ptr<QFile>& file,
+			qint64 pos, const QByteArray& data)
+	{
+		return ScheduleImpl ([file, pos, data] () -> WriteResult
+				{
+					if (pos >= 0 && !file->seek (pos))
+						return { 0, MakeWriteError (*file) };
+
+					const auto written = file->write (data);
+					if (written != data.size ())
+						return { std::max<qint64> (written, 0), MakeWriteError (*file) };
+
+					if (!file->flush ())
+						return { written, MakeWriteError (*file) };
+
+					return { written, {} };
+				});
+	}
+
+	QFuture<WriteResult> FileWriter::CopyChunk (const std::shared_ptr<QFile>& from,
+			const std::shared_ptr<QFile>& to, qint64 size)
+	{
+		return ScheduleImpl ([from, to, size] () -> WriteResult
+				{
+					const auto& chunk = from->read (size);
+					if (chunk.isEmpty ())
+					{
+						if (from->atEnd ())
+							return { 0, {} };
+
+						return
+						{
+							0,
+							QCoreApplication::translate ("LeechCraft::CSTP::FileWriter",
+										"Error reading file %1: %2")
+									.arg (from->fileName ())
+									.arg (from->errorString ())
+						};
+					}
+
+					const auto written = to->write (chunk);
+					if (written != chunk.size ())
+						return { std::max<qint64> (written, 0), MakeWriteError (*to) };
+
+					return { written, {} };
+				});
+	}
+
+	QFuture<WriteResult> FileWriter::Close (const std::shared_ptr<QFile>& file)
+	{
+		return ScheduleImpl ([file] () -> WriteResult
+				{
+					if (!file->isOpen ())
+						return { 0, {} };
+
+					const auto& error = file->flush () ? QString {} : MakeWriteError (*file);
+					file->close ();
+					return { 0, error };
+				});
+	}
+
+	QFuture<WriteResult> FileWriter::Rename (const std::shared_ptr<QFile>& file, const QString& path)
+	{
+		return ScheduleImpl ([file, path] () -> WriteResult
+				{
+					const auto& oldPath = file->fileName ();
+					const auto openMode = file->openMode ();
+					const auto pos = file->pos ();
+					file->close ();
+
+					QString error;
+					if (!file->rename (path))
+						error = QCoreApplication::translate ("LeechCraft::CSTP::FileWriter",
+									"Unable to rename %1 to %2: %3")
+								.arg (oldPath)
+								.arg (path)
+								.arg (file->errorString ());
+
+					if (!file->open (openMode))
+					{
+						error = QCoreApplication::translate ("LeechCraft::CSTP::FileWriter",
+									"Unable to reopen the renamed file %1: %2")
+								.arg (path)
+								.arg (file->errorString ());
+						file->rename (oldPath);
+						file->open (openMode);
+					}
+
+					file->seek (pos);
+					return { 0, error };
+				});
+	}
+
+	void FileWriter::Initialize ()
+	{
+	}
+
+	void FileWriter::Cleanup ()
+	{
+	}
+}
+}
@@ -0,0 +1,98 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <QString>
+#include <util/threads/workerthreadbase.h>
+
+class QFile;
+
+namespace LeechCraft
+{
+namespace CSTP
+{
+	/** How many bytes may be queued for writing per download before it
+	 * stops reading from the network.
+	 */
+	const qint64 MaxPendingWriteSize = 4 * 1024 * 1024;
+
+	struct WriteResult
+	{
+		qint64 Written_;
+
+		/** Empty if the operation succeeded.
+		 */
+		QString Error_;
+	};
+
+	/** Performs the writes to the downloaded files in a separate thread,
+	 * so that a slow disk doesn't block the UI.
+	 *
+	 * The operations are executed in the order they are scheduled in.
+	 * A file passed to this class shouldn't be touched by other threads
+	 * until the futures of all the operations on it have finished.
+	 */
+	class FileWriter final : public Util::WorkerThreadBase
+	{
+	public:
+		using Util::WorkerThreadBase::WorkerThreadBase;
+
+		/** Writes the data at the given position of the file, or at its
+		 * current position if pos is negative, and flushes it to the
+		 * system, so that a finished write survives a crash.
+		 */
+		QFuture<WriteResult> Write (const std::shared_ptr<QFile>& file,
+				qint64 pos, const QByteArray& data);
+
+		/** Reads at most size bytes from the current position of from
+		 * and writes them to the current position of to. Zero bytes
+		 * written mean the end of from has been reached.
+		 */
+		QFuture<WriteResult> CopyChunk (const std::shared_ptr<QFile>& from,
+				const std::shared_ptr<QFile>& to, qint64 size);
+
+		/** Closes the file once the operations scheduled before are
+		 * done.
+		 */
+		QFuture<WriteResult> Close (const std::shared_ptr<QFile>& file);
+
+		/** Renames the file once the operations scheduled before are
+		 * done, keeping it open in the same mode and at the same
+		 * position. The old name is kept if the renamed file can't be
+		 * reopened.
+		 */
+		QFuture<WriteResult> Rename (const std::shared_ptr<QFile>& file, const QString& path);
+	protected:
+		void Initialize () override;
+		void Cleanup () override;
+	};
+}
+}
@@ -0,0 +1,424 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "segmenteddownload.h"
+#include <algorithm>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QFile>
+#include <QtDebug>
+#include <util/threads/futures.h>
+
+namespace LeechCraft
+{
+namespace CSTP
+{
+	namespace
+	{
+		const qint64 MinSegmentSize = 1024 * 1024;
+
+		/* How many times in a row a segment may fail without receiving
+		 * any data before the whole download is considered failed.
+		 */
+		const auto MaxFailures = 3;
+	}
+
+	SegmentedDownload::SegmentedDownload (QNetworkAccessManager *nam,
+			FileWriter *writer,
+			const QNetworkRequest& req,
+			const std::shared_ptr<QFile>& file,
+			qint64 total,
+			const QList<Range_t>& ranges,
+			int maxConnections,
+			QObject *parent)
+	: QObject { parent }
+	, NAM_ { nam }
+	, Writer_ { writer }
+	, Request_ { req }
+	, File_ { file }
+	, Total_ { total }
+	, MaxConnections_ { std::max (maxConnections, 1) }
+	{
+		for (const auto& range : ranges)
+			Segments_.append ({ range.first, range.second, range.first });
+	}
+
+	SegmentedDownload::~SegmentedDownload ()
+	{
+		// The pending writes hold the file, so they needn't be waited for.
+		Stop ();
+	}
+
+	QList<SegmentedDownload::Range_t> SegmentedDownload::SplitRange (qint64 size, int count)
+	{
+		const auto actualCount = std::max<qint64> (std::min<qint64> (count, size / MinSegmentSize), 1);
+		const auto chunk = size / actualCount;
+
+		QList<Range_t> result;
+		for (qint64 i = 0; i < actualCount; ++i)
+		{
+			const auto begin = i * chunk;
+			const auto end = i == actualCount - 1 ? size - 1 : begin + chunk - 1;
+			result.append ({ begin, end });
+		}
+		return result;
+	}
+
+	qint64 SegmentedDownload::GetMinSegmentSize ()
+	{
+		return MinSegmentSize;
+	}
+
+	void SegmentedDownload::Start ()
+	{
+		SessionReceived_ = 0;
+		ErrorString_.clear ();
+
+		if (Segments_.isEmpty ())
+		{
+			QMetaObject::invokeMethod (this,
+					"finished",
+					Qt::QueuedConnection);
+			return;
+		}
+
+		for (auto& seg : Segments_)
+			seg.Failures_ = 0;
+
+		ScheduleSegments ();
+	}
+
+	void SegmentedDownload::Stop ()
+	{
+		for (auto& seg : Segments_)
+			ReleaseReply (seg);
+	}
+
+	bool SegmentedDownload::IsRunning () const
+	{
+		return std::any_of (Segments_.begin (), Segments_.end (),
+				[] (const Segment& seg) { return seg.Reply_; });
+	}
+
+	QList<SegmentedDownload::Range_t> SegmentedDownload::GetRemaining () const
+	{
+		QList<Range_t> result;
+		for (const auto& seg : Segments_)
+			if (seg.Persisted_ <= seg.End_)
+				result.append ({ seg.Persisted_, seg.End_ });
+		return result;
+	}
+
+	qint64 SegmentedDownload::GetTotal () const
+	{
+		return Total_;
+	}
+
+	qint64 SegmentedDownload::GetDone () const
+	{
+		auto result = Total_;
+		for (const auto& seg : Segments_)
+			result -= std::max<qint64> (seg.End_ - seg.Pos_ + 1, 0);
+		return result;
+	}
+
+	qint64 SegmentedDownload::GetSessionReceived () const
+	{
+		return SessionReceived_;
+	}
+
+	QString SegmentedDownload::GetErrorString () const
+	{
+		return ErrorString_;
+	}
+
+	QList<SegmentedDownload::Segment>::iterator SegmentedDownload::FindSegment (QNetworkReply *reply)
+	{
+		return std::find_if (Segments_.begin (), Segments_.end (),
+				[reply] (const Segment& seg) { return seg.Reply_ == reply; });
+	}
+
+	void SegmentedDownload::StartSegment (Segment& seg)
+	{
+		auto req = Request_;
+		req.setRawHeader ("Range", "bytes=" +
+				QByteArray::number (seg.Pos_) + '-' + QByteArray::number (seg.End_));
+
+		seg.Validated_ = false;
+		seg.Reply_ = NAM_->get (req);
+		seg.Reply_->setReadBufferSize (MaxPendingWriteSize);
+
+		connect (seg.Reply_,
+				SIGNAL (readyRead ()),
+				this,
+				SLOT (handleReadyRead ()));
+		connect (seg.Reply_,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleFinished ()));
+	}
+
+	void SegmentedDownload::ReleaseReply (Segment& seg)
+	{
+		if (!seg.Reply_)
+			return;
+
+		disconnect (seg.Reply_,
+				0,
+				this,
+				0);
+		seg.Reply_->abort ();
+		seg.Reply_->deleteLater ();
+		seg.Reply_ = nullptr;
+	}
+
+	void SegmentedDownload::ScheduleSegments ()
+	{
+		auto running = std::count_if (Segments_.begin (), Segments_.end (),
+				[] (const Segment& seg) { return seg.Reply_; });
+
+		for (auto& seg : Segments_)
+		{
+			if (running >= MaxConnections_)
+				return;
+
+			if (!seg.Reply_ && seg.Pos_ <= seg.End_)
+			{
+				StartSegment (seg);
+				++running;
+			}
+		}
+
+		while (running < MaxConnections_ && StealRange ())
+			++running;
+	}
+
+	bool SegmentedDownload::StealRange ()
+	{
+		auto remaining = [] (const Segment& seg) { return seg.End_ - seg.Pos_ + 1; };
+
+		const auto largest = std::max_element (Segments_.begin (), Segments_.end (),
+				[&remaining] (const Segment& left, const Segment& right)
+					{ return remaining (left) < remaining (right); });
+		if (largest == Segments_.end () ||
+				remaining (*largest) < 2 * MinSegmentSize)
+			return false;
+
+		const auto mid = largest->Pos_ + remaining (*largest) / 2;
+
+		// The reply of the largest segment is cut at its new end later.
+		Segment stolen { mid, largest->End_, mid };
+		largest->End_ = mid - 1;
+
+		Segments_.append (stolen);
+		StartSegment (Segments_.last ());
+		return true;
+	}
+
+	bool SegmentedDownload::Validate (const Segment& seg) const
+	{
+		if (seg.Reply_->attribute (QNetworkRequest::HttpStatusCodeAttribute).toInt () != 206)
+			return false;
+
+		// Content-Range: bytes first-last/total
+		auto contentRange = seg.Reply_->rawHeader ("Content-Range").trimmed ();
+		if (!contentRange.startsWith ("bytes "))
+			return false;
+		contentRange = contentRange.mid (6);
+
+		const auto dashPos = contentRange.indexOf ('-');
+		const auto slashPos = contentRange.indexOf ('/');
+		if (dashPos <= 0 || slashPos <= dashPos)
+			return false;
+
+		const auto& totalStr = contentRange.mid (slashPos + 1);
+		return contentRange.left (dashPos).toLongLong () == seg.Pos_ &&
+				(totalStr == "*" || totalStr.toLongLong () == Total_);
+	}
+
+	void SegmentedDownload::Fail (const QString& error)
+	{
+		qWarning () << Q_FUNC_INFO
+				<< error;
+
+		ErrorString_ = error;
+		Stop ();
+		emit failed ();
+	}
+
+	void SegmentedDownload::ProcessData (QList<Segment>::iterator pos)
+	{
+		auto& seg = *pos;
+		const auto reply = seg.Reply_;
+		if (!seg.Validated_)
+		{
+			if (!Validate (seg))
+			{
+				ErrorString_ = tr ("Unexpected reply to a range request: %1 %2.")
+						.arg (reply->attribute (QNetworkRequest::HttpStatusCodeAttribute).toInt ())
+						.arg (QString::fromLatin1 (reply->rawHeader ("Content-Range")));
+				qWarning () << Q_FUNC_INFO
+						<< ErrorString_;
+
+				Stop ();
+				emit rangesUnsupported ();
+				return;
+			}
+
+			seg.Validated_ = true;
+		}
+
+		const auto toWrite = std::min (reply->bytesAvailable (), seg.End_ - seg.Pos_ + 1);
+		const auto& data = reply->read (toWrite);
+		if (data.isEmpty ())
+			return;
+
+		PendingWrites_ += data.size ();
+		const auto writePos = seg.Pos_;
+		const auto size = data.size ();
+		Util::Sequence (this, Writer_->Write (File_, seg.Pos_, data)) >>
+				[this, writePos, size] (const WriteResult& result) { HandleWritten (writePos, size, result); };
+
+		seg.Pos_ += data.size ();
+		seg.Failures_ = 0;
+		SessionReceived_ += data.size ();
+
+		if (seg.Pos_ <= seg.End_)
+		{
+			emit progress (GetDone (), Total_);
+
+			// No more signals come from a finished reply.
+			if (reply->isFinished () && !reply->bytesAvailable ())
+				HandleInterrupted (pos);
+			return;
+		}
+
+		// The segment is removed once its data is written.
+		ReleaseReply (seg);
+
+		emit progress (GetDone (), Total_);
+
+		ScheduleSegments ();
+	}
+
+	void SegmentedDownload::HandleWritten (qint64 pos, qint64 size, const WriteResult& result)
+	{
+		PendingWrites_ -= size;
+
+		if (!result.Error_.isEmpty ())
+		{
+			if (ErrorString_.isEmpty ())
+				Fail (result.Error_);
+			return;
+		}
+
+		// The writes of a segment complete in the order they're scheduled in.
+		const auto seg = std::find_if (Segments_.begin (), Segments_.end (),
+				[pos] (const Segment& seg) { return seg.Persisted_ == pos; });
+		if (seg != Segments_.end ())
+		{
+			seg->Persisted_ += size;
+			if (seg->Persisted_ > seg->End_)
+				Segments_.erase (seg);
+		}
+
+		if (!ErrorString_.isEmpty ())
+			return;
+
+		for (auto i = Segments_.begin (); i != Segments_.end () && PendingWrites_ < MaxPendingWriteSize; ++i)
+			if (i->Reply_ && i->Reply_->bytesAvailable ())
+			{
+				ProcessData (i);
+				break;
+			}
+
+		CheckFinished ();
+	}
+
+	void SegmentedDownload::CheckFinished ()
+	{
+		if (!Segments_.isEmpty () || PendingWrites_)
+			return;
+
+		File_->flush ();
+		emit finished ();
+	}
+
+	void SegmentedDownload::handleReadyRead ()
+	{
+		if (PendingWrites_ >= MaxPendingWriteSize)
+			return;
+
+		const auto pos = FindSegment (qobject_cast<QNetworkReply*> (sender ()));
+		if (pos != Segments_.end ())
+			ProcessData (pos);
+	}
+
+	void SegmentedDownload::handleFinished ()
+	{
+		const auto reply = qobject_cast<QNetworkReply*> (sender ());
+		auto pos = FindSegment (reply);
+		if (pos == Segments_.end ())
+			return;
+
+		// The rest of the data is read once the pending writes are done.
+		if (reply->error () == QNetworkReply::NoError && reply->bytesAvailable ())
+		{
+			if (PendingWrites_ < MaxPendingWriteSize)
+				ProcessData (pos);
+			return;
+		}
+
+		HandleInterrupted (pos);
+	}
+
+	void SegmentedDownload::HandleInterrupted (QList<Segment>::iterator pos)
+	{
+		auto& seg = *pos;
+		const auto& errorString = seg.Reply_->error () == QNetworkReply::NoError ?
+				tr ("Connection closed prematurely.") :
+				seg.Reply_->errorString ();
+		ReleaseReply (seg);
+
+		if (++seg.Failures_ > MaxFailures)
+		{
+			Fail (errorString);
+			return;
+		}
+
+		qWarning () << Q_FUNC_INFO
+				<< "segment"
+				<< seg.Pos_
+				<< seg.End_
+				<< "interrupted, restarting:"
+				<< errorString;
+		ScheduleSegments ();
+	}
+}
+}
@@ -0,0 +1,169 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <QObject>
+#include <QList>
+#include <QPair>
+#include <QNetworkRequest>
+#include <QFuture>
+#include "filewriter.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QFile;
+
+namespace LeechCraft
+{
+namespace CSTP
+{
+	/** Downloads a file over several connections at once, each fetching
+	 * its own byte range into the preallocated destination file.
+	 *
+	 * Once a segment finishes and there are no pending ranges left, the
+	 * largest remaining range of the still running segments is split in
+	 * half and the upper half is given to a new connection, so that slow
+	 * connections don't hold the whole download back.
+	 *
+	 * The data is written via the FileWriter, and the replies aren't read
+	 * while too much of it is waiting to be written.
+	 *
+	 * The ranges that are still to be written to the file are available
+	 * via GetRemaining() and can be passed to a new instance later to
+	 * resume the download. They don't cover the data that's been
+	 * received but is still waiting to be written.
+	 */
+	class SegmentedDownload : public QObject
+	{
+		Q_OBJECT
+	public:
+		typedef QPair<qint64, qint64> Range_t;
+	private:
+		QNetworkAccessManager * const NAM_;
+		FileWriter * const Writer_;
+		const QNetworkRequest Request_;
+		const std::shared_ptr<QFile> File_;
+		const qint64 Total_;
+		const int MaxConnections_;
+
+		struct Segment
+		{
+			qint64 Pos_;
+			qint64 End_;
+
+			/* Everything before this position has been written to the
+			 * file. The segment is kept until it's all written.
+			 */
+			qint64 Persisted_;
+
+			QNetworkReply *Reply_ = nullptr;
+			bool Validated_ = false;
+			int Failures_ = 0;
+		};
+		QList<Segment> Segments_;
+
+		qint64 SessionReceived_ = 0;
+
+		qint64 PendingWrites_ = 0;
+		QString ErrorString_;
+	public:
+		/** Creates the download of the file of the given total size,
+		 * fetching the given ranges with at most maxConnections
+		 * simultaneous connections.
+		 *
+		 * The file should already be opened for writing and resized to
+		 * the total size.
+		 */
+		SegmentedDownload (QNetworkAccessManager*,
+				FileWriter*,
+				const QNetworkRequest&,
+				const std::shared_ptr<QFile>&,
+				qint64 total,
+				const QList<Range_t>& ranges,
+				int maxConnections,
+				QObject* = 0);
+		~SegmentedDownload ();
+
+		/** Splits the whole file of the given size into at most count
+		 * ranges, each of them being at least GetMinSegmentSize() bytes
+		 * long.
+		 */
+		static QList<Range_t> SplitRange (qint64 size, int count);
+		static qint64 GetMinSegmentSize ();
+
+		void Start ();
+		void Stop ();
+		bool IsRunning () const;
+
+		/** Returns the ranges that aren't written to the file yet.
+		 */
+		QList<Range_t> GetRemaining () const;
+
+		qint64 GetTotal () const;
+		qint64 GetDone () const;
+
+		/** Returns the number of bytes received since the last Start(),
+		 * which is handy for calculating the speed.
+		 */
+		qint64 GetSessionReceived () const;
+
+		QString GetErrorString () const;
+	private:
+		QList<Segment>::iterator FindSegment (QNetworkReply*);
+
+		void StartSegment (Segment&);
+		void ReleaseReply (Segment&);
+		void ScheduleSegments ();
+		bool StealRange ();
+
+		void ProcessData (QList<Segment>::iterator);
+		void HandleWritten (qint64 pos, qint64 size, const WriteResult&);
+		void HandleInterrupted (QList<Segment>::iterator);
+		void CheckFinished ();
+
+		bool Validate (const Segment&) const;
+		void Fail (const QString&);
+	private slots:
+		void handleReadyRead ();
+		void handleFinished ();
+	signals:
+		void progress (qint64 done, qint64 total);
+		void finished ();
+		void failed ();
+
+		/** Emitted instead of failed() when the server replies to a
+		 * range request with anything but the requested range. The
+		 * download is stopped by then.
+		 */
+		void rangesUnsupported ();
+	};
+}
+}
@@ -42,6 +42,7 @@
 #include <util/sll/prelude.h>
 #include <util/sll/qstringwrappers.h>
 #include <util/util.h>
+#include <util/threads/futures.h>
 #include <interfaces/core/icoreproxy.h>
 #include <interfaces/core/ientitymanager.h>
 #include "core.h"
@@ -53,12 +54,18 @@ namespace CSTP
 {
 	namespace
 	{
-		void LateDelete (QNetworkReply *rep)
+		template<typename T>
+		void LateDelete (T *obj)
 		{
-			if (rep)
-				rep->deleteLater ();
+			if (obj)
+				obj->deleteLater ();
 		}
 
+		/* Local files are copied in chunks of this size, so that the
+		 * progress is updated and the copy can be stopped.
+		 */
+		const qint64 LocalChunkSize = 1024 * 1024;
+
 		QVariantMap Augment (QVariantMap map, const QList<QPair<QString, QVariant>>& pairs)
 		{
 			if (pairs.isEmpty ())
@@ -75,7 +82,7 @@ namespace CSTP
 	}
 
 	Task::Task (const QUrl& url, const QVariantMap& params)
-	: Reply_ (nullptr, &LateDelete)
+	: Reply_ (nullptr, &LateDelete<QNetworkReply>)
 	, URL_ (url)
 	, Timer_ (new QTimer (this))
 	, Referer_ (params ["Referer"].toUrl ())
@@ -86,6 +93,7 @@ namespace CSTP
 				{ "Content-Type", "application/x-www-form-urlencoded" }
 			}))
 	, UploadData_ (params.value ("UploadData").toByteArray ())
+	, Segmented_ (nullptr, &LateDelete<SegmentedDownload>)
 	{
 		StartTime_.start ();
 
@@ -96,7 +104,7 @@ namespace CSTP
 	}
 
 	Task::Task (QNetworkReply *reply)
-	: Reply_ (reply, &LateDelete)
+	: Reply_ (reply, &LateDelete<QNetworkReply>)
 	, Timer_ (new QTimer (this))
 	, Operation_ (reply->operation ())
 	, Headers_
@@ -108,6 +116,7 @@ namespace CSTP
 				}
 		})
 	}
+	, Segmented_ (nullptr, &LateDelete<SegmentedDownload>)
 	{
 		StartTime_.start ();
 
@@ -128,6 +137,11 @@ namespace CSTP
 		FileSizeAtStart_ = tof->size ();
 		To_ = tof;
 
+		ReplyFinished_ = false;
+		WriteFailed_ = false;
+		Failed_ = false;
+		WritePos_ = -1;
+
 		if (!Reply_)
 		{
 			if (URL_.scheme () == "file")
@@ -138,32 +152,38 @@ namespace CSTP
 				return;
 			}
 
-			auto ua = XmlSettingsManager::Instance ().property ("UserUserAgent").toString ();
-			if (ua.isEmpty ())
-				ua = XmlSettingsManager::Instance ().property ("PredefinedUserAgent").toString ();
-
-			if (ua == "%leechcraft%")
-				ua = "LeechCraft.CSTP/" + Core::Instance ().GetCoreProxy ()->GetVersion ();
+			if (Segmented_ || !SegmentsToResume_.isEmpty ())
+			{
+				const auto ranges = Segmented_ ?
+						Segmented_->GetRemaining () :
+						SegmentsToResume_;
 
-			QNetworkRequest req { URL_ };
-			if (tof->size ())
-				req.setRawHeader ("Range", QString ("bytes=%1-").arg (tof->size ()).toLatin1 ());
-			req.setRawHeader ("User-Agent", ua.toLatin1 ());
+				// The ranges are only valid for the preallocated file.
+				if (FileSizeAtStart_ == Total_)
+				{
+					StartSegmented (Total_, ranges);
+					return;
+				}
 
-			if (Referer_.isEmpty ())
-				req.setRawHeader ("Referer", QString (QString ("http://") + URL_.host ()).toLatin1 ());
-			else
-				req.setRawHeader ("Referer", Referer_.toEncoded ());
+				qWarning () << Q_FUNC_INFO
+						<< "file size mismatch, restarting from scratch:"
+						<< FileSizeAtStart_
+						<< Total_;
+				Segmented_.reset ();
+				SegmentsToResume_.clear ();
+				tof->resize (0);
+				FileSizeAtStart_ = 0;
+			}
 
-			req.setRawHeader ("Host", URL_.host ().toLatin1 ());
-			req.setRawHeader ("Origin", URL_.scheme ().toLatin1 () + "://" + URL_.host ().toLatin1 ());
-			req.setRawHeader ("Accept", "*/*");
+			auto req = MakeRequest ();
+			if (RangesUnsupported_)
+				// The preallocated file is overwritten from its beginning.
+				WritePos_ = 0;
+			else if (tof->size () && !req.hasRawHeader ("Range"))
+				req.setRawHeader ("Range", QString ("bytes=%1-").arg (tof->size ()).toLatin1 ());
 
 			StartTime_.restart ();
 
-			for (const auto& pair : Util::Stlize (Headers_))
-				req.setRawHeader (pair.first.toLatin1 (), pair.second.toByteArray ());
-
 			auto nam = Core::Instance ().GetNetworkAccessManager ();
 			switch (Operation_)
 			{
@@ -204,6 +224,9 @@ namespace CSTP
 		if (!Timer_->isActive ())
 			Timer_->start (3000);
 
+		// Makes the reply stop reading from the socket while the writes lag behind.
+		Reply_->setReadBufferSize (MaxPendingWriteSize);
+
 		Reply_->setParent (nullptr);
 		connect (Reply_.get (),
 				SIGNAL (downloadProgress (qint64, qint64)),
@@ -231,6 +254,21 @@ namespace CSTP
 	{
 		if (Reply_)
 			Reply_->abort ();
+		else if (Segmented_)
+		{
+			Segmented_->Stop ();
+			SegmentsToResume_ = Segmented_->GetRemaining ();
+			Segmented_.reset ();
+		}
+
+		LocalSource_.reset ();
+
+		CloseFile ();
+	}
+
+	QFuture<WriteResult> Task::GetPendingClose () const
+	{
+		return PendingClose_;
 	}
 
 	void Task::ForbidNameChanges ()
@@ -243,13 +281,15 @@ namespace CSTP
 		QByteArray result;
 		{
 			QDataStream out (&result, QIODevice::WriteOnly);
-			out << 2
+			out << 4
 				<< URL_
 				<< StartTime_
 				<< Done_
 				<< Total_
 				<< Speed_
-				<< CanChangeName_;
+				<< CanChangeName_
+				<< (Segmented_ ? Segmented_->GetRemaining () : SegmentsToResume_)
+				<< RangesUnsupported_;
 		}
 		return result;
 	}
@@ -259,7 +299,7 @@ namespace CSTP
 		QDataStream in (&data, QIODevice::ReadOnly);
 		int version = 0;
 		in >> version;
-		if (version < 1 || version > 2)
+		if (version < 1 || version > 4)
 			throw std::runtime_error ("Unknown version");
 
 		in >> URL_
@@ -270,6 +310,10 @@ namespace CSTP
 
 		if (version >= 2)
 			in >> CanChangeName_;
+		if (version >= 3)
+			in >> SegmentsToResume_;
+		if (version >= 4)
+			in >> RangesUnsupported_;
 	}
 
 	double Task::GetSpeed () const
@@ -289,7 +333,7 @@ namespace CSTP
 
 	QString Task::GetState () const
 	{
-		if (!Reply_)
+		if (!Reply_ && !LocalSource_ && !(Segmented_ && Segmented_->IsRunning ()))
 			return tr ("Stopped");
 		else if (Done_ == Total_)
 			return tr ("Finished");
@@ -309,14 +353,251 @@ namespace CSTP
 
 	bool Task::IsRunning () const
 	{
-		return Reply_ && !URL_.isEmpty ();
+		return (Reply_ && !URL_.isEmpty ()) ||
+				LocalSource_ ||
+				(Segmented_ && Segmented_->IsRunning ());
+	}
+
+	bool Task::IsSegmented () const
+	{
+		return Segmented_ || !SegmentsToResume_.isEmpty ();
 	}
 
 	QString Task::GetErrorString () const
 	{
+		if (Segmented_ && !Segmented_->GetErrorString ().isEmpty ())
+			return Segmented_->GetErrorString ();
+
 		return Reply_ ? Reply_->errorString () : tr ("Task isn't initialized properly");
 	}
 
+	QNetworkRequest Task::MakeRequest () const
+	{
+		auto ua = XmlSettingsManager::Instance ().property ("UserUserAgent").toString ();
+		if (ua.isEmpty ())
+			ua = XmlSettingsManager::Instance ().property ("PredefinedUserAgent").toString ();
+
+		if (ua == "%leechcraft%")
+			ua = "LeechCraft.CSTP/" + Core::Instance ().GetCoreProxy ()->GetVersion ();
+
+		QNetworkRequest req { URL_ };
+		req.setRawHeader ("User-Agent", ua.toLatin1 ());
+
+		if (Referer_.isEmpty ())
+			req.setRawHeader ("Referer", QString (QString ("http://") + URL_.host ()).toLatin1 ());
+		else
+			req.setRawHeader ("Referer", Referer_.toEncoded ());
+
+		req.setRawHeader ("Host", URL_.host ().toLatin1 ());
+		req.setRawHeader ("Origin", URL_.scheme ().toLatin1 () + "://" + URL_.host ().toLatin1 ());
+		req.setRawHeader ("Accept", "*/*");
+
+		for (const auto& pair : Util::Stlize (Headers_))
+			req.setRawHeader (pair.first.toLatin1 (), pair.second.toByteArray ());
+
+		return req;
+	}
+
+	bool Task::ShouldSegment () const
+	{
+		if (Operation_ != QNetworkAccessManager::GetOperation ||
+				RangesUnsupported_ ||
+				URL_.isEmpty () ||
+				FileSizeAtStart_ ||
+				!XmlSettingsManager::Instance ().property ("EnableSegmentedDownloads").toBool ())
+			return false;
+
+		if (Reply_->attribute (QNetworkRequest::HttpStatusCodeAttribute).toInt () != 200 ||
+				!Reply_->rawHeader ("Accept-Ranges").toLower ().contains ("bytes") ||
+				Reply_->hasRawHeader ("Content-Encoding"))
+			return false;
+
+		const auto size = Reply_->header (QNetworkRequest::ContentLengthHeader).toLongLong ();
+		return size >= 2 * SegmentedDownload::GetMinSegmentSize ();
+	}
+
+	void Task::StartSegmented (qint64 total, const QList<SegmentedDownload::Range_t>& ranges)
+	{
+		const auto connections = XmlSettingsManager::Instance ().property ("SegmentsCount").toInt ();
+
+		SegmentsToResume_.clear ();
+		Segmented_.reset (new SegmentedDownload
+				{
+					Core::Instance ().GetNetworkAccessManager (),
+					Core::Instance ().GetFileWriter (),
+					MakeRequest (),
+					To_,
+					total,
+					ranges,
+					connections
+				});
+
+		connect (Segmented_.get (),
+				SIGNAL (progress (qint64, qint64)),
+				this,
+				SLOT (handleSegmentedProgress (qint64, qint64)));
+		connect (Segmented_.get (),
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleFinished ()));
+		connect (Segmented_.get (),
+				SIGNAL (failed ()),
+				this,
+				SLOT (handleError ()));
+		connect (Segmented_.get (),
+				SIGNAL (rangesUnsupported ()),
+				this,
+				SLOT (handleRangesUnsupported ()));
+
+		Total_ = total;
+		Done_ = Segmented_->GetDone ();
+		Speed_ = 0;
+
+		StartTime_.restart ();
+		Segmented_->Start ();
+
+		if (!Timer_->isActive ())
+			Timer_->start (3000);
+	}
+
+	void Task::WriteData (const QByteArray& data)
+	{
+		if (data.isEmpty ())
+			return;
+
+		PendingWrites_ += data.size ();
+		LastWrite_ = Core::Instance ().GetFileWriter ()->Write (To_, WritePos_, data);
+		if (WritePos_ >= 0)
+			WritePos_ += data.size ();
+
+		const auto size = data.size ();
+		Util::Sequence (this, LastWrite_) >>
+				[this, size] (const WriteResult& result) { HandleWritten (size, result); };
+	}
+
+	void Task::HandleWritten (qint64 size, const WriteResult& result)
+	{
+		PendingWrites_ -= size;
+
+		// The failure has already been reported, and the file is being closed.
+		if (Failed_)
+			return;
+
+		if (!result.Error_.isEmpty ())
+		{
+			HandleWriteError (result.Error_);
+			return;
+		}
+
+		if (Reply_ && Reply_->bytesAvailable ())
+			handleReadyRead ();
+
+		CheckFinished ();
+	}
+
+	void Task::HandleWriteError (const QString& error)
+	{
+		if (WriteFailed_)
+			return;
+
+		WriteFailed_ = true;
+
+		qWarning () << Q_FUNC_INFO
+				<< error;
+
+		if (Reply_)
+		{
+			disconnect (Reply_.get (),
+					0,
+					this,
+					0);
+			Reply_->abort ();
+		}
+
+		const auto& e = Util::MakeNotification ("LeechCraft CSTP",
+				error,
+				PCritical_);
+		Core::Instance ().GetCoreProxy ()->GetEntityManager ()->HandleEntity (e);
+
+		Fail ();
+	}
+
+	void Task::CloseFile ()
+	{
+		if (To_)
+			PendingClose_ = Core::Instance ().GetFileWriter ()->Close (To_);
+	}
+
+	void Task::Fail ()
+	{
+		if (Failed_)
+			return;
+
+		Failed_ = true;
+
+		// The writes still pending are done by the time the file is closed.
+		CloseFile ();
+		emit done (true);
+	}
+
+	void Task::CheckFinished ()
+	{
+		if (!ReplyFinished_ || Failed_ || PendingWrites_)
+			return;
+
+		// The rest is written first, and this is called again after that.
+		if (Reply_ && Reply_->bytesAvailable ())
+		{
+			handleReadyRead ();
+			return;
+		}
+
+		ReplyFinished_ = false;
+
+		// Nobody is told the file is complete before it's closed.
+		CloseFile ();
+		Util::Sequence (this, PendingClose_) >>
+				[this] (const WriteResult& result)
+				{
+					if (!result.Error_.isEmpty ())
+						HandleWriteError (result.Error_);
+					else
+						emit done (false);
+				};
+	}
+
+	void Task::CopyNextChunk ()
+	{
+		const auto source = LocalSource_;
+		LastWrite_ = Core::Instance ().GetFileWriter ()->CopyChunk (source, To_, LocalChunkSize);
+		Util::Sequence (this, LastWrite_) >>
+				[this, source] (const WriteResult& result)
+				{
+					// The transfer has been stopped in the meantime.
+					if (LocalSource_ != source)
+						return;
+
+					if (!result.Error_.isEmpty ())
+					{
+						LocalSource_.reset ();
+						HandleWriteError (result.Error_);
+						return;
+					}
+
+					if (!result.Written_)
+					{
+						LocalSource_.reset ();
+						handleFinished ();
+						return;
+					}
+
+					Done_ += result.Written_;
+					RecalculateSpeed ();
+
+					CopyNextChunk ();
+				};
+	}
+
 	void Task::Reset ()
 	{
 		RedirectHistory_.clear ();
@@ -325,6 +606,9 @@ namespace CSTP
 		Speed_ = 0;
 		FileSizeAtStart_ = -1;
 		Reply_.reset ();
+		Segmented_.reset ();
+		SegmentsToResume_.clear ();
+		RangesUnsupported_ = false;
 	}
 
 	void Task::RecalculateSpeed ()
@@ -364,7 +648,7 @@ namespace CSTP
 				<< newUrl
 				<< "for"
 				<< Reply_->url ();
-			emit done (true);
+			Fail ();
 		}
 		else
 		{
@@ -471,24 +755,15 @@ namespace CSTP
 			return;
 		}
 
-		const auto openMode = To_->openMode ();
-		To_->close ();
-
-		if (!To_->rename (path))
-		{
-			qWarning () << Q_FUNC_INFO
-				<< "failed to rename to"
-				<< path
-				<< To_->errorString ();
-		}
-		if (!To_->open (openMode))
-		{
-			qWarning () << Q_FUNC_INFO
-				<< "failed to re-open the renamed file"
-				<< path;
-			To_->rename (oldPath);
-			To_->open (openMode);
-		}
+		// The writer renames the file after the data received so far and before the rest.
+		LastWrite_ = Core::Instance ().GetFileWriter ()->Rename (To_, path);
+		Util::Sequence (this, LastWrite_) >>
+				[] (const WriteResult& result)
+				{
+					if (!result.Error_.isEmpty ())
+						qWarning () << Q_FUNC_INFO
+								<< result.Error_;
+				};
 	}
 
 	void Task::handleDataTransferProgress (qint64 done, qint64 total)
@@ -502,26 +777,89 @@ namespace CSTP
 			emit updateInterface ();
 	}
 
+	void Task::handleSegmentedProgress (qint64 done, qint64 total)
+	{
+		Done_ = done;
+		Total_ = total;
+
+		const auto elapsed = std::max (StartTime_.elapsed (), 1);
+		Speed_ = static_cast<double> (Segmented_->GetSessionReceived () * 1000) / elapsed;
+
+		if (done == total)
+			emit updateInterface ();
+	}
+
+	void Task::handleRangesUnsupported ()
+	{
+		qWarning () << Q_FUNC_INFO
+				<< URL_
+				<< "doesn't honour range requests anymore, falling back to a single connection";
+
+		Segmented_.reset ();
+		SegmentsToResume_.clear ();
+		RangesUnsupported_ = true;
+
+		Start (To_);
+	}
+
 	void Task::redirectedConstruction (const QByteArray& newUrl)
 	{
-		if (To_ && FileSizeAtStart_ >= 0)
+		// Nothing is read from the old reply anymore, so no writes are scheduled after LastWrite_.
+		Reply_.reset ();
+
+		auto restart = [this, newUrl]
 		{
-			To_->close ();
-			To_->resize (FileSizeAtStart_);
-			To_->open (QIODevice::ReadWrite);
-		}
+			if (To_ && FileSizeAtStart_ >= 0)
+			{
+				To_->close ();
+				To_->resize (FileSizeAtStart_);
+				To_->open (QIODevice::ReadWrite);
+			}
 
-		Reply_.reset ();
+			Referer_ = URL_;
+			URL_ = QUrl::fromEncoded (newUrl);
+			Start (To_);
+		};
 
-		Referer_ = URL_;
-		URL_ = QUrl::fromEncoded (newUrl);
-		Start (To_);
+		if (LastWrite_.isFinished ())
+		{
+			restart ();
+			return;
+		}
+
+		Util::Sequence (this, LastWrite_) >>
+				[restart] (const WriteResult&) { restart (); };
 	}
 
 	void Task::handleMetaDataChanged ()
 	{
 		HandleMetadataRedirection ();
 		HandleMetadataFilename ();
+
+		if (!ShouldSegment ())
+			return;
+
+		const auto size = Reply_->header (QNetworkRequest::ContentLengthHeader).toLongLong ();
+		if (!To_->resize (size))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to preallocate"
+					<< To_->fileName ()
+					<< To_->errorString ()
+					<< "falling back to a single connection";
+			return;
+		}
+
+		disconnect (Reply_.get (),
+				0,
+				this,
+				0);
+		Reply_->abort ();
+		Core::Instance ().RemoveFinishedReply (Reply_.get ());
+		Reply_.reset ();
+
+		const auto count = XmlSettingsManager::Instance ().property ("SegmentsCount").toInt ();
+		StartSegmented (size, SegmentedDownload::SplitRange (size, count));
 	}
 
 	void Task::handleLocalTransfer ()
@@ -540,75 +878,52 @@ namespace CSTP
 			return;
 		}
 
-		const auto& destination = To_->fileName ();
-		QFile file { localFile };
-		To_->close ();
-		if (!To_->remove () ||
-				!file.copy (destination))
+		const auto source = std::make_shared<QFile> (localFile);
+		if (!source->open (QIODevice::ReadOnly))
 		{
-			if (!To_->open (QIODevice::WriteOnly))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to open destfile"
-						<< To_->fileName ()
-						<< "for writing";
-				QTimer::singleShot (0,
-						this,
-						SLOT (handleError ()));
-				return;
-			}
-
-			if (!file.open (QIODevice::ReadOnly))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to open sourcefile"
-						<< file.fileName ()
-						<< "for reading";
-				QTimer::singleShot (0,
-						this,
-						SLOT (handleError ()));
-				return;
-			}
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open sourcefile"
+					<< source->fileName ()
+					<< "for reading";
+			QTimer::singleShot (0,
+					this,
+					SLOT (handleError ()));
+			return;
+		}
 
-			const int chunkSize = 10 * 1024 * 1024;
-			auto chunk = file.read (chunkSize);
-			while (chunk.size ())
-			{
-				To_->write (chunk);
-				chunk = file.read (chunkSize);
-			}
+		if ((!To_->isOpen () && !To_->open (QIODevice::WriteOnly)) ||
+				!To_->resize (0) ||
+				!To_->seek (0))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open destfile"
+					<< To_->fileName ()
+					<< "for writing";
+			QTimer::singleShot (0,
+					this,
+					SLOT (handleError ()));
+			return;
 		}
 
-		QTimer::singleShot (0,
-				this,
-				SLOT (handleFinished ()));
+		LocalSource_ = source;
+		Done_ = 0;
+		Total_ = fi.size ();
+		StartTime_.restart ();
+
+		if (!Timer_->isActive ())
+			Timer_->start (3000);
+
+		CopyNextChunk ();
 	}
 
 	bool Task::handleReadyRead ()
 	{
-		if (Reply_)
-		{
-			quint64 avail = Reply_->bytesAvailable ();
-			quint64 res = To_->write (Reply_->readAll ());
-			if (static_cast<quint64> (-1) == res ||
-					res != avail)
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "Error writing to file:"
-						<< To_->fileName ()
-						<< To_->errorString ();
-
-				const auto& errString = tr ("Error writing to file %1: %2")
-						.arg (To_->fileName ())
-						.arg (To_->errorString ());
-				const auto& e = Util::MakeNotification ("LeechCraft CSTP",
-						errString,
-						PCritical_);
-				Core::Instance ().GetCoreProxy ()->GetEntityManager ()->HandleEntity (e);
-				emit done (true);
-			}
-		}
-		if (URL_.isEmpty () &&
+		// Otherwise the reading is resumed once the pending writes are done.
+		if (Reply_ && PendingWrites_ < MaxPendingWriteSize)
+			WriteData (Reply_->readAll ());
+
+		if (!ReplyFinished_ &&
+				URL_.isEmpty () &&
 				Core::Instance ().HasFinishedReply (Reply_.get ()))
 		{
 			handleFinished ();
@@ -619,12 +934,13 @@ namespace CSTP
 
 	void Task::handleFinished ()
 	{
-		emit done (false);
+		ReplyFinished_ = true;
+		CheckFinished ();
 	}
 
 	void Task::handleError ()
 	{
-		emit done (true);
+		Fail ();
 	}
 }
 }
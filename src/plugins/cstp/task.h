@@ -35,7 +35,10 @@
 #include <QTime>
 #include <QNetworkReply>
 #include <QStringList>
+#include <QFuture>
 #include <interfaces/structures.h>
+#include "segmenteddownload.h"
+#include "filewriter.h"
 
 class QAuthenticator;
 class QNetworkProxy;
@@ -69,13 +72,48 @@ namespace CSTP
 		const QVariantMap Headers_;
 
 		const QByteArray UploadData_ = {};
+
+		std::unique_ptr<SegmentedDownload, std::function<void (SegmentedDownload*)>> Segmented_;
+		QList<SegmentedDownload::Range_t> SegmentsToResume_;
+
+		/* Set once the server has stopped honouring range requests, so
+		 * the file is downloaded over a single connection from scratch.
+		 */
+		bool RangesUnsupported_ = false;
+
+		/* Where the next chunk of a single connection download goes, or
+		 * -1 to append it to the file.
+		 */
+		qint64 WritePos_ = -1;
+
+		std::shared_ptr<QFile> LocalSource_;
+
+		bool ReplyFinished_ = false;
+		bool WriteFailed_ = false;
+
+		/* Set once done(true) is emitted, so that neither the finished
+		 * reply nor the pending writes report the task as done again.
+		 */
+		bool Failed_ = false;
+		qint64 PendingWrites_ = 0;
+		QFuture<WriteResult> LastWrite_;
+		QFuture<WriteResult> PendingClose_;
 	public:
 		explicit Task (const QUrl& url = QUrl (), const QVariantMap& params = QVariantMap ());
 		explicit Task (QNetworkReply*);
 		~Task ();
 
 		void Start (const std::shared_ptr<QFile>&);
+
+		/** Stops the task and closes the file once the data received so
+		 * far is written, without waiting for that.
+		 */
 		void Stop ();
+
+		/** Returns the closing of the file scheduled by Stop() or by a
+		 * failure. The file shouldn't be reopened until it's finished.
+		 */
+		QFuture<WriteResult> GetPendingClose () const;
 		void ForbidNameChanges ();
 
 		QByteArray Serialize () const;
@@ -88,14 +126,31 @@ namespace CSTP
 		QString GetURL () const;
 		int GetTimeFromStart () const;
 		bool IsRunning () const;
+		bool IsSegmented () const;
 		QString GetErrorString () const;
 	private:
+		QNetworkRequest MakeRequest () const;
+
+		bool ShouldSegment () const;
+		void StartSegmented (qint64, const QList<SegmentedDownload::Range_t>&);
+
+		void WriteData (const QByteArray&);
+		void HandleWritten (qint64, const WriteResult&);
+		void HandleWriteError (const QString&);
+		void CloseFile ();
+		void Fail ();
+		void CheckFinished ();
+
+		void CopyNextChunk ();
+
 		void Reset ();
 		void RecalculateSpeed ();
 		void HandleMetadataRedirection ();
 		void HandleMetadataFilename ();
 	private slots:
 		void handleDataTransferProgress (qint64, qint64);
+		void handleSegmentedProgress (qint64, qint64);
+		void handleRangesUnsupported ();
 		void redirectedConstruction (const QByteArray&);
 		void handleMetaDataChanged ();
 		void handleLocalTransfer ();
@@ -0,0 +1,409 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "segmenteddownloadtest.h"
+#include <memory>
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+#include <QNetworkAccessManager>
+#include "segmenteddownload.h"
+#include "filewriter.h"
+
+QTEST_MAIN (LeechCraft::CSTP::SegmentedDownloadTest)
+
+namespace LeechCraft
+{
+namespace CSTP
+{
+	RangeServer::RangeServer (const QByteArray& data, QObject *parent)
+	: QObject { parent }
+	, Data_ { data }
+	, Server_ { new QTcpServer { this } }
+	, ThrottleTimer_ { new QTimer { this } }
+	{
+		Server_->listen (QHostAddress::LocalHost);
+		connect (Server_,
+				SIGNAL (newConnection ()),
+				this,
+				SLOT (handleNewConnection ()));
+
+		connect (ThrottleTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (sendThrottled ()));
+		ThrottleTimer_->start (20);
+	}
+
+	QUrl RangeServer::GetUrl () const
+	{
+		return QUrl { QString { "http://127.0.0.1:%1/file.bin" }.arg (Server_->serverPort ()) };
+	}
+
+	int RangeServer::GetRequestsCount () const
+	{
+		return RequestsCount_;
+	}
+
+	void RangeServer::SetIgnoreRanges (bool ignore)
+	{
+		IgnoreRanges_ = ignore;
+	}
+
+	void RangeServer::SetSlowOffset (qint64 offset)
+	{
+		SlowOffset_ = offset;
+	}
+
+	void RangeServer::Reply (QTcpSocket *socket, const QByteArray& request)
+	{
+		++RequestsCount_;
+
+		qint64 first = 0;
+		qint64 last = Data_.size () - 1;
+
+		for (const auto& line : request.split ('\n'))
+		{
+			const auto& trimmed = line.trimmed ();
+			if (!trimmed.toLower ().startsWith ("range: bytes="))
+				continue;
+
+			const auto& spec = trimmed.mid (trimmed.indexOf ('=') + 1).split ('-');
+			first = spec.value (0).toLongLong ();
+			if (!spec.value (1).isEmpty ())
+				last = std::min<qint64> (spec.value (1).toLongLong (), last);
+		}
+
+		QByteArray body;
+		QByteArray headers;
+		if (IgnoreRanges_)
+		{
+			headers = "HTTP/1.1 200 OK\r\n";
+			body = Data_;
+			first = 0;
+		}
+		else
+		{
+			headers = "HTTP/1.1 206 Partial Content\r\n";
+			headers += "Content-Range: bytes " + QByteArray::number (first) + '-' +
+					QByteArray::number (last) + '/' + QByteArray::number (Data_.size ()) + "\r\n";
+			body = Data_.mid (first, last - first + 1);
+		}
+		headers += "Accept-Ranges: bytes\r\n";
+		headers += "Content-Length: " + QByteArray::number (body.size ()) + "\r\n";
+		headers += "Connection: close\r\n\r\n";
+
+		socket->write (headers);
+
+		if (first == SlowOffset_)
+			Throttled_ [socket] = body;
+		else
+		{
+			socket->write (body);
+			socket->disconnectFromHost ();
+		}
+	}
+
+	void RangeServer::handleNewConnection ()
+	{
+		while (const auto socket = Server_->nextPendingConnection ())
+			connect (socket,
+					SIGNAL (readyRead ()),
+					this,
+					SLOT (handleReadyRead ()));
+	}
+
+	void RangeServer::handleReadyRead ()
+	{
+		const auto socket = qobject_cast<QTcpSocket*> (sender ());
+
+		auto& request = Requests_ [socket];
+		request += socket->readAll ();
+		if (!request.contains ("\r\n\r\n"))
+			return;
+
+		Reply (socket, Requests_.take (socket));
+	}
+
+	void RangeServer::sendThrottled ()
+	{
+		const int chunkSize = 32 * 1024;
+
+		for (auto i = Throttled_.begin (); i != Throttled_.end (); )
+		{
+			const auto socket = i.key ();
+			if (socket->state () != QAbstractSocket::ConnectedState)
+			{
+				socket->deleteLater ();
+				i = Throttled_.erase (i);
+				continue;
+			}
+
+			socket->write (i->left (chunkSize));
+			i->remove (0, chunkSize);
+
+			if (i->isEmpty ())
+			{
+				socket->disconnectFromHost ();
+				i = Throttled_.erase (i);
+			}
+			else
+				++i;
+		}
+	}
+
+	namespace
+	{
+		const qint64 MiB = 1024 * 1024;
+
+		QByteArray MakeData (qint64 size)
+		{
+			QByteArray result;
+			result.resize (size);
+			for (qint64 i = 0; i < size; ++i)
+				result [static_cast<int> (i)] = static_cast<char> ((i * 31) % 251);
+			return result;
+		}
+
+		std::shared_ptr<FileWriter> MakeWriter ()
+		{
+			std::shared_ptr<FileWriter> writer
+			{
+				new FileWriter,
+				[] (FileWriter *writer)
+				{
+					writer->quit ();
+					writer->wait (5000);
+					delete writer;
+				}
+			};
+			writer->start ();
+			return writer;
+		}
+
+		std::shared_ptr<QFile> MakeFile (qint64 size)
+		{
+			const auto file = std::make_shared<QTemporaryFile> ();
+			file->open ();
+			file->resize (size);
+			return file;
+		}
+
+		QByteArray ReadBack (const std::shared_ptr<QFile>& file)
+		{
+			file->flush ();
+			file->seek (0);
+			return file->readAll ();
+		}
+
+		bool WaitForResult (SegmentedDownload& dl)
+		{
+			QSignalSpy finishedSpy { &dl, SIGNAL (finished ()) };
+			QSignalSpy failedSpy { &dl, SIGNAL (failed ()) };
+			QSignalSpy unsupportedSpy { &dl, SIGNAL (rangesUnsupported ()) };
+
+			dl.Start ();
+
+			QElapsedTimer timer;
+			timer.start ();
+			while (finishedSpy.isEmpty () &&
+					failedSpy.isEmpty () &&
+					unsupportedSpy.isEmpty () &&
+					timer.elapsed () < 30000)
+				QTest::qWait (20);
+
+			return !finishedSpy.isEmpty ();
+		}
+	}
+
+	void SegmentedDownloadTest::splitRange ()
+	{
+		const auto& ranges = SegmentedDownload::SplitRange (10 * MiB + 3, 4);
+
+		QCOMPARE (ranges.size (), 4);
+		QCOMPARE (ranges.first ().first, qint64 { 0 });
+		QCOMPARE (ranges.last ().second, 10 * MiB + 2);
+		for (int i = 1; i < ranges.size (); ++i)
+			QCOMPARE (ranges.at (i).first, ranges.at (i - 1).second + 1);
+	}
+
+	void SegmentedDownloadTest::splitSmall ()
+	{
+		const auto& ranges = SegmentedDownload::SplitRange (MiB + MiB / 2, 8);
+
+		QCOMPARE (ranges.size (), 1);
+		QCOMPARE (ranges.first (), SegmentedDownload::Range_t (0, MiB + MiB / 2 - 1));
+	}
+
+	void SegmentedDownloadTest::downloadWhole ()
+	{
+		const auto& data = MakeData (4 * MiB + 17);
+		RangeServer server { data };
+		QNetworkAccessManager nam;
+		const auto& writer = MakeWriter ();
+
+		const auto& file = MakeFile (data.size ());
+		SegmentedDownload dl
+		{
+			&nam,
+			writer.get (),
+			QNetworkRequest { server.GetUrl () },
+			file,
+			data.size (),
+			SegmentedDownload::SplitRange (data.size (), 4),
+			4
+		};
+
+		QVERIFY (WaitForResult (dl));
+		QCOMPARE (dl.GetDone (), dl.GetTotal ());
+		QVERIFY (dl.GetRemaining ().isEmpty ());
+		QCOMPARE (server.GetRequestsCount (), 4);
+		QVERIFY (ReadBack (file) == data);
+	}
+
+	void SegmentedDownloadTest::resumeRanges ()
+	{
+		const auto& data = MakeData (3 * MiB);
+		RangeServer server { data };
+		QNetworkAccessManager nam;
+		const auto& writer = MakeWriter ();
+
+		const auto& file = MakeFile (data.size ());
+		file->write (data.left (MiB));
+		file->seek (2 * MiB);
+		file->write (data.mid (2 * MiB, MiB / 2));
+
+		const QList<SegmentedDownload::Range_t> remaining
+		{
+			{ MiB, 2 * MiB - 1 },
+			{ 2 * MiB + MiB / 2, 3 * MiB - 1 }
+		};
+
+		SegmentedDownload dl { &nam, writer.get (), QNetworkRequest { server.GetUrl () }, file, data.size (), remaining, 2 };
+		QCOMPARE (dl.GetDone (), MiB + MiB / 2);
+
+		QVERIFY (WaitForResult (dl));
+		QCOMPARE (dl.GetSessionReceived (), MiB + MiB / 2);
+		QVERIFY (ReadBack (file) == data);
+	}
+
+	void SegmentedDownloadTest::stealFromSlow ()
+	{
+		const auto& data = MakeData (8 * MiB);
+		RangeServer server { data };
+		server.SetSlowOffset (0);
+		QNetworkAccessManager nam;
+		const auto& writer = MakeWriter ();
+
+		const auto& file = MakeFile (data.size ());
+		SegmentedDownload dl
+		{
+			&nam,
+			writer.get (),
+			QNetworkRequest { server.GetUrl () },
+			file,
+			data.size (),
+			SegmentedDownload::SplitRange (data.size (), 2),
+			2
+		};
+
+		QVERIFY (WaitForResult (dl));
+		QVERIFY (server.GetRequestsCount () > 2);
+		QVERIFY (ReadBack (file) == data);
+	}
+
+	void SegmentedDownloadTest::persistOnlyWritten ()
+	{
+		const auto& data = MakeData (2 * MiB);
+		RangeServer server { data };
+		QNetworkAccessManager nam;
+		const auto& writer = MakeWriter ();
+		writer->SetPaused (true);
+
+		const auto& ranges = SegmentedDownload::SplitRange (data.size (), 2);
+		const auto& file = MakeFile (data.size ());
+		SegmentedDownload dl { &nam, writer.get (), QNetworkRequest { server.GetUrl () }, file, data.size (), ranges, 2 };
+
+		QSignalSpy finishedSpy { &dl, SIGNAL (finished ()) };
+		dl.Start ();
+
+		QElapsedTimer timer;
+		timer.start ();
+		while (dl.GetDone () < dl.GetTotal () && timer.elapsed () < 30000)
+			QTest::qWait (20);
+
+		// Everything is received, but nothing is written yet.
+		QCOMPARE (dl.GetDone (), dl.GetTotal ());
+		QCOMPARE (dl.GetRemaining (), ranges);
+		QVERIFY (finishedSpy.isEmpty ());
+
+		writer->SetPaused (false);
+		while (finishedSpy.isEmpty () && timer.elapsed () < 30000)
+			QTest::qWait (20);
+
+		QVERIFY (!finishedSpy.isEmpty ());
+		QVERIFY (dl.GetRemaining ().isEmpty ());
+		QVERIFY (ReadBack (file) == data);
+	}
+
+	void SegmentedDownloadTest::reportIgnoredRanges ()
+	{
+		const auto& data = MakeData (4 * MiB);
+		RangeServer server { data };
+		server.SetIgnoreRanges (true);
+		QNetworkAccessManager nam;
+		const auto& writer = MakeWriter ();
+
+		const auto& file = MakeFile (data.size ());
+		SegmentedDownload dl
+		{
+			&nam,
+			writer.get (),
+			QNetworkRequest { server.GetUrl () },
+			file,
+			data.size (),
+			SegmentedDownload::SplitRange (data.size (), 2),
+			2
+		};
+
+		QSignalSpy failedSpy { &dl, SIGNAL (failed ()) };
+		QSignalSpy unsupportedSpy { &dl, SIGNAL (rangesUnsupported ()) };
+
+		QVERIFY (!WaitForResult (dl));
+		QCOMPARE (unsupportedSpy.size (), 1);
+		QVERIFY (failedSpy.isEmpty ());
+		QVERIFY (!dl.GetErrorString ().isEmpty ());
+		QVERIFY (!dl.IsRunning ());
+		QCOMPARE (dl.GetRemaining ().size (), 2);
+	}
+}
+}
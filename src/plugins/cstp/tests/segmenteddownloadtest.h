@@ -0,0 +1,95 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QUrl>
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+namespace LeechCraft
+{
+namespace CSTP
+{
+	/** A minimal HTTP server serving the given data with range requests
+	 * support, one request per connection.
+	 */
+	class RangeServer : public QObject
+	{
+		Q_OBJECT
+
+		const QByteArray Data_;
+		QTcpServer * const Server_;
+		QTimer * const ThrottleTimer_;
+
+		bool IgnoreRanges_ = false;
+		qint64 SlowOffset_ = -1;
+		int RequestsCount_ = 0;
+
+		QHash<QTcpSocket*, QByteArray> Requests_;
+		QHash<QTcpSocket*, QByteArray> Throttled_;
+	public:
+		RangeServer (const QByteArray&, QObject* = 0);
+
+		QUrl GetUrl () const;
+		int GetRequestsCount () const;
+
+		void SetIgnoreRanges (bool);
+
+		/** Makes the ranges starting at the given offset to be sent
+		 * slowly, emulating a throttled connection.
+		 */
+		void SetSlowOffset (qint64);
+	private:
+		void Reply (QTcpSocket*, const QByteArray&);
+	private slots:
+		void handleNewConnection ();
+		void handleReadyRead ();
+		void sendThrottled ();
+	};
+
+	class SegmentedDownloadTest : public QObject
+	{
+		Q_OBJECT
+	private slots:
+		void splitRange ();
+		void splitSmall ();
+
+		void downloadWhole ();
+		void resumeRanges ();
+		void stealFromSlow ();
+		void persistOnlyWritten ();
+		void reportIgnoredRanges ();
+	};
+}
+}
@@ -0,0 +1,119 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "compressioncache.h"
+#include <zlib.h>
+#include <QFile>
+#include <QFileInfo>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	namespace
+	{
+		const auto MaxCacheCost = 16 * 1024 * 1024;
+	}
+
+	QByteArray GzipCompress (const QByteArray& data)
+	{
+		z_stream stream {};
+
+		// 16 added to the window bits makes zlib write a gzip header.
+		if (deflateInit2 (&stream, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to initialize deflate:"
+					<< stream.msg;
+			return {};
+		}
+
+		QByteArray result;
+		result.resize (deflateBound (&stream, data.size ()));
+
+		stream.next_in = reinterpret_cast<Bytef*> (const_cast<char*> (data.constData ()));
+		stream.avail_in = data.size ();
+		stream.next_out = reinterpret_cast<Bytef*> (result.data ());
+		stream.avail_out = result.size ();
+
+		const auto rc = deflate (&stream, Z_FINISH);
+		deflateEnd (&stream);
+
+		if (rc != Z_STREAM_END)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to compress"
+					<< data.size ()
+					<< "bytes:"
+					<< rc;
+			return {};
+		}
+
+		result.resize (stream.total_out);
+		return result;
+	}
+
+	CompressionCache::CompressionCache ()
+	: Cache_ { MaxCacheCost }
+	{
+	}
+
+	QByteArray CompressionCache::GetCompressed (const QFileInfo& fi)
+	{
+		const auto& path = fi.absoluteFilePath ();
+		const auto& modified = fi.lastModified ();
+
+		{
+			QMutexLocker locker { &Lock_ };
+			if (const auto entry = Cache_.object (path))
+				if (entry->Modified_ == modified && entry->Size_ == fi.size ())
+					return entry->Data_;
+		}
+
+		QFile file { path };
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< path
+					<< file.errorString ();
+			return {};
+		}
+
+		const auto& data = GzipCompress (file.readAll ());
+		if (data.isNull ())
+			return {};
+
+		QMutexLocker locker { &Lock_ };
+		Cache_.insert (path, new Entry { modified, fi.size (), data }, data.size ());
+		return data;
+	}
+}
+}
@@ -0,0 +1,74 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QCache>
+#include <QMutex>
+#include <QDateTime>
+#include <QByteArray>
+
+class QFileInfo;
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	/** Compresses the given data into the gzip format.
+	 */
+	QByteArray GzipCompress (const QByteArray&);
+
+	/** Keeps gzip-compressed contents of the recently served small files
+	 * of compressible types, so that the popular ones aren't read and
+	 * recompressed on each request.
+	 *
+	 * The cached data is bound to the file's size and modification time
+	 * and is thus recompressed once the file changes.
+	 */
+	class CompressionCache
+	{
+		struct Entry
+		{
+			QDateTime Modified_;
+			qint64 Size_;
+			QByteArray Data_;
+		};
+
+		mutable QMutex Lock_;
+		QCache<QString, Entry> Cache_;
+	public:
+		CompressionCache ();
+
+		/** Returns the compressed contents of the file pointed to by fi,
+		 * or a null byte array if it cannot be read.
+		 */
+		QByteArray GetCompressed (const QFileInfo& fi);
+	};
+}
+}
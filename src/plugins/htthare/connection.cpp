@@ -35,17 +35,36 @@ namespace LeechCraft
 {
 namespace HttHare
 {
+	namespace
+	{
+		std::atomic<quint64> NextConnectionID { 0 };
+	}
+
 	Connection::Connection (boost::asio::io_service& service,
-			const StorageManager& stMgr, IconResolver *resolver, TrManager *trMgr)
+			const StorageManager& stMgr, IconResolver *resolver, TrManager *trMgr,
+			DirListingCache *dirCache, CompressionCache& compressionCache,
+			ConnectionsTracker& tracker, const ConnectionSettings& settings)
 	: Strand_ { service }
 	, Socket_ { service }
+	, IdleTimer_ { service }
 	, StorageMgr_ (stMgr)
 	, IconResolver_ { resolver }
 	, TrManager_ { trMgr }
+	, DirCache_ { dirCache }
+	, CompressionCache_ (compressionCache)
+	, Settings_ (settings)
+	, Tracker_ (tracker)
+	, ID_ { NextConnectionID++ }
 	, Buf_ { 2 * 1024 }
 	{
 	}
 
+	Connection::~Connection ()
+	{
+		if (IsTracked_)
+			Tracker_.Remove (this);
+	}
+
 	boost::asio::ip::tcp::socket& Connection::GetSocket ()
 	{
 		return Socket_;
@@ -66,14 +85,98 @@ namespace HttHare
 		return TrManager_;
 	}
 
+	DirListingCache* Connection::GetDirListingCache () const
+	{
+		return DirCache_;
+	}
+
+	CompressionCache& Connection::GetCompressionCache () const
+	{
+		return CompressionCache_;
+	}
+
 	const StorageManager& Connection::GetStorageManager () const
 	{
 		return StorageMgr_;
 	}
 
+	const ConnectionSettings& Connection::GetSettings () const
+	{
+		return Settings_;
+	}
+
+	bool Connection::CanKeepAlive () const
+	{
+		return HandledRequests_ < Settings_.MaxRequests_;
+	}
+
+	void Connection::AddBytesSent (quint64 bytes)
+	{
+		BytesSent_ += bytes;
+	}
+
+	void Connection::SetCurrentRequest (const QString& request)
+	{
+		QMutexLocker locker { &InfoLock_ };
+		CurrentRequest_ = request;
+	}
+
+	ConnectionStats Connection::GetStats () const
+	{
+		QMutexLocker locker { &InfoLock_ };
+		return { ID_, Peer_, CurrentRequest_, BytesSent_.load (), BytesReceived_.load () };
+	}
+
 	void Connection::Start ()
+	{
+		boost::system::error_code ec;
+		const auto& endpoint = Socket_.remote_endpoint (ec);
+		if (!ec)
+		{
+			QMutexLocker locker { &InfoLock_ };
+			Peer_ = QString::fromStdString (endpoint.address ().to_string ()) +
+					':' + QString::number (endpoint.port ());
+		}
+
+		Tracker_.Add (this);
+		IsTracked_ = true;
+
+		ReadHeader ();
+	}
+
+	void Connection::FinishRequest (bool keepAlive)
+	{
+		if (keepAlive)
+			ReadHeader ();
+		else
+			Close ();
+	}
+
+	void Connection::CloseIdle ()
 	{
 		auto conn = shared_from_this ();
+		Strand_.post ([conn]
+				{
+					if (conn->IsIdle_)
+						conn->Close ();
+				});
+	}
+
+	void Connection::ReadHeader ()
+	{
+		auto conn = shared_from_this ();
+
+		if (HandledRequests_)
+		{
+			IsIdle_ = true;
+			Tracker_.SetIdle (conn);
+		}
+
+		IdleTimer_.expires_from_now (boost::posix_time::seconds { Settings_.KeepAliveTimeout_ });
+		IdleTimer_.async_wait (Strand_.wrap ([conn] (const boost::system::error_code& ec)
+					{ conn->HandleIdleTimeout (ec); }));
+
+		// Pipelined requests are already in the buffer, so this completes right away for them.
 		boost::asio::async_read_until (Socket_,
 				Buf_,
 				std::string { "\r\n\r\n" },
@@ -81,15 +184,57 @@ namespace HttHare
 					{ conn->HandleHeader (ec, transferred); }));
 	}
 
-	void Connection::HandleHeader (const boost::system::error_code&, unsigned long transferred)
+	void Connection::HandleHeader (const boost::system::error_code& ec, unsigned long transferred)
 	{
+		IdleTimer_.expires_at (boost::posix_time::pos_infin);
+
+		if (IsIdle_)
+		{
+			IsIdle_ = false;
+			Tracker_.SetBusy (this);
+		}
+
+		if (ec)
+		{
+			if (ec != boost::asio::error::eof &&
+					ec != boost::asio::error::operation_aborted)
+				qWarning () << Q_FUNC_INFO
+						<< ec.message ().c_str ();
+
+			Close ();
+			return;
+		}
+
+		BytesReceived_ += transferred;
+
 		QByteArray data;
 		data.resize (transferred);
 
 		std::istream istr (&Buf_);
 		istr.read (data.data (), transferred);
 
-		RequestHandler { shared_from_this () } (data);
+		++HandledRequests_;
+
+		(*std::make_shared<RequestHandler> (shared_from_this ())) (data);
+	}
+
+	void Connection::HandleIdleTimeout (const boost::system::error_code& ec)
+	{
+		if (ec == boost::asio::error::operation_aborted)
+			return;
+
+		// The timer might have been rearmed after this handler has been queued.
+		if (IdleTimer_.expires_at () > boost::asio::deadline_timer::traits_type::now ())
+			return;
+
+		Close ();
+	}
+
+	void Connection::Close ()
+	{
+		boost::system::error_code ec;
+		Socket_.shutdown (boost::asio::socket_base::shutdown_both, ec);
+		Socket_.close (ec);
 	}
 }
 }
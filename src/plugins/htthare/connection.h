@@ -30,7 +30,11 @@
 #pragma once
 
 #include <memory>
+#include <atomic>
 #include <boost/asio.hpp>
+#include <QMutex>
+#include <QString>
+#include "connectionstracker.h"
 
 namespace LeechCraft
 {
@@ -39,19 +43,54 @@ namespace HttHare
 	class StorageManager;
 	class IconResolver;
 	class TrManager;
+	class DirListingCache;
+	class CompressionCache;
+
+	struct ConnectionSettings
+	{
+		/* How long an idle keep-alive connection waits for the next
+		 * request before being closed.
+		 */
+		int KeepAliveTimeout_ = 15;
+
+		/* How many requests are served over a single connection.
+		 */
+		int MaxRequests_ = 100;
+	};
 
 	class Connection : public std::enable_shared_from_this<Connection>
 	{
 		boost::asio::io_service::strand Strand_;
 		boost::asio::ip::tcp::socket Socket_;
+		boost::asio::deadline_timer IdleTimer_;
 
 		const StorageManager& StorageMgr_;
 		IconResolver * const IconResolver_;
 		TrManager * const TrManager_;
+		DirListingCache * const DirCache_;
+		CompressionCache& CompressionCache_;
+
+		const ConnectionSettings Settings_;
+		int HandledRequests_ = 0;
+
+		ConnectionsTracker& Tracker_;
+		bool IsTracked_ = false;
+		bool IsIdle_ = false;
+
+		const quint64 ID_;
+		std::atomic<quint64> BytesSent_ { 0 };
+		std::atomic<quint64> BytesReceived_ { 0 };
+
+		mutable QMutex InfoLock_;
+		QString Peer_;
+		QString CurrentRequest_;
 
 		boost::asio::streambuf Buf_;
 	public:
-		Connection (boost::asio::io_service&, const StorageManager&, IconResolver*, TrManager*);
+		Connection (boost::asio::io_service&, const StorageManager&,
+				IconResolver*, TrManager*, DirListingCache*, CompressionCache&,
+				ConnectionsTracker&, const ConnectionSettings&);
+		~Connection ();
 
 		Connection (const Connection&) = delete;
 		Connection& operator= (const Connection&) = delete;
@@ -60,12 +99,38 @@ namespace HttHare
 		boost::asio::io_service::strand& GetStrand ();
 		IconResolver* GetIconResolver () const;
 		TrManager* GetTrManager () const;
+		DirListingCache* GetDirListingCache () const;
+		CompressionCache& GetCompressionCache () const;
 
 		const StorageManager& GetStorageManager () const;
+		const ConnectionSettings& GetSettings () const;
+
+		/** Returns whether the connection may be kept open after the
+		 * current request.
+		 */
+		bool CanKeepAlive () const;
+
+		void AddBytesSent (quint64);
+		void SetCurrentRequest (const QString&);
+		ConnectionStats GetStats () const;
 
 		void Start ();
+
+		/** Called once the response to the current request has been
+		 * written. Either waits for the next request or closes the
+		 * connection.
+		 */
+		void FinishRequest (bool keepAlive);
+
+		/** Closes the connection if it is still waiting for the next
+		 * keep-alive request by the time this runs on its strand.
+		 */
+		void CloseIdle ();
 	private:
+		void ReadHeader ();
 		void HandleHeader (const boost::system::error_code&, unsigned long);
+		void HandleIdleTimeout (const boost::system::error_code&);
+		void Close ();
 	};
 
 	typedef std::shared_ptr<Connection> Connection_ptr;
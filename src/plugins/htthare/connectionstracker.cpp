@@ -0,0 +1,110 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "connectionstracker.h"
+#include <algorithm>
+#include "connection.h"
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	void ConnectionsTracker::Add (const Connection *conn)
+	{
+		QMutexLocker locker { &Lock_ };
+		Connections_ << conn;
+	}
+
+	void ConnectionsTracker::Remove (const Connection *conn)
+	{
+		std::function<void ()> handler;
+
+		{
+			QMutexLocker locker { &Lock_ };
+			Connections_.remove (conn);
+			RemoveIdle (conn);
+			handler = RemoveHandler_;
+		}
+
+		if (handler)
+			handler ();
+	}
+
+	void ConnectionsTracker::SetIdle (const std::shared_ptr<Connection>& conn)
+	{
+		QMutexLocker locker { &Lock_ };
+		Idle_ << IdleConnection { conn.get (), conn };
+	}
+
+	void ConnectionsTracker::SetBusy (const Connection *conn)
+	{
+		QMutexLocker locker { &Lock_ };
+		RemoveIdle (conn);
+	}
+
+	std::shared_ptr<Connection> ConnectionsTracker::TakeOldestIdle ()
+	{
+		QMutexLocker locker { &Lock_ };
+		while (!Idle_.isEmpty ())
+			if (const auto& conn = Idle_.takeFirst ().Weak_.lock ())
+				return conn;
+		return {};
+	}
+
+	void ConnectionsTracker::SetRemoveHandler (const std::function<void ()>& handler)
+	{
+		QMutexLocker locker { &Lock_ };
+		RemoveHandler_ = handler;
+	}
+
+	int ConnectionsTracker::GetCount () const
+	{
+		QMutexLocker locker { &Lock_ };
+		return Connections_.size ();
+	}
+
+	QList<ConnectionStats> ConnectionsTracker::GetStats () const
+	{
+		QMutexLocker locker { &Lock_ };
+
+		QList<ConnectionStats> result;
+		for (const auto conn : Connections_)
+			result << conn->GetStats ();
+		return result;
+	}
+
+	void ConnectionsTracker::RemoveIdle (const Connection *conn)
+	{
+		const auto pos = std::find_if (Idle_.begin (), Idle_.end (),
+				[conn] (const IdleConnection& idle) { return idle.Conn_ == conn; });
+		if (pos != Idle_.end ())
+			Idle_.erase (pos);
+	}
+}
+}
@@ -0,0 +1,97 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <QMutex>
+#include <QSet>
+#include <QList>
+#include <QString>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	class Connection;
+
+	struct ConnectionStats
+	{
+		quint64 ID_;
+		QString Peer_;
+		QString Request_;
+		quint64 Sent_;
+		quint64 Received_;
+	};
+
+	/* Keeps track of the open connections. It's used both from the I/O
+	 * threads and from the GUI thread.
+	 */
+	class ConnectionsTracker
+	{
+		mutable QMutex Lock_;
+		QSet<const Connection*> Connections_;
+
+		struct IdleConnection
+		{
+			const Connection *Conn_;
+			std::weak_ptr<Connection> Weak_;
+		};
+		// Oldest first.
+		QList<IdleConnection> Idle_;
+
+		std::function<void ()> RemoveHandler_;
+	public:
+		void Add (const Connection*);
+		void Remove (const Connection*);
+
+		/** Marks the connection as waiting for the next keep-alive
+		 * request, or as serving one again.
+		 */
+		void SetIdle (const std::shared_ptr<Connection>&);
+		void SetBusy (const Connection*);
+
+		/** Returns the connection that has been idle the longest, if
+		 * any, and stops considering it idle.
+		 */
+		std::shared_ptr<Connection> TakeOldestIdle ();
+
+		/** Sets the function called after a connection has been
+		 * removed, outside of the tracker lock.
+		 */
+		void SetRemoveHandler (const std::function<void ()>&);
+
+		int GetCount () const;
+		QList<ConnectionStats> GetStats () const;
+	private:
+		void RemoveIdle (const Connection*);
+	};
+}
+}
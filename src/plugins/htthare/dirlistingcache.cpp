@@ -0,0 +1,160 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "dirlistingcache.h"
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QDir>
+#include <util/sys/mimedetector.h>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	namespace
+	{
+		const auto MaxCachedDirs = 64;
+	}
+
+	DirListingCache::DirListingCache (QObject *parent)
+	: QObject { parent }
+	, Watcher_ { new QFileSystemWatcher { this } }
+	{
+		connect (Watcher_,
+				SIGNAL (directoryChanged (QString)),
+				this,
+				SLOT (handleDirectoryChanged (QString)));
+	}
+
+	DirListing_ptr DirListingCache::GetListing (const QString& path)
+	{
+		/* The modification time is checked as well to cover the changes
+		 * happening before the watch is set up by the event loop.
+		 */
+		const auto& modified = QFileInfo { path }.lastModified ();
+
+		{
+			QMutexLocker locker { &Lock_ };
+			const auto& listing = Listings_.value (path);
+			if (listing && listing->Modified_ == modified)
+			{
+				Touch (path);
+				return listing;
+			}
+		}
+
+		const auto& listing = Scan (path, modified);
+
+		QStringList evicted;
+		bool isNew = false;
+		{
+			QMutexLocker locker { &Lock_ };
+			isNew = !Listings_.contains (path);
+			Listings_ [path] = listing;
+
+			if (isNew)
+			{
+				UsageOrder_ << path;
+				while (UsageOrder_.size () > MaxCachedDirs)
+				{
+					const auto& oldest = UsageOrder_.takeFirst ();
+					Listings_.remove (oldest);
+					evicted << oldest;
+				}
+			}
+			else
+				Touch (path);
+		}
+
+		if (isNew)
+			QMetaObject::invokeMethod (this,
+					"watch",
+					Qt::QueuedConnection,
+					Q_ARG (QString, path));
+		for (const auto& oldest : evicted)
+			QMetaObject::invokeMethod (this,
+					"unwatch",
+					Qt::QueuedConnection,
+					Q_ARG (QString, oldest));
+
+		return listing;
+	}
+
+	void DirListingCache::Touch (const QString& path)
+	{
+		const auto pos = UsageOrder_.indexOf (path);
+		if (pos >= 0 && pos != UsageOrder_.size () - 1)
+			UsageOrder_.move (pos, UsageOrder_.size () - 1);
+	}
+
+	DirListing_ptr DirListingCache::Scan (const QString& path, const QDateTime& modified) const
+	{
+		const auto& infos = QDir { path }
+				.entryInfoList (QDir::AllEntries | QDir::NoDot,
+						QDir::Name | QDir::DirsFirst);
+
+		auto listing = std::make_shared<DirListing> ();
+		listing->Modified_ = modified;
+		listing->Entries_.reserve (infos.size ());
+
+		Util::MimeDetector detector;
+		for (const auto& info : infos)
+			listing->Entries_.append ({
+					info.fileName (),
+					detector (info.filePath ()),
+					info.size (),
+					info.created ()
+				});
+
+		return listing;
+	}
+
+	void DirListingCache::watch (const QString& path)
+	{
+		Watcher_->addPath (path);
+	}
+
+	void DirListingCache::unwatch (const QString& path)
+	{
+		Watcher_->removePath (path);
+	}
+
+	void DirListingCache::handleDirectoryChanged (const QString& path)
+	{
+		{
+			QMutexLocker locker { &Lock_ };
+			Listings_.remove (path);
+			UsageOrder_.removeOne (path);
+		}
+
+		// The watch is set up again once the directory is listed next time.
+		Watcher_->removePath (path);
+	}
+}
+}
@@ -0,0 +1,96 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QDateTime>
+#include <QStringList>
+
+class QFileSystemWatcher;
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	struct DirEntry
+	{
+		QString Name_;
+		QString MimeType_;
+		qint64 Size_;
+		QDateTime Created_;
+	};
+
+	struct DirListing
+	{
+		QDateTime Modified_;
+		QList<DirEntry> Entries_;
+	};
+
+	typedef std::shared_ptr<const DirListing> DirListing_ptr;
+
+	/** Caches the contents of the recently listed directories, so that
+	 * repeated requests to large directories don't rescan them and rerun
+	 * MIME detection for each file.
+	 *
+	 * The object should live in a thread with an event loop, since the
+	 * cached directories are watched for changes. GetListing() itself
+	 * may be called from any thread.
+	 */
+	class DirListingCache : public QObject
+	{
+		Q_OBJECT
+
+		QFileSystemWatcher * const Watcher_;
+
+		mutable QMutex Lock_;
+		QHash<QString, DirListing_ptr> Listings_;
+
+		/* The cached paths, least recently used first.
+		 */
+		QStringList UsageOrder_;
+	public:
+		DirListingCache (QObject* = 0);
+
+		DirListing_ptr GetListing (const QString& path);
+	private:
+		// Marks the path as the most recently used one, Lock_ must be held.
+		void Touch (const QString&);
+
+		DirListing_ptr Scan (const QString&, const QDateTime&) const;
+	private slots:
+		void watch (const QString&);
+		void unwatch (const QString&);
+		void handleDirectoryChanged (const QString&);
+	};
+}
+}
@@ -36,11 +36,27 @@
 #include <util/xsd/addressesmodelmanager.h>
 #include "server.h"
 #include "xmlsettingsmanager.h"
+#include "statsmodel.h"
 
 namespace LeechCraft
 {
 namespace HttHare
 {
+	namespace
+	{
+		ServerSettings GetServerSettings ()
+		{
+			const auto& xsm = XmlSettingsManager::Instance ();
+
+			ServerSettings settings;
+			settings.WorkerThreads_ = xsm.property ("WorkerThreads").toInt ();
+			settings.MaxConnections_ = xsm.property ("MaxConnections").toInt ();
+			settings.Connection_.KeepAliveTimeout_ = xsm.property ("KeepAliveTimeout").toInt ();
+			settings.Connection_.MaxRequests_ = xsm.property ("MaxRequestsPerConnection").toInt ();
+			return settings;
+		}
+	}
+
 	void Plugin::Init (ICoreProxy_ptr)
 	{
 		Util::InstallTranslator ("htthare");
@@ -58,8 +74,18 @@ namespace HttHare
 
 		XSD_->SetDataSource ("AddressesDataView", AddrMgr_->GetModel ());
 
+		StatsModel_ = new StatsModel { this };
+		XSD_->SetDataSource ("ActiveTransfersView", StatsModel_);
+
 		XmlSettingsManager::Instance ().RegisterObject ("EnableServer",
 				this, "handleEnableServerChanged");
+		XmlSettingsManager::Instance ().RegisterObject ({
+					"WorkerThreads",
+					"MaxConnections",
+					"KeepAliveTimeout",
+					"MaxRequestsPerConnection"
+				},
+				this, "reapplyAddresses");
 		handleEnableServerChanged ();
 	}
 
@@ -97,6 +123,14 @@ namespace HttHare
 		return XSD_;
 	}
 
+	void Plugin::StartServer ()
+	{
+		S_.reset (new Server { AddrMgr_->GetAddresses (), GetServerSettings () });
+		S_->Start ();
+
+		StatsModel_->SetServer (S_);
+	}
+
 	void Plugin::handleEnableServerChanged ()
 	{
 		const bool enable = XmlSettingsManager::Instance ().property ("EnableServer").toBool ();
@@ -107,10 +141,7 @@ namespace HttHare
 		if (S_)
 			S_.reset ();
 		else
-		{
-			S_.reset (new Server { AddrMgr_->GetAddresses () });
-			S_->Start ();
-		}
+			StartServer ();
 	}
 
 	void Plugin::reapplyAddresses ()
@@ -125,8 +156,7 @@ namespace HttHare
 		QTimer::singleShot (100, &loop, SLOT (quit ()));
 		loop.exec ();
 
-		S_.reset (new Server { AddrMgr_->GetAddresses () });
-		S_->Start ();
+		StartServer ();
 	}
 }
 }
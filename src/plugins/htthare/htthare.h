@@ -44,6 +44,7 @@ namespace Util
 namespace HttHare
 {
 	class Server;
+	class StatsModel;
 
 	class Plugin : public QObject
 				 , public IInfo
@@ -56,6 +57,7 @@ namespace HttHare
 
 		std::shared_ptr<Server> S_;
 		Util::AddressesModelManager *AddrMgr_;
+		StatsModel *StatsModel_;
 
 		Util::XmlSettingsDialog_ptr XSD_;
 	public:
@@ -68,6 +70,8 @@ namespace HttHare
 		QIcon GetIcon () const;
 
 		Util::XmlSettingsDialog_ptr GetSettingsDialog () const;
+	private:
+		void StartServer ();
 	private slots:
 		void handleEnableServerChanged ();
 		void reapplyAddresses ();
@@ -37,25 +37,58 @@ namespace LeechCraft
 {
 namespace HttHare
 {
+	namespace
+	{
+		QByteArray Resolve (QString mimetype, int dim)
+		{
+			mimetype.replace ('/', '-');
+			auto icon = QIcon::fromTheme (mimetype);
+			if (icon.isNull ())
+			{
+				mimetype.replace ("x-", "");
+				icon = QIcon::fromTheme (mimetype);
+			}
+
+			if (icon.isNull ())
+				icon = QIcon::fromTheme ("application-octet-stream");
+
+			return Util::GetAsBase64Src (icon.pixmap (dim, dim).toImage ()).toLatin1 ();
+		}
+	}
+
 	IconResolver::IconResolver (QObject *parent)
 	: QObject (parent)
 	{
 	}
 
-	void IconResolver::resolveMime (QString mimetype, QByteArray& image, int dim)
+	QByteArray IconResolver::GetIcon (const QString& mimetype, int dim)
 	{
-		mimetype.replace ('/', '-');
-		auto icon = QIcon::fromTheme (mimetype);
-		if (icon.isNull ())
+		const Key_t key { mimetype, dim };
+
+		QMutexLocker locker { &Lock_ };
+		if (Cache_.contains (key))
+			return Cache_ [key];
+
+		if (!Pending_.contains (key))
 		{
-			mimetype.replace ("x-", "");
-			icon = QIcon::fromTheme (mimetype);
+			Pending_ << key;
+			QMetaObject::invokeMethod (this,
+					"resolveMime",
+					Qt::QueuedConnection,
+					Q_ARG (QString, mimetype),
+					Q_ARG (int, dim));
 		}
 
-		if (icon.isNull ())
-			icon = QIcon::fromTheme ("application-octet-stream");
+		return {};
+	}
+
+	void IconResolver::resolveMime (const QString& mimetype, int dim)
+	{
+		const auto& image = Resolve (mimetype, dim);
 
-		image = Util::GetAsBase64Src (icon.pixmap (dim, dim).toImage ()).toLatin1 ();
+		QMutexLocker locker { &Lock_ };
+		Cache_ [{ mimetype, dim }] = image;
+		Pending_.remove ({ mimetype, dim });
 	}
 }
 }
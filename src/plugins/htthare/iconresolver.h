@@ -30,20 +30,42 @@
 #pragma once
 
 #include <QObject>
-
-class QImage;
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QPair>
 
 namespace LeechCraft
 {
 namespace HttHare
 {
+	/** Resolves the icons for MIME types into base64-encoded images
+	 * suitable for data: URLs.
+	 *
+	 * The icons are resolved in the thread this object lives in (which
+	 * should be the GUI one) and cached, while GetIcon() can be called
+	 * from any thread and never blocks on the resolution.
+	 */
 	class IconResolver : public QObject
 	{
 		Q_OBJECT
+
+		typedef QPair<QString, int> Key_t;
+
+		mutable QMutex Lock_;
+		QHash<Key_t, QByteArray> Cache_;
+		QSet<Key_t> Pending_;
 	public:
 		IconResolver (QObject* = 0);
-	public slots:
-		void resolveMime (QString, QByteArray&, int);
+
+		/** Returns the cached icon for the given MIME type, or an empty
+		 * array if it hasn't been resolved yet. In the latter case the
+		 * resolution is scheduled, so the icon is available for the
+		 * subsequent calls.
+		 */
+		QByteArray GetIcon (const QString& mimetype, int dim);
+	private slots:
+		void resolveMime (const QString&, int);
 	};
 }
 }
@@ -42,18 +42,24 @@
 #endif
 
 #include <errno.h>
+#include <algorithm>
 #include <QList>
 #include <QString>
 #include <QtDebug>
 #include <QFileInfo>
-#include <QDir>
 #include <QDateTime>
+#include <QLocale>
+#if QT_VERSION >= 0x050000
+#include <QUrlQuery>
+#endif
 #include <util/util.h>
 #include <util/sys/mimedetector.h>
 #include "connection.h"
 #include "storagemanager.h"
 #include "iconresolver.h"
 #include "trmanager.h"
+#include "dirlistingcache.h"
+#include "compressioncache.h"
 
 namespace LeechCraft
 {
@@ -84,6 +90,8 @@ namespace HttHare
 		const auto& verb = req.at (0).toLower ();
 		Url_ = QUrl::fromEncoded (req.at (1));
 
+		Conn_->SetCurrentRequest (QString::fromUtf8 (req.at (0) + ' ' + req.at (1)));
+
 		for (const auto& line : lines)
 		{
 			const auto colonPos = line.indexOf (':');
@@ -92,6 +100,16 @@ namespace HttHare
 			Headers_ [line.left (colonPos)] = line.mid (colonPos + 1).trimmed ();
 		}
 
+		const auto& connHeader = Headers_.value ("Connection").toLower ();
+		const auto isHttp11 = req.value (2).toUpper () == "HTTP/1.1";
+		KeepAlive_ = Conn_->CanKeepAlive () &&
+				(isHttp11 ? !connHeader.contains ("close") : connHeader.contains ("keep-alive"));
+
+		// Request bodies aren't read, so they'd be taken for the next request.
+		if (Headers_.value ("Content-Length").toLongLong () > 0 ||
+				Headers_.contains ("Transfer-Encoding"))
+			KeepAlive_ = false;
+
 #ifdef QT_DEBUG
 		qDebug () << Q_FUNC_INFO << "got request";
 		qDebug () << req << Url_;
@@ -127,8 +145,12 @@ namespace HttHare
 	}
 
 	void RequestHandler::ErrorResponse (int code,
-			const QByteArray& reason, const QByteArray& full)
+			const QByteArray& reason, const QByteArray& full, Verb verb)
 	{
+		/* The response is delimited by its Content-Length, so the
+		 * connection stays usable unless the request itself is malformed,
+		 * in which case KeepAlive_ hasn't been set yet.
+		 */
 		ResponseLine_ = "HTTP/1.1 " + QByteArray::number (code) + " " + reason + "\r\n";
 
 		ResponseBody_ = QString (R"delim(<html>
@@ -143,7 +165,7 @@ namespace HttHare
 				.arg (reason.data ())
 				.arg (full.data ()).toUtf8 ();
 
-		DefaultWrite (Verb::Get);
+		DefaultWrite (verb);
 	}
 
 	namespace
@@ -157,38 +179,51 @@ namespace HttHare
 		}
 
 		const auto IconSize = 16;
+
+		/* Huge directories are split into pages of this many entries.
+		 */
+		const auto PageSize = 1000;
+
+		const QByteArray NotModifiedLine = "HTTP/1.1 304 Not Modified\r\n";
 	}
 
-	QByteArray RequestHandler::MakeDirResponse (const QFileInfo& fi, const QString& path, const QUrl& url)
+	namespace
 	{
-		const auto& entries = QDir { path }
-				.entryInfoList (QDir::AllEntries | QDir::NoDot,
-						QDir::Name | QDir::DirsFirst);
+		int GetRequestedPage (const QUrl& url)
+		{
+#if QT_VERSION < 0x050000
+			const auto& pageStr = url.queryItemValue ("page");
+#else
+			const auto& pageStr = QUrlQuery { url }.queryItemValue ("page");
+#endif
+			return std::max (pageStr.toInt (), 1);
+		}
 
-		struct MimeInfo
+		QString MakePageLink (int page, const QString& text)
 		{
-			QString MimeType_;
-		};
+			return QString { "<a href='?page=%1'>%2</a>" }
+					.arg (page)
+					.arg (text);
+		}
+	}
+
+	QByteArray RequestHandler::MakeDirResponse (const QFileInfo& fi, const QString& path, const QUrl& url)
+	{
+		const auto& listing = Conn_->GetDirListingCache ()->GetListing (path);
+		const auto& entries = listing->Entries_;
+
+		const auto pagesCount = std::max ((entries.size () + PageSize - 1) / PageSize, 1);
+		const auto page = std::min (GetRequestedPage (url), pagesCount);
+		const auto pageBegin = (page - 1) * PageSize;
+		const auto pageEnd = std::min (pageBegin + PageSize, entries.size ());
+
+		const auto resolver = Conn_->GetIconResolver ();
 		QHash<QString, QByteArray> mimeCache;
-		QList<MimeInfo> mimes;
-		Util::MimeDetector detector;
-		for (const auto& entry : entries)
+		for (auto i = pageBegin; i < pageEnd; ++i)
 		{
-			const auto& type = detector (entry.filePath ());
-
+			const auto& type = entries.at (i).MimeType_;
 			if (!mimeCache.contains (type))
-			{
-				QByteArray image;
-				QMetaObject::invokeMethod (Conn_->GetIconResolver (),
-						"resolveMime",
-						Qt::BlockingQueuedConnection,
-						Q_ARG (QString, type),
-						Q_ARG (QByteArray&, image),
-						Q_ARG (int, IconSize));
-				mimeCache [type] = image;
-			}
-
-			mimes.append ({ type });
+				mimeCache [type] = resolver->GetIcon (type, IconSize);
 		}
 
 		QString result;
@@ -196,31 +231,48 @@ namespace HttHare
 		for (auto pos = mimeCache.begin (); pos != mimeCache.end (); ++pos)
 		{
 			result += "." + NormalizeClass (pos.key ()) + " {";
-			result += "background-image: url('" + pos.value () + "');";
-			result += "background-repeat: no-repeat;";
+			if (!pos.value ().isEmpty ())
+			{
+				result += "background-image: url('" + pos.value () + "');";
+				result += "background-repeat: no-repeat;";
+			}
 			result += "padding-left: " + QString::number (IconSize + 4) + ";";
 			result += "}";
 		}
 		result += "</style></head><body><h1>" + Tr ("Listing of %1").arg (url.toString ()) + "</h1>";
+
+		QString pager;
+		if (pagesCount > 1)
+		{
+			pager += "<p>";
+			if (page > 1)
+				pager += MakePageLink (page - 1, Tr ("Previous")) + " ";
+			pager += Tr ("Page %1 of %2").arg (page).arg (pagesCount);
+			if (page < pagesCount)
+				pager += " " + MakePageLink (page + 1, Tr ("Next"));
+			pager += "</p>";
+		}
+		result += pager;
+
 		result += "<table style='width: 100%'><tr>";
 		result += QString ("<th style='width: 60%'>%1</th><th style='width: 20%'>%2</th><th style='width: 20%'>%3</th>")
 					.arg (Tr ("Name"))
 					.arg (Tr ("Size"))
 					.arg (Tr ("Created"));
 
-		for (int i = 0; i < entries.size (); ++i)
+		for (auto i = pageBegin; i < pageEnd; ++i)
 		{
 			const auto& item = entries.at (i);
 
-			auto link = QUrl::toPercentEncoding (item.fileName (), {}, "'");
+			auto link = QUrl::toPercentEncoding (item.Name_, {}, "'");
 
-			result += "<tr><td class=" + NormalizeClass (mimes.at (i).MimeType_) + "><a href='";
-			result += link + "'>" + item.fileName () + "</a></td>";
-			result += "<td>" + Util::MakePrettySize (item.size ()) + "</td>";
-			result += "<td>" + item.created ().toString (Qt::SystemLocaleShortDate) + "</td></tr>";
+			result += "<tr><td class=" + NormalizeClass (item.MimeType_) + "><a href='";
+			result += link + "'>" + item.Name_ + "</a></td>";
+			result += "<td>" + Util::MakePrettySize (item.Size_) + "</td>";
+			result += "<td>" + item.Created_.toString (Qt::SystemLocaleShortDate) + "</td></tr>";
 		}
 
-		result += "</table></body></html>";
+		result += "</table>" + pager + "</body></html>";
 
 		return result.toUtf8 ();
 	}
@@ -311,6 +363,7 @@ namespace HttHare
 
 		struct Sendfiler
 		{
+			const Connection_ptr Conn_;
 			boost::asio::ip::tcp::socket& Sock_;
 			std::shared_ptr<QFile> File_;
 			off_t Offset_;
@@ -357,6 +410,7 @@ namespace HttHare
 					{
 						CurrentRange_.first = offset;
 						toTransfer -= transferred;
+						Conn_->AddBytesSent (transferred);
 					}
 
 					if (ec == boost::asio::error::interrupted)
@@ -465,13 +519,136 @@ namespace HttHare
 		}
 	}
 
-	void RequestHandler::WriteFile (const QString& path, const QFileInfo& fi, RequestHandler::Verb verb)
+	namespace
 	{
-		auto ranges = ParseRanges (Headers_.value ("Range"), fi.size ());
+		/* Files larger than this are always sent as is via sendfile().
+		 */
+		const auto MaxCompressibleSize = 1024 * 1024;
+
+		const auto HttpDateFormat = "ddd, dd MMM yyyy hh:mm:ss 'GMT'";
+
+		QByteArray ToHttpDate (const QDateTime& dt)
+		{
+			return QLocale::c ().toString (dt.toUTC (), HttpDateFormat).toLatin1 ();
+		}
+
+		QDateTime FromHttpDate (const QString& str)
+		{
+			auto dt = QLocale::c ().toDateTime (str.trimmed (), HttpDateFormat);
+			dt.setTimeSpec (Qt::UTC);
+			return dt;
+		}
+
+		QByteArray MakeETag (const QFileInfo& fi, bool compressed)
+		{
+			auto etag = '"' + QByteArray::number (fi.size (), 16) +
+					'-' + QByteArray::number (fi.lastModified ().toMSecsSinceEpoch (), 16);
+			if (compressed)
+				etag += "-gz";
+			return etag + '"';
+		}
+
+		bool IsCompressible (const QByteArray& mime)
+		{
+			return mime.startsWith ("text/") ||
+					mime.endsWith ("+xml") ||
+					mime.endsWith ("/xml") ||
+					mime.endsWith ("/json") ||
+					mime.endsWith ("/javascript") ||
+					mime.endsWith ("/x-javascript");
+		}
+	}
+
+	QByteArray RequestHandler::GetAcceptedEncoding () const
+	{
+		bool supportsDeflate = false;
+		for (const auto& val : Headers_.value ("Accept-Encoding").split (','))
+		{
+			const auto& params = val.split (';');
+			const auto& coding = params.value (0).trimmed ().toLower ();
+
+			const auto isRejected = std::any_of (params.begin () + 1, params.end (),
+					[] (const QString& param)
+					{
+						const auto& trimmed = param.trimmed ();
+						return trimmed.startsWith ("q=") && !trimmed.mid (2).toDouble ();
+					});
+			if (isRejected)
+				continue;
+
+			if (coding == "gzip")
+				return "gzip";
+			else if (coding == "deflate")
+				supportsDeflate = true;
+		}
+
+		return supportsDeflate ? "deflate" : QByteArray {};
+	}
 
+	bool RequestHandler::IsNotModified (const QByteArray& etag, const QDateTime& modified) const
+	{
+		// If-None-Match takes precedence over If-Modified-Since if both are present.
+		if (Headers_.contains ("If-None-Match"))
+		{
+			for (auto tag : Headers_ ["If-None-Match"].split (','))
+			{
+				tag = tag.trimmed ();
+				if (tag.startsWith ("W/"))
+					tag = tag.mid (2);
+
+				if (tag == "*" || tag == etag)
+					return true;
+			}
+			return false;
+		}
+
+		if (Headers_.contains ("If-Modified-Since"))
+		{
+			const auto& since = FromHttpDate (Headers_ ["If-Modified-Since"]);
+			return since.isValid () && modified.toTime_t () <= since.toTime_t ();
+		}
+
+		return false;
+	}
+
+	void RequestHandler::WriteFile (const QString& path, const QFileInfo& fi, RequestHandler::Verb verb)
+	{
 		const auto& mime = Util::MimeDetector {} (path);
+		const auto compressible = IsCompressible (mime);
+
+		const auto compress = compressible &&
+				fi.size () <= MaxCompressibleSize &&
+				!Headers_.contains ("Range") &&
+				GetAcceptedEncoding () == "gzip";
+
+		const auto& etag = MakeETag (fi, compress);
+		ResponseHeaders_.append ({ "ETag", etag });
+		ResponseHeaders_.append ({ "Last-Modified", ToHttpDate (fi.lastModified ()) });
+		if (compressible)
+			ResponseHeaders_.append ({ "Vary", "Accept-Encoding" });
+
+		if (IsNotModified (etag, fi.lastModified ()))
+		{
+			ResponseLine_ = NotModifiedLine;
+			DefaultWrite (verb);
+			return;
+		}
+
 		ResponseHeaders_.append ({ "Content-Type", mime });
 
+		if (compress)
+		{
+			ResponseBody_ = Conn_->GetCompressionCache ().GetCompressed (fi);
+			if (ResponseBody_.isNull ())
+				return ErrorResponse (500, "Internal Server Error", {}, verb);
+
+			ResponseLine_ = "HTTP/1.1 200 OK\r\n";
+			ResponseHeaders_.append ({ "Content-Encoding", "gzip" });
+			DefaultWrite (verb);
+			return;
+		}
+
+		auto ranges = ParseRanges (Headers_.value ("Range"), fi.size ());
 		if (ranges.isEmpty ())
 		{
 			ResponseLine_ = "HTTP/1.1 200 OK\r\n";
@@ -489,24 +666,28 @@ namespace HttHare
 		}
 
 		auto c = Conn_;
+		auto self = shared_from_this ();
 		boost::asio::async_write (c->GetSocket (),
 				ToBuffers (verb),
-				c->GetStrand ().wrap ([c, path, verb, ranges] (boost::system::error_code ec, ulong) mutable -> void
+				c->GetStrand ().wrap ([c, self, path, verb, ranges] (boost::system::error_code ec, ulong transferred) mutable -> void
 					{
+						c->AddBytesSent (transferred);
+
 						if (ec)
+						{
 							qWarning () << Q_FUNC_INFO
 									<< ec.message ().c_str ();
-
-						auto& s = c->GetSocket ();
-
-						std::shared_ptr<void> shutdownGuard = std::shared_ptr<void> (nullptr,
-								[&s, &ec] (void*)
-								{
-									s.shutdown (boost::asio::socket_base::shutdown_both, ec);
-								});
+							c->FinishRequest (false);
+							return;
+						}
 
 						if (verb != Verb::Get)
+						{
+							c->FinishRequest (self->KeepAlive_);
 							return;
+						}
+
+						auto& s = c->GetSocket ();
 
 						std::shared_ptr<QFile> file { new QFile { path } };
 						file->open (QIODevice::ReadOnly);
@@ -520,12 +701,17 @@ namespace HttHare
 						const auto& headRange = ranges.takeFirst ();
 						Sendfiler
 						{
+							c,
 							s,
 							file,
 							0,
 							headRange,
 							ranges,
-							[c, shutdownGuard] (boost::system::error_code, ulong) {}
+							[c, self] (boost::system::error_code sendEc, ulong)
+							{
+								const auto keepAlive = !sendEc && self->KeepAlive_;
+								c->GetStrand ().dispatch ([c, keepAlive] { c->FinishRequest (keepAlive); });
+							}
 						} (ec, 0);
 					}));
 	}
@@ -533,16 +719,18 @@ namespace HttHare
 	void RequestHandler::DefaultWrite (Verb verb)
 	{
 		auto c = Conn_;
+		auto self = shared_from_this ();
 		boost::asio::async_write (c->GetSocket (),
 				ToBuffers (verb),
-				c->GetStrand ().wrap ([c] (const boost::system::error_code& ec, ulong)
+				c->GetStrand ().wrap ([c, self] (const boost::system::error_code& ec, ulong transferred)
 					{
+						c->AddBytesSent (transferred);
+
 						if (ec)
 							qWarning () << Q_FUNC_INFO
 									<< ec.message ().c_str ();
 
-						boost::system::error_code iec;
-						c->GetSocket ().shutdown (boost::asio::socket_base::shutdown_both, iec);
+						c->FinishRequest (!ec && self->KeepAlive_);
 					}));
 	}
 
@@ -553,13 +741,11 @@ namespace HttHare
 			return { ba.constData (), static_cast<size_t> (ba.size ()) };
 		}
 
-		bool SupportsDeflate (const QStringList& ae)
+		bool HasHeader (const QList<QPair<QByteArray, QByteArray>>& headers, const QByteArray& name)
 		{
-			for (const auto& val : ae)
-				if (!val.trimmed ().compare ("deflate", Qt::CaseInsensitive))
-					return true;
-
-			return false;
+			return std::any_of (headers.begin (), headers.end (),
+					[&name] (const QPair<QByteArray, QByteArray>& pair)
+						{ return !qstricmp (pair.first.constData (), name.constData ()); });
 		}
 	}
 
@@ -567,23 +753,48 @@ namespace HttHare
 	{
 		std::vector<boost::asio::const_buffer> result;
 
-		const bool hasContentLength = std::find_if (ResponseHeaders_.begin (), ResponseHeaders_.end (),
-				[] (decltype (ResponseHeaders_.at (0)) pair)
-					{ return pair.first.toLower () == "content-length"; }) != ResponseHeaders_.end ();
+		const auto hasContentLength = HasHeader (ResponseHeaders_, "Content-Length");
 
-		const auto& splitAe = Headers_.value ("Accept-Encoding").split (',');
-		if (verb == Verb::Get &&
-				!ResponseBody_.isEmpty () &&
-				SupportsDeflate (splitAe))
+		/* HEAD gets the same headers as GET would, including the
+		 * Content-Length of the encoded body, only the body is omitted.
+		 */
+		const auto& encoding = GetAcceptedEncoding ();
+		if (!ResponseBody_.isEmpty () &&
+				!encoding.isEmpty () &&
+				!HasHeader (ResponseHeaders_, "Content-Encoding"))
 		{
-			ResponseHeaders_.append ({ "Content-Encoding", "deflate" });
-			ResponseBody_ = qCompress (ResponseBody_, 6);
-			ResponseBody_.remove (0, 4);
+			QByteArray compressed;
+			if (encoding == "gzip")
+				compressed = GzipCompress (ResponseBody_);
+			else
+			{
+				compressed = qCompress (ResponseBody_, 6);
+				compressed.remove (0, 4);
+			}
+
+			if (!compressed.isEmpty ())
+			{
+				ResponseHeaders_.append ({ "Content-Encoding", encoding });
+				ResponseHeaders_.append ({ "Vary", "Accept-Encoding" });
+				ResponseBody_ = compressed;
+			}
 		}
 
-		if (!hasContentLength)
+		// A 304 response has no body, so its length isn't zero but unknown.
+		if (!hasContentLength && ResponseLine_ != NotModifiedLine)
 			ResponseHeaders_.append ({ "Content-Length", QByteArray::number (ResponseBody_.size ()) });
 
+		if (KeepAlive_)
+		{
+			const auto& settings = Conn_->GetSettings ();
+			ResponseHeaders_.append ({ "Connection", "keep-alive" });
+			ResponseHeaders_.append ({ "Keep-Alive",
+					"timeout=" + QByteArray::number (settings.KeepAliveTimeout_) +
+					", max=" + QByteArray::number (settings.MaxRequests_) });
+		}
+		else
+			ResponseHeaders_.append ({ "Connection", "close" });
+
 		CookedRH_.clear ();
 		for (const auto& pair : ResponseHeaders_)
 			CookedRH_ += pair.first + ": " + pair.second + "\r\n";
@@ -37,6 +37,7 @@
 #include <QCoreApplication>
 
 class QFileInfo;
+class QDateTime;
 
 namespace LeechCraft
 {
@@ -45,12 +46,14 @@ namespace HttHare
 	class Connection;
 	typedef std::shared_ptr<Connection> Connection_ptr;
 
-	class RequestHandler
+	class RequestHandler : public std::enable_shared_from_this<RequestHandler>
 	{
 		Q_DECLARE_TR_FUNCTIONS (LeechCraft::HttHare::RequestHandler)
 
 		const Connection_ptr Conn_;
 
+		bool KeepAlive_ = false;
+
 		QUrl Url_;
 		QMap<QString, QString> Headers_;
 
@@ -71,7 +74,18 @@ namespace HttHare
 	private:
 		QString Tr (const char*);
 
-		void ErrorResponse (int, const QByteArray&, const QByteArray& = QByteArray ());
+		void ErrorResponse (int, const QByteArray&, const QByteArray& = QByteArray (), Verb = Verb::Get);
+
+		/** Returns the preferred content coding supported by the client,
+		 * either "gzip" or "deflate", or an empty array if none of them
+		 * is accepted.
+		 */
+		QByteArray GetAcceptedEncoding () const;
+
+		/** Checks the If-None-Match and If-Modified-Since headers of the
+		 * request against the given validators of the resource.
+		 */
+		bool IsNotModified (const QByteArray& etag, const QDateTime& modified) const;
 		QByteArray MakeDirResponse (const QFileInfo&, const QString&, const QUrl&);
 
 		void HandleRequest (Verb);
@@ -28,11 +28,13 @@
  **********************************************************************/
 
 #include "server.h"
+#include <algorithm>
 #include <QString>
 #include <QtDebug>
 #include "connection.h"
 #include "iconresolver.h"
 #include "trmanager.h"
+#include "dirlistingcache.h"
 
 namespace LeechCraft
 {
@@ -40,9 +42,11 @@ namespace HttHare
 {
 	namespace ip = boost::asio::ip;
 
-	Server::Server (const QList<QPair<QString, QString>>& addresses)
+	Server::Server (const QList<QPair<QString, QString>>& addresses, const ServerSettings& settings)
 	: IconResolver_ { new IconResolver  }
 	, TrManager_ { new TrManager }
+	, DirCache_ { new DirListingCache }
+	, Settings_ (settings)
 	{
 		ip::tcp::resolver resolver { IoService_ };
 
@@ -69,13 +73,22 @@ namespace HttHare
 			}
 		}
 
-		StartAccept ();
+		if (Settings_.MaxConnections_ > 0)
+			Tracker_.SetRemoveHandler ([this] { ResumeAccept (); });
+
+		for (const auto& acceptor : Acceptors_)
+			StartAccept (*acceptor);
 	}
 
 	Server::~Server ()
 	{
 		if (!IoService_.stopped ())
 			Stop ();
+
+		// The connections still referenced by the pending handlers die with the io_service.
+		Tracker_.SetRemoveHandler ({});
+
+		delete DirCache_;
 	}
 
 	void Server::Start ()
@@ -83,7 +96,11 @@ namespace HttHare
 		if (Acceptors_.empty ())
 			return;
 
-		for (auto i = 0; i < 2; ++i)
+		auto threadsCount = Settings_.WorkerThreads_;
+		if (threadsCount <= 0)
+			threadsCount = std::max (std::thread::hardware_concurrency (), 1u);
+
+		for (auto i = 0; i < threadsCount; ++i)
 			Threads_.emplace_back ([this] { IoService_.run (); });
 	}
 
@@ -95,23 +112,57 @@ namespace HttHare
 		Threads_.clear ();
 	}
 
-	void Server::StartAccept ()
+	QList<ConnectionStats> Server::GetStats () const
+	{
+		return Tracker_.GetStats ();
+	}
+
+	void Server::StartAccept (ip::tcp::acceptor& acceptor)
+	{
+		if (Settings_.MaxConnections_ > 0)
+		{
+			QMutexLocker locker { &PausedLock_ };
+			if (Tracker_.GetCount () >= Settings_.MaxConnections_)
+			{
+				PausedAcceptors_.push_back (&acceptor);
+				locker.unlock ();
+
+				// ResumeAccept() picks the acceptor up once the connection is gone.
+				if (const auto& idle = Tracker_.TakeOldestIdle ())
+					idle->CloseIdle ();
+				return;
+			}
+		}
+
+		Connection_ptr connection { new Connection { IoService_, StorageMgr_,
+				IconResolver_, TrManager_, DirCache_, CompressionCache_,
+				Tracker_, Settings_.Connection_ } };
+
+		acceptor.async_accept (connection->GetSocket (),
+				[this, connection, &acceptor] (const boost::system::error_code& ec)
+				{
+					if (!ec)
+						connection->Start ();
+					else
+						qWarning () << Q_FUNC_INFO
+								<< "cannot accept:"
+								<< ec.message ().c_str ();
+
+					StartAccept (acceptor);
+				});
+	}
+
+	void Server::ResumeAccept ()
 	{
-		Connection_ptr connection { new Connection { IoService_, StorageMgr_, IconResolver_, TrManager_ } };
-
-		for (auto& acceptor : Acceptors_)
-			acceptor->async_accept (connection->GetSocket (),
-					[this, connection] (const boost::system::error_code& ec)
-					{
-						if (!ec)
-							connection->Start ();
-						else
-							qWarning () << Q_FUNC_INFO
-									<< "cannot accept:"
-									<< ec.message ().c_str ();
-
-						StartAccept ();
-					});
+		decltype (PausedAcceptors_) paused;
+
+		{
+			QMutexLocker locker { &PausedLock_ };
+			std::swap (paused, PausedAcceptors_);
+		}
+
+		for (const auto acceptor : paused)
+			IoService_.post ([this, acceptor] { StartAccept (*acceptor); });
 	}
 }
 }
@@ -31,7 +31,11 @@
 
 #include <thread>
 #include <boost/asio.hpp>
+#include <QMutex>
 #include "storagemanager.h"
+#include "connection.h"
+#include "connectionstracker.h"
+#include "compressioncache.h"
 
 template<typename T>
 class QSet;
@@ -44,20 +48,48 @@ namespace HttHare
 {
 	class IconResolver;
 	class TrManager;
+	class DirListingCache;
+
+	struct ServerSettings
+	{
+		/* The number of threads serving the connections, 0 means one
+		 * thread per CPU core.
+		 */
+		int WorkerThreads_ = 0;
+
+		/* New connections aren't accepted while this many are open: the
+		 * oldest idle keep-alive connection is closed to make room, and
+		 * the new ones wait in the listen backlog until some connection
+		 * goes away. 0 means no limit.
+		 */
+		int MaxConnections_ = 0;
+
+		ConnectionSettings Connection_;
+	};
 
 	class Server
 	{
+		ConnectionsTracker Tracker_;
+
 		boost::asio::io_service IoService_;
 		std::vector<std::unique_ptr<boost::asio::ip::tcp::acceptor>> Acceptors_;
 
+		// Guards the connection limit check together with parking the acceptor.
+		QMutex PausedLock_;
+		std::vector<boost::asio::ip::tcp::acceptor*> PausedAcceptors_;
+
 		StorageManager StorageMgr_;
+		CompressionCache CompressionCache_;
 
 		std::vector<std::thread> Threads_;
 
 		IconResolver * const IconResolver_;
 		TrManager * const TrManager_;
+		DirListingCache * const DirCache_;
+
+		const ServerSettings Settings_;
 	public:
-		Server (const QList<QPair<QString, QString>>& addresses);
+		Server (const QList<QPair<QString, QString>>& addresses, const ServerSettings&);
 		~Server ();
 
 		Server (const Server&) = delete;
@@ -65,8 +97,11 @@ namespace HttHare
 
 		void Start ();
 		void Stop ();
+
+		QList<ConnectionStats> GetStats () const;
 	private:
-		void StartAccept ();
+		void StartAccept (boost::asio::ip::tcp::acceptor&);
+		void ResumeAccept ();
 	};
 }
 }
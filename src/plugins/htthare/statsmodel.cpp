@@ -0,0 +1,120 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "statsmodel.h"
+#include <QTimer>
+#include <util/util.h>
+#include "server.h"
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	StatsModel::StatsModel (QObject *parent)
+	: QStandardItemModel { parent }
+	{
+		setHorizontalHeaderLabels ({ tr ("Client"), tr ("Request"), tr ("Sent"), tr ("Received"), tr ("Speed") });
+
+		const auto timer = new QTimer { this };
+		timer->start (1000);
+		connect (timer,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (update ()));
+
+		SinceLastUpdate_.start ();
+	}
+
+	void StatsModel::SetServer (const std::weak_ptr<Server>& server)
+	{
+		Server_ = server;
+		LastSent_.clear ();
+		update ();
+	}
+
+	namespace
+	{
+		QList<QStandardItem*> MakeRow (const QStringList& texts)
+		{
+			QList<QStandardItem*> row;
+			for (const auto& text : texts)
+			{
+				const auto item = new QStandardItem { text };
+				item->setEditable (false);
+				row << item;
+			}
+			return row;
+		}
+	}
+
+	void StatsModel::update ()
+	{
+		const auto server = Server_.lock ();
+		const auto& stats = server ? server->GetStats () : QList<ConnectionStats> {};
+
+		const auto secs = std::max<qint64> (SinceLastUpdate_.restart (), 1) / 1000.;
+
+		removeRows (0, rowCount ());
+
+		QHash<quint64, quint64> sent;
+		quint64 totalSent = 0;
+		quint64 totalReceived = 0;
+		double totalSpeed = 0;
+		for (const auto& conn : stats)
+		{
+			const auto speed = (conn.Sent_ - LastSent_.value (conn.ID_)) / secs;
+
+			appendRow (MakeRow ({
+						conn.Peer_,
+						conn.Request_,
+						Util::MakePrettySize (conn.Sent_),
+						Util::MakePrettySize (conn.Received_),
+						tr ("%1/s").arg (Util::MakePrettySize (speed))
+					}));
+
+			sent [conn.ID_] = conn.Sent_;
+			totalSent += conn.Sent_;
+			totalReceived += conn.Received_;
+			totalSpeed += speed;
+		}
+		LastSent_ = sent;
+
+		if (stats.isEmpty ())
+			return;
+
+		appendRow (MakeRow ({
+					tr ("Total"),
+					tr ("%n connection(s)", 0, stats.size ()),
+					Util::MakePrettySize (totalSent),
+					Util::MakePrettySize (totalReceived),
+					tr ("%1/s").arg (Util::MakePrettySize (totalSpeed))
+				}));
+	}
+}
+}
@@ -0,0 +1,247 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "loadtest.h"
+#include <memory>
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QUrl>
+#include <boost/asio.hpp>
+
+QTEST_APPLESS_MAIN (LeechCraft::HttHare::LoadTest)
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	/* These benchmarks fire lots of small requests at a running HttHare
+	 * instance and report the requests per second. Point HTTHARE_TEST_URL
+	 * to a small file shared by it, like http://localhost:14801/file.txt,
+	 * and optionally set HTTHARE_TEST_REQUESTS (10000 by default).
+	 *
+	 * benchClose opens a connection per request, which is what every
+	 * request cost before keep-alive support.
+	 */
+	namespace
+	{
+		using boost::asio::ip::tcp;
+
+		struct Target
+		{
+			QByteArray Host_;
+			QByteArray Port_;
+			QByteArray Path_;
+			int Count_;
+		};
+
+		struct Result
+		{
+			int Succeeded_ = 0;
+			int Connections_ = 0;
+			qint64 Elapsed_ = 0;
+		};
+
+		Target GetTarget ()
+		{
+			const auto& url = QUrl::fromEncoded (qgetenv ("HTTHARE_TEST_URL"));
+			auto path = url.toEncoded (QUrl::RemoveScheme | QUrl::RemoveAuthority);
+			if (path.isEmpty ())
+				path = "/";
+
+			const auto count = qgetenv ("HTTHARE_TEST_REQUESTS").toInt ();
+
+			return
+			{
+				url.host ().toUtf8 (),
+				QByteArray::number (url.port (80)),
+				path,
+				count > 0 ? count : 10000
+			};
+		}
+
+		QByteArray MakeRequest (const Target& target, bool keepAlive)
+		{
+			return "GET " + target.Path_ + " HTTP/1.1\r\n"
+					"Host: " + target.Host_ + "\r\n"
+					"Connection: " + (keepAlive ? "keep-alive" : "close") + "\r\n"
+					"\r\n";
+		}
+
+		/* Reads a single response, returns whether it's a successful one
+		 * and sets isKeptAlive to whether the server leaves the connection
+		 * open after it.
+		 */
+		bool ReadResponse (tcp::socket& sock, boost::asio::streambuf& buf, bool& isKeptAlive)
+		{
+			const auto headerSize = boost::asio::read_until (sock, buf, std::string { "\r\n\r\n" });
+
+			QByteArray header;
+			header.resize (headerSize);
+			std::istream istr (&buf);
+			istr.read (header.data (), headerSize);
+
+			const auto& lines = header.split ('\n');
+
+			qint64 length = 0;
+			isKeptAlive = false;
+			for (const auto& rawLine : lines)
+			{
+				const auto& line = rawLine.trimmed ().toLower ();
+				if (line.startsWith ("content-length:"))
+					length = line.mid (15).trimmed ().toLongLong ();
+				else if (line.startsWith ("connection:"))
+					isKeptAlive = line.contains ("keep-alive");
+			}
+
+			const auto buffered = static_cast<qint64> (buf.size ());
+			if (length > buffered)
+				boost::asio::read (sock, buf, boost::asio::transfer_exactly (length - buffered));
+			buf.consume (length);
+
+			return lines.value (0).split (' ').value (1) == "200";
+		}
+
+		/* Sends the requests in batches of pipelineDepth, reading the
+		 * responses only after the whole batch has been written.
+		 */
+		Result Run (const Target& target, bool keepAlive, int pipelineDepth = 1)
+		{
+			boost::asio::io_service service;
+			tcp::resolver resolver { service };
+			const auto endpoints = resolver.resolve (tcp::resolver::query { target.Host_.constData (), target.Port_.constData () });
+
+			const auto& request = MakeRequest (target, keepAlive);
+
+			Result result;
+
+			std::unique_ptr<tcp::socket> sock;
+			boost::asio::streambuf buf;
+
+			QElapsedTimer timer;
+			timer.start ();
+
+			for (int sent = 0; sent < target.Count_; )
+			{
+				if (!sock)
+				{
+					sock.reset (new tcp::socket { service });
+					boost::asio::connect (*sock, endpoints);
+					buf.consume (buf.size ());
+					++result.Connections_;
+				}
+
+				const auto batch = keepAlive ?
+						std::min (pipelineDepth, target.Count_ - sent) :
+						1;
+
+				QByteArray requests;
+				for (int i = 0; i < batch; ++i)
+					requests += request;
+				boost::asio::write (*sock, boost::asio::buffer (requests.constData (), requests.size ()));
+				sent += batch;
+
+				for (int i = 0; i < batch; ++i)
+				{
+					bool isKeptAlive = false;
+					if (ReadResponse (*sock, buf, isKeptAlive))
+						++result.Succeeded_;
+
+					if (!isKeptAlive)
+					{
+						// The rest of the batch is dropped along with the connection.
+						sent -= batch - i - 1;
+						sock.reset ();
+						break;
+					}
+				}
+			}
+
+			result.Elapsed_ = std::max<qint64> (timer.elapsed (), 1);
+			return result;
+		}
+
+		void Report (const char *name, const Target& target, const Result& result)
+		{
+			qDebug () << name
+					<< result.Succeeded_
+					<< "of"
+					<< target.Count_
+					<< "requests over"
+					<< result.Connections_
+					<< "connections in"
+					<< result.Elapsed_
+					<< "ms,"
+					<< target.Count_ * 1000 / result.Elapsed_
+					<< "requests/sec";
+		}
+	}
+
+	void LoadTest::benchClose ()
+	{
+		if (qgetenv ("HTTHARE_TEST_URL").isEmpty ())
+			QSKIP ("HTTHARE_TEST_URL is not set");
+
+		const auto& target = GetTarget ();
+
+		const auto& result = Run (target, false);
+		Report ("close:", target, result);
+
+		QCOMPARE (result.Succeeded_, target.Count_);
+		QCOMPARE (result.Connections_, target.Count_);
+	}
+
+	void LoadTest::benchKeepAlive ()
+	{
+		if (qgetenv ("HTTHARE_TEST_URL").isEmpty ())
+			QSKIP ("HTTHARE_TEST_URL is not set");
+
+		const auto& target = GetTarget ();
+
+		const auto& result = Run (target, true);
+		Report ("keep-alive:", target, result);
+
+		QCOMPARE (result.Succeeded_, target.Count_);
+		QVERIFY (result.Connections_ < target.Count_);
+	}
+
+	void LoadTest::benchPipelined ()
+	{
+		if (qgetenv ("HTTHARE_TEST_URL").isEmpty ())
+			QSKIP ("HTTHARE_TEST_URL is not set");
+
+		const auto& target = GetTarget ();
+
+		const auto& result = Run (target, true, 10);
+		Report ("pipelined by 10:", target, result);
+
+		QCOMPARE (result.Succeeded_, target.Count_);
+		QVERIFY (result.Connections_ < target.Count_);
+	}
+}
+}
@@ -70,6 +70,7 @@
 #include <util/sll/either.h>
 #include <util/sll/visitor.h>
 #include <util/sll/qtutil.h>
+#include <util/threads/futures.h>
 #include <interfaces/core/iiconthememanager.h>
 #include "localfileresolver.h"
 #include "core.h"
@@ -120,19 +121,23 @@ namespace LMP
 
 	void AudioPropsWidget::SetProps (const QString& path)
 	{
-		Util::Visit (Core::Instance ().GetLocalFileResolver ()->ResolveInfo (path).AsVariant (),
-				[this] (const MediaInfo& info) { SetProps (info); },
-				[this] (const ResolveError& err)
+		Util::Sequence (this, Core::Instance ().GetLocalFileResolver ()->ResolveInfoAsync (path)) >>
+				[this] (const ITagResolver::ResolveResult_t& result)
 				{
-					qWarning () << Q_FUNC_INFO
-							<< err.FilePath_;
-
-					QMessageBox::critical (this,
-							"LeechCraft",
-							tr ("Error showing properties for %1: %2.")
-								.arg (QFileInfo (err.FilePath_).fileName ())
-								.arg (err.ReasonString_));
-				});
+					Util::Visit (result.AsVariant (),
+							[this] (const MediaInfo& info) { SetProps (info); },
+							[this] (const ResolveError& err)
+							{
+								qWarning () << Q_FUNC_INFO
+										<< err.FilePath_;
+
+								QMessageBox::critical (this,
+										"LeechCraft",
+										tr ("Error showing properties for %1: %2.")
+											.arg (QFileInfo (err.FilePath_).fileName ())
+											.arg (err.ReasonString_));
+							});
+				};
 	}
 
 	namespace
@@ -0,0 +1,346 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "collectionsnapshot.h"
+#include <algorithm>
+#include <QFile>
+#include <QDataStream>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QtDebug>
+#include <util/sys/paths.h>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+namespace CollectionSnapshot
+{
+	namespace
+	{
+		const quint32 Magic = 0x4c4d5053;
+		const quint32 Version = 1;
+
+		QString GetSnapshotPath ()
+		{
+			return Util::CreateIfNotExists ("lmp").filePath ("collection.snapshot");
+		}
+
+		void WriteTrack (QDataStream& out, const Collection::Track& track)
+		{
+			out << static_cast<qint32> (track.ID_)
+					<< static_cast<qint32> (track.Number_)
+					<< track.Name_
+					<< static_cast<qint32> (track.Length_)
+					<< track.Genres_
+					<< track.FilePath_;
+		}
+
+		void ReadTrack (QDataStream& in, Collection::Track& track)
+		{
+			qint32 id = 0, number = 0, length = 0;
+			in >> id
+					>> number
+					>> track.Name_
+					>> length
+					>> track.Genres_
+					>> track.FilePath_;
+			track.ID_ = id;
+			track.Number_ = number;
+			track.Length_ = length;
+		}
+
+		void WriteAlbum (QDataStream& out, const Collection::Album& album)
+		{
+			out << static_cast<qint32> (album.ID_)
+					<< album.Name_
+					<< static_cast<qint32> (album.Year_)
+					<< album.CoverPath_
+					<< static_cast<quint32> (album.Tracks_.size ());
+			for (const auto& track : album.Tracks_)
+				WriteTrack (out, track);
+		}
+
+		Collection::Album_ptr ReadAlbum (QDataStream& in)
+		{
+			const auto album = std::make_shared<Collection::Album> ();
+
+			qint32 id = 0, year = 0;
+			quint32 tracksCount = 0;
+			in >> id
+					>> album->Name_
+					>> year
+					>> album->CoverPath_
+					>> tracksCount;
+			album->ID_ = id;
+			album->Year_ = year;
+
+			album->Tracks_.reserve (tracksCount);
+			for (quint32 i = 0; i < tracksCount && in.status () == QDataStream::Ok; ++i)
+			{
+				Collection::Track track;
+				ReadTrack (in, track);
+				album->Tracks_ << track;
+			}
+
+			return album;
+		}
+
+		bool ReadHeader (QDataStream& in, qint64& generation)
+		{
+			quint32 magic = 0, version = 0;
+			in >> magic >> version >> generation;
+			return in.status () == QDataStream::Ok &&
+					magic == Magic &&
+					version == Version;
+		}
+
+		QMutex SaveMutex;
+
+		bool IsSameTrack (const Collection::Track& left, const Collection::Track& right)
+		{
+			return left.ID_ == right.ID_ &&
+					left.Number_ == right.Number_ &&
+					left.Name_ == right.Name_ &&
+					left.Length_ == right.Length_ &&
+					left.Genres_ == right.Genres_ &&
+					left.FilePath_ == right.FilePath_;
+		}
+
+		bool IsSameAlbum (const Collection::Album& left, const Collection::Album& right)
+		{
+			return left.ID_ == right.ID_ &&
+					left.Name_ == right.Name_ &&
+					left.Year_ == right.Year_ &&
+					left.CoverPath_ == right.CoverPath_ &&
+					left.Tracks_.size () == right.Tracks_.size () &&
+					std::equal (left.Tracks_.begin (), left.Tracks_.end (),
+							right.Tracks_.begin (), IsSameTrack);
+		}
+	}
+
+	boost::optional<LocalCollectionStorage::LoadResult> Load (qint64 generation)
+	{
+		QElapsedTimer timer;
+		timer.start ();
+
+		QFile file { GetSnapshotPath () };
+		if (!file.open (QIODevice::ReadOnly))
+			return {};
+
+		const auto size = file.size ();
+		const auto data = file.map (0, size);
+		if (!data)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to map"
+					<< file.fileName ()
+					<< file.errorString ();
+			return {};
+		}
+
+		const auto& raw = QByteArray::fromRawData (reinterpret_cast<const char*> (data), size);
+		QDataStream in { raw };
+		in.setVersion (QDataStream::Qt_4_8);
+
+		qint64 snapshotGeneration = -1;
+		if (!ReadHeader (in, snapshotGeneration) || snapshotGeneration != generation)
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "snapshot is outdated:"
+					<< snapshotGeneration
+					<< "vs"
+					<< generation;
+			return {};
+		}
+
+		quint32 albumsCount = 0;
+		in >> albumsCount;
+		QHash<int, Collection::Album_ptr> albums;
+		albums.reserve (albumsCount);
+		for (quint32 i = 0; i < albumsCount && in.status () == QDataStream::Ok; ++i)
+		{
+			const auto& album = ReadAlbum (in);
+			albums [album->ID_] = album;
+		}
+
+		LocalCollectionStorage::LoadResult result;
+
+		quint32 artistsCount = 0;
+		in >> artistsCount;
+		result.Artists_.reserve (artistsCount);
+		for (quint32 i = 0; i < artistsCount && in.status () == QDataStream::Ok; ++i)
+		{
+			Collection::Artist artist;
+
+			qint32 id = 0;
+			QList<qint32> albumIds;
+			in >> id >> artist.Name_ >> albumIds;
+			artist.ID_ = id;
+
+			for (const auto albumId : albumIds)
+				if (const auto& album = albums.value (albumId))
+					artist.Albums_ << album;
+
+			result.Artists_ << artist;
+		}
+
+		in >> result.PresentArtists_
+				>> result.PresentAlbums_
+				>> result.Path2MTime_;
+
+		file.unmap (data);
+
+		if (in.status () != QDataStream::Ok)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "corrupted snapshot"
+					<< file.fileName ();
+			return {};
+		}
+
+		qDebug () << Q_FUNC_INFO
+				<< "loaded"
+				<< result.Artists_.size ()
+				<< "artists in"
+				<< timer.elapsed ()
+				<< "ms";
+
+		return result;
+	}
+
+	boost::optional<qint64> GetGeneration ()
+	{
+		QFile file { GetSnapshotPath () };
+		if (!file.open (QIODevice::ReadOnly))
+			return {};
+
+		QDataStream in { &file };
+		in.setVersion (QDataStream::Qt_4_8);
+
+		qint64 generation = -1;
+		if (!ReadHeader (in, generation))
+			return {};
+
+		return generation;
+	}
+
+	void Save (const LocalCollectionStorage::LoadResult& result, qint64 generation)
+	{
+		QMutexLocker locker { &SaveMutex };
+
+		const auto& path = GetSnapshotPath ();
+		QFile file { path + ".new" };
+		if (!file.open (QIODevice::WriteOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+			return;
+		}
+
+		QDataStream out { &file };
+		out.setVersion (QDataStream::Qt_4_8);
+		out << Magic << Version << generation;
+
+		QHash<int, Collection::Album_ptr> albums;
+		for (const auto& artist : result.Artists_)
+			for (const auto& album : artist.Albums_)
+				albums [album->ID_] = album;
+
+		out << static_cast<quint32> (albums.size ());
+		for (const auto& album : albums)
+			WriteAlbum (out, *album);
+
+		out << static_cast<quint32> (result.Artists_.size ());
+		for (const auto& artist : result.Artists_)
+		{
+			QList<qint32> albumIds;
+			for (const auto& album : artist.Albums_)
+				albumIds << album->ID_;
+
+			out << static_cast<qint32> (artist.ID_)
+					<< artist.Name_
+					<< albumIds;
+		}
+
+		out << result.PresentArtists_
+				<< result.PresentAlbums_
+				<< result.Path2MTime_;
+
+		file.close ();
+
+		if (out.status () != QDataStream::Ok || file.error () != QFile::NoError)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to write"
+					<< file.fileName ()
+					<< file.errorString ();
+			file.remove ();
+			return;
+		}
+
+		QFile::remove (path);
+		if (!file.rename (path))
+			qWarning () << Q_FUNC_INFO
+					<< "unable to rename snapshot"
+					<< file.errorString ();
+	}
+
+	bool IsSame (const LocalCollectionStorage::LoadResult& left, const LocalCollectionStorage::LoadResult& right)
+	{
+		if (left.Artists_.size () != right.Artists_.size () ||
+				left.PresentArtists_ != right.PresentArtists_ ||
+				left.PresentAlbums_ != right.PresentAlbums_ ||
+				left.Path2MTime_ != right.Path2MTime_)
+			return false;
+
+		QHash<int, const Collection::Artist*> rightArtists;
+		for (const auto& artist : right.Artists_)
+			rightArtists [artist.ID_] = &artist;
+
+		for (const auto& artist : left.Artists_)
+		{
+			const auto other = rightArtists.value (artist.ID_);
+			if (!other ||
+					other->Name_ != artist.Name_ ||
+					other->Albums_.size () != artist.Albums_.size ())
+				return false;
+
+			for (int i = 0; i < artist.Albums_.size (); ++i)
+				if (!IsSameAlbum (*artist.Albums_.at (i), *other->Albums_.at (i)))
+					return false;
+		}
+
+		return true;
+	}
+}
+}
+}
@@ -0,0 +1,59 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include "localcollectionstorage.h"
+
+namespace LeechCraft
+{
+namespace LMP
+{
+/** A binary dump of the collection as loaded by
+ * LocalCollectionStorage::Load(), used to show the collection on startup
+ * without going through SQL.
+ *
+ * The snapshot is tagged by the storage generation it's been made for and
+ * is ignored if the storage has changed since then.
+ */
+namespace CollectionSnapshot
+{
+	boost::optional<LocalCollectionStorage::LoadResult> Load (qint64 generation);
+	boost::optional<qint64> GetGeneration ();
+
+	void Save (const LocalCollectionStorage::LoadResult&, qint64 generation);
+
+	/** Checks whether the two results describe the same collection, down
+	 * to the IDs and the order of the albums and tracks.
+	 */
+	bool IsSame (const LocalCollectionStorage::LoadResult&, const LocalCollectionStorage::LoadResult&);
+}
+}
+}
@@ -38,6 +38,7 @@
 #include "sync/syncmanager.h"
 #include "sync/syncunmountablemanager.h"
 #include "sync/clouduploadmanager.h"
+#include "sync/transcodescheduler.h"
 #include "interfaces/lmp/ilmpplugin.h"
 #include "interfaces/lmp/icloudstorageplugin.h"
 #include "lmpproxy.h"
@@ -65,9 +66,11 @@ namespace LMP
 
 		PlaylistManager PLManager_;
 
-		SyncManager SyncManager_;
-		SyncUnmountableManager SyncUnmountableManager_;
-		CloudUploadManager CloudUpMgr_;
+		TranscodeScheduler TCScheduler_;
+
+		SyncManager SyncManager_ { &TCScheduler_ };
+		SyncUnmountableManager SyncUnmountableManager_ { &TCScheduler_ };
+		CloudUploadManager CloudUpMgr_ { &TCScheduler_ };
 
 		ProgressManager ProgressManager_;
 
@@ -88,6 +91,7 @@ namespace LMP
 		M_->ProgressManager_.AddSyncManager (&M_->SyncManager_);
 		M_->ProgressManager_.AddSyncManager (&M_->SyncUnmountableManager_);
 		M_->ProgressManager_.AddSyncManager (&M_->CloudUpMgr_);
+		M_->ProgressManager_.AddRgAnalysisManager (&M_->RgMgr_);
 
 		M_->CollectionsManager_.Add (M_->Collection_.GetCollectionModel ());
 	}
@@ -104,6 +108,7 @@ namespace LMP
 
 	void Core::Release ()
 	{
+		M_->Player_.FlushOnLoadPlaylist ();
 		CoreInstance_.reset ();
 	}
 
@@ -32,6 +32,8 @@
 #include <atomic>
 #include <QStringList>
 #include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
 #include <QMetaType>
 #include <QtDebug>
 #include <QUrl>
@@ -49,7 +51,10 @@ namespace LMP
 		QObject * const Handler_;
 
 		std::atomic_bool ShouldStop_ { false };
-		std::atomic_bool ShouldWait_ { false };
+
+		QMutex WaitMutex_;
+		QWaitCondition WaitCond_;
+		bool ShouldWait_ = false;
 	public:
 		LightPopThread (GstBus*, QObject*);
 		~LightPopThread ();
@@ -75,11 +80,14 @@ namespace LMP
 	void LightPopThread::Stop ()
 	{
 		ShouldStop_ = true;
+		Resume ();
 	}
 
 	void LightPopThread::Resume ()
 	{
+		QMutexLocker locker { &WaitMutex_ };
 		ShouldWait_ = false;
+		WaitCond_.wakeAll ();
 	}
 
 	void LightPopThread::run ()
@@ -90,19 +98,25 @@ namespace LMP
 			if (!msg)
 				continue;
 
-			if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+			const bool isError = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR;
+			if (isError)
+			{
+				QMutexLocker locker { &WaitMutex_ };
 				ShouldWait_ = true;
+			}
 
 			QMetaObject::invokeMethod (Handler_,
 				"handleMessage",
 				Qt::QueuedConnection,
 				Q_ARG (GstMessage_ptr, std::shared_ptr<GstMessage> (msg, gst_message_unref)));
 
-			while (ShouldWait_)
-			{
-				msleep (10);
+			if (!isError)
 				continue;
-			}
+
+			// The handler drains the bus itself on errors, so sleep until it's done.
+			QMutexLocker locker { &WaitMutex_ };
+			while (ShouldWait_ && !ShouldStop_)
+				WaitCond_.wait (&WaitMutex_);
 		}
 	}
 
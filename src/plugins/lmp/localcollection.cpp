@@ -33,13 +33,14 @@
 #include <numeric>
 #include <QStandardItemModel>
 #include <QSortFilterProxyModel>
-#include <QtConcurrentMap>
 #include <QtConcurrentRun>
 #include <QTimer>
 #include <QtDebug>
 #include <util/sll/either.h>
+#include <util/threads/futures.h>
 #include <util/xpc/util.h>
 #include "localcollectionstorage.h"
+#include "collectionsnapshot.h"
 #include "core.h"
 #include "util.h"
 #include "localfileresolver.h"
@@ -53,6 +54,16 @@ namespace LeechCraft
 {
 namespace LMP
 {
+	namespace
+	{
+		struct InitialLoadResult
+		{
+			LocalCollectionStorage::LoadResult Result_;
+			bool FromSnapshot_;
+			qint64 Generation_;
+		};
+	}
+
 	LocalCollection::LocalCollection (QObject *parent)
 	: QObject (parent)
 	, IsReady_ (false)
@@ -61,6 +72,8 @@ namespace LMP
 	, FilesWatcher_ (new LocalCollectionWatcher (this))
 	, AlbumArtMgr_ (new AlbumArtManager (this))
 	, Watcher_ (new QFutureWatcher<MediaInfo> (this))
+	, AccurateWatcher_ (new QFutureWatcher<MediaInfo> (this))
+	, SnapshotTimer_ (new QTimer (this))
 	, UpdateNewArtists_ (0)
 	, UpdateNewAlbums_ (0)
 	, UpdateNewTracks_ (0)
@@ -73,15 +86,36 @@ namespace LMP
 				SIGNAL (progressValueChanged (int)),
 				this,
 				SIGNAL (scanProgressChanged (int)));
+		connect (AccurateWatcher_,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleAccurateScanFinished ()));
 
-		auto loadWatcher = new QFutureWatcher<LocalCollectionStorage::LoadResult> (this);
+		auto loadWatcher = new QFutureWatcher<InitialLoadResult> (this);
 		connect (loadWatcher,
 				SIGNAL (finished ()),
 				this,
 				SLOT (handleLoadFinished ()));
-		auto future = QtConcurrent::run ([] { return LocalCollectionStorage ().Load (); });
+		auto future = QtConcurrent::run ([]
+				{
+					LocalCollectionStorage storage;
+					const auto generation = storage.GetGeneration ();
+					if (const auto& snapshot = CollectionSnapshot::Load (generation))
+						return InitialLoadResult { *snapshot, true, generation };
+
+					const auto& result = storage.Load ();
+					CollectionSnapshot::Save (result, generation);
+					return InitialLoadResult { result, false, generation };
+				});
 		loadWatcher->setFuture (future);
 
+		SnapshotTimer_->setSingleShot (true);
+		SnapshotTimer_->setInterval (10000);
+		connect (SnapshotTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (updateSnapshot ()));
+
 		auto& xsd = XmlSettingsManager::Instance ();
 		QStringList oldDefault (xsd.property ("CollectionDir").toString ());
 		oldDefault.removeAll (QString ());
@@ -127,6 +161,10 @@ namespace LMP
 		Path2Track_.clear ();
 		Track2Path_.clear ();
 
+		Path2MTime_.clear ();
+		PendingMTimes_.clear ();
+		AccuratePathsQueue_.clear ();
+
 		Track2Album_.clear ();
 		AlbumID2Album_.clear ();
 		AlbumID2ArtistID_.clear ();
@@ -139,7 +177,10 @@ namespace LMP
 		struct IterateResult
 		{
 			QSet<QString> UnchangedFiles_;
-			QSet<QString> ChangedFiles_;
+			QHash<QString, QDateTime> ChangedFiles_;
+
+			qint64 IterateTime_;
+			qint64 UpdateTime_;
 		};
 	}
 
@@ -157,53 +198,56 @@ namespace LMP
 
 		const bool symLinks = XmlSettingsManager::Instance ()
 				.property ("FollowSymLinks").toBool ();
-		auto worker = [path, symLinks] () -> IterateResult
+		const auto path2mtime = Path2MTime_;
+		auto worker = [path, symLinks, path2mtime] () -> IterateResult
 		{
 			IterateResult result;
 
-			LocalCollectionStorage storage;
+			QElapsedTimer timer;
+			timer.start ();
 
-			const auto& paths = storage.GetTracksPaths ();
+			QHash<QString, QDateTime> toUpdate;
 
 			const auto& allInfos = RecIterateInfo (path, symLinks);
 			for (const auto& info : allInfos)
 			{
 				const auto& trackPath = info.absoluteFilePath ();
 				const auto& mtime = info.lastModified ();
-				try
+
+				const auto storedPos = path2mtime.find (trackPath);
+				if (storedPos != path2mtime.end ())
 				{
-					const auto& storedDt = storage.GetMTime (trackPath);
+					const auto& storedDt = *storedPos;
 					if (storedDt.isValid () &&
 							std::abs (storedDt.msecsTo (mtime)) < 1500)
 					{
 						result.UnchangedFiles_ << trackPath;
 						continue;
 					}
+
+					toUpdate [trackPath] = mtime;
+				}
+
+				result.ChangedFiles_ [trackPath] = mtime;
+			}
+
+			result.IterateTime_ = timer.restart ();
+
+			if (!toUpdate.isEmpty ())
+				try
+				{
+					LocalCollectionStorage {}.SetMTimes (toUpdate);
 				}
 				catch (const std::exception& e)
 				{
 					qWarning () << Q_FUNC_INFO
-							<< "error getting mtime"
-							<< trackPath
+							<< "error setting mtimes for"
+							<< toUpdate.size ()
+							<< "files:"
 							<< e.what ();
 				}
 
-				if (paths.contains (trackPath))
-				{
-					try
-					{
-						storage.SetMTime (trackPath, mtime);
-					}
-					catch (const std::exception& e)
-					{
-						qWarning () << Q_FUNC_INFO
-								<< "error setting mtime"
-								<< trackPath
-								<< e.what ();
-					}
-				}
-				result.ChangedFiles_ << trackPath;
-			}
+			result.UpdateTime_ = timer.elapsed ();
 
 			return result;
 		};
@@ -309,6 +353,8 @@ namespace LMP
 			AlbumID2Album_ [id]->CoverPath_ = path;
 
 		Storage_->SetAlbumArt (id, path);
+
+		ScheduleSnapshotUpdate ();
 	}
 
 	Collection::Album_ptr LocalCollection::GetAlbum (int albumId) const
@@ -452,9 +498,19 @@ namespace LMP
 					track.Number_ == info.TrackNumber_ &&
 					track.Name_ == info.Title_ &&
 					track.Genres_ == info.Genres_)
+			{
+				/* Only the length differs, which is what the accurate
+				 * rescan of VBR files typically finds. Update it in place
+				 * so that the track keeps its ID.
+				 */
+				if (pos != trackAlbum->Tracks_.end () &&
+						track.Length_ != info.Length_)
+					UpdateTrackLength (*pos, info.Length_);
 				continue;
+			}
 
 			auto stats = GetTrackStats (path);
+			const auto mtime = Path2MTime_.value (path);
 			RemoveTrack (path);
 
 			const auto& newArts = Storage_->AddToCollection ({ info });
@@ -463,9 +519,29 @@ namespace LMP
 			const auto newTrackIdx = FindTrack (path);
 			stats.TrackID_ = newTrackIdx;
 			Storage_->SetTrackStats (stats);
+
+			Path2MTime_ [path] = mtime;
 		}
 	}
 
+	void LocalCollection::UpdateTrackLength (Collection::Track& track, int length)
+	{
+		try
+		{
+			Storage_->SetTrackLength (track.ID_, length);
+		}
+		catch (const std::runtime_error& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "error updating track length:"
+					<< e.what ();
+			return;
+		}
+
+		track.Length_ = length;
+		CollectionModel_->SetTrackLength (track.ID_, length);
+	}
+
 	void LocalCollection::HandleNewArtists (const Collection::Artists_t& artists)
 	{
 		int albumCount = 0;
@@ -561,6 +637,9 @@ namespace LMP
 		Track2Path_.remove (id);
 		Track2Album_.remove (id);
 		PresentPaths_.remove (path);
+		Path2MTime_.remove (path);
+
+		ScheduleSnapshotUpdate ();
 
 		if (!album)
 			return;
@@ -680,20 +759,22 @@ namespace LMP
 		auto resolver = Core::Instance ().GetLocalFileResolver ();
 
 		emit scanStarted (newPaths.size ());
-		auto worker = [resolver] (const QString& path)
-		{
-			return resolver->ResolveInfo (path).ToRight ([] (const ResolveError& error)
-					{
-						qWarning () << Q_FUNC_INFO
-								<< "error resolving media info for"
-								<< error.FilePath_
-								<< error.ReasonString_;
-						return MediaInfo {};
-					});
-		};
-		const auto& future = QtConcurrent::mapped (newPaths,
-				std::function<MediaInfo (const QString&)> (worker));
-		Watcher_->setFuture (future);
+		ScanTimer_.start ();
+		Watcher_->setFuture (resolver->ResolveInfos (newPaths.toList (),
+				LocalFileResolver::ReadStyle::Fast));
+	}
+
+	void LocalCollection::InitiateAccurateRescan ()
+	{
+		if (AccurateWatcher_->isRunning () || AccuratePathsQueue_.isEmpty ())
+			return;
+
+		const auto& paths = AccuratePathsQueue_.toList ();
+		AccuratePathsQueue_.clear ();
+
+		auto resolver = Core::Instance ().GetLocalFileResolver ();
+		AccurateWatcher_->setFuture (resolver->ResolveInfos (paths,
+				LocalFileResolver::ReadStyle::Accurate, -1));
 	}
 
 	void LocalCollection::recordPlayedTrack (const QString& path)
@@ -713,6 +794,88 @@ namespace LMP
 		}
 	}
 
+	void LocalCollection::VerifySnapshot (qint64 generation)
+	{
+		// Both sides are loaded in the background thread, so that it
+		// doesn't share the albums with the collection being shown.
+		const auto future = QtConcurrent::run ([generation] () -> boost::optional<LocalCollectionStorage::LoadResult>
+				{
+					const auto& snapshot = CollectionSnapshot::Load (generation);
+					if (!snapshot)
+						return {};
+
+					LocalCollectionStorage storage;
+					const auto& result = storage.Load ();
+					if (storage.GetGeneration () != generation)
+						return {};
+
+					if (CollectionSnapshot::IsSame (*snapshot, result))
+						return {};
+
+					qWarning () << Q_FUNC_INFO
+							<< "snapshot doesn't match the storage, reloading";
+					CollectionSnapshot::Save (result, generation);
+					return result;
+				});
+		Util::Sequence (this, future) >>
+				[this, generation] (const boost::optional<LocalCollectionStorage::LoadResult>& result)
+				{
+					if (!result)
+						return;
+
+					try
+					{
+						if (Storage_->GetGeneration () != generation)
+							return;
+					}
+					catch (const std::exception& e)
+					{
+						qWarning () << Q_FUNC_INFO
+								<< e.what ();
+						return;
+					}
+
+					CollectionModel_->Clear ();
+					Artists_.clear ();
+					PresentPaths_.clear ();
+
+					Path2Track_.clear ();
+					Track2Path_.clear ();
+
+					Track2Album_.clear ();
+					AlbumID2Album_.clear ();
+					AlbumID2ArtistID_.clear ();
+
+					Storage_->Load (*result);
+					Path2MTime_ = result->Path2MTime_;
+					HandleNewArtists (result->Artists_);
+				};
+	}
+
+	void LocalCollection::ScheduleSnapshotUpdate ()
+	{
+		SnapshotTimer_->start ();
+	}
+
+	void LocalCollection::updateSnapshot ()
+	{
+		if (Watcher_->isRunning () || AccurateWatcher_->isRunning ())
+		{
+			ScheduleSnapshotUpdate ();
+			return;
+		}
+
+		QtConcurrent::run ([]
+				{
+					LocalCollectionStorage storage;
+					const auto generation = storage.GetGeneration ();
+					if (CollectionSnapshot::GetGeneration () == generation)
+						return;
+
+					CollectionSnapshot::Save (storage.Load (), generation);
+				});
+	}
+
 	void LocalCollection::rescanOnLoad ()
 	{
 		Q_FOREACH (const auto& rootPath, RootPaths_)
@@ -721,15 +884,21 @@ namespace LMP
 
 	void LocalCollection::handleLoadFinished ()
 	{
-		auto watcher = dynamic_cast<QFutureWatcher<LocalCollectionStorage::LoadResult>*> (sender ());
+		auto watcher = dynamic_cast<QFutureWatcher<InitialLoadResult>*> (sender ());
 		watcher->deleteLater ();
-		const auto& result = watcher->result ();
+		const auto& loaded = watcher->result ();
+		const auto& result = loaded.Result_;
 		Storage_->Load (result);
 
+		Path2MTime_ = result.Path2MTime_;
+
 		HandleNewArtists (result.Artists_);
 
 		IsReady_ = true;
 
+		if (loaded.FromSnapshot_)
+			VerifySnapshot (loaded.Generation_);
+
 		emit collectionReady ();
 
 		QTimer::singleShot (5000,
@@ -746,24 +915,45 @@ namespace LMP
 		auto watcher = dynamic_cast<QFutureWatcher<IterateResult>*> (sender ());
 		const auto& result = watcher->result ();
 
-		CheckRemovedFiles (result.ChangedFiles_ + result.UnchangedFiles_, path);
+		qDebug () << Q_FUNC_INFO
+				<< path
+				<< "iterated in"
+				<< result.IterateTime_
+				<< "ms, mtimes updated in"
+				<< result.UpdateTime_
+				<< "ms;"
+				<< result.ChangedFiles_.size ()
+				<< "changed,"
+				<< result.UnchangedFiles_.size ()
+				<< "unchanged";
+
+		for (auto i = result.ChangedFiles_.begin (), end = result.ChangedFiles_.end (); i != end; ++i)
+			PendingMTimes_ [i.key ()] = i.value ();
+
+		const auto& changed = QSet<QString>::fromList (result.ChangedFiles_.keys ());
+
+		CheckRemovedFiles (changed + result.UnchangedFiles_, path);
 
 		if (Watcher_->isRunning ())
-			NewPathsQueue_ << result.ChangedFiles_;
+			NewPathsQueue_ << changed;
 		else
-			InitiateScan (result.ChangedFiles_);
+			InitiateScan (changed);
 	}
 
 	void LocalCollection::handleScanFinished ()
 	{
 		auto future = Watcher_->future ();
 		QList<MediaInfo> newInfos, existingInfos;
+		QHash<QString, QDateTime> resolvedMTimes;
 		for (const auto& info : future)
 		{
 			const auto& path = info.LocalPath_;
 			if (path.isEmpty ())
 				continue;
 
+			resolvedMTimes [path] = PendingMTimes_.take (path);
+			AccuratePathsQueue_ << path;
+
 			if (PresentPaths_.contains (path))
 				existingInfos << info;
 			else
@@ -773,6 +963,13 @@ namespace LMP
 			}
 		}
 
+		qDebug () << Q_FUNC_INFO
+				<< "resolved"
+				<< newInfos.size () + existingInfos.size ()
+				<< "files in"
+				<< ScanTimer_.elapsed ()
+				<< "ms";
+
 		emit scanFinished ();
 
 		auto newArts = Storage_->AddToCollection (newInfos);
@@ -795,6 +992,31 @@ namespace LMP
 		}
 
 		HandleExistingInfos (existingInfos);
+
+		for (auto i = resolvedMTimes.begin (), end = resolvedMTimes.end (); i != end; ++i)
+			Path2MTime_ [i.key ()] = i.value ();
+
+		if (!Watcher_->isRunning ())
+		{
+			PendingMTimes_.clear ();
+			InitiateAccurateRescan ();
+		}
+
+		ScheduleSnapshotUpdate ();
+	}
+
+	void LocalCollection::handleAccurateScanFinished ()
+	{
+		QList<MediaInfo> infos;
+		for (const auto& info : AccurateWatcher_->future ())
+			if (!info.LocalPath_.isEmpty () && PresentPaths_.contains (info.LocalPath_))
+				infos << info;
+
+		HandleExistingInfos (infos);
+
+		InitiateAccurateRescan ();
+
+		ScheduleSnapshotUpdate ();
 	}
 
 	void LocalCollection::saveRootPaths ()
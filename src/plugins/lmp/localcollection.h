@@ -32,6 +32,8 @@
 #include <QObject>
 #include <QHash>
 #include <QSet>
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QFutureWatcher>
 #include <QIcon>
 #include "interfaces/lmp/collectiontypes.h"
@@ -44,6 +46,7 @@ class QStandardItem;
 class QAbstractItemModel;
 class QModelIndex;
 class QSortFilterProxyModel;
+class QTimer;
 
 namespace LeechCraft
 {
@@ -77,6 +80,9 @@ namespace LMP
 		QHash<QString, int> Path2Track_;
 		QHash<int, QString> Track2Path_;
 
+		QHash<QString, QDateTime> Path2MTime_;
+		QHash<QString, QDateTime> PendingMTimes_;
+
 		QHash<int, int> Track2Album_;
 		QHash<int, Collection::Album_ptr> AlbumID2Album_;
 		QHash<int, int> AlbumID2ArtistID_;
@@ -84,6 +90,13 @@ namespace LMP
 		QFutureWatcher<MediaInfo> *Watcher_;
 		QList<QSet<QString>> NewPathsQueue_;
 
+		QFutureWatcher<MediaInfo> *AccurateWatcher_;
+		QSet<QString> AccuratePathsQueue_;
+
+		QElapsedTimer ScanTimer_;
+
+		QTimer * const SnapshotTimer_;
+
 		int UpdateNewArtists_;
 		int UpdateNewAlbums_;
 		int UpdateNewTracks_;
@@ -151,6 +164,7 @@ namespace LMP
 		void RemoveTrack (const QString&);
 	private:
 		void HandleExistingInfos (const QList<MediaInfo>&);
+		void UpdateTrackLength (Collection::Track&, int);
 		void HandleNewArtists (const Collection::Artists_t&);
 		void RemoveAlbum (int);
 		Collection::Artists_t::iterator RemoveArtist (Collection::Artists_t::iterator);
@@ -161,6 +175,10 @@ namespace LMP
 		void CheckRemovedFiles (const QSet<QString>& scanned, const QString& root);
 
 		void InitiateScan (const QSet<QString>&);
+		void InitiateAccurateRescan ();
+
+		void ScheduleSnapshotUpdate ();
+		void VerifySnapshot (qint64 generation);
 	public slots:
 		void recordPlayedTrack (const QString&);
 	private slots:
@@ -168,7 +186,9 @@ namespace LMP
 		void handleLoadFinished ();
 		void handleIterateFinished ();
 		void handleScanFinished ();
+		void handleAccurateScanFinished ();
 		void saveRootPaths ();
+		void updateSnapshot ();
 	signals:
 		void scanStarted (int);
 		void scanProgressChanged (int);
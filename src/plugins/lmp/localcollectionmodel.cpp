@@ -206,5 +206,11 @@ namespace LMP
 		if (Album2Item_.contains (id))
 			Album2Item_ [id]->setData (path, Role::AlbumArt);
 	}
+
+	void LocalCollectionModel::SetTrackLength (int id, int length)
+	{
+		if (Track2Item_.contains (id))
+			Track2Item_ [id]->setData (length, Role::TrackLength);
+	}
 }
 }
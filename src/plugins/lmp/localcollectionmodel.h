@@ -85,6 +85,7 @@ namespace LMP
 		void RemoveArtist (int);
 
 		void SetAlbumArt (int, const QString&);
+		void SetTrackLength (int, int);
 		QVariant GetTrackData (int trackId, Role) const;
 	};
 }
@@ -199,7 +199,8 @@ namespace LMP
 		{
 			artists,
 			PresentArtists_,
-			PresentAlbums_
+			PresentAlbums_,
+			GetAllMTimes ()
 		};
 		qDebug () << "end";
 
@@ -212,6 +213,18 @@ namespace LMP
 		PresentArtists_ = result.PresentArtists_;
 	}
 
+	qint64 LocalCollectionStorage::GetGeneration ()
+	{
+		QSqlQuery query (DB_);
+		if (!query.exec ("SELECT Gen FROM generation;"))
+		{
+			Util::DBLock::DumpError (query);
+			throw std::runtime_error ("cannot get collection generation");
+		}
+
+		return query.next () ? query.value (0).toLongLong () : 0;
+	}
+
 	QStringList LocalCollectionStorage::GetTracksPaths ()
 	{
 		if (!GetAllTracks_.exec ())
@@ -275,6 +288,17 @@ namespace LMP
 		}
 	}
 
+	void LocalCollectionStorage::SetTrackLength (int id, int length)
+	{
+		SetTrackLength_.bindValue (":track_id", id);
+		SetTrackLength_.bindValue (":length", length);
+		if (!SetTrackLength_.exec ())
+		{
+			Util::DBLock::DumpError (SetTrackLength_);
+			throw std::runtime_error ("cannot update track length");
+		}
+	}
+
 	Collection::TrackStats LocalCollectionStorage::GetTrackStats (int trackId)
 	{
 		GetTrackStats_.bindValue (":track_id", trackId);
@@ -365,6 +389,37 @@ namespace LMP
 		}
 	}
 
+	QHash<QString, QDateTime> LocalCollectionStorage::GetAllMTimes ()
+	{
+		if (!GetAllFilesMTimes_.exec ())
+		{
+			Util::DBLock::DumpError (GetAllFilesMTimes_);
+			throw std::runtime_error ("cannot get files mtimes");
+		}
+
+		QHash<QString, QDateTime> result;
+		while (GetAllFilesMTimes_.next ())
+			result [GetAllFilesMTimes_.value (0).toString ()] = GetAllFilesMTimes_.value (1).toDateTime ();
+
+		GetAllFilesMTimes_.finish ();
+
+		return result;
+	}
+
+	void LocalCollectionStorage::SetMTimes (const QHash<QString, QDateTime>& mtimes)
+	{
+		if (mtimes.isEmpty ())
+			return;
+
+		Util::DBLock lock (DB_);
+		lock.Init ();
+
+		for (auto i = mtimes.begin (), end = mtimes.end (); i != end; ++i)
+			SetMTime (i.key (), i.value ());
+
+		lock.Good ();
+	}
+
 	const int LovedStateID = 1;
 	const int BannedStateID = 2;
 
@@ -714,6 +769,9 @@ namespace LMP
 		SetAlbumArt_ = QSqlQuery (DB_);
 		SetAlbumArt_.prepare ("UPDATE albums SET CoverPath = :cover_path WHERE Id = :album_id");
 
+		SetTrackLength_ = QSqlQuery (DB_);
+		SetTrackLength_.prepare ("UPDATE tracks SET Length = :length WHERE Id = :track_id;");
+
 		GetTrackStats_ = QSqlQuery (DB_);
 		GetTrackStats_.prepare ("SELECT Playcount, Added, LastPlay, Score, Rating FROM statistics WHERE TrackId = :track_id;");
 
@@ -736,6 +794,10 @@ namespace LMP
 		GetFileMTime_ = QSqlQuery (DB_);
 		GetFileMTime_.prepare ("SELECT MTime FROM fileTimes, tracks WHERE tracks.Path = :filepath AND tracks.Id = fileTimes.TrackID;");
 
+		GetAllFilesMTimes_ = QSqlQuery (DB_);
+		GetAllFilesMTimes_.prepare ("SELECT tracks.Path, fileTimes.MTime FROM tracks "
+				"LEFT OUTER JOIN fileTimes ON tracks.Id = fileTimes.TrackID;");
+
 		SetFileMTime_ = QSqlQuery (DB_);
 		SetFileMTime_.prepare ("INSERT OR REPLACE INTO fileTimes (TrackID, MTime) VALUES ((SELECT Id FROM tracks WHERE Path = :filepath), :mtime);");
 
@@ -895,6 +957,36 @@ namespace LMP
 
 		QSqlQuery (DB_).exec ("CREATE UNIQUE INDEX IF NOT EXISTS index_tracksPaths ON tracks (Path);");
 
+		/* The generation is bumped on any change to the data that's
+		 * loaded on startup, so that the collection snapshot could be
+		 * checked against it.
+		 */
+		if (!tables.contains ("generation"))
+		{
+			QSqlQuery q (DB_);
+			if (!q.exec ("CREATE TABLE generation (Gen INTEGER NOT NULL);") ||
+				!q.exec ("INSERT INTO generation (Gen) VALUES (0);"))
+			{
+				Util::DBLock::DumpError (q);
+				throw std::runtime_error ("cannot create generation table");
+			}
+		}
+
+		for (const auto& table : { "artists", "albums", "artists2albums", "tracks", "genres", "fileTimes" })
+			for (const auto& op : { "INSERT", "UPDATE", "DELETE" })
+			{
+				const auto& query = QString ("CREATE TRIGGER IF NOT EXISTS gen_%1_%2 AFTER %2 ON %1 "
+						"BEGIN UPDATE generation SET Gen = Gen + 1; END;")
+						.arg (table)
+						.arg (op);
+				QSqlQuery q (DB_);
+				if (!q.exec (query))
+				{
+					Util::DBLock::DumpError (q);
+					throw std::runtime_error ("cannot create generation triggers");
+				}
+			}
+
 		lock.Good ();
 	}
 }
@@ -31,6 +31,7 @@
 
 #include <QObject>
 #include <QHash>
+#include <QDateTime>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include "mediainfo.h"
@@ -66,6 +67,7 @@ namespace LMP
 		QSqlQuery RemoveArtist_;
 
 		QSqlQuery SetAlbumArt_;
+		QSqlQuery SetTrackLength_;
 
 		QSqlQuery GetTrackStats_;
 		QSqlQuery SetTrackStats_;
@@ -73,6 +75,7 @@ namespace LMP
 
 		QSqlQuery GetFileIdMTime_;
 		QSqlQuery GetFileMTime_;
+		QSqlQuery GetAllFilesMTimes_;
 		QSqlQuery SetFileMTime_;
 
 		// 1 is loved, 2 is banned
@@ -92,6 +95,8 @@ namespace LMP
 
 			QHash<QString, int> PresentArtists_;
 			QHash<QString, int> PresentAlbums_;
+
+			QHash<QString, QDateTime> Path2MTime_;
 		};
 
 		LocalCollectionStorage (QObject* = 0);
@@ -102,6 +107,8 @@ namespace LMP
 		LoadResult Load ();
 		void Load (const LoadResult&);
 
+		qint64 GetGeneration ();
+
 		QStringList GetTracksPaths ();
 
 		void RemoveTrack (int);
@@ -109,6 +116,7 @@ namespace LMP
 		void RemoveArtist (int);
 
 		void SetAlbumArt (int, const QString&);
+		void SetTrackLength (int, int);
 
 		Collection::TrackStats GetTrackStats (int);
 		void SetTrackStats (const Collection::TrackStats&);
@@ -117,6 +125,18 @@ namespace LMP
 		QDateTime GetMTime (const QString&);
 		void SetMTime (const QString&, const QDateTime&);
 
+		/** Returns the mtimes of all tracks in the collection.
+		 *
+		 * Tracks without a stored mtime are present in the result with
+		 * an invalid QDateTime.
+		 */
+		QHash<QString, QDateTime> GetAllMTimes ();
+
+		/** Updates the mtimes of the given tracks in a single
+		 * transaction.
+		 */
+		void SetMTimes (const QHash<QString, QDateTime>&);
+
 		void SetTrackLoved (int);
 		void SetTrackBanned (int);
 		void ClearTrackLovedBanned (int);
@@ -28,45 +28,109 @@
  **********************************************************************/
 
 #include "localfileresolver.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <QtDebug>
+#include <QFile>
 #include <QFileInfo>
+#include <QFutureInterface>
+#include <QRunnable>
+#include <QThread>
+#include <QTimer>
 #include <taglib/fileref.h>
 #include <taglib/tag.h>
 #include <util/sll/prelude.h>
 #include <util/sll/either.h>
+#include <util/threads/futures.h>
 #include "util/lmp/gstutil.h"
 #include "xmlsettingsmanager.h"
+#include "tagscachestorage.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
 
 namespace LeechCraft
 {
 namespace LMP
 {
+	LocalFileResolver::LocalFileResolver (QObject *parent)
+	: QObject { parent }
+	, TagsCache_ { std::make_shared<TagsCacheThread> () }
+	{
+		TagsCache_->SetAutoQuit (true);
+		TagsCache_->start (QThread::LowestPriority);
+
+		ResolverPool_.setMaxThreadCount (QThread::idealThreadCount ());
+
+		auto commitTimer = new QTimer { this };
+		connect (commitTimer,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (commitTagsCache ()));
+		commitTimer->start (5000);
+	}
+
+	LocalFileResolver::~LocalFileResolver ()
+	{
+		{
+			QMutexLocker locker { &DevicesMutex_ };
+			Device2Queue_.clear ();
+		}
+
+		ResolverPool_.clear ();
+		ResolverPool_.waitForDone ();
+	}
+
 	TagLib::FileRef LocalFileResolver::GetFileRef (const QString& file) const
 	{
+		return GetFileRef (file, ReadStyle::Accurate);
+	}
+
+	TagLib::FileRef LocalFileResolver::GetFileRef (const QString& file, ReadStyle style) const
+	{
+		const auto tlStyle = style == ReadStyle::Accurate ?
+				TagLib::AudioProperties::Accurate :
+				TagLib::AudioProperties::Fast;
 #ifdef Q_OS_WIN32
-		return TagLib::FileRef (reinterpret_cast<const wchar_t*> (file.utf16 ()));
+		return TagLib::FileRef (reinterpret_cast<const wchar_t*> (file.utf16 ()), true, tlStyle);
 #else
-		return TagLib::FileRef (file.toUtf8 ().constData (), true, TagLib::AudioProperties::Accurate);
+		return TagLib::FileRef (file.toUtf8 ().constData (), true, tlStyle);
 #endif
 	}
 
 	LocalFileResolver::ResolveResult_t LocalFileResolver::ResolveInfo (const QString& file)
 	{
-		const auto& modified = QFileInfo (file).lastModified ();
+		return ResolveInfo (file, ReadStyle::Accurate);
+	}
+
+	LocalFileResolver::ResolveResult_t LocalFileResolver::ResolveInfo (const QString& file, ReadStyle style)
+	{
+		const QFileInfo fileInfo { file };
+		const auto& modified = fileInfo.lastModified ();
+		const auto size = fileInfo.size ();
+		const bool accurate = style == ReadStyle::Accurate;
 
 		{
 			QReadLocker locker (&CacheLock_);
-			if (Cache_.contains (file))
-			{
-				const auto& pair = Cache_ [file];
-				if (pair.first == modified)
-					return ResolveResult_t::Right (pair.second);
-			}
+			const auto pos = Cache_.find (file);
+			if (pos != Cache_.end () &&
+					pos->MTime_ == modified &&
+					(pos->IsAccurate_ || !accurate))
+				return ResolveResult_t::Right (pos->Info_);
 		}
 
-		QMutexLocker tlLocker (&TaglibMutex_);
+		auto addToCache = [&] (const MediaInfo& info)
+		{
+			QWriteLocker locker (&CacheLock_);
+			if (Cache_.size () > 200)
+				Cache_.clear ();
+			Cache_ [file] = { modified, info, accurate };
+		};
 
-		auto r = GetFileRef (file);
+		auto r = GetFileRef (file, style);
 		auto tag = r.tag ();
 		if (!tag)
 			return ResolveResult_t::Left ({ file, "cannot get audio tags" });
@@ -95,12 +159,9 @@ namespace LMP
 			static_cast<qint32> (tag->year ()),
 			static_cast<qint32> (tag->track ())
 		};
-		{
-			QWriteLocker locker (&CacheLock_);
-			if (Cache_.size () > 200)
-				Cache_.clear ();
-			Cache_ [file] = qMakePair (modified, info);
-		}
+		addToCache (info);
+		TagsCache_->Schedule (&TagsCacheStorage::Set, info, size, modified, accurate);
+		HasUncommitted_ = true;
 		return ResolveResult_t::Right (info);
 	}
 
@@ -109,6 +170,195 @@ namespace LMP
 		return TaglibMutex_;
 	}
 
+	namespace
+	{
+		class ResolveRunnable : public QRunnable
+		{
+			const std::function<void ()> Func_;
+		public:
+			ResolveRunnable (const std::function<void ()>& func)
+			: Func_ { func }
+			{
+			}
+
+			void run () override
+			{
+				Func_ ();
+			}
+		};
+
+		const int LookupChunkSize = 500;
+
+		const int InteractivePriority = 100;
+
+		int GetThreadsPerDevice ()
+		{
+			return std::max (XmlSettingsManager::Instance ()
+					.property ("ResolverThreadsPerDevice").toInt (), 1);
+		}
+
+		quint64 GetDeviceId (const QString& path)
+		{
+#ifdef Q_OS_UNIX
+			struct stat st;
+			if (!stat (QFile::encodeName (path).constData (), &st))
+				return st.st_dev;
+#else
+			Q_UNUSED (path)
+#endif
+			return 0;
+		}
+	}
+
+	QFuture<LocalFileResolver::ResolveResult_t> LocalFileResolver::ResolveInfoAsync (const QString& file)
+	{
+		QFutureInterface<ResolveResult_t> iface;
+		iface.reportStarted ();
+
+		auto task = [this, iface, file] () mutable
+		{
+			Util::ReportFutureResult (iface, [this, &file] { return ResolveInfo (file); });
+		};
+		Enqueue (GetDeviceId (QFileInfo { file }.path ()), GetThreadsPerDevice (),
+				{ InteractivePriority, task });
+
+		return iface.future ();
+	}
+
+	QFuture<MediaInfo> LocalFileResolver::ResolveInfos (const QStringList& paths, ReadStyle style, int priority)
+	{
+		QFutureInterface<MediaInfo> iface;
+		iface.reportStarted ();
+		iface.setProgressRange (0, paths.size ());
+
+		if (paths.isEmpty ())
+		{
+			iface.reportFinished ();
+			return iface.future ();
+		}
+
+		const auto total = paths.size ();
+		const auto remaining = std::make_shared<std::atomic<int>> (total);
+		const auto report = [total, remaining] (QFutureInterface<MediaInfo> iface, const MediaInfo& info, int idx)
+		{
+			iface.reportResult (info, idx);
+
+			const auto left = --*remaining;
+			iface.setProgressValue (total - left);
+			if (!left)
+				iface.reportFinished ();
+		};
+
+		const bool accurate = style == ReadStyle::Accurate;
+		for (int chunkStart = 0; chunkStart < total; chunkStart += LookupChunkSize)
+		{
+			const auto& chunk = paths.mid (chunkStart, LookupChunkSize);
+			Util::Sequence (this, TagsCache_->Schedule (&TagsCacheStorage::Lookup, chunk, accurate)) >>
+					[=] (const QList<boost::optional<MediaInfo>>& cached) mutable
+					{
+						const auto limit = GetThreadsPerDevice ();
+
+						QHash<QString, quint64> dir2device;
+						for (int i = 0; i < chunk.size (); ++i)
+						{
+							const auto idx = chunkStart + i;
+
+							if (const auto& info = cached.value (i))
+							{
+								report (iface, *info, idx);
+								continue;
+							}
+
+							if (iface.isCanceled ())
+							{
+								report (iface, {}, idx);
+								continue;
+							}
+
+							const auto& path = chunk.at (i);
+							const auto& dir = QFileInfo { path }.path ();
+							auto devPos = dir2device.find (dir);
+							if (devPos == dir2device.end ())
+								devPos = dir2device.insert (dir, GetDeviceId (dir));
+
+							auto task = [this, iface, path, idx, style, report] () mutable
+							{
+								MediaInfo info;
+								if (!iface.isCanceled ())
+									info = ResolveInfo (path, style).ToRight ([] (const ResolveError& error)
+											{
+												qWarning () << Q_FUNC_INFO
+														<< "error resolving media info for"
+														<< error.FilePath_
+														<< error.ReasonString_;
+												return MediaInfo {};
+											});
+								report (iface, info, idx);
+							};
+							Enqueue (*devPos, limit, { priority, task });
+						}
+					};
+		}
+
+		return iface.future ();
+	}
+
+	void LocalFileResolver::Enqueue (quint64 device, int limit, const PendingResolve& resolve)
+	{
+		QMutexLocker locker { &DevicesMutex_ };
+
+		auto& queue = Device2Queue_ [device];
+		if (queue.Running_ < limit)
+		{
+			++queue.Running_;
+			StartOnPool (device, resolve);
+			return;
+		}
+
+		const auto pos = std::upper_bound (queue.Pending_.begin (), queue.Pending_.end (), resolve,
+				[] (const PendingResolve& left, const PendingResolve& right)
+					{ return left.Priority_ > right.Priority_; });
+		queue.Pending_.insert (pos, resolve);
+	}
+
+	void LocalFileResolver::StartOnPool (quint64 device, const PendingResolve& resolve)
+	{
+		const auto& func = resolve.Func_;
+		ResolverPool_.start (new ResolveRunnable
+				{
+					[this, device, func]
+					{
+						func ();
+						HandleResolveDone (device);
+					}
+				},
+				resolve.Priority_);
+	}
+
+	void LocalFileResolver::HandleResolveDone (quint64 device)
+	{
+		QMutexLocker locker { &DevicesMutex_ };
+
+		const auto pos = Device2Queue_.find (device);
+		if (pos == Device2Queue_.end ())
+			return;
+
+		if (pos->Pending_.isEmpty ())
+		{
+			if (!--pos->Running_)
+				Device2Queue_.erase (pos);
+			return;
+		}
+
+		StartOnPool (device, pos->Pending_.takeFirst ());
+	}
+
+	void LocalFileResolver::commitTagsCache ()
+	{
+		if (HasUncommitted_.exchange (false))
+			TagsCache_->Schedule (&TagsCacheStorage::Flush);
+	}
+
 	void LocalFileResolver::flushCache ()
 	{
 		QWriteLocker locker { &CacheLock_ };
@@ -29,12 +29,18 @@
 
 #pragma once
 
+#include <memory>
+#include <atomic>
+#include <functional>
 #include <stdexcept>
 #include <QObject>
 #include <QHash>
+#include <QList>
 #include <QReadWriteLock>
 #include <QMutex>
 #include <QDateTime>
+#include <QThreadPool>
+#include <QFuture>
 #include <taglib/fileref.h>
 #include "interfaces/lmp/itagresolver.h"
 #include "mediainfo.h"
@@ -43,6 +49,8 @@ namespace LeechCraft
 {
 namespace LMP
 {
+	class TagsCacheThread;
+
 	class LocalFileResolver : public QObject
 							, public ITagResolver
 	{
@@ -50,15 +58,88 @@ namespace LMP
 		Q_INTERFACES (LeechCraft::LMP::ITagResolver)
 
 		QMutex TaglibMutex_;
+		std::atomic_bool HasUncommitted_ { false };
+
+		struct CachedInfo
+		{
+			QDateTime MTime_;
+			MediaInfo Info_;
+			bool IsAccurate_;
+		};
+
 		QReadWriteLock CacheLock_;
-		QHash<QString, QPair<QDateTime, MediaInfo>> Cache_;
+		QHash<QString, CachedInfo> Cache_;
+
+		const std::shared_ptr<TagsCacheThread> TagsCache_;
+
+		QThreadPool ResolverPool_;
+
+		struct PendingResolve
+		{
+			int Priority_;
+			std::function<void ()> Func_;
+		};
+
+		struct DeviceQueue
+		{
+			int Running_ = 0;
+			QList<PendingResolve> Pending_;
+		};
+
+		QMutex DevicesMutex_;
+		QHash<quint64, DeviceQueue> Device2Queue_;
 	public:
-		using QObject::QObject;
+		enum class ReadStyle
+		{
+			Fast,
+			Accurate
+		};
+
+		LocalFileResolver (QObject* = nullptr);
+		~LocalFileResolver ();
 
 		TagLib::FileRef GetFileRef (const QString&) const;
+		TagLib::FileRef GetFileRef (const QString&, ReadStyle) const;
 		ResolveResult_t ResolveInfo (const QString&);
+		ResolveResult_t ResolveInfo (const QString&, ReadStyle);
+
+		/** Returns the mutex serializing the code that modifies the tags
+		 * of the files.
+		 *
+		 * ResolveInfo() doesn't take it: TagLib instances for different
+		 * files share no mutable state, so the files are read in parallel.
+		 */
 		QMutex& GetMutex ();
+
+		/** Resolves the given file in the resolver pool, ahead of the
+		 * pending bulk resolves.
+		 *
+		 * This is intended for the GUI code that needs the tags of a
+		 * single file and shouldn't block on reading it.
+		 */
+		QFuture<ResolveResult_t> ResolveInfoAsync (const QString&);
+
+		/** Resolves the given paths in the dedicated resolver pool.
+		 *
+		 * The persistent tags cache is looked up in batches on its own
+		 * thread, and only the files missing from it are read.
+		 *
+		 * Results are reported in the order of the paths, with a
+		 * default-constructed MediaInfo for the files that failed to
+		 * resolve. Tasks with higher priority are dequeued first.
+		 *
+		 * At most ResolverThreadsPerDevice files are read from the same
+		 * storage device at once. The rest wait in a per-device queue
+		 * and don't occupy the pool threads, so a slow device doesn't
+		 * hold up the others.
+		 */
+		QFuture<MediaInfo> ResolveInfos (const QStringList&, ReadStyle, int priority = 0);
+	private:
+		void Enqueue (quint64 device, int limit, const PendingResolve&);
+		void StartOnPool (quint64 device, const PendingResolve&);
+		void HandleResolveDone (quint64 device);
 	private slots:
+		void commitTagsCache ();
 		void flushCache ();
 	};
 }
@@ -29,13 +29,18 @@
 
 #include "player.h"
 #include <algorithm>
+#include <vector>
 #include <QStandardItemModel>
 #include <QFileInfo>
 #include <QDir>
 #include <QUrl>
+#include <QVector>
 #include <QtConcurrentRun>
 #include <QFutureSynchronizer>
+#include <QFutureInterface>
+#include <QFutureWatcher>
 #include <QApplication>
+#include <QTimer>
 #include <util/util.h>
 #include <util/xpc/util.h>
 #include <util/sll/slotclosure.h>
@@ -50,6 +55,7 @@
 #include <interfaces/media/irestorableradiostationprovider.h>
 #include "core.h"
 #include "mediainfo.h"
+#include "sortkey.h"
 #include "localfileresolver.h"
 #include "util.h"
 #include "localcollection.h"
@@ -77,54 +83,6 @@ namespace LMP
 				<< SortingCriteria::TrackNumber;
 	}
 
-	bool Player::Sorter::operator() (const MediaInfo& left, const MediaInfo& right) const
-	{
-		Q_FOREACH (auto crit, Criteria_)
-		{
-			switch (crit)
-			{
-			case SortingCriteria::Artist:
-				if (left.Artist_ != right.Artist_)
-					return left.Artist_ < right.Artist_;
-				break;
-			case SortingCriteria::Year:
-				if (left.Year_ != right.Year_)
-					return left.Year_ < right.Year_;
-				break;
-			case SortingCriteria::Album:
-				if (left.Album_ != right.Album_)
-					return left.Album_ < right.Album_;
-				break;
-			case SortingCriteria::TrackNumber:
-				if (left.TrackNumber_ != right.TrackNumber_)
-					return left.TrackNumber_ < right.TrackNumber_;
-				break;
-			case SortingCriteria::TrackTitle:
-				if (left.Title_ != right.Title_)
-					return left.Title_ < right.Title_;
-				break;
-			case SortingCriteria::DirectoryPath:
-			{
-				const auto& leftPath = QFileInfo (left.LocalPath_).dir ().absolutePath ();
-				const auto& rightPath = QFileInfo (right.LocalPath_).dir ().absolutePath ();
-				if (leftPath != rightPath)
-					return QString::localeAwareCompare (leftPath, rightPath) < 0;
-				break;
-			}
-			case SortingCriteria::FileName:
-			{
-				const auto& leftPath = QFileInfo (left.LocalPath_).fileName ();
-				const auto& rightPath = QFileInfo (right.LocalPath_).fileName ();
-				if (leftPath != rightPath)
-					return QString::localeAwareCompare (leftPath, rightPath) < 0;
-				break;
-			}
-			}
-		}
-
-		return left.LocalPath_ < right.LocalPath_;
-	}
-
 	using ResolveResult_t = QList<QPair<AudioSource, MediaInfo>>;
 
 	struct Player::ResolveJobResult
@@ -141,6 +99,7 @@ namespace LMP
 	, Path_ (new Path (Source_, Output_))
 	, PRG_ { QDateTime::currentDateTime ().toTime_t () }
 	, RulesManager_ (new PlayerRulesManager (PlaylistModel_, this))
+	, SaveTimer_ (new QTimer (this))
 	, FirstPlaylistRestore_ (true)
 	, PlayMode_ (PlayMode::Sequential)
 	{
@@ -184,6 +143,13 @@ namespace LMP
 				SLOT (handleSourceError (QString, SourceError)));
 
 		PlaylistModel_->setHorizontalHeaderLabels ({ tr ("Playlist") });
+
+		SaveTimer_->setSingleShot (true);
+		SaveTimer_->setInterval (2000);
+		connect (SaveTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (handleSaveTimeout ()));
 	}
 
 	void Player::InitWithOtherPlugins ()
@@ -255,6 +221,12 @@ namespace LMP
 
 	namespace
 	{
+		bool IsChunkedPlaylist (const AudioSource& source)
+		{
+			return source.IsLocalFile () &&
+					MakeChunkedPlaylistParser (source.GetLocalPath ());
+		}
+
 		Playlist FileToSource (const AudioSource& source)
 		{
 			if (!source.IsLocalFile ())
@@ -296,10 +268,28 @@ namespace LMP
 		if (CurrentQueue_.isEmpty ())
 			emit shouldClearFiltering ();
 
+		// Playlist files are parsed in background, and their entries are
+		// appended as they are parsed, after the other sources have
+		// replaced the playlist if requested.
 		Playlist parsedSources;
+		QStringList playlistFiles;
 		for (const auto& path : sources)
-			parsedSources += FileToSource (path);
+			if (IsChunkedPlaylist (path))
+				playlistFiles << path.GetLocalPath ();
+			else
+				parsedSources += FileToSource (path);
+
+		if (playlistFiles.isEmpty () ||
+				!parsedSources.isEmpty () ||
+				flags & EnqueueReplace)
+			EnqueuePlaylist (parsedSources, flags);
 
+		for (const auto& file : playlistFiles)
+			EnqueuePlaylistFile (file, flags & ~EnqueueReplace);
+	}
+
+	void Player::EnqueuePlaylist (Playlist parsedSources, EnqueueFlags flags)
+	{
 		if (!(flags & EnqueueReplace))
 			for (auto i = parsedSources.begin (); i != parsedSources.end (); )
 			{
@@ -309,6 +299,13 @@ namespace LMP
 					++i;
 			}
 
+		HandlePlaylistCurrent (parsedSources);
+
+		AddToPlaylistModel (parsedSources.ToSources (), flags & EnqueueSort, flags & EnqueueReplace);
+	}
+
+	void Player::HandlePlaylistCurrent (const Playlist& parsedSources)
+	{
 		const auto curSrcPos = std::find_if (parsedSources.begin (), parsedSources.end (),
 				[] (const PlaylistItem& item) { return item.Additional_ ["Current"].toBool (); });
 		if (curSrcPos != parsedSources.end ())
@@ -322,8 +319,113 @@ namespace LMP
 				AddToOneShotQueue (curSrcPos->Source_);
 				break;
 			}
+	}
 
-		AddToPlaylistModel (parsedSources.ToSources (), flags & EnqueueSort, flags & EnqueueReplace);
+	void Player::EnqueuePlaylistFile (const QString& file, EnqueueFlags flags)
+	{
+		const auto& parser = MakeChunkedPlaylistParser (file);
+
+		QFutureInterface<Playlist> iface;
+		iface.reportStarted ();
+
+		QtConcurrent::run ([iface, parser, file] () mutable
+				{
+					int chunkIdx = 0;
+					parser (file,
+							[&iface, &chunkIdx] (const Playlist& chunk)
+								{ iface.reportResult (chunk, chunkIdx++); });
+					iface.reportFinished ();
+				});
+
+		const auto& future = iface.future ();
+
+		++PlaylistLoads_;
+
+		/* The chunks are appended one by one in the order they are
+		 * parsed, each one after the previous one is resolved and after
+		 * the pending replacements of the playlist are done, so they are
+		 * neither lost nor reordered.
+		 */
+		struct LoadState
+		{
+			int Handled_ = 0;
+			bool IsBusy_ = false;
+			bool IsDone_ = false;
+		};
+		const auto state = std::make_shared<LoadState> ();
+
+		const auto pump = std::make_shared<std::function<void ()>> ();
+		const std::weak_ptr<std::function<void ()>> weakPump { pump };
+		*pump = [this, future, state, weakPump, file, flags]
+		{
+			const auto pump = weakPump.lock ();
+			if (!pump || state->IsBusy_ || state->IsDone_)
+				return;
+
+			if (PendingReplaces_)
+			{
+				RunAfterReplaces ([pump] { (*pump) (); });
+				return;
+			}
+
+			if (state->Handled_ < future.resultCount ())
+			{
+				state->IsBusy_ = true;
+				EnqueuePlaylistChunk (future.resultAt (state->Handled_++),
+						[state, pump]
+						{
+							state->IsBusy_ = false;
+							(*pump) ();
+						});
+				return;
+			}
+
+			if (!future.isFinished ())
+				return;
+
+			state->IsDone_ = true;
+
+			if (!--PlaylistLoads_)
+			{
+				SaveTimer_->stop ();
+				SaveOnLoadPlaylist ();
+			}
+
+			if (!state->Handled_)
+				EnqueuePlaylist (Playlist { QList<AudioSource> { AudioSource { file } } }, flags);
+			else if (flags & EnqueueSort && !Sorter_.Criteria_.isEmpty ())
+				AddToPlaylistModel ({}, true, false);
+		};
+
+		const auto watcher = new QFutureWatcher<Playlist> (this);
+		new Util::SlotClosure<Util::NoDeletePolicy>
+		{
+			[pump] { (*pump) (); },
+			watcher,
+			SIGNAL (resultsReadyAt (int, int)),
+			watcher
+		};
+		new Util::SlotClosure<Util::NoDeletePolicy>
+		{
+			[pump, watcher]
+			{
+				(*pump) ();
+				watcher->deleteLater ();
+			},
+			watcher,
+			SIGNAL (finished ()),
+			watcher
+		};
+
+		watcher->setFuture (future);
+	}
+
+	void Player::RunAfterReplaces (const std::function<void ()>& func)
+	{
+		if (PendingReplaces_)
+			AfterReplaces_ << func;
+		else
+			func ();
 	}
 
 	QList<AudioSource> Player::GetQueue () const
@@ -382,37 +484,53 @@ namespace LMP
 
 			RemoveFromOneShotQueue (source);
 
-			auto item = Items_.take (source);
-			auto parent = item->parent ();
-			if (parent)
+			RemoveItem (source);
+		}
+
+		SaveOnLoadPlaylist ();
+	}
+
+	void Player::RemoveItem (const AudioSource& source)
+	{
+		const auto item = Items_.take (source);
+		const auto parent = item->parent ();
+		if (parent)
+		{
+			if (parent->rowCount () == 1)
 			{
-				if (parent->rowCount () == 1)
+				for (const auto& key : AlbumRoots_.keys ())
 				{
-					for (const auto& key : AlbumRoots_.keys ())
-					{
-						auto& items = AlbumRoots_ [key];
-						if (!items.contains (parent))
-							continue;
+					auto& items = AlbumRoots_ [key];
+					if (!items.contains (parent))
+						continue;
 
-						items.removeAll (parent);
-						if (items.isEmpty ())
-							AlbumRoots_.remove (key);
-					}
-					PlaylistModel_->removeRow (parent->row ());
-				}
-				else
-				{
-					const auto& info = item->data (Role::Info).value<MediaInfo> ();
-					if (!info.LocalPath_.isEmpty ())
-						IncAlbumLength (parent, -info.Length_);
-					parent->removeRow (item->row ());
+					items.removeAll (parent);
+					if (items.isEmpty ())
+						AlbumRoots_.remove (key);
 				}
+				PlaylistModel_->removeRow (parent->row ());
 			}
 			else
-				PlaylistModel_->removeRow (item->row ());
+			{
+				const auto& info = item->data (Role::Info).value<MediaInfo> ();
+				if (!info.LocalPath_.isEmpty ())
+					IncAlbumLength (parent, -info.Length_);
+				parent->removeRow (item->row ());
+			}
 		}
+		else
+		{
+			const auto& albumID = item->data (Role::Info).value<MediaInfo> ().Album_;
+			const auto pos = AlbumRoots_.find (albumID);
+			if (pos != AlbumRoots_.end ())
+			{
+				pos->removeAll (item);
+				if (pos->isEmpty ())
+					AlbumRoots_.erase (pos);
+			}
 
-		SaveOnLoadPlaylist ();
+			PlaylistModel_->removeRow (item->row ());
+		}
 	}
 
 	void Player::SetStopAfter (const QModelIndex& index)
@@ -956,6 +1074,104 @@ namespace LMP
 					[&] (const AudioSource& source) { return PairResolve (getter, source); });
 		}
 
+		struct KeyedItem
+		{
+			int Index_;
+			bool IsUseful_;
+			QUrl Url_;
+			SortKey Key_;
+		};
+
+		std::vector<KeyedItem> MakeKeyedItems (const ResolveResult_t& resolved,
+				const SortKeyMaker& maker, int indexOffset = 0)
+		{
+			std::vector<KeyedItem> items;
+			items.reserve (resolved.size ());
+			for (int i = 0; i < resolved.size (); ++i)
+			{
+				const auto& pair = resolved.at (i);
+				if (pair.second.IsUseless ())
+					items.push_back ({ i + indexOffset, false, pair.first.ToUrl (), {} });
+				else
+					items.push_back ({ i + indexOffset, true, {}, maker (pair.second) });
+			}
+			return items;
+		}
+
+		/* Useful items go first in the order of their sort keys, followed
+		 * by the useless ones ordered by their URLs.
+		 */
+		struct KeyedLess
+		{
+			const SortKeyMaker& Maker_;
+
+			bool operator() (const KeyedItem& left, const KeyedItem& right) const
+			{
+				if (left.IsUseful_ != right.IsUseful_)
+					return left.IsUseful_;
+				else if (!left.IsUseful_)
+					return left.Url_ < right.Url_;
+				else
+					return Maker_.Less (left.Key_, right.Key_);
+			}
+		};
+
+		/* Sorts the resolved sources computing the sort key of each item
+		 * only once.
+		 */
+		void SortResolved (ResolveResult_t& resolved, const QList<SortingCriteria>& criteria)
+		{
+			const SortKeyMaker maker { criteria };
+
+			auto items = MakeKeyedItems (resolved, maker);
+			std::sort (items.begin (), items.end (), KeyedLess { maker });
+
+			ResolveResult_t sorted;
+			sorted.reserve (resolved.size ());
+			for (const auto& item : items)
+				sorted << resolved.at (item.Index_);
+			resolved = sorted;
+		}
+
+		/* Merges the two lists sorted by SortResolved() using the very
+		 * same ordering.
+		 */
+		ResolveResult_t MergeSorted (const ResolveResult_t& existing, const ResolveResult_t& added,
+				const QList<SortingCriteria>& criteria)
+		{
+			const SortKeyMaker maker { criteria };
+			const KeyedLess less { maker };
+
+			const auto& existingItems = MakeKeyedItems (existing, maker);
+			const auto& addedItems = MakeKeyedItems (added, maker, existing.size ());
+
+			std::vector<KeyedItem> items;
+			items.reserve (existingItems.size () + addedItems.size ());
+			std::merge (existingItems.begin (), existingItems.end (),
+					addedItems.begin (), addedItems.end (),
+					std::back_inserter (items),
+					less);
+
+			ResolveResult_t merged;
+			merged.reserve (items.size ());
+			for (const auto& item : items)
+				merged << (item.Index_ < existing.size () ?
+						existing.at (item.Index_) :
+						added.at (item.Index_ - existing.size ()));
+			return merged;
+		}
+
+		/* Checks whether the sources may be just appended to the
+		 * existing ones keeping the order.
+		 */
+		bool IsAfter (const ResolvedSource_t& first, const ResolvedSource_t& last,
+				const QList<SortingCriteria>& criteria)
+		{
+			const SortKeyMaker maker { criteria };
+			const auto& items = MakeKeyedItems ({ last, first }, maker);
+			return !KeyedLess { maker } (items [1], items [0]);
+		}
+
 		template<typename Sorter, typename NonLocalGetter>
 		ResolveResult_t PairResolveSort (const QList<AudioSource>& sources,
 				Sorter sorter, NonLocalGetter nonLocalGetter, bool sort)
@@ -965,21 +1181,7 @@ namespace LMP
 			if (sorter.Criteria_.isEmpty () || !sort)
 				return result;
 
-			std::sort (result.begin (), result.end (),
-					[sorter] (const ResolvedSource_t& s1, const ResolvedSource_t& s2)
-					{
-						const auto leftUseful = !s1.second.IsUseless ();
-						const auto rightUseful = !s2.second.IsUseless ();
-
-						if (leftUseful && !rightUseful)
-							return true;
-						else if (!leftUseful && rightUseful)
-							return false;
-						else if (!leftUseful || !rightUseful)
-							return s1.first.ToUrl () < s2.first.ToUrl ();
-						else
-							return sorter (s1.second, s2.second);
-					});
+			SortResolved (result, sorter.Criteria_);
 
 			return result;
 		}
@@ -989,15 +1191,24 @@ namespace LMP
 	{
 		if (!CurrentQueue_.isEmpty () && !clear)
 		{
+			if (!sources.isEmpty ())
+			{
+				AppendToPlaylistModel (sources, sort);
+				return;
+			}
+
 			EnqueueFlags flags { EnqueueReplace };
 			if (sort)
 				flags |= EnqueueSort;
-			Enqueue (CurrentQueue_ + sources, flags);
+			Enqueue (CurrentQueue_, flags);
 			return;
 		}
 
 		emit playerAvailable (false);
 
+		if (clear)
+			++PendingReplaces_;
+
 		const auto future = QtConcurrent::run ([=]
 				{
 					return ResolveJobResult
@@ -1017,9 +1228,148 @@ namespace LMP
 				{
 					ContinueAfterSorted (result);
 					emit playerAvailable (true);
+
+					if (result.ShouldClear_ && !--PendingReplaces_)
+					{
+						const auto funcs = AfterReplaces_;
+						AfterReplaces_.clear ();
+						for (const auto& func : funcs)
+							func ();
+					}
+				};
+	}
+
+	void Player::AppendToPlaylistModel (const QList<AudioSource>& sources, bool sort)
+	{
+		emit playerAvailable (false);
+
+		const auto future = QtConcurrent::run ([=]
+				{
+					return PairResolveSort (sources,
+							Sorter_,
+							[this] (const AudioSource& source)
+							{
+								return Url2Info_.value (source.ToUrl ());
+							},
+							sort);
+				});
+		Util::Sequence (this, future) >>
+				[this, sort] (const ResolveResult_t& result)
+				{
+					MergeResolved (result, sort);
+					emit playerAvailable (true);
 				};
 	}
 
+	void Player::EnqueuePlaylistChunk (Playlist chunk, const std::function<void ()>& done)
+	{
+		for (auto i = chunk.begin (); i != chunk.end (); )
+		{
+			if (Items_.contains (i->Source_))
+				i = chunk.erase (i);
+			else
+				++i;
+		}
+
+		if (chunk.isEmpty ())
+		{
+			done ();
+			return;
+		}
+
+		HandlePlaylistCurrent (chunk);
+
+		emit playerAvailable (false);
+
+		const auto& sources = chunk.ToSources ();
+		const auto future = QtConcurrent::run ([=]
+				{
+					return PairResolveAll (sources,
+							[this] (const AudioSource& source)
+							{
+								return Url2Info_.value (source.ToUrl ());
+							});
+				});
+		Util::Sequence (this, future) >>
+				[this, done] (const ResolveResult_t& result)
+				{
+					// The queue might have changed while the chunk was being resolved.
+					auto resolved = result;
+					const auto removedPos = std::remove_if (resolved.begin (), resolved.end (),
+							[this] (const ResolvedSource_t& pair) { return Items_.contains (pair.first); });
+					resolved.erase (removedPos, resolved.end ());
+
+					// Appending the chunk only adds its rows instead of rebuilding the model.
+					if (!resolved.isEmpty ())
+					{
+						if (CurrentQueue_.isEmpty ())
+							ContinueAfterSorted ({ resolved, false });
+						else
+							AppendResolved (resolved);
+					}
+
+					emit playerAvailable (true);
+
+					done ();
+				};
+	}
+
+	void Player::MergeResolved (ResolveResult_t resolved, bool sort)
+	{
+		// The queue might have changed while the new sources were being resolved.
+		const auto removedPos = std::remove_if (resolved.begin (), resolved.end (),
+				[this] (const ResolvedSource_t& pair) { return Items_.contains (pair.first); });
+		resolved.erase (removedPos, resolved.end ());
+		if (resolved.isEmpty ())
+			return;
+
+		if (CurrentQueue_.isEmpty ())
+		{
+			ContinueAfterSorted ({ resolved, false });
+			return;
+		}
+
+		const auto getResolved = [this] (const AudioSource& source)
+		{
+			if (source.GetType () == AudioSource::Type::File)
+				if (const auto item = Items_.value (source))
+					return ResolvedSource_t { source, item->data (Role::Info).value<MediaInfo> () };
+
+			return ResolvedSource_t { source, Url2Info_.value (source.ToUrl ()) };
+		};
+
+		if (!sort ||
+				Sorter_.Criteria_.isEmpty () ||
+				IsAfter (resolved.front (), getResolved (CurrentQueue_.last ()), Sorter_.Criteria_))
+		{
+			AppendResolved (resolved);
+			return;
+		}
+
+		const auto& existing = Util::Map (CurrentQueue_, getResolved);
+		const auto& merged = MergeSorted (existing, resolved, Sorter_.Criteria_);
+
+		int firstChanged = 0;
+		while (firstChanged < existing.size () &&
+				merged.at (firstChanged).first == existing.at (firstChanged).first)
+			++firstChanged;
+
+		if (!firstChanged)
+		{
+			ContinueAfterSorted ({ merged, true });
+			return;
+		}
+
+		/* The rows before the first merged source stay as they are, only
+		 * the ones after it are taken out and appended again along with
+		 * the new ones, so the model isn't reset.
+		 */
+		while (CurrentQueue_.size () > firstChanged)
+			RemoveItem (CurrentQueue_.takeLast ());
+
+		AppendResolved (merged.mid (firstChanged));
+	}
+
 	bool Player::HandleCurrentStop (const AudioSource& source)
 	{
 		if (source != CurrentStopSource_)
@@ -1391,6 +1741,146 @@ namespace LMP
 		}
 	}
 
+	QStandardItem* Player::MakeSourceItem (const AudioSource& source) const
+	{
+		auto item = new QStandardItem ();
+		item->setEditable (false);
+		item->setData (QVariant::fromValue (source), Role::Source);
+		item->setData (source == CurrentStopSource_, Role::IsStop);
+
+		const auto oneShotPos = CurrentOneShotQueue_.indexOf (source);
+		if (oneShotPos >= 0)
+			item->setData (oneShotPos, Role::OneShotPos);
+
+		return item;
+	}
+
+	void Player::AppendResolved (const ResolveResult_t& resolved)
+	{
+		QList<QStandardItem*> newRows;
+		QHash<QStandardItem*, QList<QStandardItem*>> newChildren;
+		QList<QStandardItem*> newAlbums;
+
+		QString prevAlbumRoot;
+		const auto& lastSource = CurrentQueue_.last ();
+		if (lastSource.GetType () == AudioSource::Type::File)
+			if (const auto lastItem = Items_.value (lastSource))
+				prevAlbumRoot = lastItem->data (Role::Info).value<MediaInfo> ().Album_;
+
+		for (const auto& sourcePair : resolved)
+		{
+			const auto& source = sourcePair.first;
+			CurrentQueue_ << source;
+
+			const auto item = MakeSourceItem (source);
+			Items_ [source] = item;
+
+			switch (source.GetType ())
+			{
+			case AudioSource::Type::Stream:
+				item->setText (tr ("Stream"));
+				newRows << item;
+				break;
+			case AudioSource::Type::Url:
+			{
+				const auto& url = source.ToUrl ();
+
+				auto info = Core::Instance ().TryURLResolve (url);
+				if (!info && Url2Info_.contains (url))
+					info = Url2Info_ [url];
+
+				if (info)
+					FillItem (item, *info);
+				else
+					item->setText (url.toString ());
+
+				newRows << item;
+				break;
+			}
+			case AudioSource::Type::File:
+			{
+				const auto& info = sourcePair.second;
+
+				const auto& albumID = info.Album_;
+				FillItem (item, info);
+				if (albumID != prevAlbumRoot ||
+						AlbumRoots_ [albumID].isEmpty ())
+				{
+					newRows << item;
+
+					if (!info.Album_.simplified ().isEmpty ())
+						AlbumRoots_ [albumID] << item;
+				}
+				else
+				{
+					auto& root = AlbumRoots_ [albumID].last ();
+					if (root->data (Role::IsAlbum).toBool ())
+					{
+						IncAlbumLength (root, info.Length_);
+						if (root->model ())
+							newChildren [root] << item;
+						else
+							root->appendRow (item);
+					}
+					else
+					{
+						auto albumItem = MakeAlbumItem (info);
+
+						const auto& existingInfo = root->data (Role::Info).value<MediaInfo> ();
+
+						if (root->model ())
+						{
+							const int row = root->row ();
+							albumItem->appendRow (PlaylistModel_->takeRow (row));
+							albumItem->appendRow (item);
+							PlaylistModel_->insertRow (row, albumItem);
+
+							LoadAlbumArt (albumItem, info);
+							emit insertedAlbum (albumItem->index ());
+						}
+						else
+						{
+							newRows [newRows.indexOf (root)] = albumItem;
+							albumItem->appendRow (root);
+							albumItem->appendRow (item);
+							newAlbums << albumItem;
+						}
+
+						albumItem->setData (existingInfo.Length_, Role::AlbumLength);
+						IncAlbumLength (albumItem, info.Length_);
+
+						root = albumItem;
+					}
+				}
+				prevAlbumRoot = albumID;
+				break;
+			}
+			default:
+				item->setText ("unknown");
+				newRows << item;
+				break;
+			}
+		}
+
+		for (auto i = newChildren.begin (), end = newChildren.end (); i != end; ++i)
+			i.key ()->appendRows (*i);
+
+		if (!newRows.isEmpty ())
+			PlaylistModel_->invisibleRootItem ()->appendRows (newRows);
+
+		for (const auto albumItem : newAlbums)
+		{
+			LoadAlbumArt (albumItem, albumItem->data (Role::Info).value<MediaInfo> ());
+			emit insertedAlbum (albumItem->index ());
+		}
+
+		ScheduleSaveOnLoadPlaylist ();
+
+		const auto& currentSource = Source_->GetCurrentSource ();
+		if (Items_.contains (currentSource))
+			Items_ [currentSource]->setData (true, Role::IsCurrent);
+	}
+
 	void Player::ContinueAfterSorted (const ResolveJobResult& result)
 	{
 		const auto& sources = result.Resolved_;
@@ -1418,14 +1908,7 @@ namespace LMP
 			const auto& source = sourcePair.first;
 			CurrentQueue_ << source;
 
-			auto item = new QStandardItem ();
-			item->setEditable (false);
-			item->setData (QVariant::fromValue (source), Role::Source);
-			item->setData (source == CurrentStopSource_, Role::IsStop);
-
-			const auto oneShotPos = CurrentOneShotQueue_.indexOf (source);
-			if (oneShotPos >= 0)
-				item->setData (oneShotPos, Role::OneShotPos);
+			auto item = MakeSourceItem (source);
 
 			switch (source.GetType ())
 			{
@@ -1506,7 +1989,7 @@ namespace LMP
 
 		QMetaObject::invokeMethod (PlaylistModel_, "modelReset");
 
-		SaveOnLoadPlaylist ();
+		ScheduleSaveOnLoadPlaylist ();
 
 		if (Source_->GetState () == SourceState::Stopped)
 		{
@@ -1538,6 +2021,26 @@ namespace LMP
 				GetStaticManager ()->SetOnLoadPlaylist (GetAsNativePlaylist ());
 	}
 
+	void Player::ScheduleSaveOnLoadPlaylist ()
+	{
+		if (!PlaylistLoads_)
+			SaveTimer_->start ();
+	}
+
+	void Player::FlushOnLoadPlaylist ()
+	{
+		if (!SaveTimer_->isActive ())
+			return;
+
+		SaveTimer_->stop ();
+		SaveOnLoadPlaylist ();
+	}
+
+	void Player::handleSaveTimeout ()
+	{
+		SaveOnLoadPlaylist ();
+	}
+
 	void Player::restorePlaylist ()
 	{
 		const auto staticMgr = Core::Instance ().GetPlaylistManager ()->GetStaticManager ();
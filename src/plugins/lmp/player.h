@@ -49,6 +49,7 @@ class QModelIndex;
 class QStandardItem;
 class QAbstractItemModel;
 class QStandardItemModel;
+class QTimer;
 
 typedef QPair<QString, QString> StringPair_t;
 
@@ -60,6 +61,7 @@ namespace LMP
 	class Output;
 	class Path;
 	class PlayerRulesManager;
+	class Playlist;
 	struct MediaInfo;
 	enum class SourceError;
 	enum class SourceState;
@@ -88,8 +90,14 @@ namespace LMP
 		Media::IRadioStation_ptr CurrentStation_;
 		QHash<QUrl, MediaInfo> Url2Info_;
 
+		int PendingReplaces_ = 0;
+		QList<std::function<void ()>> AfterReplaces_;
+
 		PlayerRulesManager * const RulesManager_;
 
+		QTimer * const SaveTimer_;
+		int PlaylistLoads_ = 0;
+
 		MediaInfo LastPhononMediaInfo_;
 
 		bool FirstPlaylistRestore_;
@@ -115,7 +123,6 @@ namespace LMP
 			QList<SortingCriteria> Criteria_;
 
 			Sorter ();
-			bool operator() (const MediaInfo&, const MediaInfo&) const;
 		} Sorter_;
 	public:
 		enum Role
@@ -189,9 +196,23 @@ namespace LMP
 
 		NativePlaylist_t GetAsNativePlaylist () const;
 		void SetNativePlaylist (NativePlaylist_t);
+
+		/** Saves the playlist right away if saving it was postponed.
+		 */
+		void FlushOnLoadPlaylist ();
 	private:
 		MediaInfo GetPhononMediaInfo () const;
+		void EnqueuePlaylist (Playlist, EnqueueFlags);
+		void EnqueuePlaylistFile (const QString&, EnqueueFlags);
+		void EnqueuePlaylistChunk (Playlist, const std::function<void ()>&);
+		void HandlePlaylistCurrent (const Playlist&);
+		void RunAfterReplaces (const std::function<void ()>&);
 		void AddToPlaylistModel (QList<AudioSource>, bool sort, bool clear);
+		void AppendToPlaylistModel (const QList<AudioSource>&, bool sort);
+		void MergeResolved (QList<QPair<AudioSource, MediaInfo>>, bool sort);
+		void AppendResolved (const QList<QPair<AudioSource, MediaInfo>>&);
+		QStandardItem* MakeSourceItem (const AudioSource&) const;
+		void RemoveItem (const AudioSource&);
 
 		bool HandleCurrentStop (const AudioSource&);
 
@@ -214,6 +235,7 @@ namespace LMP
 		void ContinueAfterSorted (const ResolveJobResult&);
 
 		void SaveOnLoadPlaylist () const;
+		void ScheduleSaveOnLoadPlaylist ();
 	public slots:
 		void play (const QModelIndex&);
 		void previousTrack ();
@@ -224,6 +246,7 @@ namespace LMP
 		void clear ();
 		void shufflePlaylist ();
 	private slots:
+		void handleSaveTimeout ();
 		void restorePlaylist ();
 		void handleStationError (const QString&);
 		void handleRadioStream (const QUrl&, const Media::AudioInfo&);
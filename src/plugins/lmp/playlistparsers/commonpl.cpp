@@ -36,36 +36,74 @@ namespace LeechCraft
 {
 namespace LMP
 {
-	Playlist CommonRead2Sources (const ReadParams& params)
+	namespace
 	{
-		const auto& plDir = QFileInfo (params.Path_).absoluteDir ();
+		const int FirstChunkSize = 100;
+		const int ChunkSize = 2000;
+	}
 
-		Playlist result;
+	PlaylistChunker::PlaylistChunker (const PlaylistChunkHandler_f& handler)
+	: Handler_ { handler }
+	, MaxChunkItems_ { FirstChunkSize }
+	{
+	}
 
-		for (const auto& raw : params.RawParser_ (params.Path_))
-		{
-			const auto& src = raw.SourceStr_;
+	void PlaylistChunker::Append (const PlaylistItem& item)
+	{
+		Chunk_.Append (item);
+		if (++ChunkItems_ >= MaxChunkItems_)
+			Flush ();
+	}
 
-			QUrl url (src);
-			if (!url.scheme ().isEmpty ())
-			{
-				result.Append ({
-						url.scheme () == "file" ? url.toLocalFile () : url,
-						raw.Additional_
-					});
-				continue;
-			}
+	void PlaylistChunker::Flush ()
+	{
+		if (Chunk_.IsEmpty ())
+			return;
 
-			const QFileInfo fi (src);
-			if (params.Suffixes_.contains (fi.suffix ()))
-				result += CommonRead2Sources ({ params.Suffixes_,
-							plDir.absoluteFilePath (src), params.RawParser_ });
-			else if (fi.isRelative ())
-				result.Append ({ plDir.absoluteFilePath (src), raw.Additional_ });
-			else
-				result.Append ({ src, raw.Additional_ });
-		}
+		Handler_ (Chunk_);
+
+		Chunk_ = Playlist {};
+		ChunkItems_ = 0;
+		MaxChunkItems_ = ChunkSize;
+	}
 
+	void CommonRead2Chunks (const ReadParams& params, PlaylistChunker& chunker)
+	{
+		const auto& plDir = QFileInfo (params.Path_).absoluteDir ();
+
+		params.RawParser_ (params.Path_,
+				[&] (const RawReadData& raw)
+				{
+					const auto& src = raw.SourceStr_;
+
+					QUrl url (src);
+					if (!url.scheme ().isEmpty ())
+					{
+						chunker.Append ({
+								url.scheme () == "file" ? url.toLocalFile () : url,
+								raw.Additional_
+							});
+						return;
+					}
+
+					const QFileInfo fi (src);
+					if (params.Suffixes_.contains (fi.suffix ()))
+						CommonRead2Chunks ({ params.Suffixes_,
+									plDir.absoluteFilePath (src), params.RawParser_ },
+								chunker);
+					else if (fi.isRelative ())
+						chunker.Append ({ plDir.absoluteFilePath (src), raw.Additional_ });
+					else
+						chunker.Append ({ src, raw.Additional_ });
+				});
+	}
+
+	Playlist CommonRead2Sources (const ReadParams& params)
+	{
+		Playlist result;
+		PlaylistChunker chunker { [&result] (const Playlist& chunk) { result += chunk; } };
+		CommonRead2Chunks (params, chunker);
+		chunker.Flush ();
 		return result;
 	}
 }
@@ -39,14 +39,36 @@ namespace LeechCraft
 {
 namespace LMP
 {
+	typedef std::function<void (RawReadData)> RawDataHandler_f;
+
 	struct ReadParams
 	{
 		QStringList Suffixes_;
 		QString Path_;
 
-		std::function<QList<RawReadData> (QString)> RawParser_;
+		std::function<void (QString, RawDataHandler_f)> RawParser_;
 	};
 
+	/** Collects the playlist items as they are parsed and passes them
+	 * to the handler in chunks. The first chunk is small so that the
+	 * playback could start as soon as possible.
+	 */
+	class PlaylistChunker
+	{
+		const PlaylistChunkHandler_f Handler_;
+
+		Playlist Chunk_;
+		int ChunkItems_ = 0;
+		int MaxChunkItems_;
+	public:
+		PlaylistChunker (const PlaylistChunkHandler_f&);
+
+		void Append (const PlaylistItem&);
+		void Flush ();
+	};
+
+	void CommonRead2Chunks (const ReadParams&, PlaylistChunker&);
+
 	Playlist CommonRead2Sources (const ReadParams&);
 }
 }
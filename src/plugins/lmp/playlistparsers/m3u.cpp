@@ -35,6 +35,7 @@
 #include <QUrl>
 #include <QtDebug>
 #include <util/sll/qtutil.h>
+#include "commonpl.h"
 
 namespace LeechCraft
 {
@@ -54,64 +55,82 @@ namespace M3U
 		}
 	}
 
-	Playlist Read2Sources (const QString& path)
+	namespace
 	{
-		QFile file (path);
-		if (!file.open (QIODevice::ReadOnly))
+		void ReadFile (const QString& path, PlaylistChunker& chunker)
 		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to open"
-					<< path
-					<< file.errorString ();
-			return {};
-		}
+			QFile file (path);
+			if (!file.open (QIODevice::ReadOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to open"
+						<< path
+						<< file.errorString ();
+				return;
+			}
 
-		const auto& m3uDir = QFileInfo (path).absoluteDir ();
+			const auto& m3uDir = QFileInfo (path).absoluteDir ();
 
-		QVariantMap lastMetadata;
+			QVariantMap lastMetadata;
 
-		Playlist result;
-		while (!file.atEnd ())
-		{
-			const auto& line = file.readLine ().trimmed ();
-			if (line.startsWith ('#'))
+			while (!file.atEnd ())
 			{
-				const auto& pair = ParseMetadata (line);
-				if (!pair.first.isEmpty ())
-					lastMetadata [pair.first] = pair.second;
-				continue;
-			}
+				const auto& line = file.readLine ().trimmed ();
+				if (line.isEmpty ())
+					continue;
 
-			const auto& url = QUrl::fromEncoded (line);
-			auto src = QString::fromUtf8 (line);
+				if (line.startsWith ('#'))
+				{
+					const auto& pair = ParseMetadata (line);
+					if (!pair.first.isEmpty ())
+						lastMetadata [pair.first] = pair.second;
+					continue;
+				}
 
-			const auto mdGuard = std::shared_ptr<void> (nullptr,
-					[&lastMetadata] (void*) { lastMetadata.clear (); });
+				const auto& url = QUrl::fromEncoded (line);
+				auto src = QString::fromUtf8 (line);
+
+				const auto mdGuard = std::shared_ptr<void> (nullptr,
+						[&lastMetadata] (void*) { lastMetadata.clear (); });
 
 #ifdef Q_OS_WIN32
-			if (url.scheme ().size () > 1)
+				if (url.scheme ().size () > 1)
 #else
-			if (!url.scheme ().isEmpty ())
+				if (!url.scheme ().isEmpty ())
 #endif
-			{
-				result.Append ({ url, lastMetadata });
-				continue;
-			}
+				{
+					chunker.Append ({ url, lastMetadata });
+					continue;
+				}
 
-			src.replace ('\\', '/');
+				src.replace ('\\', '/');
 
-			const QFileInfo fi (src);
-			if (fi.isRelative ())
-				src = m3uDir.absoluteFilePath (src);
+				const QFileInfo fi (src);
+				if (fi.isRelative ())
+					src = m3uDir.absoluteFilePath (src);
 
-			if (fi.suffix () == "m3u" || fi.suffix () == "m3u8")
-				result += Read2Sources (src);
-			else
-				result.Append ({ src, lastMetadata });
+				if (fi.suffix () == "m3u" || fi.suffix () == "m3u8")
+					ReadFile (src, chunker);
+				else
+					chunker.Append ({ src, lastMetadata });
+			}
 		}
+	}
+
+	Playlist Read2Sources (const QString& path)
+	{
+		Playlist result;
+		Read2Chunks (path, [&result] (const Playlist& chunk) { result += chunk; });
 		return result;
 	}
 
+	void Read2Chunks (const QString& path, const PlaylistChunkHandler_f& handler)
+	{
+		PlaylistChunker chunker { handler };
+		ReadFile (path, chunker);
+		chunker.Flush ();
+	}
+
 	void Write (const QString& path, const Playlist& sources)
 	{
 		QFile file (path);
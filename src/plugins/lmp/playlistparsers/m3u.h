@@ -40,6 +40,7 @@ namespace LMP
 namespace M3U
 {
 	Playlist Read2Sources (const QString&);
+	void Read2Chunks (const QString&, const PlaylistChunkHandler_f&);
 	void Write (const QString&, const Playlist&);
 }
 }
@@ -29,6 +29,7 @@
 
 #pragma once
 
+#include <functional>
 #include <boost/optional.hpp>
 #include <QVariantMap>
 #include <QSet>
@@ -89,5 +90,7 @@ namespace LMP
 		QString SourceStr_;
 		QVariantMap Additional_;
 	};
+
+	typedef std::function<void (Playlist)> PlaylistChunkHandler_f;
 }
 }
@@ -47,5 +47,17 @@ namespace LMP
 
 		return PlaylistParser_f ();
 	}
+
+	ChunkedPlaylistParser_f MakeChunkedPlaylistParser (const QString& file)
+	{
+		if (file.endsWith ("m3u") || file.endsWith ("m3u8"))
+			return M3U::Read2Chunks;
+		else if (file.endsWith ("xspf"))
+			return XSPF::Read2Chunks;
+		else if (file.endsWith ("pls"))
+			return PLS::Read2Chunks;
+
+		return ChunkedPlaylistParser_f ();
+	}
 }
 }
@@ -39,7 +39,9 @@ namespace LeechCraft
 namespace LMP
 {
 	typedef std::function<Playlist (const QString&)> PlaylistParser_f;
+	typedef std::function<void (const QString&, const PlaylistChunkHandler_f&)> ChunkedPlaylistParser_f;
 
 	PlaylistParser_f MakePlaylistParser (const QString& filename);
+	ChunkedPlaylistParser_f MakeChunkedPlaylistParser (const QString& filename);
 }
 }
@@ -28,8 +28,8 @@
  **********************************************************************/
 
 #include "pls.h"
-#include <algorithm>
-#include <QSettings>
+#include <QFile>
+#include <QtDebug>
 #include "commonpl.h"
 
 namespace LeechCraft
@@ -38,30 +38,55 @@ namespace LMP
 {
 namespace PLS
 {
-	QList<RawReadData> Read (const QString& path)
+	void Read (const QString& path, const RawDataHandler_f& handler)
 	{
-		QList<RawReadData> result;
-
-		QSettings settings (path, QSettings::IniFormat);
-		settings.beginGroup ("playlist");
-
-		const int numFiles = settings.value ("NumberOfEntries").toInt ();
-		for (int i = 1; i <= numFiles; ++i)
+		QFile file (path);
+		if (!file.open (QIODevice::ReadOnly))
 		{
-			const auto& str = settings.value ("File" + QString::number (i)).toString ();
-			if (!str.isEmpty ())
-				result.append ({ str, {} });
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< path
+					<< file.errorString ();
+			return;
 		}
 
-		settings.endGroup ();
+		bool inPlaylist = false;
+		while (!file.atEnd ())
+		{
+			const auto& line = file.readLine ().trimmed ();
+			if (line.isEmpty () || line.startsWith (';'))
+				continue;
+
+			if (line.startsWith ('['))
+			{
+				inPlaylist = line.toLower () == "[playlist]";
+				continue;
+			}
+
+			if (!inPlaylist || !line.toLower ().startsWith ("file"))
+				continue;
 
-		return result;
+			const auto eqIdx = line.indexOf ('=');
+			if (eqIdx == -1)
+				continue;
+
+			const auto& str = QString::fromUtf8 (line.mid (eqIdx + 1)).trimmed ();
+			if (!str.isEmpty ())
+				handler ({ str, {} });
+		}
 	}
 
 	Playlist Read2Sources (const QString& path)
 	{
 		return CommonRead2Sources ({ { "pls" }, path, Read });
 	}
+
+	void Read2Chunks (const QString& path, const PlaylistChunkHandler_f& handler)
+	{
+		PlaylistChunker chunker { handler };
+		CommonRead2Chunks ({ { "pls" }, path, Read }, chunker);
+		chunker.Flush ();
+	}
 }
 }
 }
@@ -40,6 +40,7 @@ namespace LMP
 namespace PLS
 {
 	Playlist Read2Sources (const QString&);
+	void Read2Chunks (const QString&, const PlaylistChunkHandler_f&);
 }
 }
 }
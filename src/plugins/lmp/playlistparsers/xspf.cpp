@@ -29,7 +29,7 @@
 
 #include "xspf.h"
 #include <QFile>
-#include <QDomDocument>
+#include <QXmlStreamReader>
 #include <QtDebug>
 #include "commonpl.h"
 
@@ -39,7 +39,7 @@ namespace LMP
 {
 namespace XSPF
 {
-	QList<RawReadData> Read (const QString& path)
+	void Read (const QString& path, const RawDataHandler_f& handler)
 	{
 		QFile file (path);
 		if (!file.open (QIODevice::ReadOnly))
@@ -48,37 +48,62 @@ namespace XSPF
 					<< "unable to open"
 					<< path
 					<< file.errorString ();
-			return {};
+			return;
 		}
 
-		QDomDocument doc;
-		if (!doc.setContent (file.readAll ()))
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to parse"
-					<< path;
-			return {};
-		}
+		QXmlStreamReader reader (&file);
 
-		QList<RawReadData> result;
-		auto track = doc.documentElement ()
-				.firstChildElement ("trackList")
-				.firstChildElement ("track");
-		while (!track.isNull ())
+		int trackListDepth = 0;
+		bool inTrack = false;
+		QString location;
+		while (!reader.atEnd ())
 		{
-			const auto& loc = track.firstChildElement ("location").text ();
-			if (!loc.isEmpty ())
-				result.append ({ loc, {} });
-
-			track = track.nextSiblingElement ("track");
+			switch (reader.readNext ())
+			{
+			case QXmlStreamReader::StartElement:
+				if (reader.name () == "trackList")
+					++trackListDepth;
+				else if (trackListDepth && reader.name () == "track")
+				{
+					inTrack = true;
+					location.clear ();
+				}
+				else if (inTrack && location.isEmpty () && reader.name () == "location")
+					location = reader.readElementText ().trimmed ();
+				break;
+			case QXmlStreamReader::EndElement:
+				if (reader.name () == "trackList")
+					--trackListDepth;
+				else if (inTrack && reader.name () == "track")
+				{
+					inTrack = false;
+					if (!location.isEmpty ())
+						handler ({ location, {} });
+				}
+				break;
+			default:
+				break;
+			}
 		}
-		return result;
+
+		if (reader.hasError ())
+			qWarning () << Q_FUNC_INFO
+					<< "unable to parse"
+					<< path
+					<< reader.errorString ();
 	}
 
 	Playlist Read2Sources (const QString& path)
 	{
 		return CommonRead2Sources ({ { "xspf" }, path, Read });
 	}
+
+	void Read2Chunks (const QString& path, const PlaylistChunkHandler_f& handler)
+	{
+		PlaylistChunker chunker { handler };
+		CommonRead2Chunks ({ { "xspf" }, path, Read }, chunker);
+		chunker.Flush ();
+	}
 }
 }
 }
@@ -40,6 +40,7 @@ namespace LMP
 namespace XSPF
 {
 	Playlist Read2Sources (const QString&);
+	void Read2Chunks (const QString&, const PlaylistChunkHandler_f&);
 }
 }
 }
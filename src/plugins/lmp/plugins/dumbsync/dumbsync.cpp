@@ -196,7 +196,24 @@ namespace DumbSync
 		std::function<WorkerThreadResult (void)> copier = [target, localPath, artPath] () -> WorkerThreadResult
 				{
 					QFile_ptr file (new QFile (localPath));
-					file->copy (target);
+
+					// Skip the files that are already there from a previous sync
+					// and haven't changed since then.
+					const QFileInfo targetInfo (target);
+					const QFileInfo sourceInfo (localPath);
+					if (targetInfo.exists () &&
+							targetInfo.size () == sourceInfo.size () &&
+							targetInfo.lastModified () >= sourceInfo.lastModified ())
+						qDebug () << Q_FUNC_INFO
+								<< "skipping unchanged"
+								<< target;
+					else
+					{
+						if (targetInfo.exists ())
+							QFile::remove (target);
+						file->copy (target);
+					}
+
 					if (XmlSettingsManager::Instance ().property ("UploadCovers").toBool ())
 						WriteScaledPixmap (artPath, target);
 					return { file };
@@ -59,6 +59,11 @@ namespace HttStream
 				this,
 				SLOT (handleEncQualityChanged ()));
 
+		FSM_->RegisterObject ("ClientBufferSize", this, "handleClientBufferChanged");
+		QTimer::singleShot (0,
+				this,
+				SLOT (handleClientBufferChanged ()));
+
 		FSM_->RegisterObject ({ "Address", "Port" }, this, "handleAddressChanged");
 		QTimer::singleShot (0,
 				this,
@@ -92,6 +97,12 @@ namespace HttStream
 		const auto quality = FSM_->property ("EncQuality").toDouble ();
 		Filter_->SetQuality (quality);
 	}
+
+	void FilterConfigurator::handleClientBufferChanged ()
+	{
+		const auto size = FSM_->property ("ClientBufferSize").toLongLong ();
+		Filter_->SetClientBufferSize (size * 1024);
+	}
 }
 }
 }
@@ -64,6 +64,7 @@ namespace HttStream
 	private slots:
 		void handleAddressChanged ();
 		void handleEncQualityChanged ();
+		void handleClientBufferChanged ();
 	};
 }
 }
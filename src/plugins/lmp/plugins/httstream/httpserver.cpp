@@ -28,8 +28,12 @@
  **********************************************************************/
 
 #include "httpserver.h"
+#include <algorithm>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QTimer>
+#include <QStringList>
+#include <QtDebug>
 
 namespace LeechCraft
 {
@@ -37,14 +41,28 @@ namespace LMP
 {
 namespace HttStream
 {
+	namespace
+	{
+		const int IcyMetaInt = 16000;
+		const int MaxRequestSize = 8 * 1024;
+		const int StatsInterval = 10;
+	}
+
 	HttpServer::HttpServer (QObject *parent)
 	: QObject { parent }
 	, Server_ { new QTcpServer { this } }
+	, StatsTimer_ { new QTimer { this } }
 	{
 		connect (Server_,
 				SIGNAL (newConnection ()),
 				this,
 				SLOT (handleNewConnection ()));
+
+		connect (StatsTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (dumpStats ()));
+		StatsTimer_->start (StatsInterval * 1000);
 	}
 
 	void HttpServer::SetAddress (const QString& host, int port)
@@ -72,21 +90,14 @@ namespace HttStream
 		}
 	}
 
-	QList<int> HttpServer::GetConnectedFDs () const
+	void HttpServer::SetMaxClientBuffer (qint64 size)
 	{
-		decltype (Socket2FD_) map;
-
-		{
-			QReadLocker locker { &MapLock_};
-			map = Socket2FD_;
-		}
-
-		return map.values ();
+		MaxClientBuffer_ = size;
 	}
 
 	namespace
 	{
-		void Write (QTcpSocket *socket, const QList<QByteArray>& strings)
+		void WriteResponse (QTcpSocket *socket, const QList<QByteArray>& strings)
 		{
 			for (const auto& string : strings)
 			{
@@ -96,107 +107,286 @@ namespace HttStream
 
 			socket->write ("\r\n");
 		}
+
+		void FinishResponse (QTcpSocket *socket, const QList<QByteArray>& strings)
+		{
+			WriteResponse (socket, strings);
+			socket->disconnectFromHost ();
+		}
 	}
 
-	void HttpServer::HandleSocket (QTcpSocket *socket)
+	void HttpServer::HandleRequest (QTcpSocket *socket, Client& client)
 	{
-		disconnect (socket,
-				SIGNAL (readyRead ()),
-				this,
-				0);
+		auto lines = client.Request_.split ('\n');
+		client.Request_.clear ();
 
-		if (!socket->canReadLine ())
+		const auto& requestLine = lines.takeFirst ().trimmed ().split (' ');
+		if (requestLine.size () < 2)
 		{
-			connect (socket,
-					SIGNAL (readyRead ()),
-					this,
-					SLOT (tryReadLine ()));
+			FinishResponse (socket, { "HTTP/1.0 400 Bad Request" });
 			return;
 		}
 
-		auto line = socket->readLine ();
-		line.chop (QString (" HTTP/1.0\r\n").size ());
+		QHash<QByteArray, QByteArray> headers;
+		for (const auto& line : lines)
+		{
+			const auto colonPos = line.indexOf (':');
+			if (colonPos > 0)
+				headers [line.left (colonPos).trimmed ().toLower ()] = line.mid (colonPos + 1).trimmed ();
+		}
+
+		const auto& method = requestLine.at (0);
+		const auto& path = requestLine.at (1);
 
-		if (line.startsWith ("HEAD "))
+		if (method != "HEAD" && method != "GET")
 		{
-			const auto& str = line.mid (5) == "/" ?
-					"HTTP/1.0 200 OK" :
-					"HTTP/1.0 404 Not Found";
-			Write (socket, { str });
-			connect (socket,
-					SIGNAL (bytesWritten (qint64)),
-					socket,
-					SLOT (deleteLater ()));
+			FinishResponse (socket, { "HTTP/1.0 400 Bad Request" });
+			return;
+		}
+
+		if (path != "/")
+		{
+			FinishResponse (socket, { "HTTP/1.0 404 Not Found" });
+			return;
 		}
-		else if (line.startsWith ("GET "))
+
+		client.WantsIcy_ = headers.value ("icy-metadata") == "1";
+
+		// This is a live stream, so any Range the client might send on
+		// reconnect is ignored, and the client just gets the stream from
+		// the current position.
+		QList<QByteArray> response
+		{
+			"HTTP/1.0 200 OK",
+			"Content-Type: audio/ogg",
+			"Cache-Control: no-cache",
+			"Accept-Ranges: none",
+			"Server: LeechCraft LMP"
+		};
+		if (client.WantsIcy_)
+			response << "icy-name: LeechCraft LMP"
+					<< "icy-metaint: " + QByteArray::number (IcyMetaInt);
+
+		if (method == "HEAD")
+		{
+			FinishResponse (socket, response);
+			return;
+		}
+
+		WriteResponse (socket, response);
+
+		client.IsStreaming_ = true;
+		client.BytesToMeta_ = IcyMetaInt;
+		client.Connected_.start ();
+
+		qDebug () << Q_FUNC_INFO
+				<< "new listener"
+				<< socket->peerAddress ()
+				<< (client.WantsIcy_ ? "with ICY metadata" : "");
+
+		emit gotClient ();
+	}
+
+	namespace
+	{
+		QByteArray MakeIcyBlock (const QString& title)
+		{
+			auto str = "StreamTitle='" + title.toUtf8 ().replace ('\'', '`') + "';";
+			str.truncate (255 * 16);
+
+			const auto blocks = (str.size () + 15) / 16;
+			str.append (QByteArray (blocks * 16 - str.size (), '\0'));
+			str.prepend (static_cast<char> (blocks));
+			return str;
+		}
+	}
+
+	void HttpServer::Write (QTcpSocket *socket, Client& client, const QByteArray& data)
+	{
+		client.BytesSent_ += data.size ();
+
+		if (!client.WantsIcy_)
 		{
-			if (line.mid (4) == "/")
+			socket->write (data);
+			return;
+		}
+
+		int pos = 0;
+		while (pos < data.size ())
+		{
+			const auto chunk = std::min (client.BytesToMeta_, data.size () - pos);
+			socket->write (data.constData () + pos, chunk);
+			pos += chunk;
+
+			client.BytesToMeta_ -= chunk;
+			if (client.BytesToMeta_)
+				continue;
+
+			if (client.SentTitle_ != StreamTitle_)
 			{
-				Write (socket,
-					{
-						"HTTP/1.0 200 OK",
-						"Content-Type: audio/ogg",
-						"Cache-Control: no-cache",
-						"Server: LeechCraft LMP"
-					});
-
-				{
-					QWriteLocker locker { &MapLock_ };
-					Socket2FD_ [socket] = socket->socketDescriptor ();
-				}
-
-				emit gotClient (socket->socketDescriptor ());
+				socket->write (MakeIcyBlock (StreamTitle_));
+				client.SentTitle_ = StreamTitle_;
 			}
 			else
-			{
-				Write (socket, { "HTTP/1.0 404 Not Found" });
-				connect (socket,
-						SIGNAL (bytesWritten (qint64)),
-						socket,
-						SLOT (deleteLater ()));
-			}
+				socket->putChar ('\0');
+
+			client.BytesToMeta_ = IcyMetaInt;
+		}
+	}
+
+	void HttpServer::DropClient (QTcpSocket *socket, const QString& reason)
+	{
+		const auto& client = Clients_.take (socket);
+
+		qWarning () << Q_FUNC_INFO
+				<< "dropping"
+				<< socket->peerAddress ()
+				<< "after"
+				<< client.BytesSent_
+				<< "bytes:"
+				<< reason;
+
+		disconnect (socket,
+				0,
+				this,
+				0);
+		socket->abort ();
+		socket->deleteLater ();
+
+		if (client.IsStreaming_)
+			emit clientDisconnected ();
+	}
+
+	void HttpServer::handleData (const QByteArray& data, bool isHeader, bool isSyncPoint)
+	{
+		if (isHeader)
+		{
+			if (!LastWasHeader_)
+				Headers_.clear ();
+			Headers_ << data;
 		}
-		else
+		LastWasHeader_ = isHeader;
+
+		QList<QTcpSocket*> slowClients;
+		for (auto i = Clients_.begin (), end = Clients_.end (); i != end; ++i)
 		{
-			Write (socket, { "HTTP/1.0 400 Bad Request" });
-			connect (socket,
-					SIGNAL (bytesWritten (qint64)),
-					socket,
-					SLOT (deleteLater ()));
+			const auto socket = i.key ();
+			auto& client = *i;
+			if (!client.IsStreaming_)
+				continue;
+
+			if (!client.IsSynced_)
+			{
+				if (isHeader || !isSyncPoint)
+					continue;
+
+				for (const auto& header : Headers_)
+					Write (socket, client, header);
+				client.IsSynced_ = true;
+			}
+
+			Write (socket, client, data);
+
+			if (socket->bytesToWrite () > MaxClientBuffer_)
+				slowClients << socket;
 		}
+
+		for (const auto socket : slowClients)
+			DropClient (socket, "too slow to keep up with the stream");
+	}
+
+	void HttpServer::setStreamTitle (const QString& title)
+	{
+		StreamTitle_ = title;
 	}
 
-	void HttpServer::tryReadLine ()
+	void HttpServer::handleReadyRead ()
 	{
-		auto socket = qobject_cast<QTcpSocket*> (sender ());
-		HandleSocket (socket);
+		const auto socket = qobject_cast<QTcpSocket*> (sender ());
+		if (!Clients_.contains (socket))
+			return;
+
+		auto& client = Clients_ [socket];
+		if (client.IsStreaming_)
+		{
+			socket->readAll ();
+			return;
+		}
+
+		client.Request_ += socket->readAll ();
+		client.Request_.replace ('\r', QByteArray {});
+		if (client.Request_.contains ("\n\n"))
+			HandleRequest (socket, client);
+		else if (client.Request_.size () > MaxRequestSize)
+		{
+			client.Request_.clear ();
+			FinishResponse (socket, { "HTTP/1.0 400 Bad Request" });
+		}
 	}
 
 	void HttpServer::handleNewConnection ()
 	{
-		const auto socket = Server_->nextPendingConnection ();
-		connect (socket,
-				SIGNAL (disconnected ()),
-				this,
-				SLOT (handleDisconnected ()));
-		HandleSocket (socket);
+		while (const auto socket = Server_->nextPendingConnection ())
+		{
+			Clients_ [socket];
+
+			connect (socket,
+					SIGNAL (readyRead ()),
+					this,
+					SLOT (handleReadyRead ()));
+			connect (socket,
+					SIGNAL (disconnected ()),
+					this,
+					SLOT (handleDisconnected ()));
+		}
 	}
 
 	void HttpServer::handleDisconnected ()
 	{
-		const auto sock = qobject_cast<QTcpSocket*> (sender ());
-		sock->deleteLater ();
+		const auto socket = qobject_cast<QTcpSocket*> (sender ());
+		socket->deleteLater ();
+
+		if (!Clients_.contains (socket))
+			return;
+
+		const auto& client = Clients_.take (socket);
+		if (!client.IsStreaming_)
+			return;
+
+		const auto secs = std::max<qint64> (client.Connected_.elapsed () / 1000, 1);
+		qDebug () << Q_FUNC_INFO
+				<< socket->peerAddress ()
+				<< "disconnected after"
+				<< secs
+				<< "s,"
+				<< client.BytesSent_
+				<< "bytes sent,"
+				<< client.BytesSent_ / secs / 128
+				<< "kbit/s on average";
+
+		emit clientDisconnected ();
+	}
 
-		int sockFd = 0;
-		QWriteLocker lock { &MapLock_ };
+	void HttpServer::dumpStats ()
+	{
+		for (auto i = Clients_.begin (), end = Clients_.end (); i != end; ++i)
 		{
-			if (!Socket2FD_.contains (sock))
-				return;
+			auto& client = *i;
+			if (!client.IsStreaming_)
+				continue;
 
-			sockFd = Socket2FD_.take (sock);
-		}
+			const auto delta = client.BytesSent_ - client.BytesSentLastStats_;
+			client.BytesSentLastStats_ = client.BytesSent_;
 
-		emit clientDisconnected (sockFd);
+			qDebug () << Q_FUNC_INFO
+					<< i.key ()->peerAddress ()
+					<< delta / StatsInterval / 128
+					<< "kbit/s,"
+					<< client.BytesSent_
+					<< "bytes total,"
+					<< i.key ()->bytesToWrite ()
+					<< "bytes buffered";
+		}
 	}
 }
 }
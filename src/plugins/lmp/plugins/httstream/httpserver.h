@@ -30,11 +30,13 @@
 #pragma once
 
 #include <QObject>
-#include <QMap>
-#include <QReadWriteLock>
+#include <QHash>
+#include <QByteArray>
+#include <QElapsedTimer>
 
 class QTcpServer;
 class QTcpSocket;
+class QTimer;
 
 namespace LeechCraft
 {
@@ -42,30 +44,67 @@ namespace LMP
 {
 namespace HttStream
 {
+	/** Serves the encoded stream to the connected HTTP clients.
+	 *
+	 * Each client has its own write buffer bounded by the value set via
+	 * SetMaxClientBuffer(), clients that can't keep up are disconnected
+	 * instead of stalling the stream. New clients get the stream headers
+	 * first and then join the stream at the next sync point. Clients
+	 * requesting ICY metadata get the current stream title interleaved
+	 * with the data.
+	 */
 	class HttpServer : public QObject
 	{
 		Q_OBJECT
 
 		QTcpServer * const Server_;
+		QTimer * const StatsTimer_;
 
-		mutable QReadWriteLock MapLock_;
-		QMap<QTcpSocket*, int> Socket2FD_;
+		struct Client
+		{
+			QByteArray Request_;
+
+			bool IsStreaming_ = false;
+			bool IsSynced_ = false;
+
+			bool WantsIcy_ = false;
+			int BytesToMeta_ = 0;
+			QString SentTitle_;
+
+			qint64 BytesSent_ = 0;
+			qint64 BytesSentLastStats_ = 0;
+			QElapsedTimer Connected_;
+		};
+		QHash<QTcpSocket*, Client> Clients_;
+
+		qint64 MaxClientBuffer_ = 256 * 1024;
+
+		QList<QByteArray> Headers_;
+		bool LastWasHeader_ = false;
+
+		QString StreamTitle_;
 	public:
 		HttpServer (QObject* = nullptr);
 
 		void SetAddress (const QString&, int);
-
-		QList<int> GetConnectedFDs () const;
+		void SetMaxClientBuffer (qint64);
 	private:
-		void HandleSocket (QTcpSocket*);
+		void HandleRequest (QTcpSocket*, Client&);
+		void Write (QTcpSocket*, Client&, const QByteArray&);
+		void DropClient (QTcpSocket*, const QString&);
+	public slots:
+		void handleData (const QByteArray&, bool isHeader, bool isSyncPoint);
+		void setStreamTitle (const QString&);
 	private slots:
-		void tryReadLine ();
+		void handleReadyRead ();
 
 		void handleNewConnection ();
 		void handleDisconnected ();
+
+		void dumpStats ();
 	signals:
-		void gotClient (int);
-		void clientDisconnected (int);
+		void gotClient ();
+		void clientDisconnected ();
 	};
 }
 }
@@ -45,9 +45,9 @@ namespace HttStream
 {
 	namespace
 	{
-		void CbRemoved (void*, gint fd, int reason, gpointer udata)
+		void CbHandoff (GstElement*, GstBuffer *buffer, GstPad*, gpointer udata)
 		{
-			static_cast<HttpStreamFilter*> (udata)->HandleRemoved (fd, reason);
+			static_cast<HttpStreamFilter*> (udata)->HandleBuffer (buffer);
 		}
 	}
 
@@ -65,13 +65,9 @@ namespace HttStream
 	, AConv_ { gst_element_factory_make ("audioconvert", nullptr) }
 	, Encoder_ { gst_element_factory_make ("vorbisenc", nullptr) }
 	, Muxer_ { gst_element_factory_make ("oggmux", nullptr) }
-	, MSS_ { gst_element_factory_make ("multifdsink", nullptr) }
+	, Sink_ { gst_element_factory_make ("fakesink", nullptr) }
 	, Server_ { new HttpServer { this } }
 	{
-		if (!MSS_)
-			qWarning () << Q_FUNC_INFO
-					<< "cannot create multisocketsink";
-
 		for (const auto elem : GetStreamBranchElements ())
 			gst_object_ref (elem);
 
@@ -82,14 +78,11 @@ namespace HttStream
 		gst_pad_link (TeeAudioPad_, audioPad);
 		gst_object_unref (audioPad);
 
-		g_object_set (G_OBJECT (MSS_),
-#if GST_VERSION_MAJOR < 1
-				"unit-type", GST_FORMAT_TIME,
-				"units-max", static_cast<gint64> (7 * GST_SECOND),
-				"units-soft-max", static_cast<gint64> (3 * GST_SECOND),
-#endif
-				"recover-policy", 3,
-				"sync-method", 1,
+		// Never block the playback branch on a stalled stream branch.
+		g_object_set (G_OBJECT (StreamQueue_), "leaky", 2, nullptr);
+
+		g_object_set (G_OBJECT (Sink_),
+				"signal-handoffs", TRUE,
 				"async", FALSE,
 				"sync", FALSE,
 				nullptr);
@@ -98,15 +91,15 @@ namespace HttStream
 		GstUtil::AddGhostPad (AudioQueue_, Elem_, "src");
 
 		connect (Server_,
-				SIGNAL (gotClient (int)),
+				SIGNAL (gotClient ()),
 				this,
-				SLOT (handleClient (int)));
+				SLOT (handleClient ()));
 		connect (Server_,
-				SIGNAL (clientDisconnected (int)),
+				SIGNAL (clientDisconnected ()),
 				this,
-				SLOT (handleClientDisconnected (int)));
+				SLOT (handleClientDisconnected ()));
 
-		g_signal_connect (MSS_, "client-removed", G_CALLBACK (CbRemoved), this);
+		g_signal_connect (Sink_, "handoff", G_CALLBACK (CbHandoff), this);
 	}
 
 	HttpStreamFilter::~HttpStreamFilter ()
@@ -143,26 +136,46 @@ namespace HttStream
 		Server_->SetAddress (host, port);
 	}
 
-	namespace
+	void HttpStreamFilter::SetClientBufferSize (qint64 size)
 	{
-		// http://cgit.collabora.com/git/user/kakaroto/gst-plugins-base.git/plain/gst/tcp/gstmultihandlesink.c
-		const int GST_CLIENT_STATUS_REMOVED = 2;
+		Server_->SetMaxClientBuffer (size);
 	}
 
-	void HttpStreamFilter::HandleRemoved (int fd, int reason)
+	void HttpStreamFilter::HandleBuffer (GstBuffer *buffer)
 	{
-		if (reason != GST_CLIENT_STATUS_REMOVED)
+#if GST_VERSION_MAJOR < 1
+		const QByteArray data
+		{
+			reinterpret_cast<const char*> (GST_BUFFER_DATA (buffer)),
+			static_cast<int> (GST_BUFFER_SIZE (buffer))
+		};
+		const bool isHeader = GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_IN_CAPS);
+#else
+		GstMapInfo map;
+		if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to map buffer";
 			return;
+		}
+		const QByteArray data
+		{
+			reinterpret_cast<const char*> (map.data),
+			static_cast<int> (map.size)
+		};
+		gst_buffer_unmap (buffer, &map);
+		const bool isHeader = GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_HEADER);
+#endif
+		const bool isSyncPoint = !GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
 
-		qDebug () << Q_FUNC_INFO
-				<< "detected client removal because of"
-				<< reason
-				<< "; scheduling readd...";
-
-		QMetaObject::invokeMethod (this,
-				"readdFd",
+		// The data is copied out of the pipeline just once here and then
+		// shared by all the clients.
+		QMetaObject::invokeMethod (Server_,
+				"handleData",
 				Qt::QueuedConnection,
-				Q_ARG (int, fd));
+				Q_ARG (QByteArray, data),
+				Q_ARG (bool, isHeader),
+				Q_ARG (bool, isSyncPoint));
 	}
 
 	GstElement* HttpStreamFilter::GetElement () const
@@ -172,15 +185,15 @@ namespace HttStream
 
 	void HttpStreamFilter::PostAdd (IPath *path)
 	{
-		path->AddSyncHandler ([this] (GstBus*, GstMessage *msg) { return HandleError (msg); }, this);
+		path->AddSyncHandler ([this] (GstBus*, GstMessage *msg) { return HandleMessage (msg); }, this);
 	}
 
 	void HttpStreamFilter::CreatePad ()
 	{
 		qDebug () << Q_FUNC_INFO;
 
-		gst_bin_add_many (GST_BIN (Elem_), StreamQueue_, Encoder_, AConv_, Muxer_, MSS_, nullptr);
-		gst_element_link_many (StreamQueue_, AConv_, Encoder_, Muxer_, MSS_, nullptr);
+		gst_bin_add_many (GST_BIN (Elem_), StreamQueue_, Encoder_, AConv_, Muxer_, Sink_, nullptr);
+		gst_element_link_many (StreamQueue_, AConv_, Encoder_, Muxer_, Sink_, nullptr);
 		for (auto elem : GetStreamBranchElements ())
 			gst_element_sync_state_with_parent (elem);
 
@@ -199,18 +212,18 @@ namespace HttStream
 		gst_element_release_request_pad (Tee_, TeeStreamPad_);
 		gst_object_unref (TeeStreamPad_);
 
-		gst_element_unlink_many (StreamQueue_, AConv_, Encoder_, Muxer_, MSS_, nullptr);
-		gst_bin_remove_many (GST_BIN (Elem_), StreamQueue_, Encoder_, AConv_, Muxer_, MSS_, nullptr);
+		gst_element_unlink_many (StreamQueue_, AConv_, Encoder_, Muxer_, Sink_, nullptr);
+		gst_bin_remove_many (GST_BIN (Elem_), StreamQueue_, Encoder_, AConv_, Muxer_, Sink_, nullptr);
 
 		TeeStreamPad_ = nullptr;
 	}
 
 	std::vector<GstElement*> HttpStreamFilter::GetStreamBranchElements () const
 	{
-		return { StreamQueue_, AConv_, Encoder_, Muxer_, MSS_ };
+		return { StreamQueue_, AConv_, Encoder_, Muxer_, Sink_ };
 	}
 
-	bool HttpStreamFilter::HandleFirstClientConnected ()
+	void HttpStreamFilter::HandleFirstClientConnected ()
 	{
 		const auto source = Path_->GetSourceObject ();
 		StateOnFirst_ = source->GetState ();
@@ -218,19 +231,15 @@ namespace HttStream
 		if (StateOnFirst_ == SourceState::Playing)
 		{
 			CreatePad ();
-			return true;
+			return;
 		}
-		else
-		{
-			connect (source->GetQObject (),
-					SIGNAL (stateChanged (SourceState, SourceState)),
-					this,
-					SLOT (checkCreatePad (SourceState)));
 
-			source->SetState (SourceState::Playing);
+		connect (source->GetQObject (),
+				SIGNAL (stateChanged (SourceState, SourceState)),
+				this,
+				SLOT (checkCreatePad (SourceState)));
 
-			return false;
-		}
+		source->SetState (SourceState::Playing);
 	}
 
 	void HttpStreamFilter::HandleLastClientDisconnected ()
@@ -241,12 +250,28 @@ namespace HttStream
 			Path_->GetSourceObject ()->SetState (SourceState::Paused);
 	}
 
-	int HttpStreamFilter::HandleError (GstMessage *msg)
+	int HttpStreamFilter::HandleMessage (GstMessage *msg)
 	{
+		if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_TAG)
+		{
+			GstUtil::TagMap_t map;
+			GstUtil::ParseTagMessage (msg, map, {});
+
+			const auto& title = map.value ("title");
+			const auto& artist = map.value ("artist");
+			if (!title.isEmpty ())
+				QMetaObject::invokeMethod (Server_,
+						"setStreamTitle",
+						Qt::QueuedConnection,
+						Q_ARG (QString, artist.isEmpty () ? title : artist + " - " + title));
+
+			return GST_BUS_PASS;
+		}
+
 		if (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ERROR)
 			return GST_BUS_PASS;
 
-		if (QList<GstElement*> { StreamQueue_, Encoder_, MSS_ }.contains (GST_ELEMENT (msg->src)))
+		if (QList<GstElement*> { StreamQueue_, Encoder_, Sink_ }.contains (GST_ELEMENT (msg->src)))
 		{
 			qDebug () << Q_FUNC_INFO
 					<< "detected stream error";
@@ -269,32 +294,16 @@ namespace HttStream
 				this,
 				SLOT (checkCreatePad (SourceState)));
 		CreatePad ();
-
-		for (const auto sock : PendingSockets_)
-			g_signal_emit_by_name (MSS_, "add", sock);
-
-		PendingSockets_.clear ();
-	}
-
-	void HttpStreamFilter::readdFd (int fd)
-	{
-		g_signal_emit_by_name (MSS_, "add", fd);
 	}
 
-	void HttpStreamFilter::handleClient (int socket)
+	void HttpStreamFilter::handleClient ()
 	{
-		if (ClientsCount_ || HandleFirstClientConnected ())
-			g_signal_emit_by_name (MSS_, "add", socket);
-		else
-			PendingSockets_ << socket;
-
-		++ClientsCount_;
+		if (!ClientsCount_++)
+			HandleFirstClientConnected ();
 	}
 
-	void HttpStreamFilter::handleClientDisconnected (int socket)
+	void HttpStreamFilter::handleClientDisconnected ()
 	{
-		g_signal_emit_by_name (MSS_, "remove", socket);
-
 		if (!--ClientsCount_)
 			HandleLastClientDisconnected ();
 	}
@@ -35,6 +35,7 @@
 #include "interfaces/lmp/isourceobject.h"
 
 typedef struct _GstPad GstPad;
+typedef struct _GstBuffer GstBuffer;
 typedef struct _GstMessage GstMessage;
 typedef struct _GstPadTemplate GstPadTemplate;
 
@@ -72,7 +73,7 @@ namespace HttStream
 
 		GstElement * const Muxer_;
 
-		GstElement * const MSS_;
+		GstElement * const Sink_;
 
 		HttpServer * const Server_;
 
@@ -82,7 +83,6 @@ namespace HttStream
 		int ClientsCount_ = 0;
 
 		SourceState StateOnFirst_ = SourceState::Error;
-		QList<int> PendingSockets_;
 	public:
 		HttpStreamFilter (const QByteArray& filterId,
 				const QByteArray& instanceId, IPath *path);
@@ -94,8 +94,9 @@ namespace HttStream
 
 		void SetQuality (double);
 		void SetAddress (const QString&, int);
+		void SetClientBufferSize (qint64);
 
-		void HandleRemoved (int, int);
+		void HandleBuffer (GstBuffer*);
 	protected:
 		GstElement* GetElement () const override;
 		void PostAdd (IPath*) override;
@@ -105,17 +106,15 @@ namespace HttStream
 
 		std::vector<GstElement*> GetStreamBranchElements () const;
 
-		bool HandleFirstClientConnected ();
+		void HandleFirstClientConnected ();
 		void HandleLastClientDisconnected ();
 
-		int HandleError (GstMessage*);
+		int HandleMessage (GstMessage*);
 	private slots:
 		void checkCreatePad (SourceState);
 
-		void readdFd (int);
-
-		void handleClient (int);
-		void handleClientDisconnected (int);
+		void handleClient ();
+		void handleClientDisconnected ();
 	};
 }
 }
@@ -32,6 +32,7 @@
 #include <util/xpc/util.h>
 #include <interfaces/ijobholder.h>
 #include "sync/syncmanagerbase.h"
+#include "rganalysismanager.h"
 
 namespace LeechCraft
 {
@@ -60,12 +61,20 @@ namespace LMP
 				SLOT (handleUploadProgress (int, int, SyncManagerBase*)));
 	}
 
+	void ProgressManager::AddRgAnalysisManager (RgAnalysisManager *rgMgr)
+	{
+		connect (rgMgr,
+				SIGNAL (progress (int, int, QString)),
+				this,
+				SLOT (handleRgProgress (int, int, QString)));
+	}
+
 	void ProgressManager::HandleWithHash (int done, int total,
-			SyncManagerBase *syncer, Syncer2Row_t& hash, const QString& name, const QString& status)
+			QObject *syncer, Syncer2Row_t& hash, const QString& name, const QString& status)
 	{
 		if (!hash.contains (syncer))
 		{
-			if (done == total)
+			if (done >= total)
 				return;
 
 			const QList<QStandardItem*> row
@@ -83,13 +92,14 @@ namespace LMP
 		}
 
 		const auto& row = hash [syncer];
-		if (done == total)
+		if (done >= total)
 		{
 			Model_->removeRow (row.first ()->row ());
 			hash.remove (syncer);
 			return;
 		}
 
+		row.at (JobHolderColumn::JobStatus)->setText (status);
 		Util::SetJobHolderProgress (row, done, total, tr ("%1 of %2").arg (done).arg (total));
 	}
 
@@ -104,5 +114,11 @@ namespace LMP
 		HandleWithHash (done, total, syncer, UpRows_,
 				tr ("Audio upload"), tr ("Uploading..."));
 	}
+
+	void ProgressManager::handleRgProgress (int done, int total, const QString& status)
+	{
+		HandleWithHash (done, total, sender (), RgRows_,
+				tr ("ReplayGain analysis"), status);
+	}
 }
 }
@@ -30,6 +30,7 @@
 #include "recursivedirwatcher_generic.h"
 #include <QFileSystemWatcher>
 #include <QStringList>
+#include <QSet>
 #include <QDir>
 #include <QFutureWatcher>
 #include <QtConcurrentRun>
@@ -60,25 +61,37 @@ namespace LMP
 		connect (Watcher_,
 				SIGNAL (directoryChanged (QString)),
 				this,
-				SIGNAL (directoryChanged (QString)));
+				SLOT (handleDirectoryChanged (QString)));
 	}
 
 	void RecursiveDirWatcherImpl::AddRoot (const QString& root)
 	{
 		qDebug () << Q_FUNC_INFO << "scanning" << root;
+		StartCollecting (root, SLOT (handleSubdirsCollected ()));
+	}
+
+	void RecursiveDirWatcherImpl::RemoveRoot (const QString& root)
+	{
+		Watcher_->removePaths (Dir2Subdirs_.take (root));
+	}
+
+	void RecursiveDirWatcherImpl::StartCollecting (const QString& path, const char *slot)
+	{
 		auto watcher = new QFutureWatcher<QStringList> ();
-		watcher->setProperty ("Path", root);
+		watcher->setProperty ("Path", path);
 		connect (watcher,
 				SIGNAL (finished ()),
 				this,
-				SLOT (handleSubdirsCollected ()));
+				slot);
 
-		watcher->setFuture (QtConcurrent::run (CollectSubdirs, root));
+		watcher->setFuture (QtConcurrent::run (CollectSubdirs, path));
 	}
 
-	void RecursiveDirWatcherImpl::RemoveRoot (const QString& root)
+	void RecursiveDirWatcherImpl::handleDirectoryChanged (const QString& path)
 	{
-		Watcher_->removePaths (Dir2Subdirs_.take (root));
+		emit directoryChanged (path);
+
+		StartCollecting (path, SLOT (handleChangedSubdirsCollected ()));
 	}
 
 	void RecursiveDirWatcherImpl::handleSubdirsCollected ()
@@ -94,5 +107,52 @@ namespace LMP
 		Dir2Subdirs_ [path] = paths;
 		Watcher_->addPaths (paths);
 	}
+
+	void RecursiveDirWatcherImpl::handleChangedSubdirsCollected ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<QStringList>*> (sender ());
+		if (!watcher)
+			return;
+
+		watcher->deleteLater ();
+
+		const auto& path = watcher->property ("Path").toString ();
+		const auto& current = QSet<QString>::fromList (watcher->result ());
+
+		for (auto i = Dir2Subdirs_.begin (), end = Dir2Subdirs_.end (); i != end; ++i)
+		{
+			if (path != i.key () && !path.startsWith (i.key () + '/'))
+				continue;
+
+			auto& subdirs = *i;
+
+			const auto& prefix = path + '/';
+
+			QStringList removed;
+			for (const auto& subdir : subdirs)
+				if ((subdir == path || subdir.startsWith (prefix)) &&
+						!current.contains (subdir))
+					removed << subdir;
+
+			auto added = current;
+			added.subtract (QSet<QString>::fromList (subdirs));
+
+			if (!removed.isEmpty ())
+			{
+				for (const auto& subdir : removed)
+					subdirs.removeOne (subdir);
+				Watcher_->removePaths (removed);
+			}
+
+			if (!added.isEmpty ())
+			{
+				const auto& addedList = added.toList ();
+				subdirs += addedList;
+				Watcher_->addPaths (addedList);
+			}
+
+			break;
+		}
+	}
 }
 }
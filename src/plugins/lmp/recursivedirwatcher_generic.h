@@ -49,8 +49,12 @@ namespace LMP
 
 		void AddRoot (const QString&);
 		void RemoveRoot (const QString&);
+	private:
+		void StartCollecting (const QString&, const char*);
 	private slots:
+		void handleDirectoryChanged (const QString&);
 		void handleSubdirsCollected ();
+		void handleChangedSubdirsCollected ();
 	signals:
 		void directoryChanged (const QString&);
 	};
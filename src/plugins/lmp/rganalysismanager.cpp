@@ -28,6 +28,9 @@
  **********************************************************************/
 
 #include "rganalysismanager.h"
+#include <algorithm>
+#include <QThread>
+#include <QtDebug>
 #include "localcollection.h"
 #include "localcollectionstorage.h"
 #include "engine/rganalyser.h"
@@ -49,6 +52,8 @@ namespace LMP
 
 		XmlSettingsManager::Instance ().RegisterObject ("AutobuildRG",
 				this, "handleScanFinished");
+		XmlSettingsManager::Instance ().RegisterObject ("RGAnalysersCount",
+				this, "rotateQueue");
 	}
 
 	namespace
@@ -59,9 +64,65 @@ namespace LMP
 		}
 	}
 
+	int RgAnalysisManager::GetMaxAnalysers () const
+	{
+		const auto count = XmlSettingsManager::Instance ().property ("RGAnalysersCount").toInt ();
+		return count > 0 ?
+				count :
+				std::max (QThread::idealThreadCount (), 1);
+	}
+
+	void RgAnalysisManager::StartAnalyser ()
+	{
+		QStringList paths;
+		for (const auto& track : AlbumsQueue_.takeFirst ()->Tracks_)
+			paths << track.FilePath_;
+
+		if (paths.isEmpty ())
+		{
+			++DoneAlbums_;
+			return;
+		}
+
+		const auto analyser = std::make_shared<RgAnalyser> (paths);
+		connect (analyser.get (),
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleAnalysed ()));
+		Analysers_ [analyser.get ()] = analyser;
+	}
+
+	void RgAnalysisManager::HandleBatchFinished ()
+	{
+		const auto secs = BatchTimer_.elapsed () / 1000.;
+		qDebug () << Q_FUNC_INFO
+				<< "analysed"
+				<< DoneAlbums_
+				<< "albums and"
+				<< DoneTracks_
+				<< "tracks in"
+				<< secs
+				<< "seconds";
+
+		emit progress (TotalAlbums_, TotalAlbums_, {});
+
+		DoneAlbums_ = 0;
+		TotalAlbums_ = 0;
+		DoneTracks_ = 0;
+	}
+
 	void RgAnalysisManager::handleAnalysed ()
 	{
-		const auto& result = CurrentAnalyser_->GetResult ();
+		const auto analyser = Analysers_.take (static_cast<RgAnalyser*> (sender ()));
+		if (!analyser)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown analyser"
+					<< sender ();
+			return;
+		}
+
+		const auto& result = analyser->GetResult ();
 
 		for (const auto& track : result.Tracks_)
 		{
@@ -83,30 +144,35 @@ namespace LMP
 					});
 		}
 
-		CurrentAnalyser_.reset ();
+		++DoneAlbums_;
+		DoneTracks_ += result.Tracks_.size ();
+
 		rotateQueue ();
 	}
 
 	void RgAnalysisManager::rotateQueue ()
 	{
-		if (AlbumsQueue_.isEmpty ())
+		if (!IsScanAllowed ())
+			AlbumsQueue_.clear ();
+
+		const auto maxAnalysers = GetMaxAnalysers ();
+		while (!AlbumsQueue_.isEmpty () && Analysers_.size () < maxAnalysers)
+			StartAnalyser ();
+
+		if (!TotalAlbums_)
 			return;
 
-		if (!IsScanAllowed ())
+		if (Analysers_.isEmpty () && AlbumsQueue_.isEmpty ())
 		{
-			AlbumsQueue_.clear ();
+			HandleBatchFinished ();
 			return;
 		}
 
-		QStringList paths;
-		for (const auto& track : AlbumsQueue_.takeFirst ()->Tracks_)
-			paths << track.FilePath_;
-
-		CurrentAnalyser_ = std::make_shared<RgAnalyser> (paths);
-		connect (CurrentAnalyser_.get (),
-				SIGNAL (finished ()),
-				this,
-				SLOT (handleAnalysed ()));
+		const auto mins = BatchTimer_.elapsed () / 60000.;
+		const auto& status = mins > 0 && DoneTracks_ ?
+				tr ("%1 tracks per minute").arg (static_cast<int> (DoneTracks_ / mins)) :
+				tr ("Analyzing...");
+		emit progress (DoneAlbums_, TotalAlbums_, status);
 	}
 
 	void RgAnalysisManager::handleScanFinished ()
@@ -119,16 +185,19 @@ namespace LMP
 		for (const auto track : Coll_->GetStorage ()->GetOutdatedRgTracks ())
 			albums << Coll_->GetTrackAlbumId (track);
 
-		const bool wasEmpty = AlbumsQueue_.isEmpty ();
+		if (Analysers_.isEmpty () && AlbumsQueue_.isEmpty ())
+			BatchTimer_.start ();
 
 		for (auto albumId : albums)
 			if (const auto& album = Coll_->GetAlbum (albumId))
+			{
 				AlbumsQueue_ << album;
+				++TotalAlbums_;
+			}
 
 		qDebug () << AlbumsQueue_.size ()
 				<< "albums to rescan";
-		if (wasEmpty)
-			rotateQueue ();
+		rotateQueue ();
 	}
 }
 }
@@ -29,8 +29,11 @@
 
 #pragma once
 
+#include <memory>
 #include <QObject>
 #include <QSet>
+#include <QHash>
+#include <QElapsedTimer>
 #include "interfaces/lmp/collectiontypes.h"
 
 namespace LeechCraft
@@ -46,16 +49,27 @@ namespace LMP
 
 		LocalCollection * const Coll_;
 
-		std::shared_ptr<RgAnalyser> CurrentAnalyser_;
+		QHash<RgAnalyser*, std::shared_ptr<RgAnalyser>> Analysers_;
 
 		QList<Collection::Album_ptr> AlbumsQueue_;
+
+		int DoneAlbums_ = 0;
+		int TotalAlbums_ = 0;
+		int DoneTracks_ = 0;
+		QElapsedTimer BatchTimer_;
 	public:
 		RgAnalysisManager (LocalCollection *coll, QObject* = nullptr);
+	private:
+		int GetMaxAnalysers () const;
+		void StartAnalyser ();
+		void HandleBatchFinished ();
 	private slots:
 		void handleAnalysed ();
 		void rotateQueue ();
 	public slots:
 		void handleScanFinished ();
+	signals:
+		void progress (int done, int total, const QString& status);
 	};
 }
 }
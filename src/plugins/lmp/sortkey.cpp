@@ -0,0 +1,145 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "sortkey.h"
+#include <QDir>
+#include <QFileInfo>
+#include "mediainfo.h"
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	SortKeyMaker::SortKeyMaker (const QList<SortingCriteria>& criteria)
+	: Criteria_ { criteria }
+	{
+	}
+
+	SortKey SortKeyMaker::operator() (const MediaInfo& info) const
+	{
+		SortKey key;
+		key.Path_ = info.LocalPath_;
+
+		for (auto crit : Criteria_)
+			switch (crit)
+			{
+			case SortingCriteria::Artist:
+				key.Strings_ << info.Artist_;
+				break;
+			case SortingCriteria::Year:
+				key.Ints_ << info.Year_;
+				break;
+			case SortingCriteria::Album:
+				key.Strings_ << info.Album_;
+				break;
+			case SortingCriteria::TrackNumber:
+				key.Ints_ << info.TrackNumber_;
+				break;
+			case SortingCriteria::TrackTitle:
+				key.Strings_ << info.Title_;
+				break;
+			case SortingCriteria::DirectoryPath:
+				key.Collated_.push_back (Collate (QFileInfo (info.LocalPath_).dir ().absolutePath ()));
+				break;
+			case SortingCriteria::FileName:
+				key.Collated_.push_back (Collate (QFileInfo (info.LocalPath_).fileName ()));
+				break;
+			}
+
+		return key;
+	}
+
+	bool SortKeyMaker::Less (const SortKey& left, const SortKey& right) const
+	{
+		int intIdx = 0;
+		int strIdx = 0;
+		size_t collatedIdx = 0;
+
+		for (auto crit : Criteria_)
+			switch (crit)
+			{
+			case SortingCriteria::Artist:
+			case SortingCriteria::Album:
+			case SortingCriteria::TrackTitle:
+			{
+				const auto& leftStr = left.Strings_.at (strIdx);
+				const auto& rightStr = right.Strings_.at (strIdx);
+				++strIdx;
+				if (leftStr != rightStr)
+					return leftStr < rightStr;
+				break;
+			}
+			case SortingCriteria::Year:
+			case SortingCriteria::TrackNumber:
+			{
+				const auto leftInt = left.Ints_.at (intIdx);
+				const auto rightInt = right.Ints_.at (intIdx);
+				++intIdx;
+				if (leftInt != rightInt)
+					return leftInt < rightInt;
+				break;
+			}
+			case SortingCriteria::DirectoryPath:
+			case SortingCriteria::FileName:
+			{
+				const auto res = CompareCollated (left.Collated_ [collatedIdx],
+						right.Collated_ [collatedIdx]);
+				++collatedIdx;
+				if (res)
+					return res < 0;
+				break;
+			}
+			}
+
+		return left.Path_ < right.Path_;
+	}
+
+#if QT_VERSION >= 0x050200
+	CollatedKey_t SortKeyMaker::Collate (const QString& str) const
+	{
+		return Collator_.sortKey (str);
+	}
+
+	int SortKeyMaker::CompareCollated (const CollatedKey_t& left, const CollatedKey_t& right) const
+	{
+		return left.compare (right);
+	}
+#else
+	CollatedKey_t SortKeyMaker::Collate (const QString& str) const
+	{
+		return str;
+	}
+
+	int SortKeyMaker::CompareCollated (const CollatedKey_t& left, const CollatedKey_t& right) const
+	{
+		return QString::localeAwareCompare (left, right);
+	}
+#endif
+}
+}
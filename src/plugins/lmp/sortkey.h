@@ -0,0 +1,90 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <QList>
+#include <QString>
+#include <QVector>
+#if QT_VERSION >= 0x050200
+#include <QCollator>
+#endif
+#include "sortingcriteria.h"
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	struct MediaInfo;
+
+#if QT_VERSION >= 0x050200
+	using CollatedKey_t = QCollatorSortKey;
+#else
+	using CollatedKey_t = QString;
+#endif
+
+	/** Sort key of a single track, with the fields laid out in the order
+	 * of the sorting criteria and grouped by their type.
+	 */
+	struct SortKey
+	{
+		QVector<int> Ints_;
+		QVector<QString> Strings_;
+		std::vector<CollatedKey_t> Collated_;
+
+		QString Path_;
+	};
+
+	/** Computes the sort keys of tracks for a list of sorting criteria
+	 * and compares them.
+	 *
+	 * Directory paths and file names are collated according to the
+	 * current locale. Keys produced by different instances shouldn't be
+	 * compared with each other. An instance shouldn't be used from
+	 * several threads at once.
+	 */
+	class SortKeyMaker
+	{
+		const QList<SortingCriteria> Criteria_;
+#if QT_VERSION >= 0x050200
+		QCollator Collator_;
+#endif
+	public:
+		SortKeyMaker (const QList<SortingCriteria>&);
+
+		SortKey operator() (const MediaInfo&) const;
+
+		bool Less (const SortKey&, const SortKey&) const;
+	private:
+		CollatedKey_t Collate (const QString&) const;
+		int CompareCollated (const CollatedKey_t&, const CollatedKey_t&) const;
+	};
+}
+}
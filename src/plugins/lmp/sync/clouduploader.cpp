@@ -77,7 +77,7 @@ namespace LMP
 
 	void CloudUploader::handleUploadFinished (const QString& localPath, CloudStorageError error, const QString& errorStr)
 	{
-		emit finishedCopying ();
+		emit finishedCopying (localPath);
 
 		const bool remove = CurrentJob_.RemoveOnFinish_;
 		CurrentJob_ = UploadJob ();
@@ -64,7 +64,7 @@ namespace LMP
 				LeechCraft::LMP::CloudStorageError error, const QString& errorStr);
 	signals:
 		void startedCopying (const QString&);
-		void finishedCopying ();
+		void finishedCopying (const QString& localPath);
 	};
 }
 }
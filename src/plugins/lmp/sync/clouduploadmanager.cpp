@@ -34,13 +34,14 @@
 #include <QtDebug>
 #include <interfaces/lmp/icloudstorageplugin.h>
 #include "clouduploader.h"
+#include "transcodemanager.h"
 
 namespace LeechCraft
 {
 namespace LMP
 {
-	CloudUploadManager::CloudUploadManager (QObject *parent)
-	: SyncManagerBase (parent)
+	CloudUploadManager::CloudUploadManager (TranscodeScheduler *scheduler, QObject *parent)
+	: SyncManagerBase (scheduler, parent)
 	{
 	}
 
@@ -62,9 +63,9 @@ namespace LMP
 				this,
 				SLOT (handleStartedCopying (QString)));
 		connect (up,
-				SIGNAL (finishedCopying ()),
+				SIGNAL (finishedCopying (QString)),
 				this,
-				SLOT (handleFinishedCopying ()));
+				SLOT (handleFinishedCopying (QString)));
 		Cloud2Uploaders_ [cloud] = up;
 	}
 
@@ -80,6 +81,7 @@ namespace LMP
 					<< "dumb transcoded file detected"
 					<< from
 					<< transcoded;
+			Transcoder_->Release (transcoded);
 			return;
 		}
 
@@ -90,7 +92,7 @@ namespace LMP
 
 		if (!Cloud2Uploaders_.contains (syncTo.Cloud_))
 			CreateUploader (syncTo.Cloud_);
-		Cloud2Uploaders_ [syncTo.Cloud_]->Upload ({ from != transcoded, syncTo.Account_, transcoded });
+		Cloud2Uploaders_ [syncTo.Cloud_]->Upload ({ ShouldRemoveTranscoded (from, transcoded), syncTo.Account_, transcoded });
 	}
 }
 }
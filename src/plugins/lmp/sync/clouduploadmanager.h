@@ -51,7 +51,7 @@ namespace LMP
 		};
 		QMap<QString, CloudUpload> Source2Params_;
 	public:
-		CloudUploadManager (QObject* = 0);
+		CloudUploadManager (TranscodeScheduler*, QObject* = 0);
 
 		void AddFiles (ICloudStoragePlugin*, const QString&, const QStringList&, const TranscodingParams&);
 	private:
@@ -52,7 +52,7 @@ namespace LMP
 	signals:
 		void startedCopying (const QString&);
 		void copyProgress (qint64, qint64);
-		void finishedCopying ();
+		void finishedCopying (const QString& localPath);
 		void errorCopying (const QString&, const QString&);
 	};
 
@@ -116,7 +116,7 @@ namespace LMP
 			if (!errorStr.isEmpty () && error != QFile::NoError)
 				emit errorCopying (localPath, errorStr);
 			else
-				emit finishedCopying ();
+				emit finishedCopying (localPath);
 		}
 	};
 }
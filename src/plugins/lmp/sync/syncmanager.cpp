@@ -35,7 +35,9 @@
 #include <util/lmp/util.h>
 #include <util/sll/either.h>
 #include <util/sll/visitor.h>
+#include <util/threads/futures.h>
 #include "copymanager.h"
+#include "transcodemanager.h"
 #include "../core.h"
 #include "../localfileresolver.h"
 
@@ -81,9 +83,9 @@ namespace LMP
 				this,
 				SLOT (handleStartedCopying (QString)));
 		connect (mgr,
-				SIGNAL (finishedCopying ()),
+				SIGNAL (finishedCopying (QString)),
 				this,
-				SLOT (handleFinishedCopying ()));
+				SLOT (handleFinishedCopying (QString)));
 		connect (mgr,
 				SIGNAL (copyProgress (qint64, qint64)),
 				this,
@@ -97,9 +99,10 @@ namespace LMP
 
 	namespace
 	{
-		Util::Either<ResolveError, QString> FixMask (const QString& mask, const QString& transcoded)
+		Util::Either<ResolveError, QString> FixMask (const QString& mask, const QString& transcoded,
+				const ITagResolver::ResolveResult_t& resolved)
 		{
-			return Core::Instance ().GetLocalFileResolver ()->ResolveInfo (transcoded) >>
+			return resolved >>
 					[&] (const MediaInfo& info)
 					{
 						auto result = PerformSubstitutions (mask, info, SubstitutionFlag::SFSafeFilesystem);
@@ -123,6 +126,7 @@ namespace LMP
 					<< "dumb transcoded file detected"
 					<< from
 					<< transcoded;
+			Transcoder_->Release (transcoded);
 			return;
 		}
 
@@ -130,30 +134,34 @@ namespace LMP
 				.arg ("<em>" + QFileInfo (from).fileName () + "</em>")
 				.arg ("<em>" + syncTo.MountPath_) + "</em>");
 
-		Util::Visit (FixMask (mask, transcoded).AsVariant (),
-				[&] (const QString& filename)
+		Util::Sequence (this, Core::Instance ().GetLocalFileResolver ()->ResolveInfoAsync (transcoded)) >>
+				[=] (const ITagResolver::ResolveResult_t& resolved)
 				{
-					if (!Mount2Copiers_.contains (syncTo.MountPath_))
-						CreateSyncer (syncTo.MountPath_);
-					const CopyJob copyJob
-					{
-						transcoded,
-						from != transcoded,
-						syncTo.Syncer_,
-						from,
-						syncTo.MountPath_,
-						filename
-					};
-					Mount2Copiers_ [syncTo.MountPath_]->Copy (copyJob);
-				},
-				[&] (const ResolveError& err)
-				{
-					const auto& errString = tr ("Unable to expand mask for file %1: %2.")
-							.arg ("<em>" + QFileInfo { transcoded }.fileName () + "</em>")
-							.arg (err.ReasonString_);
-					emit uploadLog (errString);
-					handleErrorCopying (transcoded, errString);
-				});
+					Util::Visit (FixMask (mask, transcoded, resolved).AsVariant (),
+							[&] (const QString& filename)
+							{
+								if (!Mount2Copiers_.contains (syncTo.MountPath_))
+									CreateSyncer (syncTo.MountPath_);
+								const CopyJob copyJob
+								{
+									transcoded,
+									ShouldRemoveTranscoded (from, transcoded),
+									syncTo.Syncer_,
+									from,
+									syncTo.MountPath_,
+									filename
+								};
+								Mount2Copiers_ [syncTo.MountPath_]->Copy (copyJob);
+							},
+							[&] (const ResolveError& err)
+							{
+								const auto& errString = tr ("Unable to expand mask for file %1: %2.")
+										.arg ("<em>" + QFileInfo { transcoded }.fileName () + "</em>")
+										.arg (err.ReasonString_);
+								emit uploadLog (errString);
+								handleErrorCopying (transcoded, errString);
+							});
+				};
 	}
 }
 }
@@ -37,9 +37,9 @@ namespace LeechCraft
 {
 namespace LMP
 {
-	SyncManagerBase::SyncManagerBase (QObject *parent)
+	SyncManagerBase::SyncManagerBase (TranscodeScheduler *scheduler, QObject *parent)
 	: QObject (parent)
-	, Transcoder_ (new TranscodeManager (this))
+	, Transcoder_ (new TranscodeManager (scheduler, this))
 	, TranscodedCount_ (0)
 	, TotalTCCount_ (0)
 	, WereTCErrors_ (false)
@@ -114,6 +114,11 @@ namespace LMP
 		CheckTCFinished ();
 	}
 
+	bool SyncManagerBase::ShouldRemoveTranscoded (const QString& from, const QString& transcoded) const
+	{
+		return from != transcoded && !Transcoder_->IsCached (transcoded);
+	}
+
 	void SyncManagerBase::handleStartedTranscoding (const QString& file)
 	{
 		emit uploadLog (tr ("File %1 started transcoding...")
@@ -139,8 +144,10 @@ namespace LMP
 					.arg ("<em>" + QFileInfo (file).fileName () + "</em>"));
 	}
 
-	void SyncManagerBase::handleFinishedCopying ()
+	void SyncManagerBase::handleFinishedCopying (const QString& localPath)
 	{
+		Transcoder_->Release (localPath);
+
 		emit uploadLog (tr ("File finished copying"));
 
 		emit uploadProgress (++CopiedCount_, TotalCopyCount_, this);
@@ -155,6 +162,8 @@ namespace LMP
 
 	void SyncManagerBase::handleErrorCopying (const QString& localPath, const QString& errorStr)
 	{
+		Transcoder_->Release (localPath);
+
 		const auto& filename = QFileInfo (localPath).fileName ();
 		const auto& text = tr ("Error copying file %1: %2.").arg (filename).arg (errorStr);
 
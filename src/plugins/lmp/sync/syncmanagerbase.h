@@ -38,6 +38,7 @@ namespace LMP
 {
 	class ISyncPlugin;
 	class TranscodeManager;
+	class TranscodeScheduler;
 	struct TranscodingParams;
 
 	class SyncManagerBase : public QObject
@@ -54,10 +55,12 @@ namespace LMP
 		int CopiedCount_;
 		int TotalCopyCount_;
 	public:
-		SyncManagerBase (QObject* = 0);
+		SyncManagerBase (TranscodeScheduler*, QObject* = 0);
 	protected:
 		void AddFiles (const QStringList&, const TranscodingParams&);
 		void HandleFileTranscoded (const QString&, const QString&);
+
+		bool ShouldRemoveTranscoded (const QString& from, const QString& transcoded) const;
 	private:
 		void CheckTCFinished ();
 		void CheckUploadFinished ();
@@ -66,7 +69,7 @@ namespace LMP
 		virtual void handleFileTranscoded (const QString&, const QString&, QString) = 0;
 		void handleFileTCFailed (const QString&);
 		void handleStartedCopying (const QString&);
-		void handleFinishedCopying ();
+		void handleFinishedCopying (const QString&);
 		void handleCopyProgress (qint64, qint64);
 		void handleErrorCopying (const QString&, const QString&);
 	signals:
@@ -32,13 +32,14 @@
 #include "core.h"
 #include "localcollection.h"
 #include "localcollectionmodel.h"
+#include "transcodemanager.h"
 
 namespace LeechCraft
 {
 namespace LMP
 {
-	SyncUnmountableManager::SyncUnmountableManager (QObject *parent)
-	: SyncManagerBase (parent)
+	SyncUnmountableManager::SyncUnmountableManager (TranscodeScheduler *scheduler, QObject *parent)
+	: SyncManagerBase (scheduler, parent)
 	, CopyMgr_ (new CopyManager<CopyJob> (this))
 	{
 		connect (CopyMgr_,
@@ -46,9 +47,9 @@ namespace LMP
 				this,
 				SLOT (handleStartedCopying (QString)));
 		connect (CopyMgr_,
-				SIGNAL (finishedCopying ()),
+				SIGNAL (finishedCopying (QString)),
 				this,
-				SLOT (handleFinishedCopying ()));
+				SLOT (handleFinishedCopying (QString)));
 		connect (CopyMgr_,
 				SIGNAL (copyProgress (qint64, qint64)),
 				this,
@@ -117,13 +118,14 @@ namespace LMP
 			qWarning () << Q_FUNC_INFO
 					<< "no syncer for file"
 					<< from;
+			Transcoder_->Release (transcoded);
 			return;
 		}
 
 		const CopyJob copyJob
 		{
 			transcoded,
-			from != transcoded,
+			ShouldRemoveTranscoded (from, transcoded),
 			params.Syncer_,
 			params.DevID_,
 			params.StorageID_,
@@ -79,7 +79,7 @@ namespace LMP
 		};
 		CopyManager<CopyJob> *CopyMgr_;
 	public:
-		SyncUnmountableManager (QObject* = 0);
+		SyncUnmountableManager (TranscodeScheduler*, QObject* = 0);
 
 		void AddFiles (const AddFilesParams&);
 	protected slots:
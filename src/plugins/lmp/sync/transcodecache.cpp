@@ -0,0 +1,182 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "transcodecache.h"
+#include <stdexcept>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QtDebug>
+#include <util/sys/paths.h>
+#include "transcodingparams.h"
+#include "../xmlsettingsmanager.h"
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	TranscodeCache::TranscodeCache ()
+	{
+		try
+		{
+			Dir_ = Util::GetUserDir (Util::UserDir::Cache, "lmp/transcoded");
+			IsValid_ = true;
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to create cache directory:"
+					<< e.what ();
+		}
+	}
+
+	QString TranscodeCache::GetKey (const QString& path, const TranscodingParams& params) const
+	{
+		const QFileInfo fi { path };
+
+		QCryptographicHash hash { QCryptographicHash::Sha1 };
+		hash.addData (fi.absoluteFilePath ().toUtf8 ());
+		hash.addData (QByteArray::number (fi.size ()));
+		hash.addData (QByteArray::number (fi.lastModified ().toMSecsSinceEpoch ()));
+		hash.addData (params.FormatID_.toUtf8 ());
+		hash.addData (QByteArray::number (static_cast<int> (params.BitrateType_)));
+		hash.addData (QByteArray::number (params.Quality_));
+		return hash.result ().toHex ();
+	}
+
+	boost::optional<QString> TranscodeCache::Find (const QString& key, const TranscodingParams& params) const
+	{
+		if (!IsValid_ || !GetMaxSize ())
+			return {};
+
+		const auto& path = GetPath (key, params);
+		if (!QFile::exists (path))
+			return {};
+
+		return path;
+	}
+
+	boost::optional<QString> TranscodeCache::Store (const QString& key,
+			const TranscodingParams& params, const QString& transcodedPath)
+	{
+		const auto maxSize = GetMaxSize ();
+		if (!IsValid_ || !maxSize)
+			return {};
+
+		const auto& path = GetPath (key, params);
+		QFile::remove (path);
+		if (!QFile::rename (transcodedPath, path))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to move"
+					<< transcodedPath
+					<< "to"
+					<< path;
+			return {};
+		}
+
+		if (TotalSize_ >= 0)
+			TotalSize_ += QFileInfo { path }.size ();
+
+		Pin (path);
+		Prune (maxSize);
+		Unpin (path);
+
+		return path;
+	}
+
+	bool TranscodeCache::Contains (const QString& path) const
+	{
+		return IsValid_ &&
+				QFileInfo { path }.absolutePath () == Dir_.absolutePath ();
+	}
+
+	void TranscodeCache::Pin (const QString& path)
+	{
+		++Pinned_ [path];
+	}
+
+	void TranscodeCache::Unpin (const QString& path)
+	{
+		const auto pos = Pinned_.find (path);
+		if (pos == Pinned_.end ())
+			return;
+
+		if (--*pos)
+			return;
+
+		Pinned_.erase (pos);
+
+		// The pinned files may have kept the cache over its limit.
+		if (const auto maxSize = GetMaxSize ())
+			Prune (maxSize);
+	}
+
+	QString TranscodeCache::GetPath (const QString& key, const TranscodingParams& params) const
+	{
+		const auto& format = Formats {}.GetFormat (params.FormatID_);
+		return Dir_.filePath (key + '.' + format->GetFileExtension ());
+	}
+
+	qint64 TranscodeCache::GetMaxSize () const
+	{
+		return XmlSettingsManager::Instance ()
+				.property ("TranscodedCacheSize").toLongLong () * 1024 * 1024;
+	}
+
+	void TranscodeCache::Prune (qint64 maxSize)
+	{
+		if (TotalSize_ >= 0 && TotalSize_ <= maxSize)
+			return;
+
+		const auto& infos = Dir_.entryInfoList (QDir::Files, QDir::Time);
+
+		TotalSize_ = 0;
+		for (const auto& info : infos)
+			TotalSize_ += info.size ();
+
+		for (auto i = infos.rbegin (); i != infos.rend () && TotalSize_ > maxSize; ++i)
+		{
+			if (Pinned_.contains (i->absoluteFilePath ()))
+				continue;
+
+			if (!QFile::remove (i->absoluteFilePath ()))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to remove"
+						<< i->absoluteFilePath ();
+				continue;
+			}
+
+			TotalSize_ -= i->size ();
+		}
+	}
+}
+}
@@ -0,0 +1,82 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <QDir>
+#include <QHash>
+#include <QString>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	struct TranscodingParams;
+
+	/** Keeps the transcoded files keyed by the source file identity and
+	 * the transcoding parameters, so that syncing the same tracks to
+	 * several devices or syncing them again only transcodes them once.
+	 *
+	 * The cache is bounded by the TranscodedCacheSize setting, the
+	 * oldest entries are evicted first. Pinned entries are never evicted,
+	 * so the cache may temporarily grow over the limit while they are
+	 * being uploaded.
+	 */
+	class TranscodeCache
+	{
+		QDir Dir_;
+		bool IsValid_ = false;
+
+		qint64 TotalSize_ = -1;
+
+		QHash<QString, int> Pinned_;
+	public:
+		TranscodeCache ();
+
+		QString GetKey (const QString& path, const TranscodingParams&) const;
+
+		boost::optional<QString> Find (const QString& key, const TranscodingParams&) const;
+		boost::optional<QString> Store (const QString& key,
+				const TranscodingParams&, const QString& transcodedPath);
+
+		bool Contains (const QString& path) const;
+
+		/** Protects the cached file from eviction until the matching
+		 * Unpin() call. Calls may be nested.
+		 */
+		void Pin (const QString& path);
+		void Unpin (const QString& path);
+	private:
+		QString GetPath (const QString& key, const TranscodingParams&) const;
+		qint64 GetMaxSize () const;
+		void Prune (qint64);
+	};
+}
+}
@@ -32,15 +32,28 @@
 #include <QtDebug>
 #include <QFileInfo>
 #include <util/sll/prelude.h>
-#include "transcodejob.h"
+#include "transcodescheduler.h"
 
 namespace LeechCraft
 {
 namespace LMP
 {
-	TranscodeManager::TranscodeManager (QObject *parent)
+	TranscodeManager::TranscodeManager (TranscodeScheduler *scheduler, QObject *parent)
 	: QObject (parent)
+	, Scheduler_ (scheduler)
 	{
+		connect (Scheduler_,
+				SIGNAL (fileStartedTranscoding (QObject*, QString)),
+				this,
+				SLOT (handleStarted (QObject*, QString)));
+		connect (Scheduler_,
+				SIGNAL (fileReady (QObject*, QString, QString, QString)),
+				this,
+				SLOT (handleReady (QObject*, QString, QString, QString)));
+		connect (Scheduler_,
+				SIGNAL (fileFailed (QObject*, QString)),
+				this,
+				SLOT (handleFailed (QObject*, QString)));
 	}
 
 	namespace
@@ -72,36 +85,37 @@ namespace LMP
 			files.erase (partPos, files.end ());
 		}
 
-		Queue_ += Util::Map (files,
-				[&params] (const QString& file) { return qMakePair (file, params); });
+		for (const auto& file : files)
+			Scheduler_->Enqueue (this, file, params);
+	}
 
-		while (RunningJobs_.size () < params.NumThreads_ && !Queue_.isEmpty ())
-			EnqueueJob (Queue_.takeFirst ());
+	bool TranscodeManager::IsCached (const QString& path) const
+	{
+		return Scheduler_->IsCached (path);
 	}
 
-	void TranscodeManager::EnqueueJob (const QPair<QString, TranscodingParams>& pair)
+	void TranscodeManager::Release (const QString& path)
 	{
-		auto job = new TranscodeJob (pair.first, pair.second, this);
-		RunningJobs_ << job;
-		connect (job,
-				SIGNAL (done (TranscodeJob*, bool)),
-				this,
-				SLOT (handleDone (TranscodeJob*, bool)));
-		emit fileStartedTranscoding (QFileInfo (pair.first).fileName ());
+		Scheduler_->Release (path);
 	}
 
-	void TranscodeManager::handleDone (TranscodeJob *job, bool success)
+	void TranscodeManager::handleStarted (QObject *requester, const QString& origPath)
 	{
-		RunningJobs_.removeAll (job);
-		job->deleteLater ();
+		if (requester == this)
+			emit fileStartedTranscoding (QFileInfo (origPath).fileName ());
+	}
 
-		if (!Queue_.isEmpty ())
-			EnqueueJob (Queue_.takeFirst ());
+	void TranscodeManager::handleReady (QObject *requester, const QString& origPath,
+			const QString& transcodedPath, const QString& pattern)
+	{
+		if (requester == this)
+			emit fileReady (origPath, transcodedPath, pattern);
+	}
 
-		if (success)
-			emit fileReady (job->GetOrigPath (), job->GetTranscodedPath (), job->GetTargetPattern ());
-		else
-			emit fileFailed (job->GetOrigPath ());
+	void TranscodeManager::handleFailed (QObject *requester, const QString& origPath)
+	{
+		if (requester == this)
+			emit fileFailed (origPath);
 	}
 }
 }
@@ -30,30 +30,30 @@
 #pragma once
 
 #include <QObject>
-#include <QPair>
 #include "transcodingparams.h"
 
 namespace LeechCraft
 {
 namespace LMP
 {
-	class TranscodeJob;
+	class TranscodeScheduler;
 
 	class TranscodeManager : public QObject
 	{
 		Q_OBJECT
 
-		QList<QPair<QString, TranscodingParams>> Queue_;
-
-		QList<TranscodeJob*> RunningJobs_;
+		TranscodeScheduler * const Scheduler_;
 	public:
-		TranscodeManager (QObject* = 0);
+		TranscodeManager (TranscodeScheduler*, QObject* = 0);
 
 		void Enqueue (QStringList, const TranscodingParams&);
-	private:
-		void EnqueueJob (const QPair<QString, TranscodingParams>&);
+
+		bool IsCached (const QString&) const;
+		void Release (const QString&);
 	private slots:
-		void handleDone (TranscodeJob*, bool);
+		void handleStarted (QObject*, const QString&);
+		void handleReady (QObject*, const QString&, const QString&, const QString&);
+		void handleFailed (QObject*, const QString&);
 	signals:
 		void fileStartedTranscoding (const QString& origPath);
 		void fileReady (const QString& origPath,
@@ -0,0 +1,220 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "transcodescheduler.h"
+#include <algorithm>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QThread>
+#include <QUuid>
+#include <QtDebug>
+#include "transcodejob.h"
+#include "../xmlsettingsmanager.h"
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	TranscodeScheduler::TranscodeScheduler (QObject *parent)
+	: QObject { parent }
+	{
+		XmlSettingsManager::Instance ().RegisterObject ("MaxTranscodeJobs",
+				this, "rotateQueue");
+	}
+
+	void TranscodeScheduler::Enqueue (QObject *requester,
+			const QString& path, const TranscodingParams& params)
+	{
+		const auto& key = Cache_.GetKey (path, params);
+		if (const auto& cached = Cache_.Find (key, params))
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "reusing"
+					<< *cached
+					<< "for"
+					<< path;
+			DeliverCached (requester, path, *cached, params.FilePattern_);
+			return;
+		}
+
+		const Waiter waiter { requester, params.FilePattern_ };
+
+		const auto pos = Key2Task_.find (key);
+		if (pos != Key2Task_.end ())
+		{
+			pos->Waiters_ << waiter;
+			if (pos->IsRunning_)
+				emit fileStartedTranscoding (requester, path);
+			return;
+		}
+
+		Key2Task_ [key] = Task { path, params, requester, { waiter }, false };
+		Owner2Queue_ [requester] << key;
+
+		rotateQueue ();
+	}
+
+	bool TranscodeScheduler::IsCached (const QString& path) const
+	{
+		return Cache_.Contains (path);
+	}
+
+	void TranscodeScheduler::Release (const QString& transcodedPath)
+	{
+		if (Cache_.Contains (transcodedPath))
+			Cache_.Unpin (transcodedPath);
+	}
+
+	int TranscodeScheduler::GetMaxJobs () const
+	{
+		const auto count = XmlSettingsManager::Instance ().property ("MaxTranscodeJobs").toInt ();
+		return count > 0 ?
+				count :
+				std::max (QThread::idealThreadCount (), 1);
+	}
+
+	void TranscodeScheduler::StartTask (const QString& key)
+	{
+		auto& task = Key2Task_ [key];
+		task.IsRunning_ = true;
+		++Owner2Running_ [task.Owner_];
+
+		const auto job = new TranscodeJob (task.Path_, task.Params_, this);
+		Job2Key_ [job] = key;
+		connect (job,
+				SIGNAL (done (TranscodeJob*, bool)),
+				this,
+				SLOT (handleDone (TranscodeJob*, bool)));
+
+		for (const auto& waiter : task.Waiters_)
+			if (waiter.Requester_)
+				emit fileStartedTranscoding (waiter.Requester_, task.Path_);
+	}
+
+	void TranscodeScheduler::rotateQueue ()
+	{
+		const auto maxJobs = GetMaxJobs ();
+
+		// Take one file from each sync manager in turn, so that a large
+		// sync doesn't starve the others.
+		bool started = true;
+		while (started && Job2Key_.size () < maxJobs)
+		{
+			started = false;
+
+			for (auto i = Owner2Queue_.begin ();
+					i != Owner2Queue_.end () && Job2Key_.size () < maxJobs; )
+			{
+				if (i->isEmpty ())
+				{
+					i = Owner2Queue_.erase (i);
+					continue;
+				}
+
+				const auto& params = Key2Task_ [i->first ()].Params_;
+				if (Owner2Running_.value (i.key ()) < std::max (params.NumThreads_, 1))
+				{
+					StartTask (i->takeFirst ());
+					started = true;
+				}
+
+				++i;
+			}
+		}
+	}
+
+	void TranscodeScheduler::DeliverCached (QObject *requester, const QString& origPath,
+			const QString& cachedPath, const QString& pattern)
+	{
+		// Keep the file until the requester uploads it and calls Release().
+		Cache_.Pin (cachedPath);
+		emit fileReady (requester, origPath, cachedPath, pattern);
+	}
+
+	void TranscodeScheduler::DeliverTranscoded (const Task& task, const QString& transcoded)
+	{
+		QList<Waiter> waiters;
+		for (const auto& waiter : task.Waiters_)
+			if (waiter.Requester_)
+				waiters << waiter;
+
+		if (waiters.isEmpty ())
+		{
+			QFile::remove (transcoded);
+			return;
+		}
+
+		// The file isn't cached, so each requester removes its own copy
+		// once it's uploaded.
+		for (int i = 1; i < waiters.size (); ++i)
+		{
+			const auto& waiter = waiters.at (i);
+
+			const QFileInfo fi { transcoded };
+			const auto& copy = fi.dir ().filePath (QUuid::createUuid ().toString () + '.' + fi.suffix ());
+			if (QFile::copy (transcoded, copy))
+				emit fileReady (waiter.Requester_, task.Path_, copy, waiter.Pattern_);
+			else
+				emit fileFailed (waiter.Requester_, task.Path_);
+		}
+
+		const auto& first = waiters.first ();
+		emit fileReady (first.Requester_, task.Path_, transcoded, first.Pattern_);
+	}
+
+	void TranscodeScheduler::handleDone (TranscodeJob *job, bool success)
+	{
+		job->deleteLater ();
+
+		const auto& key = Job2Key_.take (job);
+		const auto task = Key2Task_.take (key);
+
+		if (!--Owner2Running_ [task.Owner_])
+			Owner2Running_.remove (task.Owner_);
+
+		if (!success)
+		{
+			for (const auto& waiter : task.Waiters_)
+				if (waiter.Requester_)
+					emit fileFailed (waiter.Requester_, task.Path_);
+		}
+		else if (const auto& cached = Cache_.Store (key, task.Params_, job->GetTranscodedPath ()))
+		{
+			for (const auto& waiter : task.Waiters_)
+				if (waiter.Requester_)
+					DeliverCached (waiter.Requester_, task.Path_, *cached, waiter.Pattern_);
+		}
+		else
+			DeliverTranscoded (task, job->GetTranscodedPath ());
+
+		rotateQueue ();
+	}
+}
+}
@@ -0,0 +1,101 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QStringList>
+#include "transcodingparams.h"
+#include "transcodecache.h"
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	class TranscodeJob;
+
+	/** Runs the transcoding jobs of all the sync managers under a single
+	 * limit on simultaneous jobs, serving the already transcoded files
+	 * from the TranscodeCache and merging the requests for the same
+	 * file into a single job.
+	 */
+	class TranscodeScheduler : public QObject
+	{
+		Q_OBJECT
+
+		TranscodeCache Cache_;
+
+		struct Waiter
+		{
+			QPointer<QObject> Requester_;
+			QString Pattern_;
+		};
+
+		struct Task
+		{
+			QString Path_;
+			TranscodingParams Params_;
+			QObject *Owner_;
+			QList<Waiter> Waiters_;
+			bool IsRunning_;
+		};
+
+		QHash<QString, Task> Key2Task_;
+		QHash<QObject*, QStringList> Owner2Queue_;
+		QHash<QObject*, int> Owner2Running_;
+		QHash<TranscodeJob*, QString> Job2Key_;
+	public:
+		TranscodeScheduler (QObject* = nullptr);
+
+		void Enqueue (QObject *requester, const QString& path, const TranscodingParams&);
+
+		bool IsCached (const QString&) const;
+
+		/** Tells that the requester is done with the transcoded file
+		 * passed to it via fileReady(), so the cache may evict it.
+		 */
+		void Release (const QString& transcodedPath);
+	private:
+		int GetMaxJobs () const;
+		void StartTask (const QString&);
+		void DeliverCached (QObject*, const QString&, const QString&, const QString&);
+		void DeliverTranscoded (const Task&, const QString&);
+	private slots:
+		void rotateQueue ();
+		void handleDone (TranscodeJob*, bool);
+	signals:
+		void fileStartedTranscoding (QObject *requester, const QString& origPath);
+		void fileReady (QObject *requester, const QString& origPath,
+				const QString& transcodedPath, const QString& pattern);
+		void fileFailed (QObject *requester, const QString& origPath);
+	};
+}
+}
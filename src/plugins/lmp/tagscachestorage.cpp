@@ -0,0 +1,178 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "tagscachestorage.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSqlError>
+#include <QtDebug>
+#include <util/db/dblock.h>
+#include <util/db/util.h>
+#include <util/sys/paths.h>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		const int MaxUncommitted = 500;
+	}
+
+	TagsCacheStorage::TagsCacheStorage ()
+	: DB_ { QSqlDatabase::addDatabase ("QSQLITE",
+			Util::GenConnectionName ("org.LMP.TagsCache")) }
+	{
+		const auto& cacheDir = Util::GetUserDir (Util::UserDir::Cache, "lmp");
+		DB_.setDatabaseName (cacheDir.filePath ("tagscache.db"));
+
+		if (!DB_.open ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open the database, tags won't be cached";
+			Util::DBLock::DumpError (DB_.lastError ());
+			return;
+		}
+
+		Util::RunTextQuery (DB_, "PRAGMA synchronous = OFF;");
+		Util::RunTextQuery (DB_, "PRAGMA journal_mode = WAL;");
+
+		if (!DB_.tables ().contains ("tags"))
+			Util::RunTextQuery (DB_,
+					"CREATE TABLE tags ("
+					"Path TEXT PRIMARY KEY, "
+					"Size INTEGER NOT NULL, "
+					"MTime TIMESTAMP NOT NULL, "
+					"Accurate INTEGER NOT NULL, "
+					"Info BLOB NOT NULL "
+					");");
+
+		GetInfo_ = QSqlQuery { DB_ };
+		GetInfo_.prepare ("SELECT Size, MTime, Accurate, Info FROM tags WHERE Path = :path;");
+
+		SetInfo_ = QSqlQuery { DB_ };
+		SetInfo_.prepare ("INSERT OR REPLACE INTO tags (Path, Size, MTime, Accurate, Info) "
+				"VALUES (:path, :size, :mtime, :accurate, :info);");
+
+		IsOpen_ = true;
+	}
+
+	TagsCacheStorage::~TagsCacheStorage ()
+	{
+		Flush ();
+	}
+
+	boost::optional<MediaInfo> TagsCacheStorage::Get (const QString& path,
+			qint64 size, const QDateTime& mtime, bool accurate)
+	{
+		if (!IsOpen_)
+			return {};
+
+		GetInfo_.bindValue (":path", path);
+		if (!GetInfo_.exec ())
+		{
+			Util::DBLock::DumpError (GetInfo_);
+			return {};
+		}
+
+		if (!GetInfo_.next ())
+		{
+			GetInfo_.finish ();
+			return {};
+		}
+
+		const auto storedSize = GetInfo_.value (0).toLongLong ();
+		const auto& storedMTime = GetInfo_.value (1).toDateTime ();
+		const auto storedAccurate = GetInfo_.value (2).toBool ();
+		const auto& data = GetInfo_.value (3).toByteArray ();
+		GetInfo_.finish ();
+
+		if (storedSize != size ||
+				storedMTime != mtime ||
+				(accurate && !storedAccurate))
+			return {};
+
+		MediaInfo info;
+		QDataStream stream { data };
+		stream >> info;
+		return info;
+	}
+
+	QList<boost::optional<MediaInfo>> TagsCacheStorage::Lookup (const QStringList& paths, bool accurate)
+	{
+		QList<boost::optional<MediaInfo>> result;
+		result.reserve (paths.size ());
+		for (const auto& path : paths)
+		{
+			const QFileInfo fileInfo { path };
+			result << Get (path, fileInfo.size (), fileInfo.lastModified (), accurate);
+		}
+		return result;
+	}
+
+	void TagsCacheStorage::Set (const MediaInfo& info,
+			qint64 size, const QDateTime& mtime, bool accurate)
+	{
+		if (!IsOpen_)
+			return;
+
+		if (!UncommittedCount_)
+			DB_.transaction ();
+
+		QByteArray data;
+		{
+			QDataStream stream { &data, QIODevice::WriteOnly };
+			stream << info;
+		}
+
+		SetInfo_.bindValue (":path", info.LocalPath_);
+		SetInfo_.bindValue (":size", size);
+		SetInfo_.bindValue (":mtime", mtime);
+		SetInfo_.bindValue (":accurate", accurate);
+		SetInfo_.bindValue (":info", data);
+		if (!SetInfo_.exec ())
+			Util::DBLock::DumpError (SetInfo_);
+
+		if (++UncommittedCount_ >= MaxUncommitted)
+			Flush ();
+	}
+
+	void TagsCacheStorage::Flush ()
+	{
+		if (!UncommittedCount_)
+			return;
+
+		if (!DB_.commit ())
+			Util::DBLock::DumpError (DB_.lastError ());
+
+		UncommittedCount_ = 0;
+	}
+}
+}
@@ -0,0 +1,107 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <QStringList>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <util/threads/workerthreadbase.h>
+#include "mediainfo.h"
+
+class QDateTime;
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	/** Persistent cache of resolved tags keyed by the file path, size
+	 * and modification time.
+	 *
+	 * This class is not thread-safe and is intended to be used only via
+	 * the TagsCacheThread.
+	 *
+	 * If the database can't be opened, the cache stays empty and all
+	 * the writes to it are ignored.
+	 */
+	class TagsCacheStorage
+	{
+		QSqlDatabase DB_;
+		bool IsOpen_ = false;
+
+		QSqlQuery GetInfo_;
+		QSqlQuery SetInfo_;
+
+		int UncommittedCount_ = 0;
+	public:
+		TagsCacheStorage ();
+		~TagsCacheStorage ();
+
+		TagsCacheStorage (const TagsCacheStorage&) = delete;
+		TagsCacheStorage& operator= (const TagsCacheStorage&) = delete;
+
+		/** Returns the cached info for the given file, if any.
+		 *
+		 * If accurate is true, the entries that were resolved with
+		 * fast audio properties are ignored.
+		 */
+		boost::optional<MediaInfo> Get (const QString& path,
+				qint64 size, const QDateTime& mtime, bool accurate);
+
+		/** Returns the cached infos for the given files in the same
+		 * order, checking them against the current size and mtime of
+		 * each file.
+		 */
+		QList<boost::optional<MediaInfo>> Lookup (const QStringList& paths, bool accurate);
+
+		/** Records the info for the file with the given size and mtime.
+		 *
+		 * The records are written in batches, call Flush() to commit
+		 * the pending ones. LocalFileResolver does so periodically.
+		 */
+		void Set (const MediaInfo& info,
+				qint64 size, const QDateTime& mtime, bool accurate);
+
+		void Flush ();
+	};
+
+	class TagsCacheThread : public Util::WorkerThread<TagsCacheStorage>
+	{
+	public:
+		using WorkerThread::WorkerThread;
+
+		template<typename... Args>
+		auto Schedule (Args&&... args) -> decltype (ScheduleImpl (std::forward<Args> (args)...))
+		{
+			return ScheduleImpl (std::forward<Args> (args)...);
+		}
+	};
+}
+}
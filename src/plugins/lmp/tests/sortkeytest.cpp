@@ -0,0 +1,188 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "sortkeytest.h"
+#include <algorithm>
+#include <random>
+#include <QtTest>
+#include "sortkey.h"
+#include "mediainfo.h"
+
+QTEST_APPLESS_MAIN (LeechCraft::LMP::SortKeyTest)
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		const int TracksCount = 100000;
+
+		QList<MediaInfo> MakeInfos (int count)
+		{
+			QList<MediaInfo> infos;
+			infos.reserve (count);
+			for (int i = 0; i < count; ++i)
+			{
+				const auto artist = i / 100;
+				const auto album = i / 10;
+				const auto track = i % 10 + 1;
+
+				MediaInfo info;
+				info.Artist_ = QString ("Artist %1").arg (artist);
+				info.Album_ = QString ("Album %1").arg (album);
+				info.Title_ = QString ("Track %1 of %2").arg (track).arg (album);
+				info.Year_ = 1960 + artist % 60;
+				info.TrackNumber_ = track;
+				info.LocalPath_ = QString ("/music/%1/%2/%3 - %4.ogg")
+						.arg (info.Artist_)
+						.arg (info.Album_)
+						.arg (track, 2, 10, QChar ('0'))
+						.arg (info.Title_);
+				infos << info;
+			}
+
+			std::mt19937 gen { 42 };
+			std::shuffle (infos.begin (), infos.end (), gen);
+			return infos;
+		}
+
+		QList<SortingCriteria> TagsCriteria ()
+		{
+			return
+			{
+				SortingCriteria::Artist,
+				SortingCriteria::Year,
+				SortingCriteria::Album,
+				SortingCriteria::TrackNumber
+			};
+		}
+
+		QList<SortingCriteria> PathsCriteria ()
+		{
+			return { SortingCriteria::DirectoryPath, SortingCriteria::FileName };
+		}
+
+		QStringList SortPaths (const QList<MediaInfo>& infos, const SortKeyMaker& maker)
+		{
+			std::vector<SortKey> keys;
+			keys.reserve (infos.size ());
+			for (const auto& info : infos)
+				keys.push_back (maker (info));
+
+			std::sort (keys.begin (), keys.end (),
+					[&maker] (const SortKey& left, const SortKey& right)
+						{ return maker.Less (left, right); });
+
+			QStringList paths;
+			for (const auto& key : keys)
+				paths << key.Path_;
+			return paths;
+		}
+	}
+
+	void SortKeyTest::testSortedOrder ()
+	{
+		const SortKeyMaker maker { TagsCriteria () + PathsCriteria () };
+
+		const auto& infos = MakeInfos (1000);
+
+		std::vector<SortKey> keys;
+		for (const auto& info : infos)
+			keys.push_back (maker (info));
+
+		std::sort (keys.begin (), keys.end (),
+				[&maker] (const SortKey& left, const SortKey& right)
+					{ return maker.Less (left, right); });
+
+		for (size_t i = 1; i < keys.size (); ++i)
+		{
+			QVERIFY (!maker.Less (keys [i], keys [i - 1]));
+			QVERIFY (maker.Less (keys [i - 1], keys [i]));
+		}
+
+		QCOMPARE (keys.front ().Path_, QString ("/music/Artist 0/Album 0/01 - Track 1 of 0.ogg"));
+	}
+
+	void SortKeyTest::testMergeSorted ()
+	{
+		const SortKeyMaker maker { PathsCriteria () };
+
+		const auto& infos = MakeInfos (1000);
+		const auto& firstHalf = infos.mid (0, infos.size () / 2);
+		const auto& secondHalf = infos.mid (infos.size () / 2);
+
+		const auto& first = SortPaths (firstHalf, maker);
+		const auto& second = SortPaths (secondHalf, maker);
+
+		auto toKeys = [&maker] (const QStringList& paths)
+		{
+			std::vector<SortKey> keys;
+			for (const auto& path : paths)
+			{
+				MediaInfo info;
+				info.LocalPath_ = path;
+				keys.push_back (maker (info));
+			}
+			return keys;
+		};
+		const auto& firstKeys = toKeys (first);
+		const auto& secondKeys = toKeys (second);
+
+		std::vector<SortKey> merged;
+		std::merge (firstKeys.begin (), firstKeys.end (),
+				secondKeys.begin (), secondKeys.end (),
+				std::back_inserter (merged),
+				[&maker] (const SortKey& left, const SortKey& right)
+					{ return maker.Less (left, right); });
+
+		QStringList mergedPaths;
+		for (const auto& key : merged)
+			mergedPaths << key.Path_;
+
+		QCOMPARE (mergedPaths, SortPaths (infos, maker));
+	}
+
+	void SortKeyTest::benchSortTags ()
+	{
+		const auto& infos = MakeInfos (TracksCount);
+		const SortKeyMaker maker { TagsCriteria () };
+
+		QBENCHMARK { SortPaths (infos, maker); }
+	}
+
+	void SortKeyTest::benchSortPaths ()
+	{
+		const auto& infos = MakeInfos (TracksCount);
+		const SortKeyMaker maker { PathsCriteria () };
+
+		QBENCHMARK { SortPaths (infos, maker); }
+	}
+}
+}
@@ -34,6 +34,8 @@
 #include <interfaces/iplugin2.h>
 #include "interfaces/monocle/iredirectproxy.h"
 #include "pixmapcachemanager.h"
+#include "renderscheduler.h"
+#include "documentcachemanager.h"
 #include "recentlyopenedmanager.h"
 #include "defaultbackendmanager.h"
 #include "docstatemanager.h"
@@ -46,6 +48,8 @@ namespace Monocle
 {
 	Core::Core ()
 	: CacheManager_ (new PixmapCacheManager (this))
+	, RenderScheduler_ (new RenderScheduler (this))
+	, DocumentCacheManager_ (new DocumentCacheManager (this))
 	, ROManager_ (new RecentlyOpenedManager (this))
 	, DefaultBackendManager_ (new DefaultBackendManager (this))
 	, DocStateManager_ (new DocStateManager (this))
@@ -169,6 +173,16 @@ namespace Monocle
 		return CacheManager_;
 	}
 
+	RenderScheduler* Core::GetRenderScheduler () const
+	{
+		return RenderScheduler_;
+	}
+
+	DocumentCacheManager* Core::GetDocumentCacheManager () const
+	{
+		return DocumentCacheManager_;
+	}
+
 	RecentlyOpenedManager* Core::GetROManager () const
 	{
 		return ROManager_;
@@ -44,6 +44,8 @@ namespace Monocle
 {
 	class RecentlyOpenedManager;
 	class PixmapCacheManager;
+	class RenderScheduler;
+	class DocumentCacheManager;
 	class DefaultBackendManager;
 	class DocStateManager;
 	class BookmarksManager;
@@ -57,6 +59,8 @@ namespace Monocle
 		QList<QObject*> Backends_;
 
 		PixmapCacheManager *CacheManager_;
+		RenderScheduler *RenderScheduler_;
+		DocumentCacheManager *DocumentCacheManager_;
 		RecentlyOpenedManager *ROManager_;
 		DefaultBackendManager *DefaultBackendManager_;
 		DocStateManager *DocStateManager_;
@@ -78,6 +82,8 @@ namespace Monocle
 		CoreLoadProxy* LoadDocument (const QString&);
 
 		PixmapCacheManager* GetPixmapCacheManager () const;
+		RenderScheduler* GetRenderScheduler () const;
+		DocumentCacheManager* GetDocumentCacheManager () const;
 		RecentlyOpenedManager* GetROManager () const;
 		DefaultBackendManager* GetDefaultBackendManager () const;
 		DocStateManager* GetDocStateManager () const;
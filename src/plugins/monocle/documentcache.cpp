@@ -0,0 +1,169 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "documentcache.h"
+#include <QFile>
+#include <QBuffer>
+#include <QDataStream>
+#include <QThread>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	DocumentCache::DocumentCache (const QDir& dir)
+	: Dir_ { dir }
+	{
+	}
+
+	namespace
+	{
+		QString GetWordsName (int page)
+		{
+			return "w" + QString::number (page);
+		}
+
+		const quint8 WordsVersion = 1;
+
+		QString GetThumbName (int page)
+		{
+			return "p" + QString::number (page) + ".png";
+		}
+	}
+
+	boost::optional<QList<PageWord>> DocumentCache::GetPageWords (int page) const
+	{
+		QFile file { Dir_.filePath (GetWordsName (page)) };
+		if (!file.open (QIODevice::ReadOnly))
+			return {};
+
+		QDataStream in { qUncompress (file.readAll ()) };
+
+		quint8 version = 0;
+		in >> version;
+		if (version != WordsVersion)
+			return {};
+
+		quint32 count = 0;
+		in >> count;
+
+		QList<PageWord> words;
+		words.reserve (count);
+		for (quint32 i = 0; i < count && in.status () == QDataStream::Ok; ++i)
+		{
+			PageWord word;
+			in >> word.Text_ >> word.Rect_ >> word.HasSpaceAfter_;
+			words << word;
+		}
+
+		if (in.status () != QDataStream::Ok)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "corrupted words cache for page"
+					<< page;
+			return {};
+		}
+
+		return words;
+	}
+
+	void DocumentCache::SetPageWords (int page, const QList<PageWord>& words)
+	{
+		QByteArray data;
+		{
+			QDataStream out { &data, QIODevice::WriteOnly };
+			out << WordsVersion
+					<< static_cast<quint32> (words.size ());
+			for (const auto& word : words)
+				out << word.Text_ << word.Rect_ << word.HasSpaceAfter_;
+		}
+
+		Write (GetWordsName (page), qCompress (data));
+	}
+
+	QImage DocumentCache::GetThumbnail (int page) const
+	{
+		const auto& path = Dir_.filePath (GetThumbName (page));
+		if (!QFile::exists (path))
+			return {};
+
+		return QImage { path, "PNG" };
+	}
+
+	void DocumentCache::SetThumbnail (int page, const QImage& image)
+	{
+		QByteArray data;
+		QBuffer buffer { &data };
+		buffer.open (QIODevice::WriteOnly);
+		if (!image.save (&buffer, "PNG"))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to save thumbnail for page"
+					<< page;
+			return;
+		}
+
+		Write (GetThumbName (page), data);
+	}
+
+	void DocumentCache::Write (const QString& name, const QByteArray& data)
+	{
+		// The same page may be written by several threads at once, so
+		// each of them writes to a file of its own and then renames it.
+		const auto& tmpName = name + ".tmp" +
+				QString::number (reinterpret_cast<quintptr> (QThread::currentThreadId ()));
+		QFile file { Dir_.filePath (tmpName) };
+		if (!file.open (QIODevice::WriteOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+			return;
+		}
+
+		file.write (data);
+		file.close ();
+
+		const auto& path = Dir_.filePath (name);
+		QFile::remove (path);
+		if (!file.rename (path))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to rename"
+					<< file.fileName ()
+					<< "to"
+					<< path
+					<< file.errorString ();
+			file.remove ();
+		}
+	}
+}
+}
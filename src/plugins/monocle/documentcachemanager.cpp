@@ -0,0 +1,220 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "documentcachemanager.h"
+#include <algorithm>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFutureInterface>
+#include <QTimer>
+#include <QtConcurrentRun>
+#include <QtDebug>
+#include <util/sys/paths.h>
+#include <util/threads/futures.h>
+#include "xmlsettingsmanager.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	DocumentCacheManager::DocumentCacheManager (QObject *parent)
+	: QObject { parent }
+	, CacheDir_ { Util::GetUserDir (Util::UserDir::Cache, "monocle/pages") }
+	{
+		XmlSettingsManager::Instance ().RegisterObject ("PersistentCacheSize",
+				this, "schedulePrune");
+	}
+
+	namespace
+	{
+		const QString LastUsedName = "lastused";
+
+		/** Hashing the whole contents of a huge document would take too
+		 * long, so only its size and its first and last megabytes are
+		 * hashed. This still reads two megabytes, so it's done off the
+		 * GUI thread.
+		 */
+		QString GetDocumentId (const QString& path)
+		{
+			QFile file { path };
+			if (!file.open (QIODevice::ReadOnly))
+				return {};
+
+			const qint64 chunkSize = 1024 * 1024;
+
+			QCryptographicHash hash { QCryptographicHash::Sha1 };
+			hash.addData (QByteArray::number (file.size ()));
+			hash.addData (file.read (chunkSize));
+			if (file.size () > chunkSize)
+			{
+				file.seek (std::max (file.size () - chunkSize, chunkSize));
+				hash.addData (file.read (chunkSize));
+			}
+			return hash.result ().toHex ();
+		}
+	}
+
+	namespace
+	{
+		QString PrepareDocumentDir (const QDir& cacheDir, const QString& path)
+		{
+			const auto& id = GetDocumentId (path);
+			if (id.isEmpty ())
+				return {};
+
+			if (!cacheDir.exists (id) && !cacheDir.mkdir (id))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to create cache directory"
+						<< id
+						<< "in"
+						<< cacheDir.path ();
+				return {};
+			}
+
+			QFile lastUsed { QDir { cacheDir.filePath (id) }.filePath (LastUsedName) };
+			if (lastUsed.open (QIODevice::WriteOnly | QIODevice::Truncate))
+				lastUsed.write (QDateTime::currentDateTime ().toString (Qt::ISODate).toUtf8 ());
+
+			return id;
+		}
+	}
+
+	QFuture<DocumentCache_ptr> DocumentCacheManager::GetCache (const IDocument_ptr& doc)
+	{
+		const auto& url = doc->GetDocURL ();
+		if (!url.isLocalFile ())
+			return Util::MakeReadyFuture (DocumentCache_ptr {});
+
+		QFutureInterface<DocumentCache_ptr> iface;
+		iface.reportStarted ();
+
+		Util::Sequence (this, QtConcurrent::run (PrepareDocumentDir, CacheDir_, url.toLocalFile ())) >>
+				[this, iface] (const QString& id) mutable
+				{
+					Util::ReportFutureResult (iface, GetOpenCache (id));
+				};
+
+		return iface.future ();
+	}
+
+	DocumentCache_ptr DocumentCacheManager::GetOpenCache (const QString& id)
+	{
+		if (id.isEmpty ())
+			return {};
+
+		if (const auto& cache = OpenCaches_.value (id).lock ())
+			return cache;
+
+		const auto& cache = std::make_shared<DocumentCache> (QDir { CacheDir_.filePath (id) });
+		OpenCaches_ [id] = cache;
+
+		schedulePrune ();
+
+		return cache;
+	}
+
+	void DocumentCacheManager::schedulePrune ()
+	{
+		if (PruneScheduled_)
+			return;
+
+		PruneScheduled_ = true;
+		QTimer::singleShot (5000,
+				this,
+				SLOT (prune ()));
+	}
+
+	namespace
+	{
+		struct DocDirInfo
+		{
+			QString Name_;
+			QDateTime LastUsed_;
+			qint64 Size_;
+		};
+
+		void Prune (const QDir& cacheDir, const QStringList& openIds, qint64 maxSize)
+		{
+			QList<DocDirInfo> infos;
+			qint64 totalSize = 0;
+			for (const auto& name : cacheDir.entryList (QDir::Dirs | QDir::NoDotAndDotDot))
+			{
+				const QDir docDir { cacheDir.filePath (name) };
+
+				qint64 size = 0;
+				for (const auto& info : docDir.entryInfoList (QDir::Files))
+					size += info.size ();
+
+				infos.append ({ name, QFileInfo { docDir.filePath (LastUsedName) }.lastModified (), size });
+				totalSize += size;
+			}
+
+			if (totalSize <= maxSize)
+				return;
+
+			std::sort (infos.begin (), infos.end (),
+					[] (const DocDirInfo& left, const DocDirInfo& right)
+						{ return left.LastUsed_ < right.LastUsed_; });
+
+			for (const auto& info : infos)
+			{
+				if (totalSize <= maxSize)
+					break;
+
+				if (openIds.contains (info.Name_))
+					continue;
+
+				QDir docDir { cacheDir.filePath (info.Name_) };
+				for (const auto& file : docDir.entryList (QDir::Files))
+					docDir.remove (file);
+				cacheDir.rmdir (info.Name_);
+
+				totalSize -= info.Size_;
+			}
+		}
+	}
+
+	void DocumentCacheManager::prune ()
+	{
+		PruneScheduled_ = false;
+
+		for (auto i = OpenCaches_.begin (); i != OpenCaches_.end (); )
+			if (i->expired ())
+				i = OpenCaches_.erase (i);
+			else
+				++i;
+
+		const auto maxSize = XmlSettingsManager::Instance ()
+				.property ("PersistentCacheSize").value<qint64> () * 1024 * 1024;
+		QtConcurrent::run (Prune, CacheDir_, OpenCaches_.keys (), maxSize);
+	}
+}
+}
@@ -0,0 +1,76 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QDir>
+#include <QHash>
+#include <QFuture>
+#include "interfaces/monocle/idocument.h"
+#include "documentcache.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** Manages the on-disk caches of pages text and thumbnails.
+	 *
+	 * Caches are keyed by the hash of the document contents, so they
+	 * survive renaming and moving the documents. The overall size of the
+	 * caches is limited by the PersistentCacheSize setting, the least
+	 * recently opened documents being evicted first.
+	 */
+	class DocumentCacheManager : public QObject
+	{
+		Q_OBJECT
+
+		const QDir CacheDir_;
+
+		QHash<QString, std::weak_ptr<DocumentCache>> OpenCaches_;
+
+		bool PruneScheduled_ = false;
+	public:
+		DocumentCacheManager (QObject* = 0);
+
+		/** Returns the cache for the given document.
+		 *
+		 * The document is identified off the GUI thread, so the cache is
+		 * returned as a future. A null cache is reported for the
+		 * documents that can't be cached.
+		 */
+		QFuture<DocumentCache_ptr> GetCache (const IDocument_ptr&);
+	private:
+		DocumentCache_ptr GetOpenCache (const QString&);
+	private slots:
+		void schedulePrune ();
+		void prune ();
+	};
+}
+}
@@ -56,6 +56,7 @@
 #include <util/gui/findnotification.h>
 #include <util/sll/slotclosure.h>
 #include <util/sll/prelude.h>
+#include <util/threads/futures.h>
 #include <interfaces/imwproxy.h>
 #include <interfaces/core/irootwindowsmanager.h>
 #include <interfaces/core/iiconthememanager.h>
@@ -70,6 +71,7 @@
 #include "interfaces/monocle/iknowfileextensions.h"
 #include "interfaces/monocle/ihaveoptionalcontent.h"
 #include "core.h"
+#include "documentcachemanager.h"
 #include "pagegraphicsitem.h"
 #include "filewatcher.h"
 #include "tocwidget.h"
@@ -136,6 +138,10 @@ namespace Monocle
 				SIGNAL (navigateRequested (QString, int, double, double)),
 				this,
 				SLOT (handleNavigateRequested (QString, int, double, double)));
+		connect (SearchHandler_,
+				SIGNAL (searchFinished (QString, bool)),
+				this,
+				SLOT (handleSearchFinished (QString, bool)));
 
 		FormManager_ = new FormManager (Ui_.PagesView_, this);
 		AnnManager_ = new AnnManager (Ui_.PagesView_, this);
@@ -933,6 +939,16 @@ namespace Monocle
 		ThumbsWidget_->HandleDoc (CurrentDoc_);
 		SearchTabWidget_->HandleDoc (CurrentDoc_);
 
+		Util::Sequence (this, Core::Instance ().GetDocumentCacheManager ()->GetCache (CurrentDoc_)) >>
+				[this, document] (const DocumentCache_ptr& cache)
+				{
+					if (document != CurrentDoc_)
+						return;
+
+					SearchHandler_->SetDocumentCache (cache);
+					ThumbsWidget_->SetDocumentCache (cache);
+				};
+
 		if (const auto ihoc = qobject_cast<IHaveOptionalContent*> (docObj))
 			OptContentsWidget_->setModel (ihoc->GetOptContentModel ());
 		else
@@ -979,6 +995,11 @@ namespace Monocle
 		handlePrint ();
 	}
 
+	void DocumentTab::handleSearchFinished (const QString&, bool found)
+	{
+		FindDialog_->SetSuccessful (found);
+	}
+
 	void DocumentTab::handleThumbnailClicked (int num)
 	{
 		SetCurrentPage (num);
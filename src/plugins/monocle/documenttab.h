@@ -173,6 +173,8 @@ namespace Monocle
 		void handleNavigateRequested (QString, int, double, double);
 		void handlePrintRequested ();
 
+		void handleSearchFinished (const QString&, bool);
+
 		void handleThumbnailClicked (int);
 
 		void handlePageContentsChanged (int);
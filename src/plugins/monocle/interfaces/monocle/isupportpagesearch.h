@@ -0,0 +1,126 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QRectF>
+#include <QList>
+#include <QString>
+#include <QtPlugin>
+#include <boost/optional.hpp>
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** @brief Describes a single word on a page.
+	 *
+	 * @sa ISupportPageSearch::GetPageWords()
+	 */
+	struct PageWord
+	{
+		/** @brief The text of the word.
+		 */
+		QString Text_;
+
+		/** @brief The bounding rectangle of the word.
+		 *
+		 * The rectangle is in the same coordinates as the ones returned
+		 * by ISupportPageSearch::GetPageTextPositions().
+		 */
+		QRectF Rect_;
+
+		/** @brief Whether the word is followed by a space.
+		 */
+		bool HasSpaceAfter_;
+	};
+
+	/** @brief Interface for documents supporting searching single pages.
+	 *
+	 * This interface should be implemented by ISearchableDocument
+	 * objects that can search for text on a single page. This allows
+	 * searching huge documents in background, showing the results as
+	 * soon as they are found and cancelling the search early.
+	 *
+	 * The words returned by GetPageWords() are cached on disk along
+	 * with their positions, so that the pages that have already been
+	 * seen are searched without querying the document at all.
+	 *
+	 * The methods of this interface can be called from several threads
+	 * at once, so the implementation should be thread-safe.
+	 *
+	 * @sa ISearchableDocument
+	 */
+	class ISupportPageSearch
+	{
+	public:
+		virtual ~ISupportPageSearch () {}
+
+		/** @brief Returns the search results for the \em text on the
+		 * given \em page.
+		 *
+		 * This function should return the list of rectangles
+		 * containing the \em text on the given \em page, in the same
+		 * format as ISearchableDocument::GetTextPositions() does.
+		 *
+		 * @param[in] page The index of the page to search on.
+		 * @param[in] text The text to search for.
+		 * @param[in] cs The case sensitivity of the search.
+		 * @return The list of rectangles containing \em text on the
+		 * \em page, or an empty list if there are none.
+		 *
+		 * @sa ISearchableDocument::GetTextPositions()
+		 */
+		virtual QList<QRectF> GetPageTextPositions (int page, const QString& text, Qt::CaseSensitivity cs) = 0;
+
+		/** @brief Returns the words on the given \em page.
+		 *
+		 * The words should be returned in the reading order.
+		 *
+		 * @param[in] page The index of the page.
+		 * @return The words on the \em page, or an empty optional if
+		 * the text couldn't be extracted.
+		 */
+		virtual boost::optional<QList<PageWord>> GetPageWords (int page) = 0;
+
+		/** @brief Releases the resources allocated for searching.
+		 *
+		 * This function is called when a search is finished or
+		 * cancelled. The document may free any per-search state like
+		 * cached copies of itself here. Calls to other methods of this
+		 * interface that are still running at that moment should
+		 * still complete correctly.
+		 */
+		virtual void ReleaseSearchResources () = 0;
+	};
+}
+}
+
+Q_DECLARE_INTERFACE (LeechCraft::Monocle::ISupportPageSearch,
+		"org.LeechCraft.Monocle.ISupportPageSearch/1.0")
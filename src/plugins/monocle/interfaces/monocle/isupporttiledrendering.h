@@ -0,0 +1,82 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QImage>
+
+class QRect;
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** @brief Interface for documents supporting rendering parts of pages.
+	 *
+	 * This interface should be implemented by IDocument objects that
+	 * can render a rectangular part of a page without rendering the
+	 * whole page. This allows rendering huge pages at high zoom levels
+	 * in small tiles, only rendering the parts that are actually visible.
+	 *
+	 * If the backend plugin is threaded (see IBackendPlugin::IsThreaded()),
+	 * this method may be called from several threads at once, just like
+	 * IDocument::RenderPage().
+	 *
+	 * @sa IDocument
+	 */
+	class ISupportTiledRendering
+	{
+	public:
+		virtual ~ISupportTiledRendering () {}
+
+		/** @brief Renders the given \em tile of the given \em page.
+		 *
+		 * The \em tile is given in the coordinates of the page scaled by
+		 * \em xScale and \em yScale, so the returned image should be of
+		 * the size of the \em tile. That is, the result should be equal
+		 * to the following:
+		 * \code
+			RenderPage (page, xScale, yScale).copy (tile);
+		   \endcode
+		 *
+		 * @param[in] page The index of the page to render.
+		 * @param[in] xScale The scale of the <em>x</em> axis.
+		 * @param[in] yScale The scale of the <em>y</em> axis.
+		 * @param[in] tile The part of the scaled page to render.
+		 * @return The rendering of the given part of the page.
+		 *
+		 * @sa IDocument::RenderPage()
+		 */
+		virtual QImage RenderPageTile (int page, double xScale, double yScale, const QRect& tile) = 0;
+	};
+}
+}
+
+Q_DECLARE_INTERFACE (LeechCraft::Monocle::ISupportTiledRendering,
+		"org.LeechCraft.Monocle.ISupportTiledRendering/1.0")
@@ -29,10 +29,11 @@
 
 #include "pagegraphicsitem.h"
 #include <limits>
+#include <algorithm>
 #include <cmath>
 #include <QtDebug>
-#include <QtConcurrentRun>
-#include <QFutureWatcher>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
 #include <QGraphicsSceneMouseEvent>
 #include <QCursor>
 #include <QApplication>
@@ -40,6 +41,8 @@
 #include <QGraphicsView>
 #include <QMenu>
 #include <QWidgetAction>
+#include "interfaces/monocle/ibackendplugin.h"
+#include "interfaces/monocle/isupporttiledrendering.h"
 #include "core.h"
 #include "pixmapcachemanager.h"
 #include "arbitraryrotationwidget.h"
@@ -49,23 +52,39 @@ namespace LeechCraft
 {
 namespace Monocle
 {
+	namespace
+	{
+		const int TileSize = 512;
+
+		/** Pages smaller than this (in pixels) are rendered as a whole.
+		 */
+		const int MaxSingleTileArea = 1024 * 1024;
+
+		/** Maximum area (in pixels) of a neighbouring page that is
+		 * prefetched.
+		 */
+		const int MaxPrefetchArea = 2048 * 2048;
+	}
+
 	PageGraphicsItem::PageGraphicsItem (IDocument_ptr doc, int page, QGraphicsItem *parent)
 	: QGraphicsPixmapItem (parent)
 	, Doc_ (doc)
 	, PageNum_ (page)
+	, Threaded_ (qobject_cast<IBackendPlugin*> (Doc_->GetBackendPlugin ())->IsThreaded ())
+	, TiledRendering_ (qobject_cast<ISupportTiledRendering*> (Doc_->GetQObject ()))
 	{
 		setTransformationMode (Qt::SmoothTransformation);
 		setShapeMode (QGraphicsPixmapItem::BoundingRectShape);
-		setPixmap (QPixmap (Doc_->GetPageSize (page)));
+		setFlag (QGraphicsItem::ItemUsesExtendedStyleOption);
 		setAcceptHoverEvents (true);
+
+		Core::Instance ().GetPixmapCacheManager ()->PixmapCreated (this);
 	}
 
 	PageGraphicsItem::~PageGraphicsItem ()
 	{
+		Core::Instance ().GetRenderScheduler ()->Cancel (this);
 		Core::Instance ().GetPixmapCacheManager ()->PixmapDeleted (this);
-
-		if (RenderFuture_)
-			RenderFuture_->waitForFinished ();
 	}
 
 	void PageGraphicsItem::SetLayoutManager (PagesLayoutManager *manager)
@@ -78,17 +97,22 @@ namespace Monocle
 		ReleaseHandler_ = handler;
 	}
 
+	void PageGraphicsItem::SetThumbnailCache (const DocumentCache_ptr& cache)
+	{
+		ThumbnailCache_ = cache;
+	}
+
 	void PageGraphicsItem::SetScale (double xs, double ys)
 	{
 		if (std::abs (xs - XScale_) < std::numeric_limits<double>::epsilon () &&
 			std::abs (ys - YScale_) < std::numeric_limits<double>::epsilon ())
 			return;
 
+		InvalidateTiles ();
+
 		XScale_ = xs;
 		YScale_ = ys;
 
-		Invalid_ = true;
-
 		if (IsDisplayed ())
 			update ();
 		else
@@ -103,6 +127,11 @@ namespace Monocle
 		return PageNum_;
 	}
 
+	const IDocument_ptr& PageGraphicsItem::GetDocument () const
+	{
+		return Doc_;
+	}
+
 	QRectF PageGraphicsItem::MapFromDoc (const QRectF& rect) const
 	{
 		return
@@ -139,43 +168,137 @@ namespace Monocle
 
 	void PageGraphicsItem::ClearPixmap ()
 	{
-		setPixmap (QPixmap { QSize { 1, 1 } });
+		Core::Instance ().GetRenderScheduler ()->Cancel (this);
 
-		Invalid_ = true;
+		Tiles_.clear ();
+		PendingTiles_.clear ();
+		StaleTiles_.clear ();
 	}
 
 	void PageGraphicsItem::UpdatePixmap ()
 	{
-		Invalid_ = true;
+		InvalidateTiles ();
 		if (IsDisplayed ())
 			update ();
 	}
 
+	quint64 PageGraphicsItem::GetCachedSize () const
+	{
+		auto getSize = [] (const QPixmap& px) -> quint64
+				{ return px.isNull () ? 0 : px.width () * px.height () * px.depth () / 8; };
+
+		quint64 result = 0;
+		for (const auto& tile : Tiles_)
+			result += getSize (tile.Pixmap_);
+		for (const auto& tile : StaleTiles_)
+			result += getSize (tile.Pixmap_);
+		return result;
+	}
+
+	void PageGraphicsItem::HandleTileRendered (const TileIndex_t& idx,
+			double xScale, double yScale, const QImage& image)
+	{
+		if (std::abs (xScale - XScale_) > std::numeric_limits<double>::epsilon () * XScale_ ||
+			std::abs (yScale - YScale_) > std::numeric_limits<double>::epsilon () * YScale_)
+			return;
+
+		if (!PendingTiles_.remove (idx))
+			return;
+
+		const auto& rect = GetTileRect (idx);
+		Tiles_ [idx] = { rect, QPixmap::fromImage (image) };
+
+		if (PendingTiles_.isEmpty ())
+			StaleTiles_.clear ();
+
+		update (rect.translated (offset ().toPoint ()));
+
+		Core::Instance ().GetPixmapCacheManager ()->PixmapChanged (this);
+	}
+
+	void PageGraphicsItem::HandleTileCancelled (const TileIndex_t& idx)
+	{
+		if (!PendingTiles_.remove (idx) ||
+				!PendingTiles_.isEmpty () ||
+				StaleTiles_.isEmpty ())
+			return;
+
+		StaleTiles_.clear ();
+
+		update ();
+
+		Core::Instance ().GetPixmapCacheManager ()->PixmapChanged (this);
+	}
+
 	void PageGraphicsItem::paint (QPainter *painter,
-			const QStyleOptionGraphicsItem *option, QWidget *w)
+			const QStyleOptionGraphicsItem *option, QWidget*)
 	{
-		if (Invalid_ && IsDisplayed ())
+		const auto& exposed = option->exposedRect.intersected (boundingRect ())
+				.translated (-offset ()).toAlignedRect ();
+		if (exposed.isEmpty ())
+			return;
+
+		painter->save ();
+		painter->translate (offset ());
+		painter->fillRect (exposed, Qt::white);
+
+		if (!StaleTiles_.isEmpty ())
 		{
-			auto backendObj = Doc_->GetBackendPlugin ();
-			if (qobject_cast<IBackendPlugin*> (backendObj)->IsThreaded ())
+			const auto staleXScale = XScale_ / StaleXScale_;
+			const auto staleYScale = YScale_ / StaleYScale_;
+			const QRectF staleExposed
 			{
-				if (!RenderFuture_)
-					RequestThreadedRender ();
+				exposed.x () / staleXScale,
+				exposed.y () / staleYScale,
+				exposed.width () / staleXScale,
+				exposed.height () / staleYScale
+			};
+
+			painter->save ();
+			painter->setRenderHint (QPainter::SmoothPixmapTransform);
+			painter->scale (staleXScale, staleYScale);
+			for (const auto& tile : StaleTiles_)
+				if (staleExposed.intersects (tile.Rect_))
+					painter->drawPixmap (tile.Rect_.topLeft (), tile.Pixmap_);
+			painter->restore ();
+		}
 
-				setPixmap (GetEmptyPixmap (true));
-			}
-			else
+		bool complete = true;
+		QList<TileIndex_t> missing;
+		for (const auto& idx : GetTiles (exposed))
+		{
+			const auto pos = Tiles_.find (idx);
+			if (pos != Tiles_.end ())
 			{
-				const auto& img = Doc_->RenderPage (PageNum_, XScale_, YScale_);
-				setPixmap (QPixmap::fromImage (img));
+				painter->drawPixmap (pos->Rect_.topLeft (), pos->Pixmap_);
+				continue;
 			}
-			Invalid_ = false;
 
-			Core::Instance ().GetPixmapCacheManager ()->PixmapChanged (this);
+			complete = false;
+			if (!PendingTiles_.contains (idx))
+				missing << idx;
+		}
+
+		painter->restore ();
+
+		if (!missing.isEmpty ())
+		{
+			// The scheduler renders the most recently requested tiles
+			// first, so the tiles closest to the exposed area center
+			// should go last.
+			const auto& center = exposed.center ();
+			auto dist = [this, &center] (const TileIndex_t& idx)
+					{ return (GetTileRect (idx).center () - center).manhattanLength (); };
+			std::sort (missing.begin (), missing.end (),
+					[&dist] (const TileIndex_t& left, const TileIndex_t& right)
+						{ return dist (left) > dist (right); });
+
+			RequestTiles (missing, RenderScheduler::Priority::Visible, nullptr);
 		}
 
-		QGraphicsPixmapItem::paint (painter, option, w);
-		Core::Instance ().GetPixmapCacheManager ()->PixmapPainted (this);
+		Core::Instance ().GetPixmapCacheManager ()->PixmapPainted (this, complete);
+
+		PrefetchNeighbours ();
 	}
 
 	void PageGraphicsItem::mousePressEvent (QGraphicsSceneMouseEvent *event)
@@ -227,42 +350,129 @@ namespace Monocle
 		rotateMenu.exec (event->screenPos ());
 	}
 
-	QPixmap PageGraphicsItem::GetEmptyPixmap (bool fill) const
+	QSize PageGraphicsItem::GetScaledSize () const
 	{
 		auto size = Doc_->GetPageSize (PageNum_);
 		size.rwidth () *= XScale_;
 		size.rheight () *= YScale_;
-		QPixmap px { size };
-		if (fill)
-			px.fill ();
-		return px;
-	}
-
-	void PageGraphicsItem::RequestThreadedRender ()
-	{
-		RenderFuture_.reset (new QFutureWatcher<RenderInfo>,
-				[this] (QFutureWatcher<RenderInfo> *watcher)
-				{
-					disconnect (watcher, 0, this, 0);
-					watcher->deleteLater ();
-				});
-		connect (RenderFuture_.get (),
-				SIGNAL (finished ()),
-				this,
-				SLOT (handlePixmapRendered ()));
-
-		// C++14
-		auto xscale = XScale_;
-		auto yscale = YScale_;
-		RenderFuture_->setFuture (QtConcurrent::run ([this, xscale, yscale]
-				{
-					return RenderInfo
-					{
-						Doc_->RenderPage (PageNum_, yscale, yscale),
-						xscale,
-						yscale
-					};
-				}));
+		return size;
+	}
+
+	bool PageGraphicsItem::IsTiled () const
+	{
+		if (!TiledRendering_)
+			return false;
+
+		const auto& size = GetScaledSize ();
+		return size.width () * size.height () > MaxSingleTileArea;
+	}
+
+	QList<PageGraphicsItem::TileIndex_t> PageGraphicsItem::GetTiles (const QRect& area) const
+	{
+		const auto& rect = area.intersected ({ {}, GetScaledSize () });
+		if (rect.isEmpty ())
+			return {};
+
+		if (!IsTiled ())
+			return { qMakePair (0, 0) };
+
+		QList<TileIndex_t> result;
+		for (int row = rect.top () / TileSize; row <= rect.bottom () / TileSize; ++row)
+			for (int col = rect.left () / TileSize; col <= rect.right () / TileSize; ++col)
+				result << qMakePair (col, row);
+		return result;
+	}
+
+	QRect PageGraphicsItem::GetTileRect (const TileIndex_t& idx) const
+	{
+		const QRect pageRect { {}, GetScaledSize () };
+		if (!IsTiled ())
+			return pageRect;
+
+		return QRect { idx.first * TileSize, idx.second * TileSize, TileSize, TileSize }
+				.intersected (pageRect);
+	}
+
+	void PageGraphicsItem::InvalidateTiles ()
+	{
+		Core::Instance ().GetRenderScheduler ()->Cancel (this);
+		PendingTiles_.clear ();
+
+		if (Tiles_.isEmpty ())
+			return;
+
+		StaleTiles_ = Tiles_.values ();
+		StaleXScale_ = XScale_;
+		StaleYScale_ = YScale_;
+		Tiles_.clear ();
+	}
+
+	void PageGraphicsItem::RequestTiles (const QList<TileIndex_t>& tiles,
+			RenderScheduler::Priority priority, PageGraphicsItem *requester)
+	{
+		const auto scheduler = Core::Instance ().GetRenderScheduler ();
+		const auto& cache = IsTiled () ? DocumentCache_ptr {} : ThumbnailCache_;
+		for (const auto& idx : tiles)
+		{
+			PendingTiles_ << idx;
+			scheduler->Request ({
+						this,
+						requester,
+						Doc_,
+						PageNum_,
+						idx,
+						GetTileRect (idx),
+						XScale_,
+						YScale_,
+						Threaded_,
+						cache
+					},
+					priority);
+		}
+	}
+
+	void PageGraphicsItem::PrefetchNeighbours ()
+	{
+		if (!LayoutManager_)
+			return;
+
+		const auto& pages = LayoutManager_->GetPages ();
+		if (const auto next = pages.value (PageNum_ + 1))
+			next->Prefetch (true, this);
+		if (const auto prev = pages.value (PageNum_ - 1))
+			prev->Prefetch (false, this);
+	}
+
+	void PageGraphicsItem::Prefetch (bool fromTop, PageGraphicsItem *requester)
+	{
+		if (IsDisplayed ())
+			return;
+
+		const auto& size = GetScaledSize ();
+		if (size.isEmpty ())
+			return;
+
+		QRect rect { {}, size };
+		if (size.width () * size.height () > MaxPrefetchArea)
+		{
+			if (!IsTiled ())
+				return;
+
+			const auto height = std::max (MaxPrefetchArea / size.width (), TileSize);
+			rect.setHeight (height);
+			if (!fromTop)
+				rect.moveBottom (size.height () - 1);
+		}
+
+		QList<TileIndex_t> missing;
+		for (const auto& idx : GetTiles (rect))
+			if (!Tiles_.contains (idx) && !PendingTiles_.contains (idx))
+				missing << idx;
+
+		if (!fromTop)
+			std::reverse (missing.begin (), missing.end ());
+
+		RequestTiles (missing, RenderScheduler::Priority::Prefetch, requester);
 	}
 
 	bool PageGraphicsItem::IsDisplayed () const
@@ -283,10 +493,7 @@ namespace Monocle
 
 	QRectF PageGraphicsItem::boundingRect () const
 	{
-		auto size = Doc_->GetPageSize (PageNum_);
-		size.rwidth () *= XScale_;
-		size.rheight () *= YScale_;
-		return QRectF { offset (), size };
+		return QRectF { offset (), GetScaledSize () };
 	}
 
 	QPainterPath PageGraphicsItem::shape () const
@@ -321,25 +528,5 @@ namespace Monocle
 
 		ArbWidget_->setValue (rotation + LayoutManager_->GetRotation ());
 	}
-
-	void PageGraphicsItem::handlePixmapRendered ()
-	{
-		if (sender () != RenderFuture_.get ())
-			return;
-
-		const auto& result = RenderFuture_->result ();
-		RenderFuture_.reset ();
-
-		setPixmap (QPixmap::fromImage (result.Result_));
-
-		if (std::abs (result.XScale_ - XScale_) > std::numeric_limits<double>::epsilon () * XScale_ ||
-			std::abs (result.YScale_ - YScale_) > std::numeric_limits<double>::epsilon () * YScale_)
-		{
-			UpdatePixmap ();
-			return;
-		}
-
-		Core::Instance ().GetPixmapCacheManager ()->PixmapChanged (this);
-	}
 }
 }
@@ -33,10 +33,10 @@
 #include <memory>
 #include <QGraphicsPixmapItem>
 #include <QPointer>
+#include <QHash>
+#include <QSet>
 #include "interfaces/monocle/idocument.h"
-
-template<typename T>
-class QFutureWatcher;
+#include "renderscheduler.h"
 
 namespace LeechCraft
 {
@@ -53,24 +53,33 @@ namespace Monocle
 		IDocument_ptr Doc_;
 		const int PageNum_;
 
+		const bool Threaded_;
+		const bool TiledRendering_;
+
 		qreal XScale_ = 1;
 		qreal YScale_ = 1;
 
-		bool Invalid_ = true;
-
 		std::function<void (int, QPointF)> ReleaseHandler_;
 
 		PagesLayoutManager *LayoutManager_ = nullptr;
 
 		QPointer<ArbitraryRotationWidget> ArbWidget_;
 
-		struct RenderInfo
+		DocumentCache_ptr ThumbnailCache_;
+
+		typedef RenderScheduler::TileIndex_t TileIndex_t;
+
+		struct Tile
 		{
-			QImage Result_;
-			double XScale_;
-			double YScale_;
+			QRect Rect_;
+			QPixmap Pixmap_;
 		};
-		std::shared_ptr<QFutureWatcher<RenderInfo>> RenderFuture_;
+		QHash<TileIndex_t, Tile> Tiles_;
+		QSet<TileIndex_t> PendingTiles_;
+
+		QList<Tile> StaleTiles_;
+		qreal StaleXScale_ = 1;
+		qreal StaleYScale_ = 1;
 	public:
 		typedef std::function<void (QRectF)> RectSetter_f;
 	private:
@@ -88,8 +97,11 @@ namespace Monocle
 
 		void SetReleaseHandler (std::function<void (int, QPointF)>);
 
+		void SetThumbnailCache (const DocumentCache_ptr&);
+
 		void SetScale (double, double);
 		int GetPageNum () const;
+		const IDocument_ptr& GetDocument () const;
 
 		QRectF MapFromDoc (const QRectF&) const;
 		QRectF MapToDoc (const QRectF&) const;
@@ -100,6 +112,11 @@ namespace Monocle
 		void ClearPixmap ();
 		void UpdatePixmap ();
 
+		quint64 GetCachedSize () const;
+
+		void HandleTileRendered (const TileIndex_t&, double, double, const QImage&);
+		void HandleTileCancelled (const TileIndex_t&);
+
 		bool IsDisplayed () const;
 
 		QRectF boundingRect () const;
@@ -110,16 +127,21 @@ namespace Monocle
 		void mouseReleaseEvent (QGraphicsSceneMouseEvent*);
 		void contextMenuEvent (QGraphicsSceneContextMenuEvent*);
 	private:
-		QPixmap GetEmptyPixmap (bool fill) const;
-		void RequestThreadedRender ();
+		QSize GetScaledSize () const;
+		bool IsTiled () const;
+		QList<TileIndex_t> GetTiles (const QRect&) const;
+		QRect GetTileRect (const TileIndex_t&) const;
+
+		void InvalidateTiles ();
+		void RequestTiles (const QList<TileIndex_t>&, RenderScheduler::Priority, PageGraphicsItem*);
+		void PrefetchNeighbours ();
+		void Prefetch (bool fromTop, PageGraphicsItem*);
 	private slots:
 		void rotateCCW ();
 		void rotateCW ();
 		void requestRotation (double);
 
 		void updateRotation (double, int);
-
-		void handlePixmapRendered ();
 	signals:
 		void rotateRequested (double);
 	};
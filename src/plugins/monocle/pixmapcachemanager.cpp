@@ -28,7 +28,7 @@
  **********************************************************************/
 
 #include "pixmapcachemanager.h"
-#include <numeric>
+#include <iterator>
 #include <QtDebug>
 #include "xmlsettingsmanager.h"
 #include "pagegraphicsitem.h"
@@ -40,61 +40,125 @@ namespace Monocle
 	PixmapCacheManager::PixmapCacheManager (QObject *parent)
 	: QObject (parent)
 	{
-		XmlSettingsManager::Instance ().RegisterObject ("PixmapCacheSize",
+		XmlSettingsManager::Instance ().RegisterObject ({ "PixmapCacheSize", "PixmapCacheDocSize" },
 				this, "handleCacheSizeChanged");
 		handleCacheSizeChanged ();
 	}
 
-	namespace
+	void PixmapCacheManager::PixmapCreated (PageGraphicsItem *item)
 	{
-		quint64 GetPixmapSize (const QPixmap& px)
-		{
-			if (px.isNull ())
-				return 0;
-
-			return px.width () * px.height () * px.defaultDepth () / 8 * 1.5;
-		}
+		++Docs_ [item->GetDocument ().get ()].PagesCount_;
 	}
 
-	void PixmapCacheManager::PixmapPainted (PageGraphicsItem *item)
+	void PixmapCacheManager::PixmapPainted (PageGraphicsItem *item, bool hit)
 	{
-		RecentlyUsed_.removeAll (item);
-		RecentlyUsed_ << item;
+		auto& doc = Docs_ [item->GetDocument ().get ()];
+		++(hit ? doc.Hits_ : doc.Misses_);
+
+		const auto pos = Entries_.find (item);
+		if (pos != Entries_.end ())
+			Touch (*pos);
 	}
 
 	void PixmapCacheManager::PixmapChanged (PageGraphicsItem *item)
 	{
-		if (RecentlyUsed_.removeAll (item))
-			CurrentSize_ = std::accumulate (RecentlyUsed_.begin (), RecentlyUsed_.end (), 0,
-					[] (qint64 size, const PageGraphicsItem *item)
-						{ return size + GetPixmapSize (item->pixmap ()); });
+		const auto size = item->GetCachedSize ();
+		const auto docPtr = item->GetDocument ().get ();
+		auto& doc = Docs_ [docPtr];
+
+		auto pos = Entries_.find (item);
+		if (pos == Entries_.end ())
+		{
+			if (!size)
+				return;
+
+			RecentlyUsed_.push_back (item);
+			doc.LRU_.push_back (item);
+			pos = Entries_.insert (item,
+					{ std::prev (RecentlyUsed_.end ()), std::prev (doc.LRU_.end ()), docPtr, 0 });
+		}
+		else
+			Touch (*pos);
 
-		RecentlyUsed_ << item;
-		CurrentSize_ += GetPixmapSize (item->pixmap ());
+		CurrentSize_ += size - pos->Size_;
+		doc.Size_ += size - pos->Size_;
+		pos->Size_ = size;
+
+		CheckDocCache (docPtr);
 		CheckCache ();
 	}
 
 	void PixmapCacheManager::PixmapDeleted (PageGraphicsItem *item)
 	{
-		CurrentSize_ -= GetPixmapSize (item->pixmap ());
-		RecentlyUsed_.removeAll (item);
+		Remove (item);
+
+		const auto docPtr = item->GetDocument ().get ();
+		const auto docPos = Docs_.find (docPtr);
+		if (docPos == Docs_.end () || --docPos->PagesCount_ > 0)
+			return;
+
+		qDebug () << Q_FUNC_INFO
+				<< "pixmap cache stats for"
+				<< docPtr
+				<< ": hits:"
+				<< docPos->Hits_
+				<< "; misses:"
+				<< docPos->Misses_
+				<< "; evictions:"
+				<< docPos->Evictions_;
+
+		Docs_.erase (docPos);
+	}
+
+	void PixmapCacheManager::Touch (const Entry& entry)
+	{
+		RecentlyUsed_.splice (RecentlyUsed_.end (), RecentlyUsed_, entry.GlobalPos_);
+
+		auto& docLRU = Docs_ [entry.Doc_].LRU_;
+		docLRU.splice (docLRU.end (), docLRU, entry.DocPos_);
+	}
+
+	void PixmapCacheManager::Evict (PageGraphicsItem *page)
+	{
+		Remove (page);
+		++Docs_ [page->GetDocument ().get ()].Evictions_;
+		page->ClearPixmap ();
+	}
+
+	void PixmapCacheManager::Remove (PageGraphicsItem *page)
+	{
+		const auto pos = Entries_.find (page);
+		if (pos == Entries_.end ())
+			return;
+
+		auto& doc = Docs_ [pos->Doc_];
+		CurrentSize_ -= pos->Size_;
+		doc.Size_ -= pos->Size_;
+
+		RecentlyUsed_.erase (pos->GlobalPos_);
+		doc.LRU_.erase (pos->DocPos_);
+
+		Entries_.erase (pos);
+	}
+
+	void PixmapCacheManager::CheckDocCache (IDocument *docPtr)
+	{
+		const auto& doc = Docs_ [docPtr];
+		for (auto i = doc.LRU_.begin (); i != doc.LRU_.end () && MaxDocSize_ < doc.Size_; )
+		{
+			const auto page = *i++;
+			if (!page->IsDisplayed ())
+				Evict (page);
+		}
 	}
 
 	void PixmapCacheManager::CheckCache ()
 	{
 		for (auto i = RecentlyUsed_.begin (); i != RecentlyUsed_.end () && MaxSize_ < CurrentSize_; )
 		{
-			const auto page = *i;
-			if (page->IsDisplayed ())
-			{
-				++i;
-				continue;
-			}
-
-			const quint64 pxSize = GetPixmapSize (page->pixmap ());
-			CurrentSize_ -= pxSize;
-			page->ClearPixmap ();
-			i = RecentlyUsed_.erase (i);
+			const auto page = *i++;
+			if (!page->IsDisplayed ())
+				Evict (page);
 		}
 
 		if (MaxSize_ < CurrentSize_)
@@ -104,14 +168,18 @@ namespace Monocle
 					<< "instead of"
 					<< MaxSize_
 					<< "for"
-					<< RecentlyUsed_.size ()
+					<< Entries_.size ()
 					<< "pages";
 	}
 
 	void PixmapCacheManager::handleCacheSizeChanged ()
 	{
-		MaxSize_ = XmlSettingsManager::Instance ().property ("PixmapCacheSize").value<qint64> () * 1024 * 1024;
+		const auto& xsm = XmlSettingsManager::Instance ();
+		MaxSize_ = xsm.property ("PixmapCacheSize").value<quint64> () * 1024 * 1024;
+		MaxDocSize_ = xsm.property ("PixmapCacheDocSize").value<quint64> () * 1024 * 1024;
 
+		for (const auto doc : Docs_.keys ())
+			CheckDocCache (doc);
 		CheckCache ();
 	}
 }
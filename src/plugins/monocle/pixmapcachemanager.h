@@ -29,28 +29,65 @@
 
 #pragma once
 
+#include <list>
 #include <QObject>
+#include <QHash>
 
 namespace LeechCraft
 {
 namespace Monocle
 {
+	class IDocument;
 	class PageGraphicsItem;
 
 	class PixmapCacheManager : public QObject
 	{
 		Q_OBJECT
 
-		qint64 CurrentSize_ = 0;
-		qint64 MaxSize_ = 0;
-		QList<PageGraphicsItem*> RecentlyUsed_;
+		typedef std::list<PageGraphicsItem*> LRUList_t;
+
+		struct DocInfo
+		{
+			LRUList_t LRU_;
+			quint64 Size_ = 0;
+
+			int PagesCount_ = 0;
+
+			quint64 Hits_ = 0;
+			quint64 Misses_ = 0;
+			quint64 Evictions_ = 0;
+		};
+		QHash<IDocument*, DocInfo> Docs_;
+
+		struct Entry
+		{
+			LRUList_t::iterator GlobalPos_;
+			LRUList_t::iterator DocPos_;
+			IDocument *Doc_;
+			quint64 Size_;
+		};
+		QHash<PageGraphicsItem*, Entry> Entries_;
+
+		/** Least recently used pages go first.
+		 */
+		LRUList_t RecentlyUsed_;
+
+		quint64 CurrentSize_ = 0;
+		quint64 MaxSize_ = 0;
+		quint64 MaxDocSize_ = 0;
 	public:
 		PixmapCacheManager (QObject* = 0);
 
-		void PixmapPainted (PageGraphicsItem*);
+		void PixmapCreated (PageGraphicsItem*);
+		void PixmapPainted (PageGraphicsItem*, bool hit);
 		void PixmapChanged (PageGraphicsItem*);
 		void PixmapDeleted (PageGraphicsItem*);
 	private:
+		void Touch (const Entry&);
+		void Evict (PageGraphicsItem*);
+		void Remove (PageGraphicsItem*);
+
+		void CheckDocCache (IDocument*);
 		void CheckCache ();
 	private slots:
 		void handleCacheSizeChanged ();
@@ -244,6 +244,16 @@ namespace PDF
 		page->renderToPainter (painter, 72 * xScale, 72 * yScale);
 	}
 
+	QImage Document::RenderPageTile (int num, double xScale, double yScale, const QRect& tile)
+	{
+		std::unique_ptr<Poppler::Page> page (PDocument_->page (num));
+		if (!page)
+			return QImage ();
+
+		return page->renderToImage (72 * xScale, 72 * yScale,
+				tile.x (), tile.y (), tile.width (), tile.height ());
+	}
+
 	QMap<int, QList<QRectF>> Document::GetTextPositions (const QString& text, Qt::CaseSensitivity cs)
 	{
 		typedef QMap<int, QList<QRectF>> Result_t;
@@ -290,6 +300,56 @@ namespace PDF
 		return result;
 	}
 
+	QList<QRectF> Document::GetPageTextPositions (int num, const QString& text, Qt::CaseSensitivity cs)
+	{
+#if POPPLER_VERSION_MAJOR > 0 || POPPLER_VERSION_MINOR >= 22
+	#if POPPLER_VERSION_MAJOR > 0 || POPPLER_VERSION_MINOR >= 31
+		Poppler::Page::SearchFlags searchFlags;
+		if (cs != Qt::CaseSensitive)
+			searchFlags |= Poppler::Page::SearchFlag::IgnoreCase;
+	#else
+		const auto searchFlags = cs == Qt::CaseSensitive ?
+						Poppler::Page::CaseSensitive :
+						Poppler::Page::CaseInsensitive;
+	#endif
+
+		const auto& doc = AcquireSearchDoc ();
+		if (!doc.Doc_)
+			return {};
+
+		const auto guard = Util::MakeScopeGuard ([this, doc] { ReleaseSearchDoc (doc); });
+
+		std::unique_ptr<Poppler::Page> page (doc.Doc_->page (num));
+		if (!page)
+			return {};
+
+		return page->search (text, searchFlags);
+#else
+		return {};
+#endif
+	}
+
+	boost::optional<QList<PageWord>> Document::GetPageWords (int num)
+	{
+		const auto& doc = AcquireSearchDoc ();
+		if (!doc.Doc_)
+			return {};
+
+		const auto guard = Util::MakeScopeGuard ([this, doc] { ReleaseSearchDoc (doc); });
+
+		std::unique_ptr<Poppler::Page> page (doc.Doc_->page (num));
+		if (!page)
+			return {};
+
+		QList<PageWord> result;
+		for (const auto box : page->textList ())
+		{
+			std::unique_ptr<Poppler::TextBox> boxGuard { box };
+			result << PageWord { box->text (), box->boundingBox (), box->hasSpaceAfter () };
+		}
+		return result;
+	}
+
 	auto Document::CanSave () const -> SaveQueryResult
 	{
 		if (PDocument_->isEncrypted ())
@@ -396,6 +456,37 @@ namespace PDF
 			return;
 		TOC_ = BuildTOCLevel (this, PDocument_, *doc);
 	}
+
+	void Document::ReleaseSearchResources ()
+	{
+		QMutexLocker locker { &SearchDocsLock_ };
+		SearchDocs_.clear ();
+		++SearchDocsGeneration_;
+	}
+
+	// Poppler documents can't be searched from several threads at once,
+	// so each concurrent search gets a document of its own. The copies
+	// are kept until ReleaseSearchResources() is called, and the ones
+	// acquired before that aren't returned to the pool.
+	auto Document::AcquireSearchDoc () -> SearchDoc
+	{
+		int generation = 0;
+		{
+			QMutexLocker locker { &SearchDocsLock_ };
+			generation = SearchDocsGeneration_;
+			if (!SearchDocs_.isEmpty ())
+				return { SearchDocs_.takeLast (), generation };
+		}
+
+		return { PDocument_ptr { Poppler::Document::load (DocURL_.toLocalFile ()) }, generation };
+	}
+
+	void Document::ReleaseSearchDoc (const SearchDoc& doc)
+	{
+		QMutexLocker locker { &SearchDocsLock_ };
+		if (doc.Generation_ == SearchDocsGeneration_)
+			SearchDocs_ << doc.Doc_;
+	}
 }
 }
 }
@@ -31,6 +31,7 @@
 
 #include <memory>
 #include <QObject>
+#include <QMutex>
 #include <QUrl>
 #include <interfaces/monocle/idocument.h>
 #include <interfaces/monocle/ihavetoc.h>
@@ -39,8 +40,10 @@
 #include <interfaces/monocle/isupportannotations.h>
 #include <interfaces/monocle/isupportforms.h>
 #include <interfaces/monocle/isearchabledocument.h>
+#include <interfaces/monocle/isupportpagesearch.h>
 #include <interfaces/monocle/isaveabledocument.h>
 #include <interfaces/monocle/isupportpainting.h>
+#include <interfaces/monocle/isupporttiledrendering.h>
 #include <interfaces/monocle/ihaveoptionalcontent.h>
 
 namespace Poppler
@@ -65,7 +68,9 @@ namespace PDF
 				   , public ISupportAnnotations
 				   , public ISupportForms
 				   , public ISupportPainting
+				   , public ISupportTiledRendering
 				   , public ISearchableDocument
+				   , public ISupportPageSearch
 				   , public ISaveableDocument
 	{
 		Q_OBJECT
@@ -77,7 +82,9 @@ namespace PDF
 				LeechCraft::Monocle::ISupportAnnotations
 				LeechCraft::Monocle::ISupportForms
 				LeechCraft::Monocle::ISupportPainting
+				LeechCraft::Monocle::ISupportTiledRendering
 				LeechCraft::Monocle::ISearchableDocument
+				LeechCraft::Monocle::ISupportPageSearch
 				LeechCraft::Monocle::ISaveableDocument)
 
 		PDocument_ptr PDocument_;
@@ -85,6 +92,16 @@ namespace PDF
 		QUrl DocURL_;
 
 		QObject *Plugin_;
+
+		struct SearchDoc
+		{
+			PDocument_ptr Doc_;
+			int Generation_;
+		};
+
+		QMutex SearchDocsLock_;
+		QList<PDocument_ptr> SearchDocs_;
+		int SearchDocsGeneration_ = 0;
 	public:
 		Document (const QString&, QObject*);
 
@@ -112,8 +129,14 @@ namespace PDF
 
 		void PaintPage (QPainter*, int, double, double);
 
+		QImage RenderPageTile (int, double, double, const QRect&);
+
 		QMap<int, QList<QRectF>> GetTextPositions (const QString&, Qt::CaseSensitivity);
 
+		QList<QRectF> GetPageTextPositions (int, const QString&, Qt::CaseSensitivity);
+		boost::optional<QList<PageWord>> GetPageWords (int);
+		void ReleaseSearchResources ();
+
 		SaveQueryResult CanSave () const;
 		bool Save (const QString& path);
 
@@ -121,6 +144,9 @@ namespace PDF
 		void RequestPrinting ();
 	private:
 		void BuildTOC ();
+
+		SearchDoc AcquireSearchDoc ();
+		void ReleaseSearchDoc (const SearchDoc&);
 	signals:
 		void navigateRequested (const QString&, int, double, double);
 		void printRequested (const QList<int>&);
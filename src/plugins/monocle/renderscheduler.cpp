@@ -0,0 +1,220 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "renderscheduler.h"
+#include <algorithm>
+#include <QTimer>
+#include <QThread>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <util/sll/slotclosure.h>
+#include "interfaces/monocle/isupporttiledrendering.h"
+#include "pagegraphicsitem.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	RenderScheduler::RenderScheduler (QObject *parent)
+	: QObject { parent }
+	, MaxThreadedJobs_ { std::max (QThread::idealThreadCount (), 1) }
+	{
+	}
+
+	void RenderScheduler::Request (const TileRequest& request, Priority priority)
+	{
+		switch (priority)
+		{
+		case Priority::Visible:
+			VisibleQueue_ << request;
+			break;
+		case Priority::Prefetch:
+			PrefetchQueue_ << request;
+			break;
+		}
+
+		Dispatch ();
+	}
+
+	void RenderScheduler::Cancel (PageGraphicsItem *item)
+	{
+		auto pred = [item] (const TileRequest& request)
+				{ return !request.Item_ || request.Item_ == item; };
+		for (auto queue : { &VisibleQueue_, &PrefetchQueue_ })
+			queue->erase (std::remove_if (queue->begin (), queue->end (), pred), queue->end ());
+	}
+
+	boost::optional<RenderScheduler::TileRequest> RenderScheduler::TakeNext (bool threaded)
+	{
+		for (int i = VisibleQueue_.size () - 1; i >= 0; --i)
+		{
+			const auto request = VisibleQueue_.at (i);
+			if (request.Threaded_ != threaded)
+				continue;
+
+			VisibleQueue_.removeAt (i);
+
+			if (!request.Item_)
+				continue;
+
+			if (!request.Item_->IsDisplayed ())
+			{
+				request.Item_->HandleTileCancelled (request.Tile_);
+				continue;
+			}
+
+			return request;
+		}
+
+		for (int i = 0; i < PrefetchQueue_.size (); )
+		{
+			const auto request = PrefetchQueue_.at (i);
+			if (request.Threaded_ != threaded)
+			{
+				++i;
+				continue;
+			}
+
+			PrefetchQueue_.removeAt (i);
+
+			if (!request.Item_)
+				continue;
+
+			if (!request.Requester_ || !request.Requester_->IsDisplayed ())
+			{
+				request.Item_->HandleTileCancelled (request.Tile_);
+				continue;
+			}
+
+			return request;
+		}
+
+		return {};
+	}
+
+	void RenderScheduler::Dispatch ()
+	{
+		while (RunningThreadedJobs_ < MaxThreadedJobs_)
+		{
+			const auto& request = TakeNext (true);
+			if (!request)
+				break;
+
+			StartThreaded (*request);
+		}
+
+		if (SyncRenderScheduled_)
+			return;
+
+		const auto isSync = [] (const TileRequest& request) { return !request.Threaded_; };
+		if (std::any_of (VisibleQueue_.begin (), VisibleQueue_.end (), isSync) ||
+				std::any_of (PrefetchQueue_.begin (), PrefetchQueue_.end (), isSync))
+		{
+			SyncRenderScheduled_ = true;
+			QTimer::singleShot (0,
+					this,
+					SLOT (renderNextSync ()));
+		}
+	}
+
+	namespace
+	{
+		QImage RenderTileUncached (const RenderScheduler::TileRequest& request)
+		{
+			const auto& doc = request.Doc_;
+			if (const auto tiled = qobject_cast<ISupportTiledRendering*> (doc->GetQObject ()))
+				return tiled->RenderPageTile (request.Page_, request.XScale_, request.YScale_, request.Rect_);
+
+			const auto& image = doc->RenderPage (request.Page_, request.XScale_, request.YScale_);
+			return image.rect () == request.Rect_ ?
+					image :
+					image.copy (request.Rect_);
+		}
+
+		QImage RenderTile (const RenderScheduler::TileRequest& request)
+		{
+			const auto& cache = request.ThumbnailCache_;
+			if (cache)
+			{
+				const auto& cached = cache->GetThumbnail (request.Page_);
+				if (cached.size () == request.Rect_.size ())
+					return cached;
+			}
+
+			const auto& image = RenderTileUncached (request);
+			if (cache && !image.isNull ())
+				cache->SetThumbnail (request.Page_, image);
+			return image;
+		}
+	}
+
+	void RenderScheduler::StartThreaded (const TileRequest& request)
+	{
+		++RunningThreadedJobs_;
+
+		const auto watcher = new QFutureWatcher<QImage> (this);
+		new Util::SlotClosure<Util::DeleteLaterPolicy>
+		{
+			[this, watcher, request]
+			{
+				watcher->deleteLater ();
+				--RunningThreadedJobs_;
+
+				Deliver (request, watcher->result ());
+				Dispatch ();
+			},
+			watcher,
+			SIGNAL (finished ()),
+			watcher
+		};
+
+		auto detached = request;
+		detached.Item_.clear ();
+		detached.Requester_.clear ();
+		watcher->setFuture (QtConcurrent::run ([detached] { return RenderTile (detached); }));
+	}
+
+	void RenderScheduler::Deliver (const TileRequest& request, const QImage& image)
+	{
+		if (request.Item_)
+			request.Item_->HandleTileRendered (request.Tile_,
+					request.XScale_, request.YScale_, image);
+	}
+
+	void RenderScheduler::renderNextSync ()
+	{
+		SyncRenderScheduled_ = false;
+
+		if (const auto& request = TakeNext (false))
+			Deliver (*request, RenderTile (*request));
+
+		Dispatch ();
+	}
+}
+}
@@ -0,0 +1,120 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QRect>
+#include <QList>
+#include <QPair>
+#include <boost/optional.hpp>
+#include "interfaces/monocle/idocument.h"
+#include "documentcache.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	class PageGraphicsItem;
+
+	/** Renders page tiles requested by PageGraphicsItem objects.
+	 *
+	 * Tiles of the currently visible pages are rendered first, the most
+	 * recently requested ones going first. Prefetch requests are served
+	 * only when there are no visible tiles left to render.
+	 *
+	 * Queued requests for pages that have been scrolled away are dropped
+	 * right before they would be started, so fast scrolling doesn't pile
+	 * up stale renders.
+	 *
+	 * Requests for threaded backends are rendered in the thread pool,
+	 * others are rendered in the GUI thread, one tile per event loop
+	 * iteration.
+	 */
+	class RenderScheduler : public QObject
+	{
+		Q_OBJECT
+	public:
+		enum class Priority
+		{
+			Visible,
+			Prefetch
+		};
+
+		typedef QPair<int, int> TileIndex_t;
+
+		struct TileRequest
+		{
+			QPointer<PageGraphicsItem> Item_;
+
+			/** The visible page due to which a prefetch request has been
+			 * issued, or null for visible requests.
+			 */
+			QPointer<PageGraphicsItem> Requester_;
+
+			IDocument_ptr Doc_;
+			int Page_;
+
+			TileIndex_t Tile_;
+			QRect Rect_;
+
+			double XScale_;
+			double YScale_;
+
+			bool Threaded_;
+
+			/** If set, the whole page is rendered, and the rendering is
+			 * taken from and stored to this cache.
+			 */
+			DocumentCache_ptr ThumbnailCache_;
+		};
+	private:
+		QList<TileRequest> VisibleQueue_;
+		QList<TileRequest> PrefetchQueue_;
+
+		const int MaxThreadedJobs_;
+		int RunningThreadedJobs_ = 0;
+
+		bool SyncRenderScheduled_ = false;
+	public:
+		RenderScheduler (QObject* = 0);
+
+		void Request (const TileRequest&, Priority);
+		void Cancel (PageGraphicsItem*);
+	private:
+		boost::optional<TileRequest> TakeNext (bool threaded);
+		void Dispatch ();
+		void StartThreaded (const TileRequest&);
+		void Deliver (const TileRequest&, const QImage&);
+	private slots:
+		void renderNextSync ();
+	};
+}
+}
@@ -53,6 +53,10 @@ namespace Monocle
 	{
 		Ui_.setupUi (this);
 		Ui_.ResultsTree_->setModel (Model_);
+		connect (handler,
+				SIGNAL (searchStarted (QString)),
+				this,
+				SLOT (handleSearchStarted (QString)));
 		connect (handler,
 				SIGNAL (gotSearchResults (TextSearchHandlerResults)),
 				this,
@@ -63,17 +67,29 @@ namespace Monocle
 	{
 		Model_->clear ();
 		Root2Results_.clear ();
+
+		CurrentSearchText_.clear ();
+		CurrentRoot_ = nullptr;
+		CurrentPosCount_ = 0;
+	}
+
+	void SearchTabWidget::handleSearchStarted (const QString& text)
+	{
+		CurrentSearchText_ = text;
+		CurrentRoot_ = nullptr;
+		CurrentPosCount_ = 0;
 	}
 
 	void SearchTabWidget::handleSearchResults (const TextSearchHandlerResults& results)
 	{
+		if (results.Text_ != CurrentSearchText_)
+			return;
+
 		if (std::all_of (results.Positions_.begin (), results.Positions_.end (),
 				[] (const QList<QRectF>& list) { return list.isEmpty (); }))
 			return;
 
-
 		QList<QStandardItem*> pageItems;
-		int globalPosIdx = 0;
 		for (const auto& pair : Util::Stlize (results.Positions_))
 		{
 			const auto& posList = pair.second;
@@ -81,12 +97,12 @@ namespace Monocle
 				continue;
 
 			const auto pageItem = new QStandardItem { tr ("Page %1").arg (pair.first + 1) };
-			pageItem->setData (globalPosIdx, static_cast<int> (SearchModelRole::PageFirstIdx));
+			pageItem->setData (CurrentPosCount_, static_cast<int> (SearchModelRole::PageFirstIdx));
 			pageItem->setEditable (false);
-			for (int i = 0; i < posList.size (); ++i, ++globalPosIdx)
+			for (int i = 0; i < posList.size (); ++i, ++CurrentPosCount_)
 			{
 				const auto posItem = new QStandardItem { tr ("Occurrence %1").arg (i + 1) };
-				posItem->setData (globalPosIdx, static_cast<int> (SearchModelRole::OverallIdx));
+				posItem->setData (CurrentPosCount_, static_cast<int> (SearchModelRole::OverallIdx));
 				posItem->setEditable (false);
 				pageItem->appendRow (posItem);
 			}
@@ -94,17 +110,21 @@ namespace Monocle
 			pageItems << pageItem;
 		}
 
-		if (pageItems.isEmpty ())
-			return;
+		if (!CurrentRoot_)
+		{
+			CurrentRoot_ = new QStandardItem { results.Text_ };
+			CurrentRoot_->setEditable (false);
+			Root2Results_ [CurrentRoot_] = { results.Text_, results.FindFlags_, {} };
 
-		const auto searchItem = new QStandardItem { results.Text_ };
-		searchItem->appendRows (pageItems);
-		searchItem->setEditable (false);
+			Model_->insertRow (0, CurrentRoot_);
+		}
 
-		Root2Results_ [searchItem] = results;
+		CurrentRoot_->appendRows (pageItems);
+		Ui_.ResultsTree_->expand (CurrentRoot_->index ());
 
-		Model_->insertRow (0, searchItem);
-		Ui_.ResultsTree_->expand (searchItem->index ());
+		auto& allPositions = Root2Results_ [CurrentRoot_].Positions_;
+		for (const auto& pair : Util::Stlize (results.Positions_))
+			allPositions [pair.first] = pair.second;
 	}
 
 	namespace
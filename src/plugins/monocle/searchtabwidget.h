@@ -56,11 +56,16 @@ namespace Monocle
 		TextSearchHandler * const SearchHandler_;
 
 		QMap<QStandardItem*, TextSearchHandlerResults> Root2Results_;
+
+		QString CurrentSearchText_;
+		QStandardItem *CurrentRoot_ = nullptr;
+		int CurrentPosCount_ = 0;
 	public:
 		SearchTabWidget (TextSearchHandler*, QWidget* = nullptr);
 
 		void HandleDoc (const IDocument_ptr&);
 	private slots:
+		void handleSearchStarted (const QString&);
 		void handleSearchResults (const TextSearchHandlerResults&);
 		void on_ResultsTree__activated (const QModelIndex&);
 	};
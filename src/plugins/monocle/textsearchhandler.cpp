@@ -30,9 +30,15 @@
 #include "textsearchhandler.h"
 #include <QGraphicsView>
 #include <QGraphicsRectItem>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QThread>
+#include <QVector>
 #include <QtDebug>
 #include <util/sll/qtutil.h>
+#include <util/sll/slotclosure.h>
 #include "interfaces/monocle/isearchabledocument.h"
+#include "interfaces/monocle/isupportpagesearch.h"
 #include "pagegraphicsitem.h"
 #include "pageslayoutmanager.h"
 
@@ -51,14 +57,22 @@ namespace Monocle
 
 	void TextSearchHandler::HandleDoc (IDocument_ptr doc, const QList<PageGraphicsItem*>& pages)
 	{
+		CancelSearch ();
+
 		Doc_ = doc;
 		Pages_ = pages;
+		DocCache_.reset ();
 
 		CurrentHighlights_.clear ();
 		CurrentRectIndex_ = -1;
 		CurrentSearchString_.clear ();
 	}
 
+	void TextSearchHandler::SetDocumentCache (const DocumentCache_ptr& cache)
+	{
+		DocCache_ = cache;
+	}
+
 	bool TextSearchHandler::Search (const QString& text, Util::FindNotification::FindFlags flags)
 	{
 		if (!Doc_)
@@ -68,7 +82,7 @@ namespace Monocle
 			return RequestSearch (text, flags);
 
 		if (CurrentHighlights_.isEmpty ())
-			return false;
+			return static_cast<bool> (CurrentSearch_);
 
 		if (flags & Util::FindNotification::FindBackwards)
 		{
@@ -102,35 +116,254 @@ namespace Monocle
 	{
 		if (CurrentSearchString_ != results.Text_)
 		{
+			CancelSearch ();
 			ClearHighlights ();
 			CurrentSearchString_ = results.Text_;
 			BuildHighlights (results.Positions_);
 		}
 
-		SelectItem (select);
+		if (select >= 0 && select < CurrentHighlights_.size ())
+			SelectItem (select);
+	}
+
+	namespace
+	{
+		const int SearchChunkSize = 8;
+
+		/* The words are joined by single spaces, except for the ones
+		 * that are followed by the next word on the same line without
+		 * any space in between, and each character of the resulting
+		 * text is mapped back to its word.
+		 */
+		QList<QRectF> FindInWords (const QList<PageWord>& words, const QString& text, Qt::CaseSensitivity cs)
+		{
+			const auto& needle = text.simplified ();
+			if (needle.isEmpty ())
+				return {};
+
+			struct CharPos
+			{
+				int Word_;
+				int Offset_;
+			};
+
+			QString pageText;
+			QVector<CharPos> charPositions;
+			for (int i = 0; i < words.size (); ++i)
+			{
+				const auto& word = words.at (i);
+				pageText += word.Text_;
+				for (int j = 0; j < word.Text_.size (); ++j)
+					charPositions.append ({ i, j });
+
+				if (i == words.size () - 1)
+					break;
+
+				const auto& next = words.at (i + 1).Rect_;
+				const bool sameLine = next.top () < word.Rect_.bottom () &&
+						next.bottom () > word.Rect_.top ();
+				if (word.HasSpaceAfter_ || !sameLine)
+				{
+					pageText += ' ';
+					charPositions.append ({ -1, 0 });
+				}
+			}
+
+			QList<QRectF> result;
+			for (auto pos = pageText.indexOf (needle, 0, cs); pos >= 0;
+					pos = pageText.indexOf (needle, pos + needle.size (), cs))
+			{
+				QRectF rect;
+				for (auto i = pos; i < pos + needle.size (); ++i)
+				{
+					const auto& charPos = charPositions.at (i);
+					if (charPos.Word_ < 0)
+						continue;
+
+					const auto& word = words.at (charPos.Word_);
+					const auto charWidth = word.Rect_.width () / word.Text_.size ();
+					rect |= QRectF
+					{
+						word.Rect_.left () + charWidth * charPos.Offset_,
+						word.Rect_.top (),
+						charWidth,
+						word.Rect_.height ()
+					};
+				}
+				result << rect;
+			}
+			return result;
+		}
+
+		/* Pages with cached words are searched without touching the
+		 * document, and the words of other pages are extracted once
+		 * and cached for the subsequent searches.
+		 */
+		QList<QRectF> SearchPage (ISupportPageSearch *pageSearch, const DocumentCache_ptr& cache,
+				int page, const QString& text, Qt::CaseSensitivity cs)
+		{
+			if (!cache)
+				return pageSearch->GetPageTextPositions (page, text, cs);
+
+			auto words = cache->GetPageWords (page);
+			if (!words)
+			{
+				words = pageSearch->GetPageWords (page);
+				if (!words)
+					return pageSearch->GetPageTextPositions (page, text, cs);
+
+				cache->SetPageWords (page, *words);
+			}
+
+			return FindInWords (*words, text, cs);
+		}
 	}
 
 	bool TextSearchHandler::RequestSearch (const QString& text, Util::FindNotification::FindFlags flags)
 	{
+		CancelSearch ();
 		ClearHighlights ();
 		CurrentSearchString_ = text;
 
 		const auto searchable = qobject_cast<ISearchableDocument*> (Doc_->GetQObject ());
-		if (!searchable)
+		if (!searchable || Doc_->GetNumPages () <= 0)
 			return false;
 
 		const auto cs = flags & Util::FindNotification::FindCaseSensitively ?
 				Qt::CaseSensitive :
 				Qt::CaseInsensitive;
-		const auto& map = searchable->GetTextPositions (text, cs);
-		emit gotSearchResults ({ text, flags, map });
+
+		emit searchStarted (text);
+
+		// Only ISupportPageSearch documents are known to be searchable
+		// off the GUI thread, others are searched synchronously.
+		if (!qobject_cast<ISupportPageSearch*> (Doc_->GetQObject ()))
+		{
+			HandleSearchResults (searchable->GetTextPositions (text, cs), flags);
+			emit searchFinished (text, !CurrentHighlights_.isEmpty ());
+			return !CurrentHighlights_.isEmpty ();
+		}
+
+		CurrentSearch_ = std::make_shared<PendingSearch> ();
+		CurrentSearch_->Text_ = text;
+		CurrentSearch_->Flags_ = flags;
+		CurrentSearch_->CS_ = cs;
+		CurrentSearch_->ChunkSize_ = SearchChunkSize;
+		StartSearchJobs (CurrentSearch_);
+
+		return true;
+	}
+
+	void TextSearchHandler::CancelSearch ()
+	{
+		if (!CurrentSearch_)
+			return;
+
+		CurrentSearch_->Cancelled_ = true;
+		CurrentSearch_.reset ();
+
+		ReleaseSearchResources ();
+	}
+
+	void TextSearchHandler::ReleaseSearchResources ()
+	{
+		if (const auto pageSearch = qobject_cast<ISupportPageSearch*> (Doc_->GetQObject ()))
+			pageSearch->ReleaseSearchResources ();
+	}
+
+	void TextSearchHandler::StartSearchJobs (const PendingSearch_ptr& search)
+	{
+		const auto doc = Doc_;
+		const auto pageSearch = qobject_cast<ISupportPageSearch*> (doc->GetQObject ());
+
+		const auto numPages = doc->GetNumPages ();
+		const auto maxJobs = std::max (QThread::idealThreadCount (), 1);
+
+		while (search->RunningJobs_ < maxJobs && search->NextChunk_ < numPages)
+		{
+			const auto start = search->NextChunk_;
+			const auto end = std::min (start + search->ChunkSize_, numPages);
+			search->NextChunk_ = end;
+			++search->RunningJobs_;
+
+			const auto watcher = new QFutureWatcher<QMap<int, QList<QRectF>>> (this);
+			new Util::SlotClosure<Util::DeleteLaterPolicy>
+			{
+				[this, watcher, search, start]
+				{
+					watcher->deleteLater ();
+					--search->RunningJobs_;
+
+					if (search != CurrentSearch_)
+						return;
+
+					search->ChunkResults_ [start] = watcher->result ();
+					FlushSearchResults ();
+
+					if (CurrentSearch_)
+						StartSearchJobs (CurrentSearch_);
+				},
+				watcher,
+				SIGNAL (finished ()),
+				watcher
+			};
+
+			const auto& text = search->Text_;
+			const auto cs = search->CS_;
+			const auto& cache = DocCache_;
+			watcher->setFuture (QtConcurrent::run ([doc, pageSearch, cache, search, text, cs, start, end]
+						-> QMap<int, QList<QRectF>>
+					{
+						QMap<int, QList<QRectF>> result;
+						for (auto i = start; i < end; ++i)
+						{
+							if (search->Cancelled_)
+								break;
+
+							const auto& rects = SearchPage (pageSearch, cache, i, text, cs);
+							if (!rects.isEmpty ())
+								result [i] = rects;
+						}
+						return result;
+					}));
+		}
+	}
+
+	void TextSearchHandler::FlushSearchResults ()
+	{
+		const auto search = CurrentSearch_;
+
+		QMap<int, QList<QRectF>> ready;
+		while (search->ChunkResults_.contains (search->NextFlushed_))
+		{
+			const auto& chunk = search->ChunkResults_.take (search->NextFlushed_);
+			for (const auto& pair : Util::Stlize (chunk))
+				ready [pair.first] = pair.second;
+
+			search->NextFlushed_ = std::min (search->NextFlushed_ + search->ChunkSize_,
+					Doc_->GetNumPages ());
+		}
+
+		if (!ready.isEmpty ())
+			HandleSearchResults (ready, search->Flags_);
+
+		if (search->NextFlushed_ < Doc_->GetNumPages ())
+			return;
+
+		CurrentSearch_.reset ();
+		ReleaseSearchResources ();
+		emit searchFinished (search->Text_, !CurrentHighlights_.isEmpty ());
+	}
+
+	void TextSearchHandler::HandleSearchResults (const QMap<int, QList<QRectF>>& map,
+			Util::FindNotification::FindFlags flags)
+	{
+		emit gotSearchResults ({ CurrentSearchString_, flags, map });
 
 		BuildHighlights (map);
 
-		if (!CurrentHighlights_.isEmpty ())
+		if (CurrentRectIndex_ < 0 && !CurrentHighlights_.isEmpty ())
 			SelectItem (0);
-
-		return !CurrentHighlights_.isEmpty ();
 	}
 
 	void TextSearchHandler::BuildHighlights (const QMap<int, QList<QRectF>>& map)
@@ -164,6 +397,7 @@ namespace Monocle
 		}
 
 		CurrentHighlights_.clear ();
+		CurrentRectIndex_ = -1;
 	}
 
 	void TextSearchHandler::SelectItem (int index)
@@ -29,10 +29,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <QObject>
 #include <QMap>
 #include <util/gui/findnotification.h>
 #include "interfaces/monocle/idocument.h"
+#include "documentcache.h"
 
 class QGraphicsRectItem;
 class QGraphicsView;
@@ -62,20 +65,45 @@ namespace Monocle
 
 		IDocument_ptr Doc_;
 		QList<PageGraphicsItem*> Pages_;
+		DocumentCache_ptr DocCache_;
 
 		QString CurrentSearchString_;
 
 		QList<QGraphicsRectItem*> CurrentHighlights_;
 		int CurrentRectIndex_;
+
+		struct PendingSearch
+		{
+			QString Text_;
+			Util::FindNotification::FindFlags Flags_;
+			Qt::CaseSensitivity CS_;
+
+			std::atomic<bool> Cancelled_ { false };
+
+			int ChunkSize_ = 0;
+			int NextChunk_ = 0;
+			int NextFlushed_ = 0;
+			int RunningJobs_ = 0;
+
+			QMap<int, QMap<int, QList<QRectF>>> ChunkResults_;
+		};
+		typedef std::shared_ptr<PendingSearch> PendingSearch_ptr;
+		PendingSearch_ptr CurrentSearch_;
 	public:
 		TextSearchHandler (QGraphicsView*, PagesLayoutManager*, QObject* = 0);
 
 		void HandleDoc (IDocument_ptr, const QList<PageGraphicsItem*>&);
+		void SetDocumentCache (const DocumentCache_ptr&);
 
 		bool Search (const QString&, Util::FindNotification::FindFlags);
 		void SetPreparedResults (const TextSearchHandlerResults&, int selectedItem);
 	private:
 		bool RequestSearch (const QString&, Util::FindNotification::FindFlags);
+		void CancelSearch ();
+		void ReleaseSearchResources ();
+		void StartSearchJobs (const PendingSearch_ptr&);
+		void FlushSearchResults ();
+		void HandleSearchResults (const QMap<int, QList<QRectF>>&, Util::FindNotification::FindFlags);
 
 		void BuildHighlights (const QMap<int, QList<QRectF>>&);
 		void ClearHighlights ();
@@ -84,7 +112,14 @@ namespace Monocle
 	signals:
 		void navigateRequested (const QString&, int, double, double);
 
+		void searchStarted (const QString&);
+
+		/** Emitted for each batch of results of the current search, in
+		 * the order of pages.
+		 */
 		void gotSearchResults (const TextSearchHandlerResults&);
+
+		void searchFinished (const QString&, bool found);
 	};
 }
 }
@@ -76,6 +76,12 @@ namespace Monocle
 		LayoutMgr_->Relayout ();
 	}
 
+	void ThumbsWidget::SetDocumentCache (const DocumentCache_ptr& cache)
+	{
+		for (const auto page : LayoutMgr_->GetPages ())
+			page->SetThumbnailCache (cache);
+	}
+
 	void ThumbsWidget::updatePagesVisibility (const QMap<int, QRect>& page2rect)
 	{
 		LastVisibleAreas_ = page2rect;
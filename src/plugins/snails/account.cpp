@@ -56,6 +56,7 @@
 #include "accountthreadnotifier.h"
 #include "progresslistener.h"
 #include "progressmanager.h"
+#include "xmlsettingsmanager.h"
 
 Q_DECLARE_METATYPE (QList<QStringList>)
 Q_DECLARE_METATYPE (QList<QByteArray>)
@@ -171,6 +172,11 @@ namespace Snails
 		return SynchronizeImpl ({ path }, last, TaskPriority::High);
 	}
 
+	void Account::SetListenedFolder (const QStringList& folder)
+	{
+		WorkerPool_->SetListenedFolder (folder);
+	}
+
 	QFuture<Account::SynchronizeResult_t> Account::SynchronizeImpl (const QList<QStringList>& folders,
 			const QByteArray& last, TaskPriority prio)
 	{
@@ -195,7 +201,11 @@ namespace Snails
 									HandleMsgHeaders (msgs.NewHeaders_, folder);
 									HandleUpdatedMessages (msgs.UpdatedMsgs_, folder);
 
+									if (msgs.SyncState_)
+										Storage_->SetFolderSyncState (this, folder, *msgs.SyncState_);
+
 									UpdateFolderCount (folder);
+									PrefetchBodies (folder);
 
 									stats.NewMsgsCount_ += msgs.NewHeaders_.size ();
 								}
@@ -218,7 +228,12 @@ namespace Snails
 
 	QFuture<WrapReturnType_t<FetchWholeMessageResult_t>> Account::FetchWholeMessage (const Message_ptr& msg)
 	{
-		auto future = WorkerPool_->Schedule (TaskPriority::High,
+		return FetchWholeMessage (msg, TaskPriority::High);
+	}
+
+	QFuture<WrapReturnType_t<FetchWholeMessageResult_t>> Account::FetchWholeMessage (const Message_ptr& msg, TaskPriority prio)
+	{
+		auto future = WorkerPool_->Schedule (prio,
 				&AccountThreadWorker::FetchWholeMessage, msg);
 		Util::Sequence (this, future) >>
 			[this] (const auto& result)
@@ -662,6 +677,25 @@ namespace Snails
 				};
 	}
 
+	void Account::PrefetchBodies (const QStringList& folder)
+	{
+		const auto count = XmlSettingsManager::Instance ().property ("PrefetchBodiesCount").toInt ();
+		if (count <= 0)
+			return;
+
+		auto& queued = PrefetchQueued_ [folder];
+		for (const auto& msg : Storage_->LoadNewestUnread (this, folder, count))
+		{
+			const auto& id = msg->GetFolderID ();
+			if (msg->IsFullyFetched () || queued.contains (id))
+				continue;
+
+			queued << id;
+			Util::Sequence (this, FetchWholeMessage (msg, TaskPriority::Background)) >>
+					[this, folder, id] (const auto&) { PrefetchQueued_ [folder].remove (id); };
+		}
+	}
+
 	void Account::UpdateFolderCount (const QStringList& folder)
 	{
 		const auto totalCount = Storage_->GetNumMessages (this, folder);
@@ -784,5 +818,45 @@ namespace Snails
 			RequestMessageCount (folder.Path_);
 		}
 	}
+
+	void Account::handleReadStatusChanged (const QList<QByteArray>& readIds,
+			const QList<QByteArray>& unreadIds, const QStringList& folder)
+	{
+		const auto& known = Storage_->GetReadStatuses (this, folder);
+
+		bool hasUnknown = false;
+		QHash<QByteArray, bool> changed;
+		auto collect = [&] (const QList<QByteArray>& ids, bool read)
+		{
+			for (const auto& id : ids)
+			{
+				const auto pos = known.find (id);
+				if (pos == known.end ())
+					hasUnknown = true;
+				else if (*pos != read)
+					changed [id] = read;
+			}
+		};
+		collect (readIds, true);
+		collect (unreadIds, false);
+
+		if (!changed.isEmpty ())
+		{
+			const auto& msgs = Storage_->LoadMessages (this, folder, changed.keys ());
+			for (const auto& msg : msgs)
+				msg->SetRead (changed.value (msg->GetFolderID ()));
+
+			HandleUpdatedMessages (msgs, folder);
+			UpdateFolderCount (folder);
+		}
+
+		if (hasUnknown)
+			Synchronize (folder, {});
+	}
+
+	void Account::handleMessageCountChanged (const QStringList& folder)
+	{
+		Synchronize (folder, {});
+	}
 }
 }
@@ -33,6 +33,8 @@
 #include <functional>
 #include <QObject>
 #include <QHash>
+#include <QMap>
+#include <QSet>
 #include "message.h"
 #include "accountthread.h"
 #include "accountthreadworkerfwd.h"
@@ -147,6 +149,8 @@ namespace Snails
 
 		ProgressManager * const ProgressMgr_;
 		Storage * const Storage_;
+
+		QMap<QStringList, QSet<QByteArray>> PrefetchQueued_;
 	public:
 		Account (Storage *st, ProgressManager*, QObject* = nullptr);
 
@@ -173,6 +177,11 @@ namespace Snails
 		QFuture<SynchronizeResult_t> Synchronize ();
 		QFuture<SynchronizeResult_t> Synchronize (const QStringList&, const QByteArray&);
 
+		/** Makes the listening connection watch the given folder, so the
+		 * changes in it are seen right away instead of on the next sync.
+		 */
+		void SetListenedFolder (const QStringList&);
+
 		using FetchWholeMessageResult_t = QFuture<WrapReturnType_t<Snails::FetchWholeMessageResult_t>>;
 		FetchWholeMessageResult_t FetchWholeMessage (const Message_ptr&);
 
@@ -205,6 +214,9 @@ namespace Snails
 		QFuture<SynchronizeResult_t> SynchronizeImpl (const QList<QStringList>&, const QByteArray&, TaskPriority);
 		QMutex* GetMutex () const;
 
+		FetchWholeMessageResult_t FetchWholeMessage (const Message_ptr&, TaskPriority);
+		void PrefetchBodies (const QStringList& folder);
+
 		void UpdateNoopInterval ();
 
 		QString BuildInURL ();
@@ -230,6 +242,10 @@ namespace Snails
 		void getPassword (QString*, Direction = Direction::In);
 
 		void handleFoldersUpdated ();
+
+		void handleReadStatusChanged (const QList<QByteArray>& readIds,
+				const QList<QByteArray>& unreadIds, const QStringList& folder);
+		void handleMessageCountChanged (const QStringList& folder);
 	signals:
 		void accountChanged ();
 	};
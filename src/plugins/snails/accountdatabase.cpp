@@ -29,11 +29,13 @@
 
 #include "accountdatabase.h"
 #include <QDir>
+#include <QMutex>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QtDebug>
 #include <util/db/dblock.h>
+#include <util/db/util.h>
 #include <util/sll/qtutil.h>
 #include "account.h"
 
@@ -53,9 +55,29 @@ namespace LeechCraft
 {
 namespace Snails
 {
-	AccountDatabase::AccountDatabase (const QDir& dir, Account *acc, QObject *parent)
+	namespace
+	{
+		QSqlDatabase_ptr MakeDatabase (Account *acc)
+		{
+			const auto& connName = Util::GenConnectionName ("SnailsStorage_" + acc->GetID ().toHex ());
+			return QSqlDatabase_ptr
+			{
+				new QSqlDatabase { QSqlDatabase::addDatabase ("QSQLITE", connName) },
+				[connName] (QSqlDatabase *db)
+				{
+					db->close ();
+					delete db;
+					QSqlDatabase::removeDatabase (connName);
+				}
+			};
+		}
+	}
+
+	AccountDatabase::AccountDatabase (const QDir& dir, Account *acc,
+			const std::shared_ptr<QMutex>& writeLock, QObject *parent)
 	: QObject { parent }
-	, DB_ { std::make_shared<QSqlDatabase> (QSqlDatabase::addDatabase ("QSQLITE", "SnailsStorage_" + acc->GetID ())) }
+	, DB_ { MakeDatabase (acc) }
+	, WriteLock_ { writeLock }
 	{
 		if (!DB_->isValid ())
 		{
@@ -72,6 +94,7 @@ namespace Snails
 		}
 
 		InitTables ();
+		InitSearchIndex ();
 		PrepareQueries ();
 		LoadKnownFolders ();
 	}
@@ -88,33 +111,34 @@ namespace Snails
 		return result;
 	}
 
-	namespace
+	int AccountDatabase::GetFolderCount (const QStringList& folder, int column)
 	{
-		int GetCount (QSqlQuery& query, const QStringList& folder)
-		{
-			query.bindValue (":path", folder.join ("/"));
-			Util::DBLock::Execute (query);
-			if (!query.next ())
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to navigate to result";
-				throw std::runtime_error ("Query execution failed.");
-			}
+		const auto folderId = FindFolder (folder);
+		if (!folderId)
+			return 0;
 
-			const auto result = query.value (0).toInt ();
-			query.finish ();
-			return result;
+		QueryGetFolderCounts_.bindValue (":folderId", *folderId);
+		Util::DBLock::Execute (QueryGetFolderCounts_);
+		if (!QueryGetFolderCounts_.next ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to navigate to result";
+			throw std::runtime_error ("Query execution failed.");
 		}
+
+		const auto result = QueryGetFolderCounts_.value (column).toInt ();
+		QueryGetFolderCounts_.finish ();
+		return result;
 	}
 
 	int AccountDatabase::GetMessageCount (const QStringList& folder)
 	{
-		return GetCount (QueryGetCount_, folder);
+		return GetFolderCount (folder, 0);
 	}
 
 	int AccountDatabase::GetUnreadMessageCount (const QStringList& folder)
 	{
-		return GetCount (QueryGetUnreadCount_, folder);
+		return GetFolderCount (folder, 1);
 	}
 
 	int AccountDatabase::GetMessageCount ()
@@ -132,6 +156,50 @@ namespace Snails
 		return result;
 	}
 
+	QHash<QByteArray, bool> AccountDatabase::GetReadStatuses (const QStringList& folder)
+	{
+		QueryGetReadStatuses_.bindValue (":path", folder.join ("/"));
+		Util::DBLock::Execute (QueryGetReadStatuses_);
+
+		QHash<QByteArray, bool> result;
+		while (QueryGetReadStatuses_.next ())
+			result [QueryGetReadStatuses_.value (0).toByteArray ()] = QueryGetReadStatuses_.value (1).toBool ();
+		QueryGetReadStatuses_.finish ();
+		return result;
+	}
+
+	boost::optional<FolderSyncState> AccountDatabase::GetFolderSyncState (const QStringList& folder)
+	{
+		QueryGetFolderSyncState_.bindValue (":path", folder.join ("/"));
+		Util::DBLock::Execute (QueryGetFolderSyncState_);
+
+		const std::shared_ptr<void> finishGuard
+		{
+			nullptr,
+			[this] (void*) { QueryGetFolderSyncState_.finish (); }
+		};
+
+		if (!QueryGetFolderSyncState_.next ())
+			return {};
+
+		FolderSyncState state;
+		state.UidValidity_ = QueryGetFolderSyncState_.value (0).toUInt ();
+		state.HighestModSeq_ = QueryGetFolderSyncState_.value (1).toULongLong ();
+		return state;
+	}
+
+	void AccountDatabase::SetFolderSyncState (const QStringList& folder, const FolderSyncState& state)
+	{
+		QMutexLocker locker { WriteLock_.get () };
+
+		const auto folderId = AddFolder (folder);
+
+		QuerySetFolderSyncState_.bindValue (":folderId", folderId);
+		QuerySetFolderSyncState_.bindValue (":uidValidity", state.UidValidity_);
+		QuerySetFolderSyncState_.bindValue (":highestModSeq", state.HighestModSeq_);
+		Util::DBLock::Execute (QuerySetFolderSyncState_);
+	}
+
 	boost::optional<int> AccountDatabase::GetMsgTableId (const QByteArray& uniqueId)
 	{
 		if (uniqueId.isEmpty ())
@@ -166,25 +234,158 @@ namespace Snails
 
 	void AccountDatabase::AddMessage (const Message_ptr& msg)
 	{
-		for (const auto& folder : msg->GetFolders ())
-			AddFolder (folder);
+		AddMessages ({ msg });
+	}
+
+	void AccountDatabase::AddMessages (const QList<Message_ptr>& msgs)
+	{
+		QMutexLocker locker { WriteLock_.get () };
+
+		for (const auto& msg : msgs)
+			for (const auto& folder : msg->GetFolders ())
+				AddFolder (folder);
 
 		Util::DBLock lock { *DB_ };
 		lock.Init ();
 
-		for (const auto& folder : msg->GetFolders ())
+		for (const auto& msg : msgs)
+			AddMessageImpl (msg);
+
+		lock.Good ();
+	}
+
+	namespace
+	{
+		QList<QByteArray> GetAllData (QSqlQuery& query)
 		{
-			if (const auto existing = GetMsgTableId (msg->GetFolderID (), folder))
+			Util::DBLock::Execute (query);
+
+			QList<QByteArray> result;
+			while (query.next ())
+				result << query.value (0).toByteArray ();
+			query.finish ();
+			return result;
+		}
+	}
+
+	QByteArray AccountDatabase::GetMessageData (const QByteArray& msgId, const QStringList& folder)
+	{
+		const auto folderId = FindFolder (folder);
+		if (!folderId)
+			return {};
+
+		QueryGetMsgContents_.bindValue (":folderId", *folderId);
+		QueryGetMsgContents_.bindValue (":msgId", msgId);
+		Util::DBLock::Execute (QueryGetMsgContents_);
+
+		const auto& result = QueryGetMsgContents_.next () ?
+				QueryGetMsgContents_.value (0).toByteArray () :
+				QByteArray {};
+		QueryGetMsgContents_.finish ();
+		return result;
+	}
+
+	QList<QByteArray> AccountDatabase::GetMessagesData (const QStringList& folder)
+	{
+		const auto folderId = FindFolder (folder);
+		if (!folderId)
+			return {};
+
+		QueryGetFolderContents_.bindValue (":folderId", *folderId);
+		return GetAllData (QueryGetFolderContents_);
+	}
+
+	QList<QByteArray> AccountDatabase::GetMessagesData ()
+	{
+		return GetAllData (QueryGetAllContents_);
+	}
+
+	QList<QByteArray> AccountDatabase::GetNewestUnreadData (const QStringList& folder, int limit)
+	{
+		const auto folderId = FindFolder (folder);
+		if (!folderId)
+			return {};
+
+		QueryGetNewestUnreadContents_.bindValue (":folderId", *folderId);
+		QueryGetNewestUnreadContents_.bindValue (":limit", limit);
+		return GetAllData (QueryGetNewestUnreadContents_);
+	}
+
+	namespace
+	{
+		QString GetSearchAddresses (const Message_ptr& msg)
+		{
+			QStringList addresses;
+			for (const auto type : { Message::Address::From, Message::Address::To, Message::Address::Cc })
+				for (const auto& address : msg->GetAddresses (type))
+					addresses << address.first << address.second;
+			return addresses.join (" ");
+		}
+
+		QString ToMatchExpr (const QString& query)
+		{
+			QStringList terms;
+			for (auto word : query.split (' ', QString::SkipEmptyParts))
 			{
-				UpdateMessage (*existing, msg);
-				continue;
+				word.remove ('"');
+				if (!word.isEmpty ())
+					terms << '"' + word + "*\"";
 			}
+			return terms.join (" ");
+		}
+	}
+
+	QList<QByteArray> AccountDatabase::Search (const QString& query, int limit)
+	{
+		if (!HasSearchIndex_)
+			return {};
+
+		const auto& expr = ToMatchExpr (query);
+		if (expr.isEmpty ())
+			return {};
+
+		QuerySearch_.bindValue (":expr", expr);
+		QuerySearch_.bindValue (":limit", limit);
+		return GetAllData (QuerySearch_);
+	}
+
+	QList<QPair<int, QByteArray>> AccountDatabase::GetUnindexedData (int afterId, int limit)
+	{
+		if (!HasSearchIndex_)
+			return {};
 
-			const auto existing = GetMsgTableId (msg->GetMessageID ());
-			const auto msgTableId = existing ?
-					*existing :
-					AddMessageUnfoldered (msg);
-			AddMessageToFolder (msgTableId, GetFolder (folder), msg->GetFolderID ());
+		QueryGetUnindexedContents_.bindValue (":afterId", afterId);
+		QueryGetUnindexedContents_.bindValue (":limit", limit);
+		Util::DBLock::Execute (QueryGetUnindexedContents_);
+
+		QList<QPair<int, QByteArray>> result;
+		while (QueryGetUnindexedContents_.next ())
+			result << qMakePair (QueryGetUnindexedContents_.value (0).toInt (),
+					QueryGetUnindexedContents_.value (1).toByteArray ());
+		QueryGetUnindexedContents_.finish ();
+		return result;
+	}
+
+	void AccountDatabase::IndexMessages (const QList<QPair<int, Message_ptr>>& msgs)
+	{
+		if (!HasSearchIndex_ || msgs.isEmpty ())
+			return;
+
+		QMutexLocker locker { WriteLock_.get () };
+
+		Util::DBLock lock { *DB_ };
+		lock.Init ();
+
+		for (const auto& pair : msgs)
+		{
+			const auto& msg = pair.second;
+
+			// The message might have been removed since it's been read.
+			QueryIndexMessageById_.bindValue (":id", pair.first);
+			QueryIndexMessageById_.bindValue (":subject", msg->GetSubject ());
+			QueryIndexMessageById_.bindValue (":addresses", GetSearchAddresses (msg));
+			QueryIndexMessageById_.bindValue (":body", msg->GetBody ());
+			Util::DBLock::Execute (QueryIndexMessageById_);
 		}
 
 		lock.Good ();
@@ -193,6 +394,8 @@ namespace Snails
 	void AccountDatabase::RemoveMessage (const QByteArray& msgId, const QStringList& folder,
 			const std::function<void ()>& continuation)
 	{
+		QMutexLocker locker { WriteLock_.get () };
+
 		Util::DBLock lock { *DB_ };
 		lock.Init ();
 
@@ -206,6 +409,30 @@ namespace Snails
 		lock.Good ();
 	}
 
+	void AccountDatabase::AddMessageImpl (const Message_ptr& msg)
+	{
+		const auto& data = qCompress (msg->Serialize ());
+
+		for (const auto& folder : msg->GetFolders ())
+		{
+			const auto folderTableId = GetFolder (folder);
+
+			if (const auto existing = GetMsgTableId (msg->GetFolderID (), folder))
+				UpdateMessage (*existing, msg);
+			else
+			{
+				const auto existing = GetMsgTableId (msg->GetMessageID ());
+				const auto msgTableId = existing ?
+						*existing :
+						AddMessageUnfoldered (msg);
+				AddMessageToFolder (msgTableId, folderTableId, msg->GetFolderID ());
+			}
+
+			SetMessageContents (folderTableId, msg, data);
+			IndexMessage (folderTableId, msg);
+		}
+	}
+
 	int AccountDatabase::AddMessageUnfoldered (const Message_ptr& msg)
 	{
 		const auto& uniqueId = msg->GetMessageID ();
@@ -238,6 +465,79 @@ namespace Snails
 		Util::DBLock::Execute (QueryAddMsgToFolder_);
 	}
 
+	namespace
+	{
+		QByteArray GetThreadId (const Message_ptr& msg)
+		{
+			const auto& refs = msg->GetReferences ();
+			if (!refs.isEmpty ())
+				return refs.first ();
+
+			const auto& irt = msg->GetInReplyTo ();
+			if (!irt.isEmpty ())
+				return irt.first ();
+
+			return msg->GetMessageID ();
+		}
+	}
+
+	void AccountDatabase::SetMessageContents (int folderTableId, const Message_ptr& msg, const QByteArray& data)
+	{
+		const auto& date = msg->GetDate ();
+
+		QuerySetMsgContents_.bindValue (":folderId", folderTableId);
+		QuerySetMsgContents_.bindValue (":msgId", msg->GetFolderID ());
+		QuerySetMsgContents_.bindValue (":date", date.isValid () ? date.toMSecsSinceEpoch () : QVariant {});
+		QuerySetMsgContents_.bindValue (":threadId", GetThreadId (msg));
+		QuerySetMsgContents_.bindValue (":data", data);
+		Util::DBLock::Execute (QuerySetMsgContents_);
+	}
+
+	void AccountDatabase::IndexMessage (int folderTableId, const Message_ptr& msg)
+	{
+		if (!HasSearchIndex_)
+			return;
+
+		QueryIndexMessage_.bindValue (":folderId", folderTableId);
+		QueryIndexMessage_.bindValue (":msgId", msg->GetFolderID ());
+		QueryIndexMessage_.bindValue (":subject", msg->GetSubject ());
+		QueryIndexMessage_.bindValue (":addresses", GetSearchAddresses (msg));
+		QueryIndexMessage_.bindValue (":body", msg->GetBody ());
+		Util::DBLock::Execute (QueryIndexMessage_);
+	}
+
+	void AccountDatabase::InitSearchIndex ()
+	{
+		QSqlQuery query { *DB_ };
+
+		if (!DB_->tables ().contains ("msgsearch"))
+		{
+			/* Not every SQLite build has FTS4, and the rest of the
+			 * storage is perfectly usable without it.
+			 */
+			if (!query.exec ("CREATE VIRTUAL TABLE msgsearch USING fts4 (Subject, Addresses, Body)"))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to create the full-text index, search will be unavailable";
+				Util::DBLock::DumpError (query);
+				return;
+			}
+		}
+
+		if (!query.exec (R"d(
+					CREATE TRIGGER IF NOT EXISTS trg_msg2folder_delete_search AFTER DELETE ON msg2folder
+					BEGIN
+						DELETE FROM msgsearch WHERE docid = OLD.Id;
+					END
+				)d"))
+		{
+			Util::DBLock::DumpError (query);
+			return;
+		}
+
+		HasSearchIndex_ = true;
+	}
+
 	void AccountDatabase::InitTables ()
 	{
 		QHash<QString, QStringList> table2queries;
@@ -265,19 +565,114 @@ namespace Snails
 					FolderMessageId TEXT NOT NULL
 					)
 				)d";
+		table2queries ["folderstates"] <<
+				R"d(
+					CREATE TABLE folderstates (
+					FolderId INTEGER PRIMARY KEY REFERENCES folders (Id) ON DELETE CASCADE,
+					UidValidity INTEGER NOT NULL,
+					HighestModSeq INTEGER NOT NULL
+					)
+				)d";
+
+		table2queries ["msgcontents"] <<
+				R"d(
+					CREATE TABLE msgcontents (
+					Msg2FolderId INTEGER PRIMARY KEY REFERENCES msg2folder (Id) ON DELETE CASCADE,
+					FolderId INTEGER NOT NULL REFERENCES folders (Id) ON DELETE CASCADE,
+					Date INTEGER,
+					ThreadId TEXT,
+					Data BLOB NOT NULL
+					)
+				)d";
+		table2queries ["foldercounts"] <<
+				R"d(
+					CREATE TABLE foldercounts (
+					FolderId INTEGER PRIMARY KEY REFERENCES folders (Id) ON DELETE CASCADE,
+					Total INTEGER NOT NULL DEFAULT 0,
+					Unread INTEGER NOT NULL DEFAULT 0
+					)
+				)d";
+
+		const auto hadCounts = DB_->tables ().contains ("foldercounts");
 
 		QSqlQuery query { *DB_ };
+		auto exec = [&query] (const QString& queryStr)
+		{
+			if (!query.exec (queryStr))
+			{
+				Util::DBLock::DumpError (query);
+				throw std::runtime_error ("Query execution failed for storage creation.");
+			}
+		};
+
 		for (const auto& pair : Util::Stlize (table2queries))
 			if (!DB_->tables ().contains (pair.first))
 				for (const auto& queryStr : pair.second)
-					if (!query.exec (queryStr))
-					{
-						Util::DBLock::DumpError (query);
-						throw std::runtime_error ("Query execution failed for storage creation.");
-					}
+					exec (queryStr);
+
+		/* The counts are kept up to date by the triggers below, but the
+		 * databases created before the counts table need it filled once.
+		 */
+		if (!hadCounts)
+			exec (R"d(
+						INSERT INTO foldercounts (FolderId, Total, Unread)
+						SELECT folders.Id, COUNT(msg2folder.Id), COALESCE(SUM(messages.IsRead = 0), 0)
+						FROM folders
+						LEFT JOIN msg2folder ON msg2folder.FolderId = folders.Id
+						LEFT JOIN messages ON messages.Id = msg2folder.MsgId
+						GROUP BY folders.Id
+					)d");
+
+		const QStringList auxQueries
+		{
+			"CREATE INDEX IF NOT EXISTS idx_msg2folder_uid ON msg2folder (FolderId, FolderMessageId)",
+			"CREATE INDEX IF NOT EXISTS idx_msg2folder_msg ON msg2folder (MsgId)",
+			"CREATE INDEX IF NOT EXISTS idx_msgcontents_date ON msgcontents (FolderId, Date)",
+			"CREATE INDEX IF NOT EXISTS idx_msgcontents_thread ON msgcontents (FolderId, ThreadId)",
+			R"d(
+				CREATE TRIGGER IF NOT EXISTS trg_folders_insert AFTER INSERT ON folders
+				BEGIN
+					INSERT INTO foldercounts (FolderId) VALUES (NEW.Id);
+				END
+			)d",
+			R"d(
+				CREATE TRIGGER IF NOT EXISTS trg_msg2folder_insert AFTER INSERT ON msg2folder
+				BEGIN
+					UPDATE foldercounts
+					SET Total = Total + 1,
+						Unread = Unread + (SELECT IsRead = 0 FROM messages WHERE Id = NEW.MsgId)
+					WHERE FolderId = NEW.FolderId;
+				END
+			)d",
+			R"d(
+				CREATE TRIGGER IF NOT EXISTS trg_msg2folder_delete AFTER DELETE ON msg2folder
+				BEGIN
+					UPDATE foldercounts
+					SET Total = Total - 1,
+						Unread = Unread - (SELECT IsRead = 0 FROM messages WHERE Id = OLD.MsgId)
+					WHERE FolderId = OLD.FolderId;
+				END
+			)d",
+			R"d(
+				CREATE TRIGGER IF NOT EXISTS trg_messages_read AFTER UPDATE OF IsRead ON messages
+				WHEN OLD.IsRead != NEW.IsRead
+				BEGIN
+					UPDATE foldercounts
+					SET Unread = Unread + (CASE WHEN NEW.IsRead THEN -1 ELSE 1 END)
+					WHERE FolderId IN (SELECT FolderId FROM msg2folder WHERE MsgId = NEW.Id);
+				END
+			)d"
+		};
+		for (const auto& queryStr : auxQueries)
+			exec (queryStr);
 
 		query.exec ("PRAGMA foreign_keys = ON;");
 		query.exec ("PRAGMA synchronous = OFF;");
+
+		/* Each thread has its own connection, and WAL lets them read
+		 * while another one is writing.
+		 */
+		query.exec ("PRAGMA journal_mode = WAL;");
 	}
 
 	void AccountDatabase::PrepareQueries ()
@@ -289,21 +684,8 @@ namespace Snails
 					AND folders.Id = msg2folder.FolderId
 				)d");
 
-		QueryGetCount_ = QSqlQuery { *DB_ };
-		QueryGetCount_.prepare (R"d(
-					SELECT COUNT(1) FROM msg2folder, folders
-					WHERE folders.FolderPath = :path
-					AND folders.Id = msg2folder.FolderId
-				)d");
-
-		QueryGetUnreadCount_ = QSqlQuery { *DB_ };
-		QueryGetUnreadCount_.prepare (R"d(
-					SELECT COUNT(1) FROM msg2folder, folders, messages
-					WHERE folders.FolderPath = :path
-					AND folders.Id = msg2folder.FolderId
-					AND messages.Id = msg2folder.MsgId
-					AND messages.IsRead = 0
-				)d");
+		QueryGetFolderCounts_ = QSqlQuery { *DB_ };
+		QueryGetFolderCounts_.prepare ("SELECT Total, Unread FROM foldercounts WHERE FolderId = :folderId");
 
 		QueryGetTotalCount_ = QSqlQuery { *DB_ };
 		QueryGetTotalCount_.prepare ("SELECT COUNT(1) FROM messages");
@@ -322,6 +704,9 @@ namespace Snails
 		QueryAddFolder_ = QSqlQuery { *DB_ };
 		QueryAddFolder_.prepare ("INSERT INTO folders (FolderPath) VALUES (:path);");
 
+		QueryGetFolder_ = QSqlQuery { *DB_ };
+		QueryGetFolder_.prepare ("SELECT Id FROM folders WHERE FolderPath = :path;");
+
 		QueryGetMsgTableIdByFolder_ = QSqlQuery { *DB_ };
 		QueryGetMsgTableIdByFolder_.prepare (R"d(
 					SELECT msg2folder.MsgId FROM msg2folder, folders
@@ -358,12 +743,118 @@ namespace Snails
 					VALUES
 					(:msgTableId, :folderId, :msgId)
 				)d");
+
+		QueryGetReadStatuses_ = QSqlQuery { *DB_ };
+		QueryGetReadStatuses_.prepare (R"d(
+					SELECT msg2folder.FolderMessageId, messages.IsRead FROM msg2folder, folders, messages
+					WHERE folders.FolderPath = :path
+					AND folders.Id = msg2folder.FolderId
+					AND messages.Id = msg2folder.MsgId
+				)d");
+
+		QueryGetFolderSyncState_ = QSqlQuery { *DB_ };
+		QueryGetFolderSyncState_.prepare (R"d(
+					SELECT folderstates.UidValidity, folderstates.HighestModSeq FROM folderstates, folders
+					WHERE folders.FolderPath = :path
+					AND folders.Id = folderstates.FolderId
+				)d");
+
+		QuerySetFolderSyncState_ = QSqlQuery { *DB_ };
+		QuerySetFolderSyncState_.prepare (R"d(
+					INSERT OR REPLACE INTO folderstates
+					(FolderId, UidValidity, HighestModSeq)
+					VALUES
+					(:folderId, :uidValidity, :highestModSeq)
+				)d");
+
+		QuerySetMsgContents_ = QSqlQuery { *DB_ };
+		QuerySetMsgContents_.prepare (R"d(
+					INSERT OR REPLACE INTO msgcontents
+					(Msg2FolderId, FolderId, Date, ThreadId, Data)
+					SELECT Id, FolderId, :date, :threadId, :data FROM msg2folder
+					WHERE FolderId = :folderId
+					AND FolderMessageId = :msgId
+				)d");
+
+		QueryGetMsgContents_ = QSqlQuery { *DB_ };
+		QueryGetMsgContents_.prepare (R"d(
+					SELECT msgcontents.Data FROM msgcontents, msg2folder
+					WHERE msg2folder.FolderId = :folderId
+					AND msg2folder.FolderMessageId = :msgId
+					AND msgcontents.Msg2FolderId = msg2folder.Id
+				)d");
+
+		QueryGetFolderContents_ = QSqlQuery { *DB_ };
+		QueryGetFolderContents_.prepare (R"d(
+					SELECT Data FROM msgcontents
+					WHERE FolderId = :folderId
+					ORDER BY Date
+				)d");
+
+		QueryGetAllContents_ = QSqlQuery { *DB_ };
+		QueryGetAllContents_.prepare ("SELECT Data FROM msgcontents");
+
+		QueryGetNewestUnreadContents_ = QSqlQuery { *DB_ };
+		QueryGetNewestUnreadContents_.prepare (R"d(
+					SELECT msgcontents.Data FROM msgcontents, msg2folder, messages
+					WHERE msgcontents.FolderId = :folderId
+					AND msg2folder.Id = msgcontents.Msg2FolderId
+					AND messages.Id = msg2folder.MsgId
+					AND messages.IsRead = 0
+					ORDER BY msgcontents.Date DESC
+					LIMIT :limit
+				)d");
+
+		if (HasSearchIndex_)
+		{
+			QueryIndexMessage_ = QSqlQuery { *DB_ };
+			QueryIndexMessage_.prepare (R"d(
+						INSERT OR REPLACE INTO msgsearch
+						(docid, Subject, Addresses, Body)
+						SELECT Id, :subject, :addresses, :body FROM msg2folder
+						WHERE FolderId = :folderId
+						AND FolderMessageId = :msgId
+					)d");
+
+			QueryIndexMessageById_ = QSqlQuery { *DB_ };
+			QueryIndexMessageById_.prepare (R"d(
+						INSERT OR REPLACE INTO msgsearch
+						(docid, Subject, Addresses, Body)
+						SELECT Id, :subject, :addresses, :body FROM msg2folder
+						WHERE Id = :id
+					)d");
+
+			QueryGetUnindexedContents_ = QSqlQuery { *DB_ };
+			QueryGetUnindexedContents_.prepare (R"d(
+						SELECT Msg2FolderId, Data FROM msgcontents
+						WHERE Msg2FolderId > :afterId
+						AND NOT EXISTS (SELECT 1 FROM msgsearch WHERE msgsearch.docid = msgcontents.Msg2FolderId)
+						ORDER BY Msg2FolderId
+						LIMIT :limit
+					)d");
+
+			/* The same message stored in several folders is returned
+			 * once, with the data of its newest copy.
+			 */
+			QuerySearch_ = QSqlQuery { *DB_ };
+			QuerySearch_.prepare (R"d(
+						SELECT msgcontents.Data, MAX(msgcontents.Date) FROM msgsearch, msgcontents, msg2folder
+						WHERE msgsearch MATCH :expr
+						AND msgcontents.Msg2FolderId = msgsearch.docid
+						AND msg2folder.Id = msgsearch.docid
+						GROUP BY msg2folder.MsgId
+						ORDER BY MAX(msgcontents.Date) DESC
+						LIMIT :limit
+					)d");
+		}
 	}
 
 	int AccountDatabase::AddFolder (const QStringList& folder)
 	{
-		if (KnownFolders_.contains (folder))
-			return KnownFolders_.value (folder);
+		QMutexLocker locker { WriteLock_.get () };
+
+		if (const auto existing = FindFolder (folder))
+			return *existing;
 
 		QueryAddFolder_.bindValue (":path", folder.join ("/"));
 		Util::DBLock::Execute (QueryAddFolder_);
@@ -381,12 +872,35 @@ namespace Snails
 		return id;
 	}
 
-	int AccountDatabase::GetFolder (const QStringList& folder) const
+	int AccountDatabase::GetFolder (const QStringList& folder)
+	{
+		if (const auto id = FindFolder (folder))
+			return *id;
+
+		throw std::runtime_error ("Unknown folder");
+	}
+
+	boost::optional<int> AccountDatabase::FindFolder (const QStringList& folder)
 	{
-		if (!KnownFolders_.contains (folder))
-			throw std::runtime_error ("Unknown folder");
+		if (KnownFolders_.contains (folder))
+			return KnownFolders_.value (folder);
+
+		// The folder might have been added by another thread's connection.
+		QueryGetFolder_.bindValue (":path", folder.join ("/"));
+		Util::DBLock::Execute (QueryGetFolder_);
+
+		const std::shared_ptr<void> finishGuard
+		{
+			nullptr,
+			[this] (void*) { QueryGetFolder_.finish (); }
+		};
 
-		return KnownFolders_.value (folder);
+		if (!QueryGetFolder_.next ())
+			return {};
+
+		const auto id = QueryGetFolder_.value (0).toInt ();
+		KnownFolders_ [folder] = id;
+		return id;
 	}
 
 	void AccountDatabase::LoadKnownFolders ()
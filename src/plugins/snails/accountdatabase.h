@@ -35,11 +35,14 @@
 #include <QSqlQuery>
 #include <QStringList>
 #include <QMap>
+#include <QHash>
+#include "common.h"
 
 class QSqlDatabase;
 typedef std::shared_ptr<QSqlDatabase> QSqlDatabase_ptr;
 
 class QDir;
+class QMutex;
 
 namespace LeechCraft
 {
@@ -50,16 +53,23 @@ namespace Snails
 	class Message;
 	typedef std::shared_ptr<Message> Message_ptr;
 
+	/* A connection to the messages database of an account.
+	 *
+	 * A connection may only be used from the thread it has been created
+	 * in, so each thread has an AccountDatabase of its own (see
+	 * Storage::BaseForAccount()). The writes of all the connections to
+	 * the same database are serialized via the shared write lock.
+	 */
 	class AccountDatabase : public QObject
 	{
 		const QSqlDatabase_ptr DB_;
+		const std::shared_ptr<QMutex> WriteLock_;
 
 		QSqlQuery QueryGetIds_;
-		QSqlQuery QueryGetCount_;
-		QSqlQuery QueryGetUnreadCount_;
 		QSqlQuery QueryGetTotalCount_;
 		QSqlQuery QueryRemoveMessage_;
 		QSqlQuery QueryAddFolder_;
+		QSqlQuery QueryGetFolder_;
 
 		/* Returns the primary key of a message by its
 		 * folder-local ID and folder path.
@@ -76,31 +86,100 @@ namespace Snails
 		QSqlQuery QueryAddMsgUnfoldered_;
 		QSqlQuery QueryAddMsgToFolder_;
 
+		QSqlQuery QueryGetReadStatuses_;
+
+		QSqlQuery QueryGetFolderCounts_;
+
+		QSqlQuery QuerySetMsgContents_;
+		QSqlQuery QueryGetMsgContents_;
+		QSqlQuery QueryGetFolderContents_;
+		QSqlQuery QueryGetAllContents_;
+		QSqlQuery QueryGetNewestUnreadContents_;
+
+		bool HasSearchIndex_ = false;
+		QSqlQuery QueryIndexMessage_;
+		QSqlQuery QueryIndexMessageById_;
+		QSqlQuery QueryGetUnindexedContents_;
+		QSqlQuery QuerySearch_;
+
+		QSqlQuery QueryGetFolderSyncState_;
+		QSqlQuery QuerySetFolderSyncState_;
+
 		QMap<QStringList, int> KnownFolders_;
 	public:
-		AccountDatabase (const QDir&, Account*, QObject* = nullptr);
+		AccountDatabase (const QDir&, Account*, const std::shared_ptr<QMutex>& writeLock, QObject* = nullptr);
 
 		QList<QByteArray> GetIDs (const QStringList& folder);
 		int GetMessageCount (const QStringList& folder);
 		int GetUnreadMessageCount (const QStringList& folder);
 		int GetMessageCount ();
 
+		/* Returns the read status of each message in the folder keyed by
+		 * its folder-local ID.
+		 */
+		QHash<QByteArray, bool> GetReadStatuses (const QStringList& folder);
+
+		boost::optional<FolderSyncState> GetFolderSyncState (const QStringList& folder);
+		void SetFolderSyncState (const QStringList& folder, const FolderSyncState&);
+
 		void AddMessage (const Message_ptr&);
+
+		/* Adds or updates the messages in a single transaction.
+		 */
+		void AddMessages (const QList<Message_ptr>&);
 		void RemoveMessage (const QByteArray& msgId, const QStringList& folder,
 				const std::function<void ()>& continuation = {});
 
 		boost::optional<int> GetMsgTableId (const QByteArray& uniqueId);
 		boost::optional<int> GetMsgTableId (const QByteArray& msgId, const QStringList& folder);
+
+		/* The methods below return the serialized messages as they've
+		 * been stored by AddMessages().
+		 */
+		QByteArray GetMessageData (const QByteArray& msgId, const QStringList& folder);
+		QList<QByteArray> GetMessagesData (const QStringList& folder);
+		QList<QByteArray> GetMessagesData ();
+
+		/* Returns at most limit newest unread messages in the folder,
+		 * newest first.
+		 */
+		QList<QByteArray> GetNewestUnreadData (const QStringList& folder, int limit);
+
+		/* Returns the serialized messages whose subject, addresses or
+		 * plain text body match all the words in the query, newest
+		 * first. A message stored in several folders is returned once.
+		 */
+		QList<QByteArray> Search (const QString& query, int limit);
+
+		/* Returns at most limit serialized messages missing from the
+		 * search index whose primary keys are greater than afterId,
+		 * along with these keys, in the ascending order of the keys.
+		 */
+		QList<QPair<int, QByteArray>> GetUnindexedData (int afterId, int limit);
+
+		/* Adds the messages keyed by their primary keys to the search
+		 * index in a single transaction without touching the rest of
+		 * the tables.
+		 */
+		void IndexMessages (const QList<QPair<int, Message_ptr>>&);
 	private:
+		void AddMessageImpl (const Message_ptr&);
 		int AddMessageUnfoldered (const Message_ptr&);
 		void UpdateMessage (int, const Message_ptr&);
 		void AddMessageToFolder (int msgTableId, int folderTableId, const QByteArray& msgId);
+		void SetMessageContents (int folderTableId, const Message_ptr&, const QByteArray& data);
+		void IndexMessage (int folderTableId, const Message_ptr&);
+
+		void InitSearchIndex ();
+
+		int GetFolderCount (const QStringList& folder, int column);
 
 		void InitTables ();
 		void PrepareQueries ();
 
 		int AddFolder (const QStringList&);
-		int GetFolder (const QStringList&) const;
+		int GetFolder (const QStringList&);
+		boost::optional<int> FindFolder (const QStringList&);
 		void LoadKnownFolders ();
 	};
 }
@@ -54,7 +54,6 @@
 #include <vmime/messageIdSequence.hpp>
 #include <util/util.h>
 #include <util/xpc/util.h>
-#include <util/sll/prelude.h>
 #include "message.h"
 #include "account.h"
 #include "core.h"
@@ -67,6 +66,7 @@
 #include "folder.h"
 #include "tracerfactory.h"
 #include "accountthreadnotifier.h"
+#include "foldersync.h"
 
 namespace LeechCraft
 {
@@ -122,6 +122,14 @@ namespace Snails
 		}
 	}
 
+	namespace
+	{
+		/* vmime doesn't implement IDLE, so the listening connection polls
+		 * its selected folder often enough for the changes to look pushed.
+		 */
+		const auto ListeningPollInterval = 15 * 1000;
+	}
+
 	const char* FolderNotFound::what () const noexcept
 	{
 		return "folder not found";
@@ -148,16 +156,22 @@ namespace Snails
 		CertVerifier_->setX509RootCAs (certs);
 
 		if (IsListening_)
+		{
 			connect (ChangeListener_,
 					SIGNAL (messagesChanged (QStringList, QList<size_t>)),
 					this,
 					SLOT (handleMessagesChanged (QStringList, QList<size_t>)));
+			connect (ChangeListener_,
+					SIGNAL (messageCountChanged (QStringList)),
+					this,
+					SLOT (handleMessageCountChanged (QStringList)));
+		}
 
 		connect (NoopTimer_,
 				SIGNAL (timeout ()),
 				this,
 				SLOT (sendNoop ()));
-		NoopTimer_->start (60 * 1000);
+		NoopTimer_->start (IsListening_ ? ListeningPollInterval : 60 * 1000);
 	}
 
 	vmime::shared_ptr<vmime::net::store> AccountThreadWorker::MakeStore ()
@@ -189,11 +203,7 @@ namespace Snails
 		st->connect ();
 
 		if (IsListening_)
-			if (const auto defFolder = st->getDefaultFolder ())
-			{
-				defFolder->addMessageChangedListener (ChangeListener_);
-				CachedFolders_ [GetFolderPath (defFolder)] = defFolder;
-			}
+			Listen (st);
 
 		CachedStore_ = st;
 
@@ -261,6 +271,29 @@ namespace Snails
 		}
 	}
 
+	void AccountThreadWorker::Listen (const vmime::shared_ptr<vmime::net::store>& store)
+	{
+		if (ListenedNetFolder_)
+		{
+			ListenedNetFolder_->removeMessageChangedListener (ChangeListener_);
+			ListenedNetFolder_->removeMessageCountListener (ChangeListener_);
+			if (ListenedNetFolder_->isOpen ())
+				ListenedNetFolder_->close (false);
+			ListenedNetFolder_.reset ();
+		}
+
+		const auto& folder = store->getFolder (Folder2Path (ListenedFolder_));
+		if (!folder)
+			return;
+
+		folder->addMessageChangedListener (ChangeListener_);
+		folder->addMessageCountListener (ChangeListener_);
+		folder->open (vmime::net::folder::MODE_READ_ONLY);
+		CachedFolders_ [GetFolderPath (folder)] = folder;
+
+		ListenedNetFolder_ = folder;
+	}
+
 	VmimeFolder_ptr AccountThreadWorker::GetFolder (const QStringList& path, FolderMode mode)
 	{
 		if (path.size () == 1 && path.at (0) == "[Gmail]")
@@ -562,15 +595,15 @@ namespace Snails
 
 	namespace
 	{
+		const int HeadersFetchAttrs = vmime::net::fetchAttributes::FLAGS |
+				vmime::net::fetchAttributes::SIZE |
+				vmime::net::fetchAttributes::UID |
+				vmime::net::fetchAttributes::FULL_HEADER |
+				vmime::net::fetchAttributes::STRUCTURE |
+				vmime::net::fetchAttributes::ENVELOPE;
+
 		MessageVector_t GetMessagesInFolder (const VmimeFolder_ptr& folder, const QByteArray& lastId)
 		{
-			const int desiredFlags = vmime::net::fetchAttributes::FLAGS |
-						vmime::net::fetchAttributes::SIZE |
-						vmime::net::fetchAttributes::UID |
-						vmime::net::fetchAttributes::FULL_HEADER |
-						vmime::net::fetchAttributes::STRUCTURE |
-						vmime::net::fetchAttributes::ENVELOPE;
-
 			if (lastId.isEmpty ())
 			{
 				const auto count = folder->getMessageCount ();
@@ -585,7 +618,7 @@ namespace Snails
 					const auto& set = vmime::net::messageSet::byNumber (i + 1, std::min (count, endVal));
 					try
 					{
-						auto theseMessages = folder->getAndFetchMessages (set, desiredFlags);
+						auto theseMessages = folder->getAndFetchMessages (set, HeadersFetchAttrs);
 						std::move (theseMessages.begin (), theseMessages.end (), std::back_inserter (messages));
 					}
 					catch (const std::exception& e)
@@ -608,7 +641,7 @@ namespace Snails
 				const auto& set = vmime::net::messageSet::byUID (lastId.constData (), "*");
 				try
 				{
-					return folder->getAndFetchMessages (set, desiredFlags);
+					return folder->getAndFetchMessages (set, HeadersFetchAttrs);
 				}
 				catch (const std::exception& e)
 				{
@@ -624,67 +657,139 @@ namespace Snails
 	}
 
 	auto AccountThreadWorker::FetchMessagesInFolder (const QStringList& folderName,
-			const VmimeFolder_ptr& folder, const QByteArray& lastId) -> FolderMessages
+			const VmimeFolder_ptr& folder, const QByteArray& requestedLastId) -> FolderMessages
 	{
 		const auto changeGuard = ChangeListener_->Disable ();
 
-		qDebug () << Q_FUNC_INFO << folderName << folder.get () << lastId;
+		qDebug () << Q_FUNC_INFO << folderName << folder.get () << requestedLastId;
 
-		auto messages = GetMessagesInFolder (folder, lastId);
-		auto newMessages = Util::Map (messages, [this, &folderName] (const auto& msg)
-				{
-					auto res = FromHeaders (msg);
-					res->AddFolder (folderName);
-					return res;
-				});
-		auto existing = Storage_->LoadIDs (A_, folderName);
+		const auto& syncState = GetServerSyncState (folder);
+		const auto& storedState = Storage_->GetFolderSyncState (A_, folderName);
 
-		QList<QByteArray> ids;
+		const bool isValidityChanged = syncState && storedState &&
+				syncState->UidValidity_ != storedState->UidValidity_;
 
-		QList<Message_ptr> updatedMessages;
-		Q_FOREACH (const auto& msg, newMessages)
+		// The old UIDs mean nothing after a UIDVALIDITY change, so refetch everything.
+		const auto& lastId = isValidityChanged ? QByteArray {} : requestedLastId;
+		if (lastId.isEmpty () && syncState && storedState && !isValidityChanged)
 		{
-			if (!existing.contains (msg->GetFolderID ()))
-				continue;
+			auto result = FetchChangedMessages (folderName, folder, *storedState, *syncState);
+			result.SyncState_ = syncState;
+			return result;
+		}
+
+		const auto& messages = GetMessagesInFolder (folder, lastId);
 
-			existing.removeAll (msg->GetFolderID ());
-			newMessages.removeAll (msg);
+		auto existing = Storage_->GetReadStatuses (A_, folderName);
 
-			bool isUpdated = false;
+		QList<QByteArray> staleIds;
+		if (isValidityChanged)
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "UIDVALIDITY changed for"
+					<< folderName
+					<< "; dropping"
+					<< existing.size ()
+					<< "local messages";
+			staleIds = existing.keys ();
+			existing.clear ();
+		}
 
-			auto updated = Storage_->LoadMessage (A_, folderName, msg->GetFolderID ());
+		QList<ServerMessageState> listed;
+		listed.reserve (messages.size ());
+		QHash<QByteArray, vmime::shared_ptr<vmime::net::message>> id2msg;
+		id2msg.reserve (messages.size ());
+		for (const auto& msg : messages)
+		{
+			const QByteArray id { static_cast<vmime::string> (msg->getUID ()).c_str () };
+			listed.append ({ id, static_cast<bool> (msg->getFlags () & vmime::net::message::FLAG_SEEN), 0 });
+			id2msg [id] = msg;
+		}
 
-			if (updated->IsRead () != msg->IsRead ())
-			{
-				updated->SetRead (msg->IsRead ());
-				isUpdated = true;
-			}
+		const auto& delta = DiffFolder (listed, existing, true);
+
+		QList<Message_ptr> newMessages;
+		newMessages.reserve (delta.NewIds_.size ());
+		for (const auto& id : delta.NewIds_)
+		{
+			const auto& res = FromHeaders (id2msg.value (id));
+			res->AddFolder (folderName);
+			newMessages << res;
+		}
 
-			auto sumFolders = updated->GetFolders ();
-			if (!folderName.isEmpty () &&
-					!sumFolders.contains (folderName))
+		QList<Message_ptr> updatedMessages;
+		if (!delta.ChangedReadStatuses_.isEmpty ())
+		{
+			updatedMessages = Storage_->LoadMessages (A_, folderName, delta.ChangedReadStatuses_.keys ());
+			for (const auto& updated : updatedMessages)
 			{
-				updated->AddFolder (folderName);
-				isUpdated = true;
+				const auto& id = updated->GetFolderID ();
+				updated->SetRead (delta.ChangedReadStatuses_.value (id));
+				updated->SetVmimeHeader (id2msg.value (id)->getHeader ());
 			}
+		}
+
+		// With a lastId, the stored messages that weren't listed are merely older.
+		if (lastId.isEmpty ())
+			return { newMessages, updatedMessages, delta.UnchangedIds_, delta.RemovedIds_ + staleIds, syncState };
+		else
+			return { newMessages, updatedMessages, delta.UnchangedIds_, staleIds, {} };
+	}
 
-			updated->SetVmimeHeader (msg->GetVmimeHeader ());
+	auto AccountThreadWorker::FetchChangedMessages (const QStringList& folderName,
+			const VmimeFolder_ptr& folder,
+			const FolderSyncState& stored, const FolderSyncState& current) -> FolderMessages
+	{
+		const auto& delta = FetchFolderDelta (folder,
+				Storage_->GetReadStatuses (A_, folderName), stored, current);
 
-			if (isUpdated)
-				updatedMessages << updated;
-			else
-				ids << msg->GetFolderID ();
+		QList<Message_ptr> updatedMessages;
+		if (!delta.ChangedReadStatuses_.isEmpty ())
+		{
+			updatedMessages = Storage_->LoadMessages (A_, folderName, delta.ChangedReadStatuses_.keys ());
+			for (const auto& msg : updatedMessages)
+				msg->SetRead (delta.ChangedReadStatuses_.value (msg->GetFolderID ()));
 		}
 
+		qDebug () << Q_FUNC_INFO
+				<< folderName
+				<< ": new"
+				<< delta.NewIds_.size ()
+				<< "; updated"
+				<< updatedMessages.size ()
+				<< "; removed"
+				<< delta.RemovedIds_.size ();
+
 		return
 		{
-			newMessages,
+			FetchNewHeaders (folderName, folder, delta.NewIds_),
 			updatedMessages,
-			ids,
-			lastId.isEmpty () ? existing : QList<QByteArray> {}
+			delta.UnchangedIds_,
+			delta.RemovedIds_,
+			{}
 		};
 	}
 
+	QList<Message_ptr> AccountThreadWorker::FetchNewHeaders (const QStringList& folderName,
+			const VmimeFolder_ptr& folder, const QList<QByteArray>& ids)
+	{
+		QList<Message_ptr> result;
+
+		const auto chunkSize = 100;
+		for (int i = 0; i < ids.size (); i += chunkSize)
+		{
+			const auto& set = ToMessageSet (ids.mid (i, chunkSize));
+			for (const auto& msg : folder->getAndFetchMessages (set, HeadersFetchAttrs))
+			{
+				const auto& res = FromHeaders (msg);
+				res->AddFolder (folderName);
+				result << res;
+			}
+		}
+
+		return result;
+	}
+
 	namespace
 	{
 		void FullifyHeaderMessage (const Message_ptr& msg, const vmime::shared_ptr<vmime::net::message>& full)
@@ -815,6 +920,45 @@ namespace Snails
 		auto set = vmime::net::messageSet::empty ();
 		for (const auto& num : numbers)
 			set.addRange (vmime::net::numberMessageRange { num });
+
+		// The change is reported from within a vmime call, so defer the fetch.
+		const auto at = static_cast<AccountThread*> (QThread::currentThread ());
+		at->Schedule (TaskPriority::High,
+				[this, folder, set] (AccountThreadWorker*)
+				{
+					const auto& netFolder = GetFolder (folder, FolderMode::NoChange);
+					if (!netFolder || !netFolder->isOpen ())
+						return;
+
+					QList<QByteArray> readIds;
+					QList<QByteArray> unreadIds;
+					for (const auto& msg : netFolder->getAndFetchMessages (set,
+							vmime::net::fetchAttributes::FLAGS | vmime::net::fetchAttributes::UID))
+					{
+						const QByteArray id { static_cast<vmime::string> (msg->getUID ()).c_str () };
+						if (msg->getFlags () & vmime::net::message::FLAG_SEEN)
+							readIds << id;
+						else
+							unreadIds << id;
+					}
+
+					QMetaObject::invokeMethod (A_,
+							"handleReadStatusChanged",
+							Qt::QueuedConnection,
+							Q_ARG (QList<QByteArray>, readIds),
+							Q_ARG (QList<QByteArray>, unreadIds),
+							Q_ARG (QStringList, folder));
+				});
+	}
+
+	void AccountThreadWorker::handleMessageCountChanged (const QStringList& folder)
+	{
+		qDebug () << Q_FUNC_INFO << folder;
+
+		QMetaObject::invokeMethod (A_,
+				"handleMessageCountChanged",
+				Qt::QueuedConnection,
+				Q_ARG (QStringList, folder));
 	}
 
 	void AccountThreadWorker::sendNoop ()
@@ -825,6 +969,8 @@ namespace Snails
 				{
 					if (CachedStore_)
 						CachedStore_->noop ();
+					else if (IsListening_)
+						MakeStore ();
 				});
 	}
 
@@ -860,6 +1006,7 @@ namespace Snails
 	void AccountThreadWorker::Disconnect ()
 	{
 		CachedFolders_.clear ();
+		ListenedNetFolder_.reset ();
 
 		if (!CachedStore_)
 			return;
@@ -878,6 +1025,17 @@ namespace Snails
 		sendNoop ();
 	}
 
+	void AccountThreadWorker::SetListenedFolder (const QStringList& folder)
+	{
+		if (!IsListening_ || folder == ListenedFolder_)
+			return;
+
+		ListenedFolder_ = folder;
+
+		if (CachedStore_)
+			Listen (CachedStore_);
+	}
+
 	auto AccountThreadWorker::Synchronize (const QList<QStringList>& foldersToFetch, const QByteArray& last) -> SyncResult
 	{
 		const auto& store = MakeStore ();
@@ -30,6 +30,7 @@
 #pragma once
 
 #include <boost/variant.hpp>
+#include <boost/optional.hpp>
 #include <QObject>
 #include <vmime/net/session.hpp>
 #include <vmime/net/message.hpp>
@@ -43,6 +44,7 @@
 #include "message.h"
 #include "account.h"
 #include "accountthreadworkerfwd.h"
+#include "common.h"
 
 class QTimer;
 
@@ -83,6 +85,9 @@ namespace Snails
 
 		Util::AssocCache<QStringList, vmime::shared_ptr<vmime::net::folder>> CachedFolders_;
 
+		QStringList ListenedFolder_;
+		vmime::shared_ptr<vmime::net::folder> ListenedNetFolder_;
+
 		const vmime::shared_ptr<vmime::security::cert::defaultCertificateVerifier> CertVerifier_;
 		const vmime::shared_ptr<vmime::security::authenticator> InAuth_;
 
@@ -101,6 +106,11 @@ namespace Snails
 			QList<Message_ptr> UpdatedMsgs_;
 			QList<QByteArray> OtherIds_;
 			QList<QByteArray> RemovedIds_;
+
+			/* Set only if the folder has been fully synchronized, so that
+			 * the next sync can be done incrementally against this state.
+			 */
+			boost::optional<FolderSyncState> SyncState_;
 		};
 		using Folder2Messages_t = QHash<QStringList, FolderMessages>;
 	private:
@@ -113,11 +123,16 @@ namespace Snails
 
 		Folder2Messages_t FetchMessagesIMAP (const QList<QStringList>&, const QByteArray&);
 		FolderMessages FetchMessagesInFolder (const QStringList&, const VmimeFolder_ptr&, const QByteArray&);
+		FolderMessages FetchChangedMessages (const QStringList&, const VmimeFolder_ptr&,
+				const FolderSyncState& stored, const FolderSyncState& current);
+		QList<Message_ptr> FetchNewHeaders (const QStringList&, const VmimeFolder_ptr&, const QList<QByteArray>&);
 
 		QList<Folder> SyncIMAPFolders (vmime::shared_ptr<vmime::net::store>);
 		QList<Message_ptr> FetchFullMessages (const std::vector<vmime::shared_ptr<vmime::net::message>>&);
 
 		void SetNoopTimeout (int);
+
+		void Listen (const vmime::shared_ptr<vmime::net::store>&);
 	public:
 		void SetNoopTimeoutChangeNotifier (const std::shared_ptr<AccountThreadNotifier<int>>&);
 
@@ -126,6 +141,12 @@ namespace Snails
 
 		void TestConnectivity ();
 
+		/* Makes the listening connection report the changes in the given
+		 * folder instead of the previous one. An empty path stands for
+		 * the INBOX.
+		 */
+		void SetListenedFolder (const QStringList&);
+
 		struct SyncResult
 		{
 			QList<Folder> AllFolders_;
@@ -152,6 +173,7 @@ namespace Snails
 		void SendMessage (const Message_ptr&);
 	private slots:
 		void handleMessagesChanged (const QStringList& folder, const QList<size_t>& numbers);
+		void handleMessageCountChanged (const QStringList& folder);
 
 		void sendNoop ();
 	signals:
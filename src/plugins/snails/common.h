@@ -44,7 +44,12 @@ namespace Snails
 	enum class TaskPriority
 	{
 		High,
-		Low
+		Low,
+
+		/* Runs only when nothing else is waiting, one task at a time
+		 * and only on the already established connections.
+		 */
+		Background
 	};
 
 	enum class MailListMode
@@ -52,5 +57,15 @@ namespace Snails
 		Normal,
 		MultiSelect
 	};
+
+	/** Server-side state of a folder as of its last full synchronization.
+	 *
+	 * HighestModSeq_ is zero if the server doesn't support CONDSTORE.
+	 */
+	struct FolderSyncState
+	{
+		quint32 UidValidity_ = 0;
+		quint64 HighestModSeq_ = 0;
+	};
 }
 }
@@ -0,0 +1,182 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "foldersync.h"
+#include <algorithm>
+#include <QSet>
+#include <QtDebug>
+#include <vmime/net/message.hpp>
+#include <vmime/net/messageSet.hpp>
+#include <vmime/net/imap/IMAPMessage.hpp>
+#include <vmime/net/imap/IMAPFolderStatus.hpp>
+
+namespace LeechCraft
+{
+namespace Snails
+{
+	boost::optional<FolderSyncState> GetServerSyncState (const vmime::shared_ptr<vmime::net::folder>& folder)
+	{
+		const auto& status = vmime::dynamicCast<vmime::net::imap::IMAPFolderStatus> (folder->getStatus ());
+		if (!status || !status->getUIDValidity ())
+			return {};
+
+		FolderSyncState state;
+		state.UidValidity_ = status->getUIDValidity ();
+		state.HighestModSeq_ = status->getHighestModSeq ();
+		return state;
+	}
+
+	FolderDelta DiffFolder (const QList<ServerMessageState>& listed,
+			QHash<QByteArray, bool> existing, bool isComplete)
+	{
+		FolderDelta delta;
+		for (const auto& state : listed)
+		{
+			const auto pos = existing.find (state.ID_);
+			if (pos == existing.end ())
+			{
+				delta.NewIds_ << state.ID_;
+				continue;
+			}
+
+			if (*pos != state.IsRead_)
+				delta.ChangedReadStatuses_ [state.ID_] = state.IsRead_;
+			else
+				delta.UnchangedIds_ << state.ID_;
+
+			existing.erase (pos);
+		}
+
+		if (isComplete)
+			delta.RemovedIds_ = existing.keys ();
+		else
+			delta.UnchangedIds_ += existing.keys ();
+
+		return delta;
+	}
+
+	bool AreModSeqsExplained (const QList<ServerMessageState>& newMessages,
+			quint64 storedModSeq, quint64 currentModSeq)
+	{
+		if (!storedModSeq || currentModSeq <= storedModSeq)
+			return storedModSeq && currentModSeq == storedModSeq;
+
+		QSet<quint64> modSeqs;
+		for (const auto& state : newMessages)
+		{
+			if (state.ModSeq_ <= storedModSeq || state.ModSeq_ > currentModSeq)
+				return false;
+
+			modSeqs << state.ModSeq_;
+		}
+
+		return static_cast<quint64> (modSeqs.size ()) >= currentModSeq - storedModSeq;
+	}
+
+	QList<ServerMessageState> ListMessageStates (const vmime::shared_ptr<vmime::net::folder>& folder,
+			const vmime::net::messageSet& set)
+	{
+		const auto& messages = folder->getAndFetchMessages (set,
+				vmime::net::fetchAttributes::FLAGS | vmime::net::fetchAttributes::UID);
+
+		QList<ServerMessageState> result;
+		result.reserve (messages.size ());
+		for (const auto& msg : messages)
+		{
+			// vmime fetches MODSEQ along with the flags if the server supports CONDSTORE.
+			const auto& imapMsg = vmime::dynamicCast<vmime::net::imap::IMAPMessage> (msg);
+			result.append ({
+					QByteArray { static_cast<vmime::string> (msg->getUID ()).c_str () },
+					static_cast<bool> (msg->getFlags () & vmime::net::message::FLAG_SEEN),
+					imapMsg ? imapMsg->getModSequence () : 0
+				});
+		}
+		return result;
+	}
+
+	namespace
+	{
+		quint64 GetHighestUid (const QHash<QByteArray, bool>& existing)
+		{
+			quint64 result = 0;
+			for (auto i = existing.begin (), end = existing.end (); i != end; ++i)
+				result = std::max (result, i.key ().toULongLong ());
+			return result;
+		}
+	}
+
+	FolderDelta FetchFolderDelta (const vmime::shared_ptr<vmime::net::folder>& folder,
+			const QHash<QByteArray, bool>& existing,
+			const FolderSyncState& stored, const FolderSyncState& current)
+	{
+		const auto serverCount = static_cast<int> (folder->getMessageCount ());
+
+		if (stored.HighestModSeq_ &&
+				stored.HighestModSeq_ == current.HighestModSeq_ &&
+				serverCount == existing.size ())
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "folder is unchanged since modseq"
+					<< stored.HighestModSeq_;
+			return { {}, {}, existing.keys (), {} };
+		}
+
+		/* Only the messages above the highest known UID can be new. Note
+		 * that n:* includes the last message even if its UID is below n.
+		 */
+		const auto highestUid = GetHighestUid (existing);
+		QList<ServerMessageState> newMessages;
+		for (const auto& state : ListMessageStates (folder,
+					vmime::net::messageSet::byUID (QByteArray::number (highestUid + 1).constData (), "*")))
+			if (state.ID_.toULongLong () > highestUid)
+				newMessages << state;
+
+		/* If nothing has been expunged and the new messages explain all
+		 * the modifications, the already known messages are unchanged.
+		 */
+		if (serverCount == existing.size () + newMessages.size () &&
+				AreModSeqsExplained (newMessages, stored.HighestModSeq_, current.HighestModSeq_))
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "only"
+					<< newMessages.size ()
+					<< "new messages since modseq"
+					<< stored.HighestModSeq_;
+			return DiffFolder (newMessages, existing, false);
+		}
+
+		/* vmime can't FETCH with CHANGEDSINCE, so any other change
+		 * requires listing the flags of the whole folder, which is still
+		 * much cheaper than the headers.
+		 */
+		return DiffFolder (ListMessageStates (folder, vmime::net::messageSet::byUID ("1", "*")),
+				existing, true);
+	}
+}
+}
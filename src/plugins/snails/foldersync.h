@@ -0,0 +1,96 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include <boost/optional.hpp>
+#include <vmime/net/folder.hpp>
+#include "common.h"
+
+namespace LeechCraft
+{
+namespace Snails
+{
+	/* The state of a single message as listed by the server.
+	 *
+	 * ModSeq_ is zero if the server doesn't support CONDSTORE.
+	 */
+	struct ServerMessageState
+	{
+		QByteArray ID_;
+		bool IsRead_;
+		quint64 ModSeq_;
+	};
+
+	/* The changes in a folder relative to the locally stored messages.
+	 */
+	struct FolderDelta
+	{
+		QList<QByteArray> NewIds_;
+		QHash<QByteArray, bool> ChangedReadStatuses_;
+		QList<QByteArray> UnchangedIds_;
+		QList<QByteArray> RemovedIds_;
+	};
+
+	/* Returns the current UIDVALIDITY and HIGHESTMODSEQ of the folder, or
+	 * an empty optional if the server doesn't report UIDVALIDITY.
+	 */
+	boost::optional<FolderSyncState> GetServerSyncState (const vmime::shared_ptr<vmime::net::folder>&);
+
+	/* Diffs the server listing against the read statuses of the stored
+	 * messages in linear time.
+	 *
+	 * If isComplete is false, the listing covers only some of the
+	 * messages in the folder, and the stored messages missing from it
+	 * are considered unchanged instead of removed.
+	 */
+	FolderDelta DiffFolder (const QList<ServerMessageState>& listed,
+			QHash<QByteArray, bool> existing, bool isComplete);
+
+	/* Returns whether the messages added since the storedModSeq account
+	 * for every modification up to the currentModSeq, that is, whether
+	 * nothing else has changed in the folder.
+	 */
+	bool AreModSeqsExplained (const QList<ServerMessageState>& newMessages,
+			quint64 storedModSeq, quint64 currentModSeq);
+
+	QList<ServerMessageState> ListMessageStates (const vmime::shared_ptr<vmime::net::folder>&,
+			const vmime::net::messageSet&);
+
+	/* Computes the changes in the folder since it has been synchronized
+	 * at the stored state, listing as few messages as possible.
+	 */
+	FolderDelta FetchFolderDelta (const vmime::shared_ptr<vmime::net::folder>&,
+			const QHash<QByteArray, bool>& existing,
+			const FolderSyncState& stored, const FolderSyncState& current);
+}
+}
@@ -28,9 +28,9 @@
  **********************************************************************/
 
 #include "mailmodel.h"
+#include <algorithm>
 #include <QIcon>
 #include <util/util.h>
-#include <util/sll/prelude.h>
 #include <util/models/modelitembase.h>
 #include <interfaces/core/iiconthememanager.h>
 #include "core.h"
@@ -40,35 +40,69 @@ namespace LeechCraft
 {
 namespace Snails
 {
-	struct MailModel::TreeNode : Util::ModelItemBase<MailModel::TreeNode>
+	struct MailModel::MessageInfo
 	{
-		Message_ptr Msg_;
+		QByteArray FolderId_;
+		QByteArray MessageId_;
 
-		QSet<QByteArray> UnreadChildren_;
+		QString From_;
+		QString Subject_;
+		QDateTime Date_;
+		quint64 Size_ = 0;
+		bool IsRead_ = false;
 
 		bool IsAvailable_ = true;
-
 		bool IsChecked_ = false;
 
+		MessageInfo *Parent_ = nullptr;
+		QList<MessageInfo*> Children_;
+
+		int TotalDescendants_ = 0;
+		int UnreadDescendants_ = 0;
+
+		/* The date of the most recent message in this (sub)thread.
+		 */
+		QDateTime LatestDate_;
+
+		TreeNode *Node_ = nullptr;
+
+		void SetMessage (const Message_ptr& msg)
+		{
+			const auto& addr = msg->GetAddress (Message::Address::From);
+			From_ = addr.first.isEmpty () ? addr.second : addr.first;
+			Subject_ = msg->GetSubject ();
+			Date_ = msg->GetDate ();
+			Size_ = msg->GetSize ();
+			IsRead_ = msg->IsRead ();
+		}
+	};
+
+	struct MailModel::TreeNode : Util::ModelItemBase<MailModel::TreeNode>
+	{
+		MessageInfo * const Info_ = nullptr;
+
+		/* Cached position in the parent, since the root may have
+		 * hundreds of thousands of children.
+		 */
+		int Row_ = 0;
+
+		bool ChildrenFetched_ = true;
+
 		TreeNode () = default;
 
-		TreeNode (const Message_ptr& msg, const TreeNode_ptr& parent)
+		TreeNode (MessageInfo *info, const TreeNode_ptr& parent, int row)
 		: Util::ModelItemBase<TreeNode> { parent }
-		, Msg_ { msg }
+		, Info_ { info }
+		, Row_ { row }
+		, ChildrenFetched_ { info->Children_.isEmpty () }
 		{
+			info->Node_ = this;
 		}
 
 		void SetParent (const TreeNode_wptr& parent)
 		{
 			Parent_ = parent;
 		}
-
-		template<typename G, typename F>
-		std::result_of_t<G (const TreeNode*)> Fold (const G& g, const F& f) const
-		{
-			const auto& values = Util::Map (Children_, [&] (const TreeNode_ptr& c) { return c->Fold (g, f); });
-			return std::accumulate (values.begin (), values.end (), g (this), f);
-		}
 	};
 
 	MailModel::MailModel (const MessageListActionsManager *actsMgr, QObject *parent)
@@ -120,19 +154,19 @@ namespace Snails
 		if (structItem == Root_.get ())
 			return {};
 
-		const auto& msg = structItem->Msg_;
+		const auto info = structItem->Info_;
 
 		const auto column = static_cast<Column> (index.column ());
 
 		switch (role)
 		{
 		case MessageActions:
-			return QVariant::fromValue (MsgId2Actions_.value (msg->GetFolderID ()));
+			return QVariant::fromValue (MsgId2Actions_.value (info->FolderId_));
 		case Qt::DisplayRole:
 		case Sort:
 			break;
 		case Qt::CheckStateRole:
-			return structItem->IsChecked_ ?
+			return info->IsChecked_ ?
 					Qt::Checked :
 					Qt::Unchecked;
 		case Qt::TextAlignmentRole:
@@ -153,9 +187,9 @@ namespace Snails
 			switch (column)
 			{
 			case Column::StatusIcon:
-				if (!msg->IsRead ())
+				if (!info->IsRead_)
 					iconName = "mail-unread-new";
-				else if (structItem->UnreadChildren_.size ())
+				else if (info->UnreadDescendants_)
 					iconName = "mail-unread";
 				else
 					iconName = "mail-read";
@@ -170,14 +204,13 @@ namespace Snails
 			return Core::Instance ().GetProxy ()->GetIconThemeManager ()->GetIcon (iconName);
 		}
 		case ID:
-			return msg->GetFolderID ();
+			return info->FolderId_;
 		case IsRead:
-			return msg->IsRead ();
+			return info->IsRead_;
 		case UnreadChildrenCount:
-			return structItem->UnreadChildren_.size ();
+			return info->UnreadDescendants_;
 		case TotalChildrenCount:
-			return structItem->Fold ([] (const TreeNode *n) { return n->GetRowCount (); },
-					[] (int a, int b) { return a + b; });
+			return info->TotalDescendants_;
 		default:
 			return {};
 		}
@@ -185,21 +218,14 @@ namespace Snails
 		switch (column)
 		{
 		case Column::From:
-		{
-			const auto& addr = msg->GetAddress (Message::Address::From);
-			return addr.first.isEmpty () ? addr.second : addr.first;
-		}
+			return info->From_;
 		case Column::Subject:
-		{
-			const auto& subject = msg->GetSubject ();
-			return subject.isEmpty () ? "<" + tr ("No subject") + ">" : subject;
-		}
+			return info->Subject_.isEmpty () ? "<" + tr ("No subject") + ">" : info->Subject_;
 		case Column::Date:
 		{
-			const auto& date = role != Sort || index.parent ().isValid () ?
-						msg->GetDate () :
-						structItem->Fold ([] (const TreeNode *n) { return n->Msg_->GetDate (); },
-								[] (auto d1, auto d2) { return std::max (d1, d2); });
+			const auto& date = role != Sort || info->Parent_ ?
+						info->Date_ :
+						info->LatestDate_;
 			if (role == Sort)
 				return date;
 			else
@@ -207,11 +233,11 @@ namespace Snails
 		}
 		case Column::Size:
 			if (role == Sort)
-				return msg->GetSize ();
+				return info->Size_;
 			else
-				return Util::MakePrettySize (msg->GetSize ());
+				return Util::MakePrettySize (info->Size_);
 		case Column::UnreadChildren:
-			if (const auto unread = structItem->UnreadChildren_.size ())
+			if (const auto unread = info->UnreadDescendants_)
 				return unread;
 
 			return role == Sort ? 0 : QString::fromUtf8 ("·");
@@ -229,7 +255,7 @@ namespace Snails
 			flags |= Qt::ItemIsEditable;
 
 		const auto structItem = static_cast<TreeNode*> (index.internalPointer ());
-		if (!structItem->IsAvailable_)
+		if (structItem->Info_ && !structItem->Info_->IsAvailable_)
 			flags &= ~Qt::ItemIsEnabled;
 
 		return flags;
@@ -253,11 +279,7 @@ namespace Snails
 			return {};
 
 		const auto structItem = static_cast<TreeNode*> (index.internalPointer ());
-		const auto& parentItem = structItem->GetParent ();
-		if (parentItem == Root_)
-			return {};
-
-		return createIndex (parentItem->GetRow (), 0, parentItem.get ());
+		return GetIndex (structItem->GetParent ().get (), 0);
 	}
 
 	int MailModel::rowCount (const QModelIndex& parent) const
@@ -268,6 +290,44 @@ namespace Snails
 		return structItem->GetRowCount ();
 	}
 
+	bool MailModel::hasChildren (const QModelIndex& parent) const
+	{
+		if (!parent.isValid ())
+			return !Root_->IsEmpty ();
+
+		const auto structItem = static_cast<TreeNode*> (parent.internalPointer ());
+		return !structItem->Info_->Children_.isEmpty ();
+	}
+
+	bool MailModel::canFetchMore (const QModelIndex& parent) const
+	{
+		if (!parent.isValid ())
+			return false;
+
+		return !static_cast<TreeNode*> (parent.internalPointer ())->ChildrenFetched_;
+	}
+
+	void MailModel::fetchMore (const QModelIndex& parent)
+	{
+		if (!parent.isValid ())
+			return;
+
+		const auto structItem = static_cast<TreeNode*> (parent.internalPointer ());
+		if (structItem->ChildrenFetched_)
+			return;
+
+		structItem->ChildrenFetched_ = true;
+
+		const auto& children = structItem->Info_->Children_;
+		if (children.isEmpty ())
+			return;
+
+		beginInsertRows (parent, 0, children.size () - 1);
+		for (const auto child : children)
+			MakeNode (child, structItem);
+		endInsertRows ();
+	}
+
 	bool MailModel::setData (const QModelIndex& index, const QVariant& value, int role)
 	{
 		if (role != Qt::CheckStateRole)
@@ -277,7 +337,7 @@ namespace Snails
 			return false;
 
 		const auto structItem = static_cast<TreeNode*> (index.internalPointer ());
-		structItem->IsChecked_ = value.toInt () == Qt::Checked;
+		structItem->Info_->IsChecked_ = value.toInt () == Qt::Checked;
 
 		emit dataChanged (index, index);
 
@@ -296,24 +356,18 @@ namespace Snails
 		return Folder_;
 	}
 
-	Message_ptr MailModel::GetMessage (const QByteArray& id) const
-	{
-		return GetMessageByFolderId (id);
-	}
-
 	void MailModel::Clear ()
 	{
-		if (Messages_.isEmpty ())
+		if (Infos_.isEmpty ())
 			return;
 
-		beginRemoveRows ({}, 0, Messages_.size () - 1);
-		Messages_.clear ();
+		beginResetModel ();
 		Root_->EraseChildren (Root_->begin (), Root_->end ());
-		FolderId2Nodes_.clear ();
+		Infos_.clear ();
 		MsgId2FolderId_.clear ();
-		endRemoveRows ();
-
+		PendingReplies_.clear ();
 		MsgId2Actions_.clear ();
+		endResetModel ();
 	}
 
 	void MailModel::Append (QList<Message_ptr> messages)
@@ -347,76 +401,124 @@ namespace Snails
 				[] (const Message_ptr& left, const Message_ptr& right)
 					{ return left->GetDate () < right->GetDate (); });
 
-		Messages_ += messages;
-
+		QList<MessageInfo*> newRoots;
 		for (const auto& msg : messages)
 		{
-			const auto& msgId = msg->GetMessageID ();
-			if (!msgId.isEmpty ())
-				MsgId2FolderId_ [msgId] = msg->GetFolderID ();
-
 			const auto& acts = ActionsMgr_->GetMessageActions (msg);
 			if (!acts.isEmpty ())
 				MsgId2Actions_ [msg->GetFolderID ()] = acts;
+
+			const auto info = AddInfo (msg);
+			if (!info->Parent_)
+				newRoots << info;
 		}
 
-		for (const auto& msg : messages)
-			if (!AppendStructured (msg))
-			{
-				const auto node = std::make_shared<TreeNode> (msg, Root_);
+		newRoots.erase (std::remove_if (newRoots.begin (), newRoots.end (),
+					[] (MessageInfo *info) { return info->Parent_; }),
+				newRoots.end ());
 
-				const auto childrenCount = Root_->GetRowCount ();
-				beginInsertRows ({}, childrenCount, childrenCount);
-				Root_->AppendExisting (node);
-				FolderId2Nodes_ [msg->GetFolderID ()] << node;
-				endInsertRows ();
-			}
+		if (!newRoots.isEmpty ())
+		{
+			const auto firstRow = Root_->GetRowCount ();
+			beginInsertRows ({}, firstRow, firstRow + newRoots.size () - 1);
+			for (const auto info : newRoots)
+				MakeNode (info, Root_.get ());
+			endInsertRows ();
+		}
 
 		emit messageListUpdated ();
 	}
 
 	bool MailModel::Update (const Message_ptr& msg)
 	{
-		const auto pos = std::find_if (Messages_.begin (), Messages_.end (),
-				[&msg] (const Message_ptr& other)
-					{ return other->GetFolderID () == msg->GetFolderID (); });
-		if (pos == Messages_.end ())
+		const auto& info = Infos_.value (msg->GetFolderID ());
+		if (!info)
 			return false;
 
-		if (*pos != msg)
-		{
-			const auto readChanged = (*pos)->IsRead () != msg->IsRead ();
+		const auto wasRead = info->IsRead_;
 
-			*pos = msg;
-			for (const auto& indexPair : GetIndexes (msg->GetFolderID (), { 0, columnCount () - 1 }))
-			{
-				for (const auto& index : indexPair)
-					static_cast<TreeNode*> (index.internalPointer ())->Msg_ = msg;
-				emit dataChanged (indexPair.value (0), indexPair.value (1));
-			}
+		info->SetMessage (msg);
 
-			if (readChanged)
-				UpdateParentReadCount (msg->GetFolderID (), !msg->IsRead ());
-		}
+		if (info->Node_)
+			EmitRowChanged (info->Node_);
+
+		if (wasRead != info->IsRead_)
+			UpdateAncestors (info.get (), 0, info->IsRead_ ? -1 : 1);
 
 		return true;
 	}
 
 	bool MailModel::Remove (const QByteArray& id)
 	{
-		const auto msgPos = std::find_if (Messages_.begin (), Messages_.end (),
-				[&id] (const Message_ptr& other) { return other->GetFolderID () == id; });
-		if (msgPos == Messages_.end ())
+		const auto info = Infos_.value (id);
+		if (!info)
 			return false;
 
-		UpdateParentReadCount (id, false);
+		const auto parent = info->Parent_;
+		if (parent)
+		{
+			UpdateAncestors (info.get (), -1, info->IsRead_ ? 0 : -1);
+			parent->Children_.removeOne (info.get ());
+		}
+
+		for (const auto child : info->Children_)
+		{
+			child->Parent_ = parent;
+			if (parent)
+				parent->Children_ << child;
+		}
+
+		if (parent)
+			UpdateLatestDates (parent);
+
+		if (const auto node = info->Node_)
+		{
+			const auto parentNode = node->GetParent ();
+
+			if (!node->ChildrenFetched_)
+			{
+				RemoveNode (node);
 
-		for (const auto& node : FolderId2Nodes_.value (id))
-			RemoveNode (node);
+				// The parent node has all its children, so the moved ones need nodes too.
+				if (!info->Children_.isEmpty ())
+				{
+					const auto firstRow = parentNode->GetRowCount ();
+					beginInsertRows (GetIndex (parentNode.get (), 0),
+							firstRow, firstRow + info->Children_.size () - 1);
+					for (const auto child : info->Children_)
+						MakeNode (child, parentNode.get ());
+					endInsertRows ();
+				}
+			}
+			else
+			{
+				if (const auto childCount = node->GetRowCount ())
+				{
+					beginRemoveRows (GetIndex (node, 0), 0, childCount - 1);
+					const auto childNodes = node->GetChildren ();
+					node->GetChildren ().clear ();
+					endRemoveRows ();
+
+					const auto firstRow = parentNode->GetRowCount ();
+					for (int i = 0; i < childNodes.size (); ++i)
+					{
+						childNodes [i]->SetParent (parentNode);
+						childNodes [i]->Row_ = firstRow + i;
+					}
+
+					beginInsertRows (GetIndex (parentNode.get (), 0), firstRow, firstRow + childCount - 1);
+					parentNode->AppendExisting (childNodes);
+					endInsertRows ();
+				}
+
+				RemoveNode (node);
+			}
+		}
 
-		FolderId2Nodes_.remove (id);
-		MsgId2FolderId_.remove ((*msgPos)->GetMessageID ());
-		Messages_.erase (msgPos);
+		if (MsgId2FolderId_.value (info->MessageId_) == id)
+			MsgId2FolderId_.remove (info->MessageId_);
+		MsgId2Actions_.remove (id);
+		Infos_.remove (id);
 
 		return true;
 	}
@@ -424,185 +526,191 @@ namespace Snails
 	void MailModel::MarkUnavailable (const QList<QByteArray>& ids)
 	{
 		for (const auto& id : ids)
-			for (const auto& node : FolderId2Nodes_.value (id))
-			{
-				if (!node->IsAvailable_)
-					continue;
+		{
+			const auto& info = Infos_.value (id);
+			if (!info || !info->IsAvailable_)
+				continue;
 
-				node->IsAvailable_ = false;
-				EmitRowChanged (node);
-			}
+			info->IsAvailable_ = false;
+			if (info->Node_)
+				EmitRowChanged (info->Node_);
+		}
 	}
 
 	QList<QByteArray> MailModel::GetCheckedIds () const
 	{
 		QList<QByteArray> result;
 
-		for (const auto& list : FolderId2Nodes_)
-			for (const auto& node : list)
-				if (node->IsChecked_)
-					result << node->Msg_->GetFolderID ();
+		for (const auto& info : Infos_)
+			if (info->IsChecked_)
+				result << info->FolderId_;
 
 		std::sort (result.begin (), result.end ());
-		result.erase (std::unique (result.begin (), result.end ()), result.end ());
 
 		return result;
 	}
 
 	bool MailModel::HasCheckedIds () const
 	{
-		return std::any_of (FolderId2Nodes_.begin (), FolderId2Nodes_.end (),
-				[] (const auto& list)
-				{
-					return std::any_of (list.begin (), list.end (),
-							[] (const auto& node) { return node->IsChecked_; });
-				});
+		return std::any_of (Infos_.begin (), Infos_.end (),
+				[] (const auto& info) { return info->IsChecked_; });
 	}
 
-	void MailModel::UpdateParentReadCount (const QByteArray& folderId, bool addUnread)
+	MailModel::MessageInfo* MailModel::AddInfo (const Message_ptr& msg)
 	{
-		QList<TreeNode_ptr> nodes;
-		for (const auto& node : FolderId2Nodes_.value (folderId))
-		{
-			const auto& parent = node->GetParent ();
-			if (parent != Root_)
-				nodes << parent;
-		}
+		const auto& info = std::make_shared<MessageInfo> ();
+		info->FolderId_ = msg->GetFolderID ();
+		info->MessageId_ = msg->GetMessageID ();
+		info->SetMessage (msg);
+		info->LatestDate_ = info->Date_;
+		Infos_ [info->FolderId_] = info;
 
-		for (int i = 0; i < nodes.size (); ++i)
-		{
-			const auto& item = nodes.at (i);
+		auto refs = msg->GetReferences ();
+		for (const auto& replyTo : msg->GetInReplyTo ())
+			if (!refs.contains (replyTo))
+				refs << replyTo;
 
-			bool emitUpdate = false;
-			if (addUnread && !item->UnreadChildren_.contains (folderId))
-			{
-				item->UnreadChildren_ << folderId;
-				emitUpdate = true;
-			}
-			else if (!addUnread && item->UnreadChildren_.remove (folderId))
-				emitUpdate = true;
+		if (const auto parent = FindParent (refs))
+			Link (info.get (), parent);
+		else if (!refs.isEmpty ())
+			PendingReplies_ [refs.last ()] << info->FolderId_;
 
-			if (emitUpdate)
-			{
-				const auto& leftIdx = createIndex (item->GetRow (), 0, item.get ());
-				const auto& rightIdx = createIndex (item->GetRow (), columnCount () - 1, item.get ());
-				emit dataChanged (leftIdx, rightIdx);
-			}
+		if (!info->MessageId_.isEmpty ())
+		{
+			MsgId2FolderId_ [info->MessageId_] = info->FolderId_;
 
-			const auto& parent = item->GetParent ();
-			if (parent != Root_)
-				nodes << parent;
+			for (const auto& replyId : PendingReplies_.take (info->MessageId_))
+				if (const auto& reply = Infos_.value (replyId))
+					Adopt (reply.get (), info.get ());
 		}
+
+		return info.get ();
 	}
 
-	void MailModel::RemoveNode (const TreeNode_ptr& node)
+	MailModel::MessageInfo* MailModel::FindParent (const QList<QByteArray>& refs) const
 	{
-		const auto& parent = node->GetParent ();
-
-		const auto& parentIndex = parent == Root_ ?
-				QModelIndex {} :
-				createIndex (parent->GetRow (), 0, parent.get ());
-
-		const auto row = node->GetRow ();
-
-		// TODO can this be reworked?
-		if (const auto childCount = node->GetRowCount ())
+		for (int i = refs.size () - 1; i >= 0; --i)
 		{
-			const auto& nodeIndex = createIndex (row, 0, node.get ());
+			const auto& folderId = MsgId2FolderId_.value (refs.at (i));
+			if (folderId.isEmpty ())
+				continue;
 
-			beginRemoveRows (nodeIndex, 0, childCount - 1);
-			auto childNodes = std::move (node->GetChildren ());
-			endRemoveRows ();
+			if (const auto& info = Infos_.value (folderId))
+				return info.get ();
+		}
 
-			for (const auto& childNode : childNodes)
-				childNode->SetParent (parent);
+		return nullptr;
+	}
 
-			beginInsertRows (parentIndex,
-					parent->GetRowCount (),
-					parent->GetRowCount () + childCount - 1);
-			parent->AppendExisting (childNodes);
-			endInsertRows ();
-		}
+	void MailModel::Link (MessageInfo *child, MessageInfo *parent)
+	{
+		child->Parent_ = parent;
+		parent->Children_ << child;
 
-		beginRemoveRows (parentIndex, row, row);
-		parent->EraseChild (parent->begin () + row);
-		endRemoveRows ();
+		UpdateAncestors (child,
+				child->TotalDescendants_ + 1,
+				child->UnreadDescendants_ + !child->IsRead_,
+				child->LatestDate_);
+
+		if (parent->Node_ && parent->Node_->ChildrenFetched_)
+			InsertNode (child, parent->Node_);
 	}
 
-	bool MailModel::AppendStructured (const Message_ptr& msg)
+	void MailModel::Adopt (MessageInfo *reply, MessageInfo *parent)
 	{
-		auto refs = msg->GetReferences ();
-		for (const auto& replyTo : msg->GetInReplyTo ())
-			if (!refs.contains (replyTo))
-				refs << replyTo;
+		if (reply->Parent_)
+			return;
 
-		if (refs.isEmpty ())
-			return false;
+		for (auto ancestor = parent; ancestor; ancestor = ancestor->Parent_)
+			if (ancestor == reply)
+				return;
 
-		QByteArray folderId;
-		for (int i = refs.size () - 1; i >= 0; --i)
+		if (reply->Node_)
+			RemoveNode (reply->Node_);
+
+		Link (reply, parent);
+	}
+
+	void MailModel::UpdateAncestors (MessageInfo *info, int totalDelta, int unreadDelta, const QDateTime& latest)
+	{
+		for (auto ancestor = info->Parent_; ancestor; ancestor = ancestor->Parent_)
 		{
-			folderId = MsgId2FolderId_.value (refs.at (i));
-			if (!folderId.isEmpty ())
-				break;
+			ancestor->TotalDescendants_ += totalDelta;
+			ancestor->UnreadDescendants_ += unreadDelta;
+			if (latest.isValid () && latest > ancestor->LatestDate_)
+				ancestor->LatestDate_ = latest;
+
+			if (ancestor->Node_)
+				EmitRowChanged (ancestor->Node_);
 		}
-		if (folderId.isEmpty ())
-			return false;
+	}
 
-		const auto& indexes = GetIndexes (folderId, 0);
-		for (const auto& parentIndex : indexes)
+	void MailModel::UpdateLatestDates (MessageInfo *info)
+	{
+		for (; info; info = info->Parent_)
 		{
-			const auto parentNode = static_cast<TreeNode*> (parentIndex.internalPointer ());
-			const auto row = parentNode->GetRowCount ();
+			auto latest = info->Date_;
+			for (const auto child : info->Children_)
+				latest = std::max (latest, child->LatestDate_);
 
-			const auto node = std::make_shared<TreeNode> (msg, parentNode->shared_from_this ());
-			beginInsertRows (parentIndex, row, row);
-			parentNode->AppendExisting (node);
-			FolderId2Nodes_ [msg->GetFolderID ()] << node;
-			endInsertRows ();
-		}
+			if (latest == info->LatestDate_)
+				break;
 
-		if (!msg->IsRead ())
-			UpdateParentReadCount (msg->GetFolderID (), true);
+			info->LatestDate_ = latest;
+			if (info->Node_)
+				EmitRowChanged (info->Node_);
+		}
+	}
 
-		return !indexes.isEmpty ();
+	void MailModel::MakeNode (MessageInfo *info, TreeNode *parent)
+	{
+		parent->AppendExisting (std::make_shared<TreeNode> (info, parent->shared_from_this (), parent->GetRowCount ()));
 	}
 
-	void MailModel::EmitRowChanged (const TreeNode_ptr& node)
+	void MailModel::InsertNode (MessageInfo *info, TreeNode *parent)
 	{
-		emit dataChanged (GetIndex (node, 0),
-				GetIndex (node, static_cast<int> (Column::MaxNext)));
+		const auto row = parent->GetRowCount ();
+		beginInsertRows (GetIndex (parent, 0), row, row);
+		MakeNode (info, parent);
+		endInsertRows ();
 	}
 
-	QModelIndex MailModel::GetIndex (const TreeNode_ptr& node, int column) const
+	void MailModel::RemoveNode (TreeNode *node)
 	{
-		return createIndex (node->GetRow (), column, node.get ());
+		const auto& parent = node->GetParent ();
+		const auto row = node->Row_;
+
+		beginRemoveRows (GetIndex (parent.get (), 0), row, row);
+
+		Dematerialize (node);
+		parent->EraseChild (parent->begin () + row);
+
+		auto& siblings = parent->GetChildren ();
+		for (int i = row; i < siblings.size (); ++i)
+			siblings [i]->Row_ = i;
+
+		endRemoveRows ();
 	}
 
-	QList<QModelIndex> MailModel::GetIndexes (const QByteArray& folderId, int column) const
+	void MailModel::Dematerialize (TreeNode *node)
 	{
-		return Util::Map (FolderId2Nodes_.value (folderId),
-				[this, column] (const auto& node) { return GetIndex (node, column); });
+		node->Info_->Node_ = nullptr;
+		for (const auto& child : *node)
+			Dematerialize (child.get ());
 	}
 
-	QList<QList<QModelIndex>> MailModel::GetIndexes (const QByteArray& folderId, const QList<int>& columns) const
+	void MailModel::EmitRowChanged (const TreeNode *node)
 	{
-		return Util::Map (FolderId2Nodes_.value (folderId),
-				[this, &columns] (const auto& node)
-				{
-					return Util::Map (columns,
-							[this, &node] (auto column) { return GetIndex (node, column); });
-				});
+		emit dataChanged (GetIndex (node, 0),
+				GetIndex (node, static_cast<int> (Column::MaxNext)));
 	}
 
-	Message_ptr MailModel::GetMessageByFolderId (const QByteArray& id) const
+	QModelIndex MailModel::GetIndex (const TreeNode *node, int column) const
 	{
-		const auto pos = std::find_if (Messages_.begin (), Messages_.end (),
-				[&id] (const Message_ptr& msg) { return msg->GetFolderID () == id; });
-		if (pos == Messages_.end ())
+		if (!node || node == Root_.get ())
 			return {};
 
-		return *pos;
+		return createIndex (node->Row_, column, const_cast<TreeNode*> (node));
 	}
 }
 }
@@ -29,8 +29,10 @@
 
 #pragma once
 
+#include <memory>
 #include <QStringList>
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QList>
 #include "message.h"
 #include "messagelistactioninfo.h"
@@ -41,6 +43,13 @@ namespace Snails
 {
 	class MessageListActionsManager;
 
+	/* Keeps a compact summary of each message in the folder instead of
+	 * the messages themselves and threads the summaries as they arrive.
+	 *
+	 * Only the thread roots always have tree nodes, the replies get
+	 * theirs once their parent is expanded (see canFetchMore() and
+	 * fetchMore()).
+	 */
 	class MailModel : public QAbstractItemModel
 	{
 		Q_OBJECT
@@ -51,15 +60,22 @@ namespace Snails
 
 		QStringList Folder_;
 
+		struct MessageInfo;
+		typedef std::shared_ptr<MessageInfo> MessageInfo_ptr;
+
 		struct TreeNode;
 		typedef std::shared_ptr<TreeNode> TreeNode_ptr;
 		typedef std::weak_ptr<TreeNode> TreeNode_wptr;
 		const TreeNode_ptr Root_;
 
-		QList<Message_ptr> Messages_;
-		QHash<QByteArray, QList<TreeNode_ptr>> FolderId2Nodes_;
+		QHash<QByteArray, MessageInfo_ptr> Infos_;
 		QHash<QByteArray, QByteArray> MsgId2FolderId_;
 
+		/* Folder IDs of the messages whose parent hasn't been seen yet,
+		 * keyed by the Message-ID of that parent.
+		 */
+		QHash<QByteArray, QList<QByteArray>> PendingReplies_;
+
 		QHash<QByteArray, QList<MessageListActionInfo>> MsgId2Actions_;
 	public:
 		enum class Column
@@ -93,13 +109,14 @@ namespace Snails
 		QModelIndex index (int, int, const QModelIndex& = {}) const;
 		QModelIndex parent (const QModelIndex&) const;
 		int rowCount (const QModelIndex& = {}) const;
+		bool hasChildren (const QModelIndex& = {}) const;
+		bool canFetchMore (const QModelIndex&) const;
+		void fetchMore (const QModelIndex&);
 		bool setData (const QModelIndex&, const QVariant&, int);
 
 		void SetFolder (const QStringList&);
 		QStringList GetCurrentFolder () const;
 
-		Message_ptr GetMessage (const QByteArray&) const;
-
 		void Clear ();
 
 		void Append (QList<Message_ptr>);
@@ -112,17 +129,22 @@ namespace Snails
 		QList<QByteArray> GetCheckedIds () const;
 		bool HasCheckedIds () const;
 	private:
-		void UpdateParentReadCount (const QByteArray&, bool);
+		MessageInfo* AddInfo (const Message_ptr&);
+		MessageInfo* FindParent (const QList<QByteArray>& refs) const;
+		void Link (MessageInfo *child, MessageInfo *parent);
+		void Adopt (MessageInfo *reply, MessageInfo *parent);
+
+		void UpdateAncestors (MessageInfo*, int totalDelta, int unreadDelta, const QDateTime& latest = {});
+		void UpdateLatestDates (MessageInfo*);
 
-		void RemoveNode (const TreeNode_ptr&);
-		bool AppendStructured (const Message_ptr&);
+		void MakeNode (MessageInfo*, TreeNode*);
+		void InsertNode (MessageInfo*, TreeNode*);
+		void RemoveNode (TreeNode*);
+		void Dematerialize (TreeNode*);
 
-		void EmitRowChanged (const TreeNode_ptr&);
+		void EmitRowChanged (const TreeNode*);
 
-		QModelIndex GetIndex (const TreeNode_ptr& node, int column) const;
-		QList<QModelIndex> GetIndexes (const QByteArray& folderId, int column) const;
-		QList<QList<QModelIndex>> GetIndexes (const QByteArray& folderId, const QList<int>& columns) const;
-		Message_ptr GetMessageByFolderId (const QByteArray&) const;
+		QModelIndex GetIndex (const TreeNode* node, int column) const;
 	signals:
 		void messageListUpdated ();
 		void messagesSelectionChanged ();
@@ -82,7 +82,7 @@ namespace Snails
 
 		try
 		{
-			mailModel->Append (Storage_->LoadMessages (Acc_, path, ids));
+			mailModel->Append (Storage_->LoadMessages (Acc_, path));
 		}
 		catch (const std::exception& e)
 		{
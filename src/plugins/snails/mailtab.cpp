@@ -719,6 +719,7 @@ namespace Snails
 	{
 		const auto& folder = sidx.data (FoldersModel::Role::FolderPath).toStringList ();
 		CurrAcc_->GetMailModelsManager ()->ShowFolder (folder, MailModel_.get ());
+		CurrAcc_->SetListenedFolder (folder);
 		Ui_.MailTree_->setCurrentIndex ({});
 
 		handleMailSelected ();
@@ -1008,12 +1009,17 @@ namespace Snails
 
 		for (const auto& id : GetSelectedIds ())
 		{
-			const auto& msg = MailModel_->GetMessage (id);
-			if (!msg)
+			Message_ptr msg;
+			try
+			{
+				msg = Storage_->LoadMessage (CurrAcc_.get (), MailModel_->GetCurrentFolder (), id);
+			}
+			catch (const std::exception& e)
 			{
 				qWarning () << Q_FUNC_INFO
 						<< "no message for id"
-						<< id;
+						<< id
+						<< e.what ();
 				continue;
 			}
 
@@ -1050,6 +1056,9 @@ namespace Snails
 		{
 			f (index);
 
+			if (model->canFetchMore (index))
+				model->fetchMore (index);
+
 			for (int i = 0; i < model->rowCount (index); ++i)
 				Recurse (model->index (i, 0, index), model, f);
 		}
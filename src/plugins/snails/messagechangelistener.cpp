@@ -64,5 +64,13 @@ namespace Snails
 
 		emit messagesChanged (GetFolderPath (folder), numsList);
 	}
+
+	void MessageChangeListener::messageCount (vmime::shared_ptr<vmime::net::events::messageCountEvent> event)
+	{
+		if (!IsEnabled_)
+			return;
+
+		emit messageCountChanged (GetFolderPath (event->getFolder ()));
+	}
 }
 }
@@ -38,6 +38,7 @@ namespace Snails
 {
 	class MessageChangeListener : public QObject
 								, public vmime::net::events::messageChangedListener
+								, public vmime::net::events::messageCountListener
 	{
 		Q_OBJECT
 
@@ -48,8 +49,10 @@ namespace Snails
 		std::shared_ptr<void> Disable ();
 	protected:
 		void messageChanged (vmime::shared_ptr<vmime::net::events::messageChangedEvent>) override;
+		void messageCount (vmime::shared_ptr<vmime::net::events::messageCountEvent>) override;
 	signals:
 		void messagesChanged (const QStringList& folder, const QList<size_t>& numbers);
+		void messageCountChanged (const QStringList& folder);
 	};
 }
 }
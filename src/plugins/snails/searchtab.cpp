@@ -0,0 +1,206 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "searchtab.h"
+#include <QElapsedTimer>
+#include <QStandardItemModel>
+#include <QtConcurrentRun>
+#include <util/sll/visitor.h>
+#include <util/threads/futures.h>
+#include "accountsmanager.h"
+#include "storage.h"
+
+namespace LeechCraft
+{
+namespace Snails
+{
+	namespace
+	{
+		enum Column
+		{
+			Subject,
+			From,
+			Folder,
+			Date
+		};
+
+		const int RowRole = Qt::UserRole + 1;
+	}
+
+	SearchTab::SearchTab (const AccountsManager *accsMgr, Storage *st,
+			const TabClassInfo& tc, QObject *pmt, QWidget *parent)
+	: QWidget { parent }
+	, AccsMgr_ { accsMgr }
+	, Storage_ { st }
+	, TabClass_ { tc }
+	, PMT_ { pmt }
+	, ResultsModel_ { new QStandardItemModel { this } }
+	{
+		Ui_.setupUi (this);
+
+		Ui_.AccountsBox_->setModel (AccsMgr_->GetAccountsModel ());
+
+		ResultsModel_->setHorizontalHeaderLabels ({ tr ("Subject"), tr ("From"), tr ("Folder"), tr ("Date") });
+		Ui_.ResultsView_->setModel (ResultsModel_);
+
+		connect (Ui_.SearchEdit_,
+				SIGNAL (returnPressed ()),
+				this,
+				SLOT (search ()));
+		connect (Ui_.ResultsView_->selectionModel (),
+				SIGNAL (currentRowChanged (QModelIndex, QModelIndex)),
+				this,
+				SLOT (handleResultSelected (QModelIndex)));
+	}
+
+	TabClassInfo SearchTab::GetTabClassInfo () const
+	{
+		return TabClass_;
+	}
+
+	QObject* SearchTab::ParentMultiTabs ()
+	{
+		return PMT_;
+	}
+
+	void SearchTab::Remove ()
+	{
+		emit removeTab (this);
+		deleteLater ();
+	}
+
+	QToolBar* SearchTab::GetToolBar () const
+	{
+		return nullptr;
+	}
+
+	void SearchTab::ShowMessage (const Message_ptr& msg)
+	{
+		QString text;
+		text += tr ("Subject: %1").arg (msg->GetSubject ()) + "\n";
+		text += tr ("From: %1").arg (msg->GetAddressString (Message::Address::From)) + "\n";
+		text += tr ("To: %1").arg (msg->GetAddressString (Message::Address::To)) + "\n";
+		text += tr ("Date: %1").arg (msg->GetDate ().toLocalTime ().toString ()) + "\n\n";
+		text += msg->GetBody ();
+		Ui_.Preview_->setPlainText (text);
+	}
+
+	void SearchTab::search ()
+	{
+		ResultsModel_->removeRows (0, ResultsModel_->rowCount ());
+		Results_.clear ();
+		CurrMsg_.reset ();
+		Ui_.Preview_->clear ();
+
+		const auto& acc = AccsMgr_->GetAccount (Ui_.AccountsBox_->model ()->
+					index (Ui_.AccountsBox_->currentIndex (), 0));
+		if (!acc)
+			return;
+
+		QElapsedTimer timer;
+		timer.start ();
+
+		Ui_.StatusLabel_->setText (tr ("Searching..."));
+
+		const auto searchId = ++LastSearchId_;
+		const auto storage = Storage_;
+		const auto& text = Ui_.SearchEdit_->text ();
+		Util::Sequence (this, QtConcurrent::run ([storage, acc, text] { return storage->SearchMessages (acc.get (), text); })) >>
+				[this, searchId, timer] (const QList<Message_ptr>& results)
+				{
+					if (searchId != LastSearchId_)
+						return;
+
+					ShowResults (results);
+
+					Ui_.StatusLabel_->setText (tr ("%n message(s) found in %1 ms", 0, Results_.size ())
+								.arg (timer.elapsed ()));
+				};
+	}
+
+	void SearchTab::ShowResults (const QList<Message_ptr>& results)
+	{
+		Results_ = results;
+
+		for (int i = 0; i < Results_.size (); ++i)
+		{
+			const auto& msg = Results_.at (i);
+
+			QList<QStandardItem*> row
+			{
+				new QStandardItem { msg->GetSubject () },
+				new QStandardItem { msg->GetAddressString (Message::Address::From) },
+				new QStandardItem { msg->GetFolders ().value (0).join ("/") },
+				new QStandardItem { msg->GetDate ().toLocalTime ().toString (Qt::SystemLocaleShortDate) }
+			};
+			row.at (Column::Subject)->setData (i, RowRole);
+			row.at (Column::Date)->setData (msg->GetDate (), Qt::UserRole);
+			ResultsModel_->appendRow (row);
+		}
+	}
+
+	void SearchTab::handleResultSelected (const QModelIndex& index)
+	{
+		const auto row = index.sibling (index.row (), Column::Subject).data (RowRole);
+		if (!row.isValid ())
+			return;
+
+		CurrMsg_ = Results_.value (row.toInt ());
+		if (!CurrMsg_)
+			return;
+
+		ShowMessage (CurrMsg_);
+
+		if (CurrMsg_->IsFullyFetched ())
+			return;
+
+		const auto& acc = AccsMgr_->GetAccount (Ui_.AccountsBox_->model ()->
+					index (Ui_.AccountsBox_->currentIndex (), 0));
+		if (!acc)
+			return;
+
+		Util::Sequence (this, acc->FetchWholeMessage (CurrMsg_)) >>
+				[this, msg = CurrMsg_] (const auto& result)
+				{
+					if (msg != CurrMsg_)
+						return;
+
+					Util::Visit (result.AsVariant (),
+							[this] (const Message_ptr& msg) { ShowMessage (msg); },
+							[this] (auto err)
+							{
+								const auto& errMsg = Util::Visit (err,
+										[] (auto e) { return QString::fromUtf8 (e.what ()); });
+								Ui_.Preview_->append (tr ("Unable to fetch whole message: %1.")
+											.arg (errMsg));
+							});
+				};
+	}
+}
+}
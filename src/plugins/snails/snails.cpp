@@ -35,6 +35,7 @@
 #include <xmlsettingsdialog/xmlsettingsdialog.h>
 #include <interfaces/core/iiconthememanager.h>
 #include "mailtab.h"
+#include "searchtab.h"
 #include "xmlsettingsmanager.h"
 #include "accountslistwidget.h"
 #include "core.h"
@@ -74,6 +75,15 @@ namespace Snails
 			60,
 			TFOpenableByRequest
 		};
+		SearchTabClass_ =
+		{
+			"search",
+			tr ("Mail search"),
+			tr ("Allows one to search through the locally stored mail."),
+			proxy->GetIconThemeManager ()->GetIcon ("edit-find"),
+			55,
+			TFOpenableByRequest
+		};
 
 		ComposeMessageTab::SetParentPlugin (this);
 		ComposeMessageTab::SetTabClassInfo (ComposeTabClass_);
@@ -146,7 +156,8 @@ namespace Snails
 		return
 		{
 			MailTabClass_,
-			ComposeTabClass_
+			ComposeTabClass_,
+			SearchTabClass_
 		};
 	}
 
@@ -163,6 +174,11 @@ namespace Snails
 			const auto ct = ComposeTabFactory_->MakeTab ();
 			handleNewTab (ct->GetTabClassInfo ().VisibleName_, ct);
 		}
+		else if (tabClass == "search")
+		{
+			const auto st = new SearchTab { AccsMgr_.get (), Storage_.get (), SearchTabClass_, this };
+			handleNewTab (SearchTabClass_.VisibleName_, st);
+		}
 		else
 			qWarning () << Q_FUNC_INFO
 					<< "unknown tab class"
@@ -67,6 +67,7 @@ namespace Snails
 
 		TabClassInfo MailTabClass_;
 		TabClassInfo ComposeTabClass_;
+		TabClassInfo SearchTabClass_;
 
 		Util::XmlSettingsDialog_ptr XSD_;
 		Util::WkFontsWidget *WkFontsWidget_;
@@ -29,17 +29,19 @@
 
 #include "storage.h"
 #include <stdexcept>
+#include <algorithm>
 #include <QFile>
+#include <QFileInfo>
 #include <QApplication>
+#include <QDirIterator>
 #include <QtConcurrentMap>
+#include <QtConcurrentRun>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDataStream>
-#include <QtConcurrentRun>
 #include <util/db/dblock.h>
 #include <util/sys/paths.h>
-#include <util/threads/futures.h>
 #include "xmlsettingsmanager.h"
 #include "account.h"
 #include "accountdatabase.h"
@@ -58,6 +60,42 @@ namespace Snails
 			stream << t;
 			return result;
 		}
+
+		Message_ptr DeserializeMessage (const QByteArray& data)
+		{
+			const auto& msg = std::make_shared<Message> ();
+			msg->Deserialize (qUncompress (data));
+			return msg;
+		}
+
+		QList<Message_ptr> DeserializeMessages (const QList<QByteArray>& datas)
+		{
+			const auto& future = QtConcurrent::mapped (datas,
+					std::function<Message_ptr (QByteArray)>
+					{
+						[] (const QByteArray& data) -> Message_ptr
+						{
+							try
+							{
+								return DeserializeMessage (data);
+							}
+							catch (const std::exception& e)
+							{
+								qWarning () << Q_FUNC_INFO
+										<< "error deserializing the message:"
+										<< e.what ();
+								return {};
+							}
+						}
+					});
+
+			QList<Message_ptr> result;
+			result.reserve (datas.size ());
+			for (const auto& msg : future.results ())
+				if (msg)
+					result << msg;
+			return result;
+		}
 	}
 
 	Storage::Storage (QObject *parent)
@@ -68,225 +106,109 @@ namespace Snails
 		SDir_ = Util::CreateIfNotExists ("snails/storage");
 	}
 
-	namespace
+	Storage::~Storage ()
 	{
-		QList<Message_ptr> MessageSaverProc (QList<Message_ptr> msgs, const QDir& dir)
-		{
-			for (const auto& msg : msgs)
-			{
-				if (msg->GetFolderID ().isEmpty ())
-					continue;
+		IsShuttingDown_ = true;
+		BackgroundJobs_.waitForFinished ();
 
-				const QString dirName = msg->GetFolderID ().toHex ().right (3);
-
-				QDir msgDir = dir;
-				if (!dir.exists (dirName))
-					msgDir.mkdir (dirName);
-				if (!msgDir.cd (dirName))
-				{
-					qWarning () << Q_FUNC_INFO
-							<< "unable to cd into"
-							<< msgDir.filePath (dirName);
-					continue;
-				}
-
-				QFile file (msgDir.filePath (msg->GetFolderID ().toHex ()));
-				file.open (QIODevice::WriteOnly);
-				file.write (qCompress (msg->Serialize (), 9));
-			}
-
-			return msgs;
-		}
+		// Other threads' connections are closed when the threads exit.
+		AccountBases_.setLocalData ({});
 	}
 
-	void Storage::SaveMessages (Account *acc, const QStringList& folder, const QList<Message_ptr>& msgs)
+	void Storage::SaveMessages (Account *acc, const QStringList&, const QList<Message_ptr>& msgs)
 	{
-		auto dir = DirForAccount (acc);
-		for (const auto& elem : folder)
-		{
-			const auto& subdir = elem.toUtf8 ().toHex ();
-			if (!dir.exists (subdir))
-				dir.mkdir (subdir);
-
-			if (!dir.cd (subdir))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to cd to"
-						<< dir.filePath (subdir);
-				throw std::runtime_error ("Unable to cd to the directory");
-			}
-		}
-
-		for (const auto& msg : msgs)
-			PendingSaveMessages_ [acc] [msg->GetFolderID ()] = msg;
-
-		Util::Sequence (this, QtConcurrent::run (MessageSaverProc, msgs, dir)) >>
-				[this, acc] (const QList<Message_ptr>& messages)
-				{
-					auto& hash = PendingSaveMessages_ [acc];
-
-					for (const auto& msg : messages)
-						hash.remove (msg->GetFolderID ());
-				};
-
+		QList<Message_ptr> toSave;
 		for (const auto& msg : msgs)
 		{
 			if (msg->GetFolderID ().isEmpty ())
 				continue;
 
-			AddMessage (msg, acc);
+			toSave << msg;
 			UpdateCaches (msg);
 		}
+
+		BaseForAccount (acc)->AddMessages (toSave);
 	}
 
 	MessageSet Storage::LoadMessages (Account *acc)
 	{
 		MessageSet result;
-
-		const QDir& dir = DirForAccount (acc);
-		for (const auto& str : dir.entryList (QDir::NoDotAndDotDot | QDir::Dirs))
-		{
-			QDir subdir = dir;
-			if (!subdir.cd (str))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to cd to"
-						<< str;
-				continue;
-			}
-
-			for (const auto& str : subdir.entryList (QDir::NoDotAndDotDot | QDir::Files))
-			{
-				QFile file (subdir.filePath (str));
-				if (!file.open (QIODevice::ReadOnly))
-				{
-					qWarning () << Q_FUNC_INFO
-							<< "unable to open"
-							<< str
-							<< file.errorString ();
-					continue;
-				}
-
-				const auto& msg = std::make_shared<Message> ();
-				try
-				{
-					msg->Deserialize (qUncompress (file.readAll ()));
-				}
-				catch (const std::exception& e)
-				{
-					qWarning () << Q_FUNC_INFO
-							<< "error deserializing the message from"
-							<< file.fileName ()
-							<< e.what ();
-					continue;
-				}
-				result << msg;
-				UpdateCaches (msg);
-			}
-		}
-
-		for (const auto& msg : PendingSaveMessages_ [acc])
+		for (const auto& msg : DeserializeMessages (BaseForAccount (acc)->GetMessagesData ()))
 		{
 			result << msg;
 			UpdateCaches (msg);
 		}
-
 		return result;
 	}
 
-	Message_ptr Storage::LoadMessage (Account *acc, const QStringList& folder, const QByteArray& id)
+	QList<Message_ptr> Storage::LoadMessages (Account *acc, const QStringList& folder)
 	{
-		if (PendingSaveMessages_ [acc].contains (id))
-			return PendingSaveMessages_ [acc] [id];
-
-		auto dir = DirForAccount (acc);
-		for (const auto& elem : folder)
-		{
-			const auto& subdir = elem.toUtf8 ().toHex ();
-			if (!dir.cd (subdir))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to cd to"
-						<< dir.filePath (subdir);
-				throw std::runtime_error ("Unable to cd to the directory");
-			}
-		}
-
-		const auto& msg = LoadMessage (acc, dir, id);
-		UpdateCaches (msg);
-		return msg;
+		const auto& result = DeserializeMessages (BaseForAccount (acc)->GetMessagesData (folder));
+		for (const auto& msg : result)
+			UpdateCaches (msg);
+		return result;
 	}
 
-	Message_ptr Storage::LoadMessage (Account *acc, QDir dir, const QByteArray& id) const
+	QList<Message_ptr> Storage::LoadNewestUnread (Account *acc, const QStringList& folder, int limit)
 	{
-		if (PendingSaveMessages_ [acc].contains (id))
-			return PendingSaveMessages_ [acc] [id];
-
-		if (!dir.cd (id.toHex ().right (3)))
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to cd to"
-					<< dir.filePath (id.toHex ().right (3));
-			throw std::runtime_error ("Unable to cd to the directory");
-		}
+		return DeserializeMessages (BaseForAccount (acc)->GetNewestUnreadData (folder, limit));
+	}
 
-		QFile file (dir.filePath (id.toHex ()));
-		if (!file.open (QIODevice::ReadOnly))
+	Message_ptr Storage::LoadMessage (Account *acc, const QStringList& folder, const QByteArray& id)
+	{
+		const auto& data = BaseForAccount (acc)->GetMessageData (id, folder);
+		if (data.isEmpty ())
 		{
 			qWarning () << Q_FUNC_INFO
-					<< "unable to open"
-					<< file.fileName ()
-					<< file.errorString ();
-			throw std::runtime_error ("Unable to open the message file");
+					<< "no message"
+					<< id
+					<< "in"
+					<< folder;
+			throw std::runtime_error ("Unable to find the message");
 		}
 
-		const auto& msg = std::make_shared<Message> ();
+		Message_ptr msg;
 		try
 		{
-			msg->Deserialize (qUncompress (file.readAll ()));
+			msg = DeserializeMessage (data);
 		}
 		catch (const std::exception& e)
 		{
 			qWarning () << Q_FUNC_INFO
-					<< "error deserializing the message from"
-					<< file.fileName ()
+					<< "error deserializing the message"
+					<< id
 					<< e.what ();
 			throw;
 		}
 
+		UpdateCaches (msg);
 		return msg;
 	}
 
 	QList<Message_ptr> Storage::LoadMessages (Account *acc, const QStringList& folder, const QList<QByteArray>& ids)
 	{
-		auto rootDir = DirForAccount (acc);
-		for (const auto& elem : folder)
+		const auto& base = BaseForAccount (acc);
+
+		QList<QByteArray> datas;
+		datas.reserve (ids.size ());
+		for (const auto& id : ids)
 		{
-			const auto& subdir = elem.toUtf8 ().toHex ();
-			if (!rootDir.cd (subdir) &&
-					!(rootDir.mkpath (subdir) && rootDir.cd (subdir)))
+			const auto& data = base->GetMessageData (id, folder);
+			if (data.isEmpty ())
 			{
 				qWarning () << Q_FUNC_INFO
-						<< "unable to cd to"
-						<< rootDir.filePath (subdir);
-				throw std::runtime_error ("Unable to cd to the directory");
+						<< "no message"
+						<< id
+						<< "in"
+						<< folder;
+				throw std::runtime_error ("Unable to find the message");
 			}
+			datas << data;
 		}
 
-		QList<Message_ptr> result;
-		auto future = QtConcurrent::mapped (ids,
-				std::function<Message_ptr (QByteArray)>
-				{
-					[this, acc, rootDir] (const QByteArray& id)
-						{ return LoadMessage (acc, rootDir, id); }
-				});
-
-		for (const auto& item : future.results ())
-			result << item;
-
+		const auto& result = DeserializeMessages (datas);
 		for (const auto& msg : result)
 			UpdateCaches (msg);
-
 		return result;
 	}
 
@@ -295,34 +217,19 @@ namespace Snails
 		return BaseForAccount (acc)->GetIDs (folder);
 	}
 
-	void Storage::RemoveMessage (Account *acc, const QStringList& folder, const QByteArray& id)
+	QList<Message_ptr> Storage::SearchMessages (Account *acc, const QString& query, int limit)
 	{
-		PendingSaveMessages_ [acc].remove (id);
-
-		BaseForAccount (acc)->RemoveMessage (id, folder,
-				[this, acc, folder, id] { RemoveMessageFile (acc, folder, id); });
+		return DeserializeMessages (BaseForAccount (acc)->Search (query, limit));
 	}
 
-	int Storage::GetNumMessages (Account *acc) const
+	void Storage::RemoveMessage (Account *acc, const QStringList& folder, const QByteArray& id)
 	{
-		int result = 0;
-
-		const QDir& dir = DirForAccount (acc);
-		for (const auto& str : dir.entryList (QDir::NoDotAndDotDot | QDir::Dirs))
-		{
-			QDir subdir = dir;
-			if (!subdir.cd (str))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to cd to"
-						<< str;
-				continue;
-			}
-
-			result += subdir.entryList (QDir::NoDotAndDotDot | QDir::Files).size ();
-		}
+		BaseForAccount (acc)->RemoveMessage (id, folder);
+	}
 
-		return result;
+	int Storage::GetNumMessages (Account *acc)
+	{
+		return BaseForAccount (acc)->GetMessageCount ();
 	}
 
 	int Storage::GetNumMessages (Account *acc, const QStringList& folder)
@@ -335,54 +242,35 @@ namespace Snails
 		return BaseForAccount (acc)->GetUnreadMessageCount (folder);
 	}
 
-	bool Storage::HasMessagesIn (Account *acc) const
+	bool Storage::HasMessagesIn (Account *acc)
 	{
 		return GetNumMessages (acc);
 	}
 
 	bool Storage::IsMessageRead (Account *acc, const QStringList& folder, const QByteArray& id)
 	{
-		if (IsMessageRead_.contains (id))
-			return IsMessageRead_ [id];
+		{
+			QMutexLocker locker { &IsMessageReadLock_ };
+			if (IsMessageRead_.contains (id))
+				return IsMessageRead_ [id];
+		}
 
 		return LoadMessage (acc, folder, id)->IsRead ();
 	}
 
-	void Storage::RemoveMessageFile (Account *acc, const QStringList& folder, const QByteArray& id)
+	QHash<QByteArray, bool> Storage::GetReadStatuses (Account *acc, const QStringList& folder)
 	{
-		auto dir = DirForAccount (acc);
-		for (const auto& elem : folder)
-		{
-			const auto& subdir = elem.toUtf8 ().toHex ();
-			if (!dir.cd (subdir))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to cd to"
-						<< dir.filePath (subdir);
-				throw std::runtime_error ("Unable to cd to the directory");
-			}
-		}
-
-		if (!dir.cd (id.toHex ().right (3)))
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to cd to"
-					<< dir.filePath (id.toHex ().right (3));
-			throw std::runtime_error ("Unable to cd to the directory");
-		}
+		return BaseForAccount (acc)->GetReadStatuses (folder);
+	}
 
-		QFile file (dir.filePath (id.toHex ()));
-		if (!file.exists ())
-			return;
+	boost::optional<FolderSyncState> Storage::GetFolderSyncState (Account *acc, const QStringList& folder)
+	{
+		return BaseForAccount (acc)->GetFolderSyncState (folder);
+	}
 
-		qDebug () << "removing" << file.fileName () << file.size ();
-		if (!file.remove ())
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to remove the file:"
-					<< file.errorString ();
-			throw std::runtime_error ("Unable to remove the file");
-		}
+	void Storage::SetFolderSyncState (Account *acc, const QStringList& folder, const FolderSyncState& state)
+	{
+		BaseForAccount (acc)->SetFolderSyncState (folder, state);
 	}
 
 	QDir Storage::DirForAccount (Account *acc) const
@@ -405,23 +293,197 @@ namespace Snails
 
 	AccountDatabase_ptr Storage::BaseForAccount (Account *acc)
 	{
-		if (AccountBases_.contains (acc))
-			return AccountBases_ [acc];
+		auto& bases = AccountBases_.localData ();
+		if (const auto& base = bases.value (acc))
+			return base;
+
+		// Creating the tables mustn't race with another thread's connection.
+		QMutexLocker locker { &AccountsLock_ };
+
+		auto writeLock = WriteLocks_.value (acc);
+		if (!writeLock)
+			writeLock = std::make_shared<QMutex> (QMutex::Recursive);
 
 		const auto& dir = DirForAccount (acc);
-		const auto& base = std::make_shared<AccountDatabase> (dir, acc);
-		AccountBases_ [acc] = base;
+		const auto& base = std::make_shared<AccountDatabase> (dir, acc, writeLock);
+		bases [acc] = base;
+
+		if (!WriteLocks_.contains (acc))
+		{
+			WriteLocks_ [acc] = writeLock;
+
+			// Folders would look empty and the first sync would refetch
+			// everything until the old files are in, so the import is done
+			// before anybody gets the base. Other threads wait on AccountsLock_.
+			ImportLegacyFiles (base, dir);
+
+			BackgroundJobs_.addFuture (QtConcurrent::run ([this, acc] { BuildSearchIndex (acc); }));
+		}
+
 		return base;
 	}
 
-	void Storage::AddMessage (Message_ptr msg, Account *acc)
+	namespace
+	{
+		void RemoveEmptyDirs (const QDir& dir)
+		{
+			QStringList paths;
+			QDirIterator it { dir.path (), QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories };
+			while (it.hasNext ())
+				paths << it.next ();
+
+			// Children go before their parents, and non-empty dirs are left alone.
+			std::sort (paths.begin (), paths.end (),
+					[] (const QString& left, const QString& right) { return left.size () > right.size (); });
+			for (const auto& path : paths)
+				dir.rmdir (path);
+		}
+	}
+
+	void Storage::ImportLegacyFiles (const AccountDatabase_ptr& base, const QDir& dir)
+	{
+		const auto& subdirs = dir.entryList (QDir::NoDotAndDotDot | QDir::Dirs);
+		if (subdirs.isEmpty ())
+			return;
+
+		qDebug () << Q_FUNC_INFO
+				<< "importing message files from"
+				<< dir.path ();
+
+		int count = 0;
+		int failed = 0;
+		QList<Message_ptr> batch;
+		QStringList batchFiles;
+		auto flush = [&]
+		{
+			try
+			{
+				base->AddMessages (batch);
+				count += batch.size ();
+
+				for (const auto& path : batchFiles)
+					if (!QFile::remove (path))
+						qWarning () << Q_FUNC_INFO
+								<< "unable to remove"
+								<< path;
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to import"
+						<< batch.size ()
+						<< "messages:"
+						<< e.what ();
+				failed += batch.size ();
+			}
+
+			batch.clear ();
+			batchFiles.clear ();
+		};
+
+		QDirIterator it { dir.path (), QDir::Files, QDirIterator::Subdirectories };
+		while (it.hasNext ())
+		{
+			QFile file { it.next () };
+			if (QFileInfo { file }.dir () == dir)
+				continue;
+
+			if (!file.open (QIODevice::ReadOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to open"
+						<< file.fileName ()
+						<< file.errorString ();
+				++failed;
+				continue;
+			}
+
+			try
+			{
+				batch << DeserializeMessage (file.readAll ());
+				batchFiles << file.fileName ();
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "error deserializing the message from"
+						<< file.fileName ()
+						<< e.what ();
+				++failed;
+				continue;
+			}
+
+			if (batch.size () >= 1000)
+				flush ();
+		}
+		flush ();
+
+		RemoveEmptyDirs (dir);
+
+		qDebug () << Q_FUNC_INFO
+				<< "imported"
+				<< count
+				<< "messages";
+		if (failed)
+			qWarning () << Q_FUNC_INFO
+					<< failed
+					<< "message files couldn't be imported and are left in"
+					<< dir.path ();
+	}
+
+	void Storage::BuildSearchIndex (Account *acc)
 	{
 		const auto& base = BaseForAccount (acc);
-		base->AddMessage (msg);
+
+		int count = 0;
+		int lastId = 0;
+		while (!IsShuttingDown_)
+		{
+			const auto& datas = base->GetUnindexedData (lastId, 1000);
+			if (datas.isEmpty ())
+				break;
+
+			lastId = datas.last ().first;
+
+			QList<QPair<int, Message_ptr>> msgs;
+			for (const auto& pair : datas)
+				try
+				{
+					msgs << qMakePair (pair.first, DeserializeMessage (pair.second));
+				}
+				catch (const std::exception& e)
+				{
+					qWarning () << Q_FUNC_INFO
+							<< "error deserializing the message"
+							<< pair.first
+							<< e.what ();
+				}
+
+			try
+			{
+				base->IndexMessages (msgs);
+				count += msgs.size ();
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to index"
+						<< msgs.size ()
+						<< "messages:"
+						<< e.what ();
+			}
+		}
+
+		if (count)
+			qDebug () << Q_FUNC_INFO
+					<< "indexed"
+					<< count
+					<< "messages";
 	}
 
 	void Storage::UpdateCaches (Message_ptr msg)
 	{
+		QMutexLocker locker { &IsMessageReadLock_ };
 		IsMessageRead_ [msg->GetFolderID ()] = msg->IsRead ();
 	}
 }
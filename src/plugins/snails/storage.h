@@ -29,12 +29,18 @@
 
 #pragma once
 
+#include <atomic>
 #include <QObject>
 #include <QDir>
 #include <QSettings>
 #include <QHash>
 #include <QSet>
+#include <QMutex>
+#include <QThreadStorage>
+#include <QFutureSynchronizer>
+#include <boost/optional.hpp>
 #include "message.h"
+#include "common.h"
 
 namespace LeechCraft
 {
@@ -51,36 +57,54 @@ namespace Snails
 
 		QDir SDir_;
 		QSettings Settings_;
+
+		QMutex IsMessageReadLock_;
 		QHash<QByteArray, bool> IsMessageRead_;
 
-		QHash<Account*, AccountDatabase_ptr> AccountBases_;
-		QHash<Account*, QHash<QByteArray, Message_ptr>> PendingSaveMessages_;
+		/* Database connections can't be shared between threads, so
+		 * each thread gets its own connection to each account base.
+		 */
+		QThreadStorage<QHash<Account*, AccountDatabase_ptr>> AccountBases_;
+
+		QMutex AccountsLock_;
+		QHash<Account*, std::shared_ptr<QMutex>> WriteLocks_;
+
+		QFutureSynchronizer<void> BackgroundJobs_;
+		std::atomic_bool IsShuttingDown_ { false };
 	public:
 		Storage (QObject* = nullptr);
+		~Storage ();
 
 		void SaveMessages (Account*, const QStringList& folders, const QList<Message_ptr>&);
 
 		MessageSet LoadMessages (Account*);
+		QList<Message_ptr> LoadMessages (Account*, const QStringList& folder);
 		Message_ptr LoadMessage (Account*, const QStringList& folder, const QByteArray& id);
 		QList<Message_ptr> LoadMessages (Account*, const QStringList& folder, const QList<QByteArray>& ids);
+		QList<Message_ptr> LoadNewestUnread (Account*, const QStringList& folder, int limit);
 
 		QList<QByteArray> LoadIDs (Account*, const QStringList& folder);
+
+		QList<Message_ptr> SearchMessages (Account*, const QString& query, int limit = 500);
 		void RemoveMessage (Account*, const QStringList&, const QByteArray&);
 
-		int GetNumMessages (Account*) const;
+		int GetNumMessages (Account*);
 		int GetNumMessages (Account*, const QStringList& folder);
 		int GetNumUnread (Account*, const QStringList& folder);
-		bool HasMessagesIn (Account*) const;
+		bool HasMessagesIn (Account*);
 
 		bool IsMessageRead (Account*, const QStringList& folder, const QByteArray&);
-	private:
-		Message_ptr LoadMessage (Account*, QDir, const QByteArray&) const;
-		void RemoveMessageFile (Account*, const QStringList&, const QByteArray&);
+		QHash<QByteArray, bool> GetReadStatuses (Account*, const QStringList& folder);
+
+		boost::optional<FolderSyncState> GetFolderSyncState (Account*, const QStringList& folder);
+		void SetFolderSyncState (Account*, const QStringList& folder, const FolderSyncState&);
 	private:
 		QDir DirForAccount (Account*) const;
 		AccountDatabase_ptr BaseForAccount (Account*);
 
-		void AddMessage (Message_ptr, Account*);
+		void ImportLegacyFiles (const AccountDatabase_ptr&, const QDir&);
+		void BuildSearchIndex (Account*);
+
 		void UpdateCaches (Message_ptr);
 	};
 }
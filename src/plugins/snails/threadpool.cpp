@@ -51,9 +51,10 @@ namespace Snails
 			[this, thread] (const auto& result)
 			{
 				RunScheduled (thread.get ());
+				RunBackground ();
 
 				Util::Visit (result.AsVariant (),
-						[] (Util::Void) {},
+						[this] (Util::Void) { StartListening (); },
 						[this] (const auto& err)
 						{
 							Util::Visit (err,
@@ -74,6 +75,18 @@ namespace Snails
 		return GetNextThread ();
 	}
 
+	void ThreadPool::SetListenedFolder (const QStringList& folder)
+	{
+		if (folder == ListenedFolder_)
+			return;
+
+		ListenedFolder_ = folder;
+
+		if (ListeningThread_)
+			ListeningThread_->Schedule (TaskPriority::Low,
+					&AccountThreadWorker::SetListenedFolder, folder);
+	}
+
 	void ThreadPool::RunThreads ()
 	{
 		if (CheckingNext_)
@@ -104,6 +117,7 @@ namespace Snails
 						{
 							ExistingThreads_ << thread;
 							RunScheduled (thread.get ());
+							RunBackground ();
 						},
 						[this, thread] (const auto& err)
 						{
@@ -127,6 +141,80 @@ namespace Snails
 			};
 	}
 
+	void ThreadPool::StartListening ()
+	{
+		if (ListeningThread_)
+			return;
+
+		const auto thread = std::make_shared<AccountThread> (true,
+				"ListeningThread", CertList_, Acc_, Storage_);
+		ListeningThread_ = thread;
+
+		thread->start (QThread::LowPriority);
+		thread->Schedule (TaskPriority::Low, &AccountThreadWorker::SetListenedFolder, ListenedFolder_);
+
+		Util::Sequence (this, thread->Schedule (TaskPriority::Low, &AccountThreadWorker::TestConnectivity)) >>
+			[this, thread] (const auto& result)
+			{
+				Util::Visit (result.AsVariant (),
+						[] (Util::Void) {},
+						[this, thread] (const auto& err)
+						{
+							Util::Visit (err,
+									[this, thread] (const vmime::exceptions::authentication_error& err)
+									{
+										qWarning () << Q_FUNC_INFO
+												<< "listening connection refused:"
+												<< err.what ()
+												<< "; changes will only be fetched on sync";
+										HandleThreadOverflow (thread);
+										if (ListeningThread_ == thread)
+											ListeningThread_.reset ();
+									},
+									[] (const auto& e) { qWarning () << Q_FUNC_INFO << e.what (); });
+						});
+			};
+	}
+
+	void ThreadPool::RunBackground ()
+	{
+		if (RunningBackground_ ||
+				ScheduledBackground_.isEmpty () ||
+				!Scheduled_.isEmpty () ||
+				ExistingThreads_.isEmpty ())
+			return;
+
+		/* Background tasks never open new connections, so they just wait
+		 * for an existing one to become idle.
+		 */
+		const auto thread = GetNextThread ();
+		if (thread->GetQueueSize ())
+		{
+			if (!BackgroundRecheckPending_)
+			{
+				BackgroundRecheckPending_ = true;
+				Util::ExecuteLater ([this]
+						{
+							BackgroundRecheckPending_ = false;
+							RunBackground ();
+						},
+						500);
+			}
+			return;
+		}
+
+		RunningBackground_ = true;
+		ScheduledBackground_.takeFirst () (thread);
+	}
+
+	void ThreadPool::HandleTaskFinished (TaskPriority prio)
+	{
+		if (prio == TaskPriority::Background)
+			RunningBackground_ = false;
+
+		RunBackground ();
+	}
+
 	AccountThread_ptr ThreadPool::CreateThread ()
 	{
 		const auto& threadName = "PooledThread_" + QString::number (ExistingThreads_.size ());
@@ -53,17 +53,33 @@ namespace Snails
 
 		QList<AccountThread_ptr> ExistingThreads_;
 
+		/* Keeps the listened folder selected and reports the changes in
+		 * it, never runs the scheduled tasks.
+		 *
+		 * It's started only after the first pooled connection succeeds,
+		 * so it never takes the only connection the server allows, and
+		 * it's dropped if the server refuses it.
+		 */
+		AccountThread_ptr ListeningThread_;
+		QStringList ListenedFolder_;
+
 		bool HitLimit_ = false;
 		bool CheckingNext_ = false;
 
 		QList<std::function<void (AccountThread*)>> Scheduled_;
 
+		QList<std::function<void (AccountThread*)>> ScheduledBackground_;
+		bool RunningBackground_ = false;
+		bool BackgroundRecheckPending_ = false;
+
 		QList<std::function<void (AccountThread*)>> ThreadInitializers_;
 	public:
 		ThreadPool (const CertList_t&, Account*, Storage*);
 
 		AccountThread* GetThread ();
 
+		void SetListenedFolder (const QStringList&);
+
 		template<typename F, typename... Args>
 		QFuture<WrapFunctionType_t<F, Args...>> Schedule (TaskPriority prio, const F& func, const Args&... args)
 		{
@@ -83,6 +99,10 @@ namespace Snails
 			case TaskPriority::Low:
 				Scheduled_.append (runner);
 				break;
+			case TaskPriority::Background:
+				ScheduledBackground_.append (runner);
+				RunBackground ();
+				return iface.future ();
 			}
 
 			RunThreads ();
@@ -109,6 +129,7 @@ namespace Snails
 						if (result.IsRight ())
 						{
 							iface.reportFinished (&result);
+							HandleTaskFinished (prio);
 							return;
 						}
 
@@ -124,17 +145,26 @@ namespace Snails
 										PerformScheduledFunc (GetNextThread (), iface, prio, func, args...);
 									}
 									else
+									{
 										iface.reportFinished (&result);
+										HandleTaskFinished (prio);
+									}
 								},
 								[=, &iface] (auto)
 								{
 									iface.reportFinished (&result);
+									HandleTaskFinished (prio);
 								});
 					};
 		}
 
 		void RunThreads ();
 
+		void StartListening ();
+
+		void RunBackground ();
+		void HandleTaskFinished (TaskPriority);
+
 		AccountThread_ptr CreateThread ();
 
 		void RunScheduled (AccountThread*);